@@ -267,7 +267,9 @@ aio_insert(AIOCallback *op, AIO_Reqs *req)
   num_requests++;
   req->queued++;
 #endif
-  if (op->aiocb.aio_reqprio == AIO_LOWEST_PRIORITY)     // http request
+  if (op->aiocb.aio_reqprio < AIO_LOWEST_PRIORITY) {   // background
+    req->background_aio_todo.enqueue(op);
+  } else if (op->aiocb.aio_reqprio == AIO_LOWEST_PRIORITY)     // http request
   {
     AIOCallback *cb = (AIOCallback *) req->http_aio_todo.tail;
     if (!cb)
@@ -487,7 +489,17 @@ aio_thread_main(void *arg)
       /* check if any pending requests on the atomic list */
       if (!INK_ATOMICLIST_EMPTY(my_aio_req->aio_temp_list))
         aio_move(my_aio_req);
-      if (!(op = my_aio_req->aio_todo.pop()) && !(op = my_aio_req->http_aio_todo.pop()))
+      /* background requests go last, but not forever: one is served
+         after every AIO_BACKGROUND_MAX_PASSED requests that went ahead */
+      if (my_aio_req->background_aio_todo.head && my_aio_req->background_passed >= AIO_BACKGROUND_MAX_PASSED) {
+        op = my_aio_req->background_aio_todo.pop();
+        my_aio_req->background_passed = 0;
+      } else if ((op = my_aio_req->aio_todo.pop()) || (op = my_aio_req->http_aio_todo.pop())) {
+        if (my_aio_req->background_aio_todo.head)
+          my_aio_req->background_passed++;
+      } else if ((op = my_aio_req->background_aio_todo.pop())) {
+        my_aio_req->background_passed = 0;
+      } else
         break;
 #ifdef AIO_STATS
       num_requests--;
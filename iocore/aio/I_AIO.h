@@ -58,6 +58,10 @@
 
 #define AIO_LOWEST_PRIORITY      0
 #define AIO_DEFAULT_PRIORITY     AIO_LOWEST_PRIORITY
+// served after the other requests queued for the disk, but at least
+// once every AIO_BACKGROUND_MAX_PASSED requests
+#define AIO_BACKGROUND_PRIORITY  (-1)
+#define AIO_BACKGROUND_MAX_PASSED 64
 
 struct AIOCallback: public Continuation
 {
@@ -85,6 +85,7 @@ struct AIO_Reqs
 {
   Que(AIOCallback, link) aio_todo;       /* queue for holding non-http requests */
   Que(AIOCallback, link) http_aio_todo;  /* queue for http requests */
+  Que(AIOCallback, link) background_aio_todo;  /* queue for background writes (directory sync) */
   /* Atomic list to temporarily hold the request if the
      lock for a particular queue cannot be acquired */
   InkAtomicList aio_temp_list;
@@ -95,6 +96,7 @@ struct AIO_Reqs
   volatile int queued;          /* total number of aio_todo and http_todo requests */
   volatile int filedes;         /* the file descriptor for the requests */
   volatile int requests_queued;
+  int background_passed;         /* requests served ahead of a waiting background request */
 };
 
 #ifdef AIO_STATS
@@ -59,6 +59,7 @@ int cache_config_ram_cache_compress_percent = 90;
 int cache_config_ram_cache_use_seen_filter = 0;
 int cache_config_http_max_alts = 3;
 int cache_config_dir_sync_frequency = 60;
+int64_t cache_config_dir_sync_max_write_rate = 0;
 int cache_config_permit_pinning = 0;
 int cache_config_vary_on_user_agent = 0;
 int cache_config_select_alternate = 1;
@@ -119,6 +120,7 @@ volatile int CacheProcessor::start_done = 0;
 int CacheProcessor::clear = 0;
 int CacheProcessor::fix = 0;
 int CacheProcessor::start_internal_flags = 0;
+static ink_hrtime cache_start_time = 0;
 int CacheProcessor::auto_clear_flag = 0;
 CacheProcessor cacheProcessor;
 Vol **gvol = NULL;
@@ -429,7 +431,7 @@ CacheVC::set_http_info(CacheHTTPInfo *ainfo)
     // don't know the total len yet
   }
   if (enable_cache_empty_http_doc) {
-    MIMEField *field = ainfo->m_alt->m_response_hdr.
+    MIMEField *field = ainfo->response_get()->
       field_find(MIME_FIELD_CONTENT_LENGTH, MIME_LEN_CONTENT_LENGTH);
     if (field && !field->value_get_int64())
       f.force_empty = 1;
@@ -739,6 +741,7 @@ CacheProcessor::start_internal(int flags)
 #endif
 
   start_internal_flags = flags;
+  cache_start_time = ink_get_hrtime();
   clear = !!(flags & PROCESSOR_RECONFIGURE) || auto_clear_flag;
   fix = !!(flags & PROCESSOR_FIX);
   int i;
@@ -1199,6 +1202,25 @@ CacheProcessor::cacheInitialized()
       GLOBAL_CACHE_SET_DYN_STAT(cache_bytes_total_stat, total_cache_bytes);
       GLOBAL_CACHE_SET_DYN_STAT(cache_direntries_total_stat, total_direntries);
       GLOBAL_CACHE_SET_DYN_STAT(cache_direntries_used_stat, used_direntries);
+
+      // startup breakdown, vols come up in parallel so report the slowest
+      ink_hrtime dir_read_time = 0, recover_time = 0;
+      int64_t clean_vols = 0;
+      for (i = 0; i < gnvol; i++) {
+        vol = gvol[i];
+        if (vol->dir_read_done && vol->dir_read_done - vol->init_start > dir_read_time)
+          dir_read_time = vol->dir_read_done - vol->init_start;
+        if (vol->dir_read_done && vol->recover_done && vol->recover_done - vol->dir_read_done > recover_time)
+          recover_time = vol->recover_done - vol->dir_read_done;
+        if (vol->clean_start)
+          clean_vols++;
+      }
+      GLOBAL_CACHE_SET_DYN_STAT(cache_startup_dir_read_time_stat, dir_read_time / HRTIME_MSECOND);
+      GLOBAL_CACHE_SET_DYN_STAT(cache_startup_recover_time_stat, recover_time / HRTIME_MSECOND);
+      GLOBAL_CACHE_SET_DYN_STAT(cache_startup_total_time_stat, (ink_get_hrtime() - cache_start_time) / HRTIME_MSECOND);
+      GLOBAL_CACHE_SET_DYN_STAT(cache_startup_clean_vols_stat, clean_vols);
+      Note("cache startup took %" PRId64 " ms, %" PRId64 " of %d vols skipped recovery",
+           (int64_t)((ink_get_hrtime() - cache_start_time) / HRTIME_MSECOND), clean_vols, gnvol);
       dir_sync_init();
       cache_init_ok = 1;
     } else
@@ -1264,7 +1286,10 @@ Vol::db_check(bool fix)
 static void
 vol_init_data_internal(Vol *d)
 {
-  d->buckets = ((d->len - (d->start - d->skip)) / cache_config_min_average_object_size) / DIR_DEPTH;
+  int avg_obj_size = cache_config_min_average_object_size;
+  if (d->cache_vol && d->cache_vol->avg_obj_size)
+    avg_obj_size = d->cache_vol->avg_obj_size;
+  d->buckets = ((d->len - (d->start - d->skip)) / avg_obj_size) / DIR_DEPTH;
   d->segments = (d->buckets + (((1<<16)-1)/DIR_DEPTH)) / ((1<<16)/DIR_DEPTH);
   d->buckets = (d->buckets + d->segments - 1) / d->segments;
   d->start = d->skip + 2 *vol_dirlen(d);
@@ -1318,6 +1343,7 @@ vol_clear_init(Vol *d)
 {
   size_t dir_len = vol_dirlen(d);
   memset(d->raw_dir, 0, dir_len);
+  memset(d->sync_dirty, SYNC_DIRTY_BOTH, d->segments);
   vol_init_dir(d);
   d->header->magic = VOL_MAGIC;
   d->header->version.ink_major = CACHE_DB_MAJOR_VERSION;
@@ -1329,6 +1355,9 @@ vol_clear_init(Vol *d)
   d->header->create_time = time(NULL);
   d->header->dirty = 0;
   d->sector_size = d->header->sector_size = d->disk->hw_sector_size;
+#ifdef HTTP_CACHE
+  d->header->url_hash_method = url_hash_method;
+#endif
   *d->footer = *d->header;
 
 #ifdef SSD_CACHE
@@ -1387,6 +1416,7 @@ Vol::init(char *s, off_t blocks, off_t dir_skip, bool clear)
   skip = dir_skip;
   int i;
   prev_recover_pos = 0;
+  init_start = ink_get_hrtime();
 
   // successive approximation, directory/meta data eats up some storage
   start = dir_skip;
@@ -1405,6 +1435,9 @@ Vol::init(char *s, off_t blocks, off_t dir_skip, bool clear)
   dir = (Dir *) (raw_dir + vol_headerlen(this));
   header = (VolHeaderFooter *) raw_dir;
   footer = (VolHeaderFooter *) (raw_dir + vol_dirlen(this) - ROUND_TO_STORE_BLOCK(sizeof(VolHeaderFooter)));
+  // neither copy on disk is known to match until it has been written once
+  sync_dirty = (unsigned char *)ats_malloc(segments);
+  memset(sync_dirty, SYNC_DIRTY_BOTH, segments);
 
 #ifdef SSD_CACHE
   num_ssd_vols = good_ssd_disks;
@@ -1495,12 +1528,25 @@ Vol::handle_dir_read(int event, void *data)
     }
   }
 
+  dir_read_done = ink_get_hrtime();
   if (header->magic != VOL_MAGIC || header->version.ink_major != CACHE_DB_MAJOR_VERSION || footer->magic != VOL_MAGIC) {
     Warning("bad footer in cache directory for '%s', clearing", hash_id);
     Note("clearing cache directory '%s'", hash_id);
     clear_dir();
     return EVENT_DONE;
   }
+#ifdef HTTP_CACHE
+  // Documents keyed with another hash can never be found again, so
+  // reclaim the space now rather than waiting for them to be overwritten.
+  // This takes the objects plugins keyed through the API with them; the
+  // directory doesn't record which keys came from a url.
+  if (header->url_hash_method != (uint32_t) url_hash_method) {
+    Note("cache directory '%s' was keyed with url_hash_method %u, now %d, clearing",
+         hash_id, header->url_hash_method, url_hash_method);
+    clear_dir();
+    return EVENT_DONE;
+  }
+#endif
   CHECK_DIR(this);
 
   sector_size = header->sector_size;
@@ -1579,6 +1625,21 @@ Vol::handle_recover_from_data(int event, void *data)
       SET_HANDLER(&Vol::handle_recover_write_dir);
       return handle_recover_write_dir(EVENT_IMMEDIATE, 0);
     }
+    if (header->clean_shutdown == VOL_CLEAN_SHUTDOWN && footer->clean_shutdown == VOL_CLEAN_SHUTDOWN) {
+      /* The directory was written by sync_cache_dir_on_shutdown() after the
+         last agg write, so there is nothing to scan. Only clear the window
+         after write_pos that an in flight write could have touched, and
+         rewrite the directory without the marker so that a crash from here
+         on goes through the full recovery. */
+      if (is_debug_tag_set("cache_init"))
+        Note("clean shutdown marker found for '%s', skipping recovery", hash_id);
+      header->clean_shutdown = footer->clean_shutdown = 0;
+      clean_start = true;
+      io.aiocb.aio_buf = NULL;
+      recover_wrapped = 0;
+      recover_pos = header->write_pos;
+      goto Ldone;
+    }
     // initialize
     recover_wrapped = 0;
     last_sync_serial = 0;
@@ -1824,6 +1885,7 @@ Vol::handle_recover_write_dir(int event, void *data)
   delete init_info;
   init_info = 0;
   set_io_not_in_progress();
+  recover_done = ink_get_hrtime();
   scan_pos = header->write_pos;
   periodic_scan();
   SET_HANDLER(&Vol::dir_init_done);
@@ -2453,7 +2515,7 @@ static bool unmarshal_helper(Doc *doc, Ptr<IOBufferData> &buf, int &okay) {
   char *tmp = doc->hdr();
   int len = doc->hlen;
   while (len > 0) {
-    int r = HTTPInfo::unmarshal(tmp, len, buf._ptr());
+    int r = HTTPInfo::unmarshal_lazy(tmp, len, buf._ptr());
     if (r < 0) {
       ink_assert(!"CacheVC::handleReadDone unmarshal failed");
       okay = 0;
@@ -2980,6 +3042,7 @@ cplist_update()
         int size_in_blocks = config_vol->size << (20 - STORE_BLOCK_SHIFT);
         if ((cp->size <= size_in_blocks) && (cp->scheme == config_vol->scheme)) {
           config_vol->cachep = cp;
+          cp->avg_obj_size = config_vol->avg_obj_size;
         } else {
           /* delete this volume from all the disks */
           int d_no;
@@ -3120,6 +3183,7 @@ cplist_reconfigure()
         CacheVol *new_cp = NEW(new CacheVol());
         new_cp->disk_vols = (DiskVol **)ats_malloc(gndisks * sizeof(DiskVol *));
         memset(new_cp->disk_vols, 0, gndisks * sizeof(DiskVol *));
+        new_cp->avg_obj_size = config_vol->avg_obj_size;
         if (create_volume(config_vol->number, size_in_blocks, config_vol->scheme, new_cp))
           return -1;
         cp_list.enqueue(new_cp);
@@ -3385,6 +3449,15 @@ register_cache_stats(RecRawStatBlock *rsb, const char *prefix)
   REG_INT("hdr_marshal_bytes", cache_hdr_marshal_bytes_stat);
   REG_INT("gc_bytes_evacuated", cache_gc_bytes_evacuated_stat);
   REG_INT("gc_frags_evacuated", cache_gc_frags_evacuated_stat);
+  REG_INT("startup.dir_read_msec", cache_startup_dir_read_time_stat);
+  REG_INT("startup.recover_msec", cache_startup_recover_time_stat);
+  REG_INT("startup.total_msec", cache_startup_total_time_stat);
+  REG_INT("startup.clean_vols", cache_startup_clean_vols_stat);
+  REG_INT("dir_sync.bytes_written", cache_dir_sync_bytes_stat);
+  REG_INT("dir_sync.last_interval_bytes", cache_dir_sync_interval_bytes_stat);
+  REG_INT("dir_sync.segments_skipped", cache_dir_sync_segments_skipped_stat);
+  REG_INT("write.doc_bytes", cache_write_doc_bytes_stat);
+  REG_INT("write.disk_bytes", cache_write_disk_bytes_stat);
 }
 
 
@@ -3416,6 +3489,7 @@ ink_cache_init(ModuleVersion v)
 
   IOCORE_EstablishStaticConfigInt32(cache_config_dir_sync_frequency, "proxy.config.cache.dir.sync_frequency");
   Debug("cache_init", "proxy.config.cache.dir.sync_frequency = %d", cache_config_dir_sync_frequency);
+  IOCORE_EstablishStaticConfigInteger(cache_config_dir_sync_max_write_rate, "proxy.config.cache.dir.sync_max_write_rate");
 
   IOCORE_EstablishStaticConfigInt32(cache_config_vary_on_user_agent, "proxy.config.cache.vary_on_user_agent");
   Debug("cache_init", "proxy.config.cache.vary_on_user_agent = %d", cache_config_vary_on_user_agent);
@@ -3465,10 +3539,9 @@ ink_cache_init(ModuleVersion v)
     cache_config_target_fragment_size = DEFAULT_TARGET_FRAGMENT_SIZE;
 
 #ifdef HTTP_CACHE
-  extern int url_hash_method;
-
   //  # 0 - MD5 hash
   //  # 1 - MMH hash
+  //  # 2 - MurmurHash3 (x64, 128 bit)
   IOCORE_EstablishStaticConfigInt32(url_hash_method, "proxy.config.cache.url_hash_method");
   Debug("cache_init", "proxy.config.cache.url_hash_method = %d", url_hash_method);
   IOCORE_EstablishStaticConfigInt32(enable_cache_empty_http_doc, "proxy.config.cache.enable_empty_http_doc");
@@ -3728,7 +3801,7 @@ CacheWriterEntry::get_writer_meta(CacheVC *vc, bool *header_only)
       return 1;
     }
     float Q = HttpTransactCache::calculate_quality_of_match(vc->params, &vc->request,
-        &tmp_alt.m_alt->m_request_hdr, &tmp_alt.m_alt->m_response_hdr);
+        tmp_alt.request_get(), tmp_alt.response_get());
     if (Q > 0) {
       vc->alternate.copy_shallow(&tmp_alt);
       vc->doc_len = nbytes;
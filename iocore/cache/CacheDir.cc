@@ -45,6 +45,15 @@ ProxyMutex *mutex = _m; \
 CACHE_INCREMENT_DYN_STAT(cache_directory_collision_count_stat); \
 } while (0);
 
+// Every change to a segment goes through dir_insert, dir_overwrite,
+// dir_delete_entry or dir_init_segment (freelist_clean and dir_clear_range
+// finish through dir_delete_entry), so this is where CacheSync learns
+// which segments are stale in each directory copy.
+#define DIR_SEGMENT_DIRTY(_s, _d) do { \
+(_d)->header->dirty = 1; \
+(_d)->sync_dirty[_s] = SYNC_DIRTY_BOTH; \
+} while (0)
+
 
 // Globals
 
@@ -209,6 +218,7 @@ dir_init_segment(int s, Vol *d)
   d->header->freelist[s] = 0;
   Dir *seg = dir_segment(s, d);
   int l, b;
+  DIR_SEGMENT_DIRTY(s, d);
   memset(seg, 0, SIZEOF_DIR * DIR_DEPTH * d->buckets);
   for (l = 1; l < DIR_DEPTH; l++) {
     for (b = 0; b < d->buckets; b++) {
@@ -302,7 +312,7 @@ dir_delete_entry(Dir *e, Dir *p, int s, Vol *d)
 {
   Dir *seg = dir_segment(s, d);
   int no = dir_next(e);
-  d->header->dirty = 1;
+  DIR_SEGMENT_DIRTY(s, d);
   if (p) {
     unsigned int fo = d->header->freelist[s];
     unsigned int eo = dir_to_offset(e, seg);
@@ -737,7 +747,7 @@ Lfill:
          e, key->word(0), d->fd, bi, e, key->word(1), dir_tag(e), dir_offset(e));
   DDebug("dir_show", "%x,%x,%x,%x,%x", b->w[0], b->w[1], b->w[2], b->w[3], b->w[4]);
   CHECK_DIR(d);
-  d->header->dirty = 1;
+  DIR_SEGMENT_DIRTY(s, d);
   CACHE_INC_DIR_USED(d->mutex);
   return 1;
 }
@@ -811,7 +821,7 @@ Lfill:
         "overwrite %p %X into vol %d bucket %d at %p tag %X %X boffset %" PRId64 "",
          e, key->word(0), d->fd, bi, e, t, dir_tag(e), dir_offset(e));
   CHECK_DIR(d);
-  d->header->dirty = 1;
+  DIR_SEGMENT_DIRTY(s, d);
   return res;
 }
 
@@ -976,6 +986,8 @@ CacheSync::aio_write(int fd, char *b, int n, off_t o)
   io.aiocb.aio_offset = o;
   io.aiocb.aio_nbytes = n;
   io.aiocb.aio_buf = b;
+  // queue behind client reads on the same disk
+  io.aiocb.aio_reqprio = AIO_BACKGROUND_PRIORITY;
   io.action = this;
   io.thread = AIO_CALLBACK_THREAD_ANY;
   ink_assert(ink_aio_write(&io) >= 0);
@@ -1034,7 +1046,14 @@ sync_cache_dir_on_shutdown(void)
     }
     size_t dirlen = vol_dirlen(d);
     if (!d->header->dirty && !d->dir_sync_in_progress) {
-      Debug("cache_dir_sync", "Dir %s: ignoring -- not dirty", d->hash_id);
+      // the copy on disk is current, only stamp the clean shutdown marker on it
+      Debug("cache_dir_sync", "Dir %s: not dirty, marking clean shutdown", d->hash_id);
+      size_t footerlen = ROUND_TO_STORE_BLOCK(sizeof(VolHeaderFooter));
+      off_t start = d->skip + ((d->header->sync_serial & 1) ? dirlen : 0);
+      d->header->clean_shutdown = d->footer->clean_shutdown = VOL_CLEAN_SHUTDOWN;
+      size_t h = pwrite(d->fd, d->raw_dir, footerlen, start);
+      size_t f = pwrite(d->fd, d->raw_dir + dirlen - footerlen, footerlen, start + dirlen - footerlen);
+      ink_debug_assert(h == footerlen && f == footerlen);
       continue;
     }
 #ifdef HIT_EVACUATE
@@ -1099,6 +1118,8 @@ sync_cache_dir_on_shutdown(void)
       Debug("cache_dir_sync", "Periodic dir sync in progress -- overwriting");
     }
     d->footer->sync_serial = d->header->sync_serial;
+    // nothing can be written behind this directory, let the next startup skip recovery
+    d->header->clean_shutdown = d->footer->clean_shutdown = VOL_CLEAN_SHUTDOWN;
 
 #ifdef SSD_CACHE
       for (int j = 0; j < d->num_ssd_vols; j++) {
@@ -1121,6 +1142,49 @@ sync_cache_dir_on_shutdown(void)
 
 
 
+/*
+ * Token bucket for the periodic directory sync. Returns how long to
+ * wait before n bytes may be written, 0 if they can go now.
+ */
+ink_hrtime
+CacheSync::throttle(int64_t n)
+{
+  int64_t rate = cache_config_dir_sync_max_write_rate;
+  if (rate <= 0)
+    return 0;
+  int64_t burst = rate > SYNC_MAX_WRITE ? rate : SYNC_MAX_WRITE;
+  ink_hrtime now = ink_get_hrtime();
+  ink_hrtime elapsed = now - last_refill;
+  last_refill = now;
+  if (elapsed >= HRTIME_SECOND)
+    tokens = burst;
+  else
+    tokens += elapsed * rate / HRTIME_SECOND;
+  if (tokens > burst)
+    tokens = burst;
+  if (tokens >= n) {
+    tokens -= n;
+    return 0;
+  }
+  return (n - tokens) * HRTIME_SECOND / rate + 1;
+}
+
+// void CacheSync::abort_sync(Vol *d)
+//
+//   A copy that was not completely written is not valid on disk and its
+//   dirty segments were cleared when it was started. Mark them dirty
+//   again, and the directory, so the next sync of that copy writes
+//   them. Called with the volume locked.
+//
+void
+CacheSync::abort_sync(Vol *d)
+{
+  for (int i = 0; i < d->segments && i < segslen; i++)
+    d->sync_dirty[i] |= segs[i];
+  d->header->dirty = 1;
+  d->dir_sync_in_progress = 0;
+}
+
 int
 CacheSync::mainEvent(int event, Event *e)
 {
@@ -1140,6 +1204,8 @@ Lrestart:
       buf = 0;
       buflen = 0;
     }
+    GLOBAL_CACHE_SET_DYN_STAT(cache_dir_sync_interval_bytes_stat, interval_bytes);
+    interval_bytes = 0;
     Debug("cache_dir_sync", "sync done");
     if (event == EVENT_INTERVAL)
       trigger = e->ethread->schedule_in(this, HRTIME_SECONDS(cache_config_dir_sync_frequency));
@@ -1151,11 +1217,16 @@ Lrestart:
     // AIO Thread
     if (io.aio_result != (int64_t)io.aiocb.aio_nbytes) {
       Warning("vol write error during directory sync '%s'", gvol[vol]->hash_id);
+      // the segments have to be put back under the volume lock
+      failed = true;
       event = EVENT_NONE;
-      goto Ldone;
+    } else {
+      GLOBAL_CACHE_SUM_GLOBAL_DYN_STAT(cache_dir_sync_bytes_stat, io.aiocb.aio_nbytes);
+      interval_bytes += io.aiocb.aio_nbytes;
+      // with a rate limit the token bucket does the pacing
+      trigger = eventProcessor.schedule_in(this, cache_config_dir_sync_max_write_rate > 0 ? 0 : SYNC_DELAY);
+      return EVENT_CONT;
     }
-    trigger = eventProcessor.schedule_in(this, SYNC_DELAY);
-    return EVENT_CONT;
   }
   {
     CACHE_TRY_LOCK(lock, gvol[vol]->mutex, mutex->thread_holding);
@@ -1170,10 +1241,14 @@ Lrestart:
     d->hit_evacuate_window = (d->data_blocks * cache_config_hit_evacuate_percent) / 100;
 #endif
 
-    if (DISK_BAD(d->disk))
+    if (failed || DISK_BAD(d->disk)) {
+      if (writepos)
+        abort_sync(d);
       goto Ldone;
+    }
 
-    int headerlen = ROUND_TO_STORE_BLOCK(sizeof(VolHeaderFooter));
+    int headerlen = vol_headerlen(d);
+    int footerlen = ROUND_TO_STORE_BLOCK(sizeof(VolHeaderFooter));
     size_t dirlen = vol_dirlen(d);
     if (!writepos) {
       // start
@@ -1211,6 +1286,11 @@ Lrestart:
         buf = (char *)ats_memalign(sysconf(_SC_PAGESIZE), dirlen);
         buflen = dirlen;
       }
+      if (segslen < d->segments) {
+        ats_free(segs);
+        segs = (unsigned char *)ats_malloc(d->segments);
+        segslen = d->segments;
+      }
       d->header->sync_serial++;
       d->footer->sync_serial = d->header->sync_serial;
 
@@ -1222,36 +1302,76 @@ Lrestart:
 
       CHECK_DIR(d);
       memcpy(buf, d->raw_dir, dirlen);
+      /* The copy we are about to overwrite was last written two syncs ago,
+         so only the segments changed since then need to go out. Changes
+         made after this snapshot mark the segment dirty again. */
+      int dirty_bit = SYNC_DIRTY(d->header->sync_serial & 1);
+      for (int i = 0; i < d->segments; i++) {
+        segs[i] = d->sync_dirty[i] & dirty_bit;
+        d->sync_dirty[i] &= ~dirty_bit;
+      }
+      segment = 0;
       d->dir_sync_in_progress = 1;
     }
     size_t B = d->header->sync_serial & 1;
     off_t start = d->skip + (B ? dirlen : 0);
-
-    if (!writepos) {
-      // write header
-      aio_write(d->fd, buf + writepos, headerlen, start + writepos);
-      writepos += headerlen;
-    } else if (writepos < (off_t)dirlen - headerlen) {
-      // write part of body
-      int l = SYNC_MAX_WRITE;
-      if (writepos + l > (off_t)dirlen - headerlen)
-        l = dirlen - headerlen - writepos;
-      aio_write(d->fd, buf + writepos, l, start + writepos);
-      writepos += l;
-    } else if (writepos < (off_t)dirlen) {
-      ink_assert(writepos == (off_t)dirlen - headerlen);
-      // write footer
-      aio_write(d->fd, buf + writepos, headerlen, start + writepos);
-      writepos += headerlen;
-    } else {
+    off_t bodyend = (off_t)dirlen - footerlen;
+    off_t o = writepos, next = writepos;
+    int next_segment = segment;
+
+    // header (including the segment freelists) first, then the dirty
+    // segments and the footer last, so a partial sync is never valid
+    if (writepos < headerlen) {
+      next = writepos + SYNC_MAX_WRITE;
+      if (next > headerlen)
+        next = headerlen;
+    } else if (writepos < bodyend) {
+      int64_t seglen = (int64_t) d->buckets * DIR_DEPTH * SIZEOF_DIR;
+      while (next_segment < d->segments && !segs[next_segment])
+        next_segment++;
+      GLOBAL_CACHE_SUM_GLOBAL_DYN_STAT(cache_dir_sync_segments_skipped_stat, next_segment - segment);
+      if (next_segment >= d->segments) {
+        segment = next_segment;
+        writepos = bodyend;
+        o = next = bodyend;
+      } else {
+        // coalesce adjacent dirty segments, rounding out to whole store blocks
+        o = headerlen + ROUND_DOWN_TO_STORE_BLOCK(next_segment * seglen);
+        int end_segment = next_segment + 1;
+        while (end_segment < d->segments && segs[end_segment] &&
+               (end_segment + 1) * seglen - next_segment * seglen <= SYNC_MAX_WRITE)
+          end_segment++;
+        next = headerlen + ROUND_TO_STORE_BLOCK(end_segment * seglen);
+        if (next > bodyend)
+          next = bodyend;
+        next_segment = end_segment;
+      }
+    }
+    if (writepos >= bodyend && writepos < (off_t)dirlen) {
+      // footer
+      o = bodyend;
+      next = dirlen;
+    } else if (writepos >= (off_t)dirlen) {
       d->dir_sync_in_progress = 0;
       goto Ldone;
     }
+
+    // the first write goes out at once, the snapshot has already been taken
+    ink_hrtime wait = throttle(next - o);
+    if (wait && writepos) {
+      trigger = eventProcessor.schedule_in(this, wait);
+      return EVENT_CONT;
+    }
+    segment = next_segment;
+    writepos = next;
+    aio_write(d->fd, buf + o, next - o, start + o);
     return EVENT_CONT;
   }
 Ldone:
   // done
   writepos = 0;
+  segment = 0;
+  failed = false;
   vol++;
   goto Lrestart;
 }
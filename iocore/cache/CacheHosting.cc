@@ -689,6 +689,7 @@ ConfigVolumes::BuildListFromString(char *config_file_path, char *file_buf)
   int scheme = CACHE_NONE_TYPE;
   int size = 0;
   int in_percent = 0;
+  int avg_obj_size = 0;
   const char *matcher_name = "[CacheVolition]";
 
   memset(volume_seen, 0, sizeof(volume_seen));
@@ -705,6 +706,7 @@ ConfigVolumes::BuildListFromString(char *config_file_path, char *file_buf)
   tmp = bufTok.iterFirst(&i_state);
   while (tmp != NULL) {
     state = PAIR_ZERO;
+    avg_obj_size = 0;
     line_num++;
 
     // skip all blank spaces at beginning of line
@@ -726,6 +728,7 @@ ConfigVolumes::BuildListFromString(char *config_file_path, char *file_buf)
         }
         configp->scheme = scheme;
         configp->size = size;
+        configp->avg_obj_size = avg_obj_size;
         configp->cachep = NULL;
         cp_queue.enqueue(configp);
         num_volumes++;
@@ -734,7 +737,8 @@ ConfigVolumes::BuildListFromString(char *config_file_path, char *file_buf)
         else
           num_stream_volumes++;
         Debug("cache_hosting",
-              "added volume=%d, scheme=%d, size=%d percent=%d\n", volume_number, scheme, size, in_percent);
+              "added volume=%d, scheme=%d, size=%d percent=%d avg_obj_size=%d\n",
+              volume_number, scheme, size, in_percent, avg_obj_size);
         break;
       }
 
@@ -853,6 +857,27 @@ ConfigVolumes::BuildListFromString(char *config_file_path, char *file_buf)
         state = DONE;
         break;
 
+      case DONE:
+        // optional, once: average object size the volume directory is sized for
+        if (strcasecmp(tmp, "avg_obj_size") || avg_obj_size) {
+          state = INK_ERROR;
+          break;
+        }
+        tmp += 13;
+        avg_obj_size = atoi(tmp);
+
+        while (ParseRules::is_digit(*tmp))
+          tmp++;
+
+        if (avg_obj_size < CACHE_BLOCK_SIZE) {
+          snprintf(errBuf, sizeof(errBuf), "%s discarding %s entry at line %d : avg_obj_size must be at least %d",
+                   matcher_name, config_file_path, line_num, CACHE_BLOCK_SIZE);
+          IOCORE_SignalError(errBuf, manager_alarmed);
+          state = INK_ERROR;
+          break;
+        }
+        break;
+
       }
 
       if (state == INK_ERROR || *tmp) {
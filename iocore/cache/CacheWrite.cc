@@ -870,6 +870,12 @@ agg_copy(char *p, CacheVC *vc)
 
     if (res_alt_blk)
       res_alt_blk->free();
+    {
+      // disk_bytes / doc_bytes is the write amplification of the volume
+      ProxyMutex *mutex = vol->mutex;
+      CACHE_SUM_DYN_STAT(cache_write_doc_bytes_stat, len);
+      CACHE_SUM_DYN_STAT(cache_write_disk_bytes_stat, vc->agg_len);
+    }
     return vc->agg_len;
   } else {
     // for evacuated documents, copy the data, and update directory
@@ -881,6 +887,10 @@ agg_copy(char *p, CacheVC *vc)
       CACHE_DEBUG_INCREMENT_DYN_STAT(cache_gc_frags_evacuated_stat);
       CACHE_DEBUG_SUM_DYN_STAT(cache_gc_bytes_evacuated_stat, l);
     }
+    {
+      ProxyMutex *mutex = vol->mutex;
+      CACHE_SUM_DYN_STAT(cache_write_disk_bytes_stat, l);
+    }
     doc->sync_serial = vc->vol->header->sync_serial;
     doc->write_serial = vc->vol->header->write_serial;
 
@@ -33,7 +33,8 @@
 #define CACHE_ALT_INDEX_DEFAULT     -1
 #define CACHE_ALT_REMOVED           -2
 
-#define CACHE_DB_MAJOR_VERSION      23
+// bump CLUSTER_MAJOR_VERSION too if the marshaled alternate layout changes
+#define CACHE_DB_MAJOR_VERSION      24
 #define CACHE_DB_MINOR_VERSION      0
 
 #define CACHE_DIR_MAJOR_VERSION     19
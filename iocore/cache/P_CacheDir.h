@@ -55,6 +55,9 @@ struct CacheVC;
 
 #define SYNC_MAX_WRITE                  (2 * 1024 * 1024)
 #define SYNC_DELAY                      HRTIME_MSECONDS(500)
+// Vol::sync_dirty bits, one per directory copy (A/B = sync_serial & 1)
+#define SYNC_DIRTY(_copy)               (1 << (_copy))
+#define SYNC_DIRTY_BOTH                 (SYNC_DIRTY(0) | SYNC_DIRTY(1))
 #define DO_NOT_REMOVE_THIS              0
 
 // Debugging Options
@@ -288,12 +291,24 @@ struct CacheSync: public Continuation
   char *buf;
   size_t buflen;
   off_t writepos;
+  // segments to write for the copy being synced, snapshot of Vol::sync_dirty
+  unsigned char *segs;
+  int segslen;
+  int segment;
+  // write rate limiting, see proxy.config.cache.dir.sync_max_write_rate
+  int64_t tokens;
+  ink_hrtime last_refill;
+  int64_t interval_bytes;
+  bool failed;                  // a write of the current copy failed
   AIOCallbackInternal io;
   Event *trigger;
   int mainEvent(int event, Event *e);
   void aio_write(int fd, char *b, int n, off_t o);
+  ink_hrtime throttle(int64_t n);
+  void abort_sync(Vol *d);
 
-  CacheSync():Continuation(new_ProxyMutex()), vol(0), buf(0), buflen(0), writepos(0), trigger(0)
+  CacheSync():Continuation(new_ProxyMutex()), vol(0), buf(0), buflen(0), writepos(0), segs(0), segslen(0),
+    segment(0), tokens(SYNC_MAX_WRITE), last_refill(0), interval_bytes(0), failed(false), trigger(0)
   {
     SET_HANDLER(&CacheSync::mainEvent);
   }
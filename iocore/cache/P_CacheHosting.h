@@ -165,6 +165,7 @@ struct ConfigVol
   int size;
   bool in_percent;
   int percent;
+  int avg_obj_size;             // 0 = proxy.config.cache.min_average_object_size
   CacheVol *cachep;
   LINK(ConfigVol, link);
 };
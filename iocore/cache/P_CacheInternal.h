@@ -164,6 +164,15 @@ enum
   cache_hdr_vector_marshal_stat,
   cache_hdr_marshal_stat,
   cache_hdr_marshal_bytes_stat,
+  cache_startup_dir_read_time_stat,
+  cache_startup_recover_time_stat,
+  cache_startup_total_time_stat,
+  cache_startup_clean_vols_stat,
+  cache_dir_sync_bytes_stat,
+  cache_dir_sync_interval_bytes_stat,
+  cache_dir_sync_segments_skipped_stat,
+  cache_write_doc_bytes_stat,
+  cache_write_disk_bytes_stat,
   cache_stat_count
 };
 
@@ -213,6 +222,7 @@ do { \
 
 // Configuration
 extern int cache_config_dir_sync_frequency;
+extern int64_t cache_config_dir_sync_max_write_rate;
 extern int cache_config_http_max_alts;
 extern int cache_config_permit_pinning;
 extern int cache_config_select_alternate;
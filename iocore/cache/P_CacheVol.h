@@ -34,6 +34,7 @@
 
 // Vol (volumes)
 #define VOL_MAGIC                      0xF1D0F00D
+#define VOL_CLEAN_SHUTDOWN             0xC1EA5D0E
 #ifdef SSD_CACHE
 #define SSD_VOL_MAGIC									 0xF1D0F00E
 #define MIGRATE_BUCKETS                 1021
@@ -121,7 +122,8 @@ struct VolHeaderFooter
   uint32_t write_serial;
   uint32_t dirty;
   uint32_t sector_size;
-  uint32_t unused;                // pad out to 8 byte boundary
+  uint32_t clean_shutdown;        // VOL_CLEAN_SHUTDOWN if synced by sync_cache_dir_on_shutdown
+  uint32_t url_hash_method;       // hash the keys were made with, see URLHashMethod
 #ifdef SSD_CACHE
   SSDVolHeaderFooter ssd_header[8];
 #endif
@@ -446,6 +448,7 @@ struct Vol: public Continuation
   Dir *dir;
   VolHeaderFooter *header;
   VolHeaderFooter *footer;
+  unsigned char *sync_dirty;  // per segment, SYNC_DIRTY() for each copy that is out of date
   int segments;
   off_t buckets;
   off_t recover_pos;
@@ -483,10 +486,16 @@ struct Vol: public Continuation
   uint32_t last_write_serial;
   uint32_t sector_size;
   bool recover_wrapped;
+  bool clean_start;         // directory was synced on a clean shutdown, recovery skipped
   bool dir_sync_waiting;
   bool dir_sync_in_progress;
   bool writing_end_marker;
 
+  // startup timing, see CacheProcessor::cacheInitialized()
+  ink_hrtime init_start;
+  ink_hrtime dir_read_done;
+  ink_hrtime recover_done;
+
   CacheKey first_fragment_key;
   int64_t first_fragment_offset;
   Ptr<IOBufferData> first_fragment_data;
@@ -604,7 +613,8 @@ struct Vol: public Continuation
       dir(0), buckets(0), recover_pos(0), prev_recover_pos(0), scan_pos(0), skip(0), start(0),
       len(0), data_blocks(0), hit_evacuate_window(0), agg_todo_size(0), agg_buf_pos(0), trigger(0),
       evacuate_size(0), disk(NULL), last_sync_serial(0), last_write_serial(0), recover_wrapped(false),
-      dir_sync_waiting(0), dir_sync_in_progress(0), writing_end_marker(0) {
+      clean_start(false), dir_sync_waiting(0), dir_sync_in_progress(0), writing_end_marker(0),
+      init_start(0), dir_read_done(0), recover_done(0) {
     open_dir.mutex = mutex;
     agg_buffer = (char *)ats_memalign(sysconf(_SC_PAGESIZE), AGG_SIZE);
     memset(agg_buffer, 0, AGG_SIZE);
@@ -630,6 +640,7 @@ struct CacheVol
   int vol_number;
   int scheme;
   int size;
+  int avg_obj_size;             // directory sizing, see ConfigVol
   int num_vols;
   Vol **vols;
   DiskVol **disk_vols;
@@ -638,7 +649,7 @@ struct CacheVol
   RecRawStatBlock *vol_rsb;
 
   CacheVol()
-    : vol_number(-1), scheme(0), size(0), num_vols(0), vols(NULL), disk_vols(0), vol_rsb(0)
+    : vol_number(-1), scheme(0), size(0), avg_obj_size(0), num_vols(0), vols(NULL), disk_vols(0), vol_rsb(0)
   { }
 };
 
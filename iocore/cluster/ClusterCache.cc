@@ -4175,6 +4175,7 @@ CacheDiffuser::cacheRemoteReadHandler(int event, void *e)
     return EVENT_CONT;
   } else if (event == CACHE_EVENT_OPEN_READ_FAILED) {
     Debug("CacheDiffuser", "remote open read failed, %d", (int) (intptr_t) e);
+    CLUSTER_INCREMENT_DYN_STAT(CLUSTER_DIFFUSE_FAILURES_STAT);
     // reset
     terminate = true;
     return EVENT_DONE;
@@ -4206,6 +4207,7 @@ CacheDiffuser::cacheRemoteReadHandler(int event, void *e)
 Lfailed:
   remote_read_vc->do_io_close(0);
   remote_read_vc = NULL;
+  CLUSTER_INCREMENT_DYN_STAT(CLUSTER_DIFFUSE_FAILURES_STAT);
   terminate = true;
   return EVENT_DONE;
 }
@@ -4222,6 +4224,7 @@ CacheDiffuser::cacheLocalWriteHandler(int event, void *e)
     read_vio = remote_read_vc->do_io_read(this, doc_size, &buffer);
     return EVENT_CONT;
   } else if (event == CACHE_EVENT_OPEN_WRITE_FAILED) {
+    CLUSTER_INCREMENT_DYN_STAT(CLUSTER_DIFFUSE_FAILURES_STAT);
     terminate = true;
     return EVENT_DONE;
   }
@@ -4231,14 +4234,7 @@ CacheDiffuser::cacheLocalWriteHandler(int event, void *e)
   case VC_EVENT_EOS:
     goto Lfailed;
   case VC_EVENT_WRITE_COMPLETE:
-    local_write_vc->do_io_close();
-    local_write_vc = NULL;
-    terminate = true;
-    char cache_url[2048];
-    int length;
-    url.string_get_buf(cache_url, sizeof(cache_url), &length);
-    if (cache_migrate)
-      cache_migrate(cache_url, length);
+    finish_local_write();
     return EVENT_DONE;
   case VC_EVENT_WRITE_READY:
     if (remote_read_vc) {
@@ -4248,10 +4244,8 @@ CacheDiffuser::cacheLocalWriteHandler(int event, void *e)
     }
 
     if (write_vio->ndone >= doc_size) {
-      local_write_vc->do_io_close();
-      local_write_vc = NULL;
       ink_debug_assert(!remote_read_vc);
-      terminate = true;
+      finish_local_write();
       return EVENT_DONE;
     }
     write_vio->reenable();
@@ -4265,10 +4259,30 @@ CacheDiffuser::cacheLocalWriteHandler(int event, void *e)
 Lfailed:
   local_write_vc->do_io_close(0);
   local_write_vc = NULL;
+  CLUSTER_INCREMENT_DYN_STAT(CLUSTER_DIFFUSE_FAILURES_STAT);
   terminate = true;
   return EVENT_DONE;
 }
 
+// The copy is complete: account the bytes that no longer have to cross
+// the cluster for it and tell the hot url code it can be served locally.
+void
+CacheDiffuser::finish_local_write()
+{
+  char cache_url[2048];
+  int length;
+
+  CLUSTER_INCREMENT_DYN_STAT(CLUSTER_DIFFUSE_OBJECTS_STAT);
+  CLUSTER_SUM_DYN_STAT(CLUSTER_DIFFUSE_BYTES_STAT, write_vio->ndone);
+  local_write_vc->do_io_close();
+  local_write_vc = NULL;
+  terminate = true;
+
+  url.string_get_buf(cache_url, sizeof(cache_url), &length);
+  if (cache_migrate)
+    cache_migrate(cache_url, length);
+}
+
 Action *
 CacheDiffuser::do_cache_diffuse(ClusterMachine *m, int opcode, INK_MD5 *key, URL *url, CacheHTTPHdr *request, CacheLookupHttpConfig *params, CacheFragType type)
 {
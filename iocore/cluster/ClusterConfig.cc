@@ -430,6 +430,19 @@ free_configuration(ClusterConfiguration * c, ClusterConfiguration * prev)
   eventProcessor.schedule_in(NEW(new ConfigurationContinuation(c, prev)), CLUSTER_CONFIGURATION_TIMEOUT, ET_CALL);
 }
 
+//
+// Record how much of the keyspace changed owner in a new configuration
+//
+static void
+note_hash_table_moved(ClusterConfiguration * c, ClusterConfiguration * cc)
+{
+  int moved = cluster_hash_table_moved(c, cc);
+
+  CLUSTER_SUM_GLOBAL_DYN_STAT(CLUSTER_HASH_BUCKETS_MOVED_STAT, moved);
+  Note("cluster hash: %d -> %d machines moved %d of %d buckets (%.2f%%)",
+       c->n_machines, cc->n_machines, moved, CLUSTER_HASH_TABLE_SIZE, moved * 100.0 / CLUSTER_HASH_TABLE_SIZE);
+}
+
 ClusterConfiguration *
 configuration_add_machine(ClusterConfiguration * c, ClusterMachine * m)
 {
@@ -475,6 +488,7 @@ configuration_add_machine(ClusterConfiguration * c, ClusterMachine * m)
   build_cluster_hash_table(cc);
   INK_MEMORY_BARRIER;           // commit writes before freeing old hash table
   //CLUSTER_INCREMENT_DYN_STAT(CLUSTER_CONFIGURATION_CHANGES_STAT);
+  note_hash_table_moved(c, cc);
 
   free_configuration(c, cc);
   return cc;
@@ -512,6 +526,7 @@ configuration_remove_machine(ClusterConfiguration * c, ClusterMachine * m)
   build_cluster_hash_table(cc);
   INK_MEMORY_BARRIER;           // commit writes before freeing old hash table
   //CLUSTER_INCREMENT_DYN_STAT(CLUSTER_CONFIGURATION_CHANGES_STAT);
+  note_hash_table_moved(c, cc);
 
   free_configuration(c, cc);
   return cc;
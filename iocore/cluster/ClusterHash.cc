@@ -54,6 +54,16 @@ bool randClusterHash = false;
 // bool boundClusterHash = true;
 // bool randClusterHash = true;
 
+//
+// consistentClusterHash - place every machine on a hash ring at
+//                         consistentClusterHashVirtualNodes points and
+//                         give each bucket to the next machine on the
+//                         ring, so that a join or leave only moves the
+//                         buckets of the machine that changed
+//
+bool consistentClusterHash = false;
+int consistentClusterHashVirtualNodes = 128;
+
 
 
 //
@@ -167,6 +177,96 @@ build_hash_table_bucket(ClusterConfiguration * c)
   }
 }
 
+//
+// 64 bit finalizer from MurmurHash3, it is enough to spread the
+// (machine, virtual node) and bucket numbers over the ring.
+//
+static inline uint64_t
+ring_hash(uint64_t k)
+{
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+struct ClusterHashRingPoint
+{
+  uint64_t point;
+  unsigned char machine;
+};
+
+static int
+cmp_ring_point(const void *a, const void *b)
+{
+  const ClusterHashRingPoint *pa = (const ClusterHashRingPoint *) a;
+  const ClusterHashRingPoint *pb = (const ClusterHashRingPoint *) b;
+
+  if (pa->point == pb->point)
+    return 0;
+  return pa->point < pb->point ? -1 : 1;
+}
+
+//
+// Build the hash table from a consistent hash ring.
+// The ring points of a machine depend only on its address, so the
+// owner of a bucket only changes if that machine or its successor on
+// the ring joins or leaves.
+// It costs O(B log(N * V)) for B buckets, N machines and V virtual nodes.
+//
+static void
+build_hash_table_consistent(ClusterConfiguration * c)
+{
+  int vnodes = consistentClusterHashVirtualNodes > 0 ? consistentClusterHashVirtualNodes : 1;
+  int n_points = c->n_machines * vnodes;
+  ClusterHashRingPoint *ring = (ClusterHashRingPoint *)ats_malloc(n_points * sizeof(ClusterHashRingPoint));
+  int i, m, v;
+
+  for (m = 0, i = 0; m < c->n_machines; m++) {
+    uint64_t id = ((uint64_t) c->machines[m]->ip << 32) | ((uint64_t) (c->machines[m]->cluster_port & 0xFFFF) << 16);
+    for (v = 0; v < vnodes; v++, i++) {
+      ring[i].point = ring_hash(id | v);
+      ring[i].machine = m;
+    }
+  }
+  qsort(ring, n_points, sizeof(ClusterHashRingPoint), cmp_ring_point);
+
+  for (i = 0; i < CLUSTER_HASH_TABLE_SIZE; i++) {
+    uint64_t h = ring_hash((uint64_t) i);
+    int lo = 0, hi = n_points;
+
+    // first point at or after the bucket, wrapping around the ring
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if (ring[mid].point < h)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    c->hash_table[i] = ring[lo == n_points ? 0 : lo].machine;
+  }
+
+  ats_free(ring);
+}
+
+//
+// Return the number of buckets which are owned by a different machine
+// in configuration 'to' than in configuration 'from'.
+//
+int
+cluster_hash_table_moved(ClusterConfiguration * from, ClusterConfiguration * to)
+{
+  int moved = 0;
+
+  for (int i = 0; i < CLUSTER_HASH_TABLE_SIZE; i++) {
+    if (!from->machines[from->hash_table[i]]->equal(to->machines[to->hash_table[i]]))
+      moved++;
+  }
+  return moved;
+}
+
 static void
 adjust_cluster_hash_table(ClusterConfiguration * c)
 {
@@ -191,10 +291,91 @@ adjust_cluster_hash_table(ClusterConfiguration * c)
 void
 build_cluster_hash_table(ClusterConfiguration * c)
 {
-  if (machineClusterHash)
+  if (consistentClusterHash)
+    build_hash_table_consistent(c);
+  else if (machineClusterHash)
     build_hash_table_machine(c);
   else
     build_hash_table_bucket(c);
 
   adjust_cluster_hash_table(c);
 }
+
+//
+// Regression: keys moved on join/leave with the consistent hash
+//
+static int
+hash_table_owned(ClusterConfiguration * c, ClusterMachine * m)
+{
+  int owned = 0;
+
+  for (int i = 0; i < CLUSTER_HASH_TABLE_SIZE; i++) {
+    if (c->machines[c->hash_table[i]] == m)
+      owned++;
+  }
+  return owned;
+}
+
+REGRESSION_TEST(ClusterHash_Consistent) (RegressionTest * t, int atype, int *pstatus)
+{
+  NOWARN_UNUSED(atype);
+  const int n = 40;
+  const int leaving = 7;
+  ClusterMachine *machines[n + 1];
+  ClusterConfiguration *all = NEW(new ClusterConfiguration);
+  ClusterConfiguration *less = NEW(new ClusterConfiguration);
+  ClusterConfiguration *more = NEW(new ClusterConfiguration);
+  int i, owned, moved, min_owned = CLUSTER_HASH_TABLE_SIZE, max_owned = 0;
+
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  for (i = 0; i <= n; i++) {
+    machines[i] = NEW(new ClusterMachine(htonl(0x0a000001 + i), 8086));
+    if (i < n)
+      all->machines[all->n_machines++] = machines[i];
+    if (i < n && i != leaving)
+      less->machines[less->n_machines++] = machines[i];
+    more->machines[more->n_machines++] = machines[i];
+  }
+
+  // the legacy table, for comparison
+  build_hash_table_machine(all);
+  build_hash_table_machine(less);
+  build_hash_table_machine(more);
+  rprintf(t, "table hash: leave moved %d, join moved %d of %d buckets\n",
+          cluster_hash_table_moved(all, less), cluster_hash_table_moved(all, more), CLUSTER_HASH_TABLE_SIZE);
+
+  build_hash_table_consistent(all);
+  build_hash_table_consistent(less);
+  build_hash_table_consistent(more);
+
+  for (i = 0; i < n; i++) {
+    owned = hash_table_owned(all, machines[i]);
+    min_owned = owned < min_owned ? owned : min_owned;
+    max_owned = owned > max_owned ? owned : max_owned;
+  }
+  rprintf(t, "consistent hash: %d machines own %d - %d buckets (ideal %d)\n",
+          n, min_owned, max_owned, CLUSTER_HASH_TABLE_SIZE / n);
+
+  // on leave only the buckets of the machine that left may move
+  owned = hash_table_owned(all, machines[leaving]);
+  moved = cluster_hash_table_moved(all, less);
+  rprintf(t, "consistent hash: leave moved %d buckets, %d were owned by the leaving machine\n", moved, owned);
+  if (moved != owned) {
+    *pstatus = REGRESSION_TEST_FAILED;
+  }
+
+  // on join buckets may only move to the new machine, and no more than its share
+  owned = hash_table_owned(more, machines[n]);
+  moved = cluster_hash_table_moved(all, more);
+  rprintf(t, "consistent hash: join moved %d buckets, %d are owned by the new machine\n", moved, owned);
+  if (moved != owned || moved > 2 * CLUSTER_HASH_TABLE_SIZE / (n + 1)) {
+    *pstatus = REGRESSION_TEST_FAILED;
+  }
+
+  delete all;
+  delete less;
+  delete more;
+  for (i = 0; i <= n; i++)
+    delete machines[i];
+}
@@ -588,6 +588,10 @@ ClusterProcessor::init()
                      "proxy.process.cluster.nodes",
                      RECD_INT, RECP_NON_PERSISTENT, (int) CLUSTER_NODES_STAT, RecRawStatSyncSum);
   CLUSTER_CLEAR_DYN_STAT(CLUSTER_NODES_STAT);
+  RecRegisterRawStat(cluster_rsb, RECT_PROCESS,
+                     "proxy.process.cluster.hash_buckets_moved",
+                     RECD_INT, RECP_NON_PERSISTENT, (int) CLUSTER_HASH_BUCKETS_MOVED_STAT, RecRawStatSyncSum);
+  CLUSTER_CLEAR_DYN_STAT(CLUSTER_HASH_BUCKETS_MOVED_STAT);
   RecRegisterRawStat(cluster_rsb, RECT_PROCESS,
                      "proxy.process.cluster.machines_allocated",
                      RECD_INT, RECP_NON_PERSISTENT, (int) CLUSTER_MACHINES_ALLOCATED_STAT, RecRawStatSyncSum);
@@ -782,6 +786,18 @@ ClusterProcessor::init()
                      "proxy.process.cluster.write_lock_misses",
                      RECD_INT, RECP_NON_PERSISTENT, (int) CLUSTER_WRITE_LOCK_MISSES_STAT, RecRawStatSyncCount);
   CLUSTER_CLEAR_DYN_STAT(CLUSTER_WRITE_LOCK_MISSES_STAT);
+  RecRegisterRawStat(cluster_rsb, RECT_PROCESS,
+                     "proxy.process.cluster.diffuse.objects",
+                     RECD_INT, RECP_NON_PERSISTENT, (int) CLUSTER_DIFFUSE_OBJECTS_STAT, RecRawStatSyncSum);
+  CLUSTER_CLEAR_DYN_STAT(CLUSTER_DIFFUSE_OBJECTS_STAT);
+  RecRegisterRawStat(cluster_rsb, RECT_PROCESS,
+                     "proxy.process.cluster.diffuse.bytes",
+                     RECD_INT, RECP_NON_PERSISTENT, (int) CLUSTER_DIFFUSE_BYTES_STAT, RecRawStatSyncSum);
+  CLUSTER_CLEAR_DYN_STAT(CLUSTER_DIFFUSE_BYTES_STAT);
+  RecRegisterRawStat(cluster_rsb, RECT_PROCESS,
+                     "proxy.process.cluster.diffuse.failures",
+                     RECD_INT, RECP_NON_PERSISTENT, (int) CLUSTER_DIFFUSE_FAILURES_STAT, RecRawStatSyncSum);
+  CLUSTER_CLEAR_DYN_STAT(CLUSTER_DIFFUSE_FAILURES_STAT);
   CLUSTER_CLEAR_DYN_STAT(CLUSTER_NODES_STAT);   // clear sum and count
   // INKqa08033: win2k: ui: cluster warning light on
   // Used to call CLUSTER_INCREMENT_DYN_STAT here; switch to SUM_GLOBAL_DYN_STAT
@@ -826,6 +842,11 @@ ClusterProcessor::init()
   IOCORE_ReadConfigInteger(cluster_packet_tos, "proxy.config.cluster.sock_packet_tos");
   IOCORE_EstablishStaticConfigInt32(RPC_only_CacheCluster, "proxy.config.cluster.rpc_cache_cluster");
 
+  int cluster_hash_method = 0;
+  IOCORE_ReadConfigInteger(cluster_hash_method, "proxy.config.cluster.hash_method");
+  consistentClusterHash = (cluster_hash_method == 1);
+  IOCORE_ReadConfigInteger(consistentClusterHashVirtualNodes, "proxy.config.cluster.hash_virtual_nodes");
+
   IOCORE_EstablishStaticConfigInteger(cluster_flow_ctrl_min_bps, "proxy.config.cluster.flow_ctrl.min_bps");
   IOCORE_EstablishStaticConfigInteger(cluster_flow_ctrl_max_bps, "proxy.config.cluster.flow_ctrl.max_bps");
   IOCORE_EstablishStaticConfigInt32(cluster_send_min_wait_time, "proxy.config.cluster.flow_ctrl.min_send_wait_time");
@@ -122,6 +122,10 @@ enum
   CLUSTER_REMOTE_CONNECTION_TIME_STAT,
   CLUSTER_SETDATA_NO_CLUSTERVC_STAT,
   CLUSTER_SETDATA_NO_CLUSTER_STAT,
+  CLUSTER_HASH_BUCKETS_MOVED_STAT,
+  CLUSTER_DIFFUSE_OBJECTS_STAT,
+  CLUSTER_DIFFUSE_BYTES_STAT,
+  CLUSTER_DIFFUSE_FAILURES_STAT,
   cluster_stat_count
 };
 
@@ -62,7 +62,9 @@
 // - provides callbacks to other processors when the cluster configuration
 //   changes
 //
-#define CLUSTER_MAJOR_VERSION               6
+// Cached alternates are sent in their marshaled form, so bump this with
+// CACHE_DB_MAJOR_VERSION when the alternate layout changes.
+#define CLUSTER_MAJOR_VERSION               7
 #define CLUSTER_MINOR_VERSION               0
 
 // Lowest supported major/minor cluster version
@@ -1191,8 +1193,11 @@ ClusterConfiguration *configuration_remove_machine(ClusterConfiguration * c, Clu
 extern bool machineClusterHash;
 extern bool boundClusterHash;
 extern bool randClusterHash;
+extern bool consistentClusterHash;
+extern int consistentClusterHashVirtualNodes;
 
 void build_cluster_hash_table(ClusterConfiguration *);
+int cluster_hash_table_moved(ClusterConfiguration * from, ClusterConfiguration * to);
 
 inline void
 ClusterVC_enqueue_read(Queue<ClusterVConnectionBase, ClusterVConnectionBase::Link_read_link> &q, ClusterVConnectionBase * vc)
@@ -1343,7 +1348,7 @@ struct ClusterCacheVC: public CacheVConnection
 #ifdef HTTP_CACHE
   virtual void set_http_info(CacheHTTPInfo *info) {
     if (enable_cache_empty_http_doc) {
-      MIMEField *field = info->m_alt->m_response_hdr.field_find(
+      MIMEField *field = info->response_get()->field_find(
           MIME_FIELD_CONTENT_LENGTH, MIME_LEN_CONTENT_LENGTH);
       if (field && !field->value_get_int64())
         f.force_empty = 1;
@@ -1477,6 +1482,7 @@ struct CacheDiffuser : public Continuation
   int cacheRemoteReadHandler(int event, void *e);
   Action *do_cache_remote_read();
   Action *do_cache_local_write();
+  void finish_local_write();
   static Action *do_cache_diffuse(ClusterMachine *m, int opcode, INK_MD5 *key, URL *url, CacheHTTPHdr *request, CacheLookupHttpConfig *params, CacheFragType frag_type);
   int main_handler(int event, void *e);
 };
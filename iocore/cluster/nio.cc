@@ -32,6 +32,7 @@
 
 int g_worker_thread_count = 0;
 static int read_buffer_size = 2 * 1024 * 1024;
+static int write_max_combine_bytes = WRITE_MAX_COMBINE_BYTES;
 
 struct worker_thread_context *g_worker_thread_contexts = NULL;
 
@@ -130,6 +131,8 @@ static void init_nio_stats()
 
   RecRegisterStatInt(RECT_PROCESS, "proxy.process.cluster.io.call_writev_count", 0, RECP_NON_PERSISTENT);
   RecRegisterStatInt(RECT_PROCESS, "proxy.process.cluster.io.call_read_count", 0, RECP_NON_PERSISTENT);
+  RecRegisterStatInt(RECT_PROCESS, "proxy.process.cluster.io.send_copy_bytes", 0, RECP_NON_PERSISTENT);
+  RecRegisterStatInt(RECT_PROCESS, "proxy.process.cluster.io.recv_copy_bytes", 0, RECP_NON_PERSISTENT);
 
   nio_records.send_retry_count = RecRegisterStat(RECT_PROCESS,
       "proxy.process.cluster.io.send_retry_count", RECD_INT, data_default, RECP_NON_PERSISTENT);
@@ -169,12 +172,43 @@ static void init_nio_stats()
 #endif
 }
 
+static void log_nio_peer_stats()
+{
+	struct worker_thread_context *pThreadContext;
+	struct worker_thread_context *pContextEnd;
+  SocketContext *pSockContext;
+  PeerIOStats *s;
+  int i;
+
+	pContextEnd = g_worker_thread_contexts + g_work_threads;
+	for (pThreadContext=g_worker_thread_contexts; pThreadContext<pContextEnd;
+      pThreadContext++)
+	{
+    pthread_mutex_lock(&pThreadContext->lock);
+    for (i=0; i<pThreadContext->active_sock_count; i++) {
+      pSockContext = pThreadContext->active_sockets[i];
+      s = &pSockContext->io_stats;
+      Debug(CLUSTER_DEBUG_TAG, "%s:%d sock: #%d, type: %c, "
+          "writev: %"PRId64", msgs per writev: %.2f, send copy bytes: %"PRId64", "
+          "read: %"PRId64", msgs per read: %.2f, recv copy bytes: %"PRId64,
+          pSockContext->machine->hostname, pSockContext->machine->cluster_port,
+          pSockContext->sock, pSockContext->connect_type,
+          s->call_writev_count, s->call_writev_count > 0 ?
+          (double)s->writev_msg_count / (double)s->call_writev_count : 0.0,
+          s->send_copy_bytes, s->call_read_count, s->call_read_count > 0 ?
+          (double)s->recv_msg_count / (double)s->call_read_count : 0.0,
+          s->recv_copy_bytes);
+    }
+    pthread_mutex_unlock(&pThreadContext->lock);
+  }
+}
+
 void log_nio_stats()
 {
   RecData data;
 	struct worker_thread_context *pThreadContext;
 	struct worker_thread_context *pContextEnd;
-  SocketStats sum = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+  SocketStats sum = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
   static time_t last_calc_bps_time = CURRENT_TIME();
   static int64_t last_send_bytes = 0;
 
@@ -203,6 +237,8 @@ void log_nio_stats()
     sum.ping_success_count += pThreadContext->stats.ping_success_count;
     sum.ping_time_used += pThreadContext->stats.ping_time_used;
     sum.send_delayed_time += pThreadContext->stats.send_delayed_time;
+    sum.send_copy_bytes += pThreadContext->stats.send_copy_bytes;
+    sum.recv_copy_bytes += pThreadContext->stats.recv_copy_bytes;
     sum.push_msg_count += pThreadContext->stats.push_msg_count;
     sum.push_msg_bytes += pThreadContext->stats.push_msg_bytes;
     sum.fail_msg_count += pThreadContext->stats.fail_msg_count;
@@ -249,6 +285,14 @@ void log_nio_stats()
   RecSetRecord(RECT_PROCESS, "proxy.process.cluster.io.call_writev_count", RECD_INT, &data, NULL);
   data.rec_int = sum.call_read_count;
   RecSetRecord(RECT_PROCESS, "proxy.process.cluster.io.call_read_count", RECD_INT, &data, NULL);
+  data.rec_int = sum.send_copy_bytes;
+  RecSetRecord(RECT_PROCESS, "proxy.process.cluster.io.send_copy_bytes", RECD_INT, &data, NULL);
+  data.rec_int = sum.recv_copy_bytes;
+  RecSetRecord(RECT_PROCESS, "proxy.process.cluster.io.recv_copy_bytes", RECD_INT, &data, NULL);
+
+  if (is_debug_tag_set(CLUSTER_DEBUG_TAG)) {
+    log_nio_peer_stats();
+  }
 
   RecDataSetFromInk64(RECD_INT, &nio_records.send_retry_count->data,
         sum.send_retry_count);
@@ -320,8 +364,10 @@ int nio_init()
 	pthread_t tid;
 
   REC_EstablishStaticConfigInt32(read_buffer_size, "proxy.config.cluster.read_buffer_size");
+  REC_EstablishStaticConfigInt32(write_max_combine_bytes, "proxy.config.cluster.write_max_combine_bytes");
   Debug(CLUSTER_DEBUG_TAG, "file: " __FILE__ ", line: %d, "
-      "read_buffer_size: %d", __LINE__, read_buffer_size);
+      "read_buffer_size: %d, write_max_combine_bytes: %d", __LINE__,
+      read_buffer_size, write_max_combine_bytes);
 
 	if ((result=init_pthread_lock(&worker_thread_lock)) != 0) {
 		return result;
@@ -454,6 +500,8 @@ int cluster_global_init(message_deal_func deal_func,
     INIT_READER(pSockContext->reader, read_buffer_size); \
     memcpy(pSockContext->reader.current, old_msg_header, msg_bytes); \
     pSockContext->reader.current += msg_bytes; \
+    pSockContext->thread_context->stats.recv_copy_bytes += msg_bytes; \
+    pSockContext->io_stats.recv_copy_bytes += msg_bytes; \
     oldBuffer = NULL; \
   } while (0)
 
@@ -551,6 +599,7 @@ int nio_add_to_epoll(SocketContext *pSockContext)
   pSockContext->queue_index = 0;
   pSockContext->ping_start_time = 0;
   pSockContext->ping_fail_count = 0;
+  memset(&pSockContext->io_stats, 0, sizeof(pSockContext->io_stats));
   pSockContext->next_write_time = CURRENT_NS() + send_wait_time;
   pSockContext->next_ping_time = CURRENT_NS() + cluster_ping_send_interval;
 
@@ -830,7 +879,7 @@ static int deal_write_event(SocketContext * pSockContext)
       */
       if (total_msg_count == WRITEV_ITEM_ONCE ||
           vec_count >= WRITEV_ARRAY_SIZE - 2 ||
-          total_bytes >= WRITE_MAX_COMBINE_BYTES)
+          total_bytes >= write_max_combine_bytes)
       {
         fetch_done = true;
         break;
@@ -868,6 +917,8 @@ static int deal_write_event(SocketContext * pSockContext)
 
   pSockContext->thread_context->stats.send_retry_count += total_msg_count;
   pSockContext->thread_context->stats.call_writev_count++;
+  pSockContext->io_stats.call_writev_count++;
+  pSockContext->io_stats.writev_msg_count += total_msg_count;
 	write_bytes = writev(pSockContext->sock, write_vec, vec_count);
 	if (write_bytes == 0) {   //connection closed
 		Debug(CLUSTER_DEBUG_TAG, "file: "__FILE__", line: %d, "
@@ -1029,6 +1080,11 @@ static int deal_write_event(SocketContext * pSockContext)
 
       pSockContext->thread_context->stats.send_delayed_time +=
         CURRENT_NS() - msg->in_queue_time;
+      if (msg->data_type == DATA_TYPE_BUFFER) {
+        pSockContext->thread_context->stats.send_copy_bytes +=
+          msg->header.data_len;
+        pSockContext->io_stats.send_copy_bytes += msg->header.data_len;
+      }
       release_out_message(pSockContext, msg);
     }
   }
@@ -1180,6 +1236,7 @@ static int deal_read_event(SocketContext *pSockContext)
   MsgHeader *pHeader;
 
   pSockContext->thread_context->stats.call_read_count++;
+  pSockContext->io_stats.call_read_count++;
   read_bytes = read(pSockContext->sock, pSockContext->reader.current,
       pSockContext->reader.buff_end - pSockContext->reader.current);
   /*
@@ -1387,6 +1444,7 @@ static int deal_read_event(SocketContext *pSockContext)
     }
 
     pSockContext->thread_context->stats.recv_msg_count++;
+    pSockContext->io_stats.recv_msg_count++;
     deal_message(pHeader, pSockContext, pSockContext->reader.blocks);
 
     pSockContext->reader.blocks = NULL;  //free memory pointer
@@ -25,10 +25,10 @@
 
 #define MAX_MACHINE_COUNT        255   //IMPORTANT: can't be 256!!
 
-//combine multi msg to call writev
-#define WRITEV_ARRAY_SIZE   128
+//combine multi msg to call writev, must be less than IOV_MAX
+#define WRITEV_ARRAY_SIZE   256
 #define WRITEV_ITEM_ONCE    (WRITEV_ARRAY_SIZE / 2)
-#define WRITE_MAX_COMBINE_BYTES  (64 * 1024)
+#define WRITE_MAX_COMBINE_BYTES  (256 * 1024)  //default writev byte budget
 
 #define CONNECT_TYPE_CLIENT  'C'  //connect by me, client
 #define CONNECT_TYPE_SERVER  'S'  //connect by peer, server
@@ -133,6 +133,15 @@ typedef struct {
   pthread_mutex_t lock;
 } MessageQueue;
 
+typedef struct peer_io_stats {
+  int64_t call_writev_count;  //writev calls to this peer
+  int64_t writev_msg_count;   //messages carried by these writev calls
+  int64_t send_copy_bytes;    //body bytes sent from the copied mini buffer
+  int64_t call_read_count;    //read calls from this peer
+  int64_t recv_msg_count;     //messages parsed from these reads
+  int64_t recv_copy_bytes;    //bytes moved to a new recv buffer
+} PeerIOStats;
+
 typedef struct socket_context {
 	int sock;  //socket fd
   char padding[ALIGN_BYTES]; //padding buffer
@@ -150,6 +159,7 @@ typedef struct socket_context {
   int64_t next_ping_time; //next time to send ping message
   int64_t next_write_time; //next time to send data
   int64_t ping_start_time;
+  PeerIOStats io_stats;   //per peer io stats, reset when connected
 
 #ifdef USE_MULTI_ALLOCATOR
   Allocator *out_msg_allocator;  //for send
@@ -166,6 +176,7 @@ struct SocketStats {
   int64_t call_writev_count;
   int64_t send_retry_count;
   int64_t send_delayed_time;
+  int64_t send_copy_bytes;  //body bytes sent from the copied mini buffer
 
   volatile int64_t push_msg_count; //push to send queue msg count
   volatile int64_t push_msg_bytes; //push to send queue msg bytes
@@ -179,6 +190,7 @@ struct SocketStats {
   int64_t recv_bytes;
   int64_t enqueue_in_msg_bytes; //push into in msg queue
   int64_t dequeue_in_msg_bytes; //pop from in msg queue
+  int64_t recv_copy_bytes;  //partial msg bytes moved to a new recv buffer
 
   int64_t call_read_count;
   int64_t epoll_wait_count;
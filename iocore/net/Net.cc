@@ -32,6 +32,8 @@
 #include "P_Net.h"
 
 RecRawStatBlock *net_rsb = NULL;
+RecRawStatBlock *ssl_handshake_time_histogram = NULL;
+RecRawStatBlock *ssl_handshake_queue_histogram = NULL;
 int net_config_poll_timeout = DEFAULT_POLL_TIMEOUT;
 
 static inline void
@@ -125,6 +127,66 @@ register_net_stats()
   NET_CLEAR_DYN_STAT(socks_connections_currently_open_stat);
 #endif
 
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.handshakes_queued",
+                     RECD_INT, RECP_NON_PERSISTENT, (int) ssl_handshakes_queued_stat, RecRawStatSyncSum);
+  NET_CLEAR_DYN_STAT(ssl_handshakes_queued_stat);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.handshakes_offloaded",
+                     RECD_INT, RECP_NULL, (int) ssl_handshakes_offloaded_stat, RecRawStatSyncSum);
+
+  // Resumption rate is handshakes_resumed / (handshakes_full + handshakes_resumed)
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.handshakes_full",
+                     RECD_INT, RECP_NULL, (int) ssl_handshakes_full_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.handshakes_resumed",
+                     RECD_INT, RECP_NULL, (int) ssl_handshakes_resumed_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.session_cache.hits",
+                     RECD_INT, RECP_NULL, (int) ssl_session_cache_hit_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.session_cache.misses",
+                     RECD_INT, RECP_NULL, (int) ssl_session_cache_miss_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.session_cache.inserts",
+                     RECD_INT, RECP_NULL, (int) ssl_session_cache_insert_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.session_cache.evictions",
+                     RECD_INT, RECP_NULL, (int) ssl_session_cache_eviction_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.session_cache.expired",
+                     RECD_INT, RECP_NULL, (int) ssl_session_cache_expired_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.session_cache.too_big",
+                     RECD_INT, RECP_NULL, (int) ssl_session_cache_too_big_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.ktls.connections",
+                     RECD_INT, RECP_NULL, (int) ssl_ktls_connections_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.ktls.fallbacks",
+                     RECD_INT, RECP_NULL, (int) ssl_ktls_fallbacks_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.ktls.bytes_sent",
+                     RECD_INT, RECP_NULL, (int) ssl_ktls_bytes_stat, RecRawStatSyncSum);
+
+  ssl_handshake_time_histogram = RecAllocateRawStatHistogram();
+  RecRegisterRawStatHistogram(ssl_handshake_time_histogram, RECT_PROCESS,
+                              "proxy.process.ssl.handshake_time", RECP_NON_PERSISTENT);
+  ssl_handshake_queue_histogram = RecAllocateRawStatHistogram();
+  RecRegisterRawStatHistogram(ssl_handshake_queue_histogram, RECT_PROCESS,
+                              "proxy.process.ssl.handshake_queue_time", RECP_NON_PERSISTENT);
 }
 
 void
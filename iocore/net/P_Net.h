@@ -55,11 +55,28 @@ enum Net_Stats
   socks_connections_successful_stat,
   socks_connections_unsuccessful_stat,
   socks_connections_currently_open_stat,
+  ssl_handshakes_queued_stat,
+  ssl_handshakes_offloaded_stat,
+  ssl_handshakes_full_stat,
+  ssl_handshakes_resumed_stat,
+  ssl_session_cache_hit_stat,
+  ssl_session_cache_miss_stat,
+  ssl_session_cache_insert_stat,
+  ssl_session_cache_eviction_stat,
+  ssl_session_cache_expired_stat,
+  ssl_session_cache_too_big_stat,
+  ssl_ktls_connections_stat,
+  ssl_ktls_fallbacks_stat,
+  ssl_ktls_bytes_stat,
   Net_Stat_Count
 };
 
 struct RecRawStatBlock;
 extern RecRawStatBlock *net_rsb;
+// Server SSL handshake latency and time spent waiting for a handshake
+// thread, in microseconds
+extern RecRawStatBlock *ssl_handshake_time_histogram;
+extern RecRawStatBlock *ssl_handshake_queue_histogram;
 #define SSL_HANDSHAKE_WANT_READ   6
 #define SSL_HANDSHAKE_WANT_WRITE  7
 #define SSL_HANDSHAKE_WANT_ACCEPT 8
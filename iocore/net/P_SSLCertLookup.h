@@ -29,6 +29,29 @@
 
 struct SSLConfigParams;
 struct SSLContextStorage;
+struct SSLCertLookup;
+
+// The ssl_multicert.config fields a server context is built from, kept for
+// certificates whose context is only created when a client first asks for it.
+struct SSLCertSpec
+{
+  SSLCertSpec() : cert(NULL), ca(NULL), key(NULL), ticket_key_filename(NULL), session_ticket_enabled(-1) {}
+  ~SSLCertSpec() {
+    ats_free(cert);
+    ats_free(ca);
+    ats_free(key);
+    ats_free(ticket_key_filename);
+  }
+
+  char * cert;
+  char * ca;
+  char * key;
+  char * ticket_key_filename;
+  int session_ticket_enabled;
+};
+
+// Builds the context for a lazily loaded certificate, returns NULL on failure.
+typedef SSL_CTX * (*SSLContextLoader)(SSLCertLookup * lookup, const SSLCertSpec * spec);
 
 struct SSLCertLookup : public ConfigInfo
 {
@@ -40,6 +63,18 @@ struct SSLCertLookup : public ConfigInfo
   SSL_CTX * findInfoInHash(const char * address) const;
   SSL_CTX * findInfoInHash(const IpEndpoint& address) const;
 
+  // Lazily loaded certificates. Once enabled, add() takes ownership of a spec and
+  // returns the handle to index its names under. The context is created by the
+  // loader on the first lookup, and at most max_loaded of them are kept, the least
+  // recently used being released first.
+  void enableLazyContexts(SSLContextLoader loader, unsigned max_loaded);
+  int add(SSLCertSpec * spec);
+  bool insert(int handle, const char * name);
+
+  // Number of certificates indexed and number of contexts currently loaded.
+  unsigned count() const;
+  unsigned loaded() const;
+
   // Return the last-resort default TLS context if there is no name or address match.
   SSL_CTX * defaultContext() const { return ssl_default; }
 
@@ -47,4 +82,35 @@ struct SSLCertLookup : public ConfigInfo
   virtual ~SSLCertLookup();
 };
 
+// SSLCertNameIndex
+//
+//   The names each certificate file was indexed under, saved across
+//   reloads. A certificate whose file still has the recorded inode, size
+//   and modification time (to the nanosecond) doesn't need to be read to be
+//   indexed, which is most of the cost of loading a large
+//   ssl_multicert.config with lazy contexts.
+//
+struct SSLCertNameIndex
+{
+  SSLCertNameIndex();
+  ~SSLCertNameIndex();
+
+  bool load(const char * path);
+  bool save(const char * path) const;
+
+  // The space separated names recorded for certfile if it is unchanged.
+  const char * find(const char * certfile, const struct stat& st) const;
+  void add(const char * certfile, const struct stat& st, const char * names);
+
+  unsigned count() const { return nentries; }
+
+private:
+  struct Entry;
+
+  void add(const char * certfile, int64_t mtime, int64_t inode, int64_t size, const char * names);
+
+  InkHashTable * entries;
+  unsigned nentries;
+};
+
 #endif /* __P_SSLCERTLOOKUP_H__ */
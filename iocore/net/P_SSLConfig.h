@@ -49,7 +49,8 @@ struct SSLConfigParams : public ConfigInfo
   enum SSL_SESSION_CACHE_MODE
   {
     SSL_SESSION_CACHE_MODE_OFF = 0,
-    SSL_SESSION_CACHE_MODE_SERVER = 1
+    SSL_SESSION_CACHE_MODE_SERVER = 1,
+    SSL_SESSION_CACHE_MODE_SERVER_SHARED = 2
   };
 
   SSLConfigParams();
@@ -64,11 +65,15 @@ struct SSLConfigParams : public ConfigInfo
   char *serverCACertFilename;
   char *serverCACertPath;
   char *configFilePath;
+  char *certIndexFilePath;
   char *cipherSuite;
   int clientCertLevel;
   int verify_depth;
+  int lazy_contexts;
   int ssl_session_cache;
   int ssl_session_cache_size;
+  int ssl_session_cache_timeout;
+  char *ssl_session_cache_filename;
 
   char *clientCertPath;
   char *clientKeyPath;
@@ -80,6 +85,7 @@ struct SSLConfigParams : public ConfigInfo
   long ssl_ctx_options;
   
   static int ssl_maxrecord;
+  static int ssl_ktls;
 };
 
 /////////////////////////////////////////////////////////////
@@ -62,6 +62,10 @@ public:
 
   static EventType ET_SSL;
 
+  // Threads running server handshakes, 0 to run them on the net threads
+  static int handshake_threads;
+  static EventType ET_SSL_HANDSHAKE;
+
   //
   // Private
   //
@@ -60,11 +60,14 @@ class SSLNextProtocolSet;
 //  A VConnection for a network socket.
 //
 //////////////////////////////////////////////////////////////////
+struct SSLHandshakeJob;
+
 class SSLNetVConnection:public UnixNetVConnection
 {
 public:
   virtual int sslStartHandShake(int event, int &err);
   virtual void free(EThread * t);
+  virtual void do_io_close(int lerrno = -1);
   virtual void enableRead()
   {
     read.enabled = 1;
@@ -87,6 +90,7 @@ public:
     sslClientConnection = state;
   };
   int sslServerHandShakeEvent(int &err);
+  int sslServerHandShakeOffload(int &err);
   int sslClientHandShakeEvent(int &err);
   virtual void net_read_io(NetHandler * nh, EThread * lthread);
   virtual int64_t load_buffer_and_write(int64_t towrite, int64_t &wattempted, int64_t &total_wrote, MIOBufferAccessor & buf);
@@ -111,6 +115,17 @@ public:
     return npnEndpoint;
   }
 
+  // Server handshake steps run on ET_SSL_HANDSHAKE, see SSLHandshakeJob
+  SSLHandshakeJob *sslHandshakeJob;     // queued or running step
+  bool sslHandshakeJobEvent;            // I/O was signalled while it ran
+  int sslHandshakeJobRet;               // final result, 0 if none
+  int sslHandshakeJobErr;
+  ink_hrtime sslHandshakeBeginTime;
+
+  // The kernel encrypts what we write, see SSLEnableKernelTLS()
+  bool sslKernelTLS;
+  bool sslKernelTLSDesync;              // OpenSSL tried to write a record itself
+
 private:
   SSLNetVConnection(const SSLNetVConnection &);
   SSLNetVConnection & operator =(const SSLNetVConnection &);
@@ -0,0 +1,88 @@
+/** @file
+
+  Shared SSL server session cache
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef __P_SSLSESSIONCACHE_H__
+#define __P_SSLSESSIONCACHE_H__
+
+#include "libts.h"
+#include "P_SSLUtils.h"
+
+// Sessions are kept DER encoded in fixed size entries; a session that
+// doesn't fit (typically one carrying a large client certificate) is
+// not cached.
+#define SSL_SESSION_CACHE_ENTRY_SIZE   1024
+#define SSL_SESSION_CACHE_STRIPES      64
+
+struct SSLSessionCacheHeader;
+struct SSLSessionCacheStripe;
+struct SSLSessionCacheEntry;
+
+//
+// SSLSessionCache
+//
+//   The server session cache kept in a file mapped shared, so that the
+//   sessions survive a restart and are shared by every process on the
+//   box pointed at the same file. The table is split in stripes, each
+//   with its own process shared lock, hash buckets and LRU list.
+//   Entries expire with their session (SSL_SESSION_get_time() +
+//   SSL_SESSION_get_timeout(), wall clock).
+//
+struct SSLSessionCache
+{
+  // Map the cache at path, creating or resizing it to hold nentries
+  // sessions. Returns NULL on failure.
+  static SSLSessionCache *open(const char *path, int nentries);
+
+  bool insert(SSL_SESSION * sess);
+  SSL_SESSION *lookup(const unsigned char *id, unsigned id_len);
+  void remove(const unsigned char *id, unsigned id_len);
+
+  // Hook the cache into a server context in place of the OpenSSL one
+  void attach(SSL_CTX * ctx);
+
+  ~SSLSessionCache();
+
+private:
+  SSLSessionCache(int afd, char *abase, size_t asize);
+
+  SSLSessionCacheStripe *stripe_for(uint32_t hash);
+  SSLSessionCacheEntry *entry(int32_t i);
+  int32_t stripe_index(SSLSessionCacheStripe * s);
+  int32_t *buckets(SSLSessionCacheStripe * s);
+  bool check_stripe(SSLSessionCacheStripe * s);
+  int32_t find(SSLSessionCacheStripe * s, uint32_t hash, const unsigned char *id, unsigned id_len);
+  void unlink(SSLSessionCacheStripe * s, int32_t i);
+  bool lock(SSLSessionCacheStripe * s);
+  void unlock(SSLSessionCacheStripe * s);
+  void init_stripe(SSLSessionCacheStripe * s);
+
+  int fd;
+  char *base;
+  size_t size;
+  SSLSessionCacheHeader *header;
+};
+
+// The cache in use, NULL unless proxy.config.ssl.session_cache is 2
+extern SSLSessionCache *ssl_session_cache;
+
+#endif /* __P_SSLSESSIONCACHE_H__ */
@@ -55,6 +55,14 @@ void SSLInitializeLibrary();
 // Release SSL_CTX and the associated data
 void SSLReleaseContext(SSL_CTX* ctx);
 
+// Hand the transmit side of an established connection to the kernel, after
+// which the socket must be written directly rather than with SSL_write().
+// Returns false, leaving the connection untouched, if it can't be offloaded.
+bool SSLEnableKernelTLS(SSL * ssl, int fd);
+
+// Send close_notify on a connection SSLEnableKernelTLS() succeeded on.
+bool SSLKernelTLSCloseNotify(int fd);
+
 // Log an SSL error.
 void SSLError(const char *errStr, bool critical = true);
 
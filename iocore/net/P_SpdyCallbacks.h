@@ -23,23 +23,6 @@ ssize_t spdy_send_callback
 (spdylay_session *session,
  const uint8_t *data, size_t length, int flags, void *user_data);
 
-/**
- * @functypedef
- *
- * Callback function invoked when |session| wants to receive data from
- * the remote peer. The implementation of this function must read at
- * most |length| bytes of data and store it in |buf|. The |flags| is
- * currently not used and always 0. It must return the number of bytes
- * written in |buf| if it succeeds. If it cannot read any single byte
- * without blocking, it must return :enum:`SPDYLAY_ERR_WOULDBLOCK`. If
- * it gets EOF before it reads any single byte, it must return
- * :enum:`SPDYLAY_ERR_EOF`. For other errors, it must return
- * :enum:`SPDYLAY_ERR_CALLBACK_FAILURE`.
- */
-ssize_t spdy_recv_callback
-(spdylay_session *session,
- uint8_t *buf, size_t length, int flags, void *user_data);
-
 /**
  * @functypedef
  *
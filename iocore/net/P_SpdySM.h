@@ -93,6 +93,16 @@ public:
   void init(TSVConn conn);
   void clear();
 
+  //
+  // Look up a stream without inserting an empty entry,
+  // returns NULL if the stream has been deleted.
+  //
+  SpdyRequest *find_request(int32_t stream_id)
+  {
+    map<int32_t, SpdyRequest*>::iterator iter = req_map.find(stream_id);
+    return iter == req_map.end() ? NULL : iter->second;
+  }
+
 public:
 
   int64_t sm_id;
@@ -30,6 +30,7 @@
 #include "I_Layout.h"
 #include "Regex.h"
 #include "Trie.h"
+#include "HostTrie.h"
 #include "ts/TestBox.h"
 
 struct SSLAddressLookupKey
@@ -68,31 +69,160 @@ private:
   unsigned char sep; // offset of address/port separator
 };
 
+// Contexts released from the lazy context cache may still be in use by a
+// handshake that looked them up a moment before, so they are kept this long
+// before being freed.
+#define SSL_CONTEXT_RETIRE_TIME HRTIME_SECONDS(60)
+
+// Lazy contexts are built under one of these, picked by slot, so that a
+// certificate slow to read only holds up the handshakes that want it.
+#define SSL_CONTEXT_LOAD_LOCKS 64
+
+struct ats_wildcard_matcher
+{
+  ats_wildcard_matcher() {
+    if (regex.compile("^\\*\\.[^\\*.]+") != 0) {
+      Fatal("failed to compile TLS wildcard matching regex");
+    }
+  }
+
+  ~ats_wildcard_matcher() {
+  }
+
+  bool match(const char * hostname) const {
+    return regex.match(hostname) != -1;
+  }
+
+private:
+  DFA regex;
+};
+
+// Host names are indexed in a HostTrie, label by label from the top level
+// domain down, so that a single walk finds both the exact name and the most
+// specific wildcard covering it. A wildcard "*.foo.com" is bound to
+// ".foo.com", the empty label under foo.com, and also matches foo.com
+// itself. The trie holds slot + 1, since it can't hold NULL.
+
+// Inserting a wildcard twice fails, inserting an exact name twice replaces the previous slot.
+static bool
+ssl_name_insert(HostTrie& names, const char * name, int32_t slot, bool wildcard)
+{
+  char key[TS_MAX_HOST_NAME_LEN + 2];
+  int len = strlen(name);
+
+  if (len > TS_MAX_HOST_NAME_LEN) {
+    Error("host name '%s' is too long", name);
+    return false;
+  }
+
+  if (wildcard) {
+    key[0] = '.';
+    memcpy(key + 1, name, len);
+    return names.Insert(key, len + 1, (void *)(intptr_t)(slot + 1));
+  }
+
+  return names.Insert(name, len, (void *)(intptr_t)(slot + 1), true);
+}
+
+// The slot of the exact name, else of the longest wildcard match, else -1.
+static int32_t
+ssl_name_lookup(const HostTrie& names, const char * name)
+{
+  HostTrie::Node node = HostTrie::ROOT;
+  int32_t best = -1;
+  const char * end = name + strlen(name);
+
+  if (end == name) {
+    return -1;
+  }
+
+  for (;;) {
+    const char * start = end;
+    while (start > name && start[-1] != '.') {
+      --start;
+    }
+
+    // Only wildcards have empty labels.
+    if (start == end) {
+      return best;
+    }
+
+    node = names.child(node, start, end - start);
+    if (node == HostTrie::NO_NODE) {
+      return best;
+    }
+
+    HostTrie::Node domain = names.child(node, "", 0);
+    if (domain != HostTrie::NO_NODE && names.value(domain) != NULL) {
+      best = (int32_t)(intptr_t)names.value(domain) - 1;
+    }
+
+    if (start == name) {
+      break;
+    }
+    end = start - 1;
+  }
+
+  return names.value(node) != NULL ? (int32_t)(intptr_t)names.value(node) - 1 : best;
+}
+
 struct SSLContextStorage
 {
-  SSLContextStorage();
+  SSLContextStorage(SSLCertLookup * lookup);
   ~SSLContextStorage();
 
   bool insert(SSL_CTX * ctx, const char * name);
-  SSL_CTX * lookup(const char * name) const;
+  bool insert(int32_t slot, const char * name);
+  int32_t add(SSLCertSpec * spec);
+  SSL_CTX * lookup(const char * name);
+
+  void enable(SSLContextLoader loader, unsigned max_loaded);
+  unsigned count() const { return nslots; }
+  unsigned loaded() const { return ncontexts + nloaded; }
 
 private:
-  struct SSLEntry
+  struct SSLContextSlot
   {
-    explicit SSLEntry(SSL_CTX * c) : ctx(c) {}
-
-    void Print() const { Debug("ssl", "SSLEntry=%p SSL_CTX=%p", this, ctx); }
+    SSL_CTX * volatile ctx;
+    SSLCertSpec * spec;   // NULL if the context was created at load time
+    bool referenced;
+    bool failed;
+  };
 
+  struct SSLRetiredContext
+  {
     SSL_CTX * ctx;
-    LINK(SSLEntry, link);
+    ink_hrtime when;
+    LINK(SSLRetiredContext, link);
   };
 
-  Trie<SSLEntry>  wildcards;
-  InkHashTable *  hostnames;
-  Vec<SSL_CTX *>  references;
+  int32_t new_slot();
+  SSL_CTX * load(int32_t slot);
+  void retire(SSL_CTX * ctx);
+  void reap(bool all);
+
+  SSLCertLookup *   owner;
+  ats_wildcard_matcher wildcard;
+  HostTrie          names;
+  InkHashTable *    contexts;   // SSL_CTX to slot, for contexts created at load time
+  unsigned          ncontexts;
+  SSLContextSlot *  slots;
+  uint32_t          nslots;
+  uint32_t          slots_alloc;
+
+  // Lazily loaded contexts, released in CLOCK order once there are max_loaded of them.
+  // The mutex only covers the CLOCK and the retired contexts, never a load.
+  ink_mutex         mutex;
+  ink_mutex         load_locks[SSL_CONTEXT_LOAD_LOCKS];
+  SSLContextLoader  loader;
+  int32_t *         ring;
+  unsigned          max_loaded;
+  unsigned          nloaded;
+  unsigned          hand;
+  Queue<SSLRetiredContext> retired;
 };
 
-SSLCertLookup::SSLCertLookup() : ssl_storage(NEW(new SSLContextStorage())), ssl_default(NULL)
+SSLCertLookup::SSLCertLookup() : ssl_storage(NEW(new SSLContextStorage(this))), ssl_default(NULL)
 {
 }
 
@@ -139,148 +269,385 @@ SSLCertLookup::insert(SSL_CTX * ctx, const IpEndpoint& address)
   return this->ssl_storage->insert(ctx, key.get());
 }
 
-struct ats_wildcard_matcher
+void
+SSLCertLookup::enableLazyContexts(SSLContextLoader loader, unsigned max_loaded)
 {
-  ats_wildcard_matcher() {
-    if (regex.compile("^\\*\\.[^\\*.]+") != 0) {
-      Fatal("failed to compile TLS wildcard matching regex");
+  this->ssl_storage->enable(loader, max_loaded);
+}
+
+int
+SSLCertLookup::add(SSLCertSpec * spec)
+{
+  return this->ssl_storage->add(spec);
+}
+
+bool
+SSLCertLookup::insert(int handle, const char * name)
+{
+  return this->ssl_storage->insert(handle, name);
+}
+
+unsigned
+SSLCertLookup::count() const
+{
+  return this->ssl_storage->count();
+}
+
+unsigned
+SSLCertLookup::loaded() const
+{
+  return this->ssl_storage->loaded();
+}
+
+SSLContextStorage::SSLContextStorage(SSLCertLookup * lookup)
+  : owner(lookup), wildcard(), names(), contexts(ink_hash_table_create(InkHashTableKeyType_Word)), ncontexts(0),
+    slots(NULL), nslots(0), slots_alloc(0), loader(NULL), ring(NULL), max_loaded(0), nloaded(0), hand(0), retired()
+{
+  ink_mutex_init(&this->mutex, "SSLContextStorage");
+  for (int i = 0; i < SSL_CONTEXT_LOAD_LOCKS; ++i) {
+    ink_mutex_init(&this->load_locks[i], "SSLContextStorage load");
+  }
+}
+
+SSLContextStorage::~SSLContextStorage()
+{
+  for (uint32_t i = 0; i < this->nslots; ++i) {
+    if (this->slots[i].ctx) {
+      SSLReleaseContext(this->slots[i].ctx);
     }
+    delete this->slots[i].spec;
   }
 
-  ~ats_wildcard_matcher() {
+  this->reap(true /* all */);
+
+  ats_free(this->slots);
+  ats_free(this->ring);
+  ink_hash_table_destroy(this->contexts);
+  ink_mutex_destroy(&this->mutex);
+  for (int i = 0; i < SSL_CONTEXT_LOAD_LOCKS; ++i) {
+    ink_mutex_destroy(&this->load_locks[i]);
   }
+}
 
-  bool match(const char * hostname) const {
-    return regex.match(hostname) != -1;
+void
+SSLContextStorage::enable(SSLContextLoader _loader, unsigned _max_loaded)
+{
+  ink_release_assert(this->loader == NULL);
+
+  this->loader = _loader;
+  this->max_loaded = MAX(_max_loaded, 1U);
+  this->ring = (int32_t *)ats_malloc(this->max_loaded * sizeof(int32_t));
+}
+
+int32_t
+SSLContextStorage::new_slot()
+{
+  if (this->nslots == this->slots_alloc) {
+    this->slots_alloc = MAX(this->slots_alloc * 2, 64U);
+    this->slots = (SSLContextSlot *)ats_realloc(this->slots, this->slots_alloc * sizeof(SSLContextSlot));
   }
 
-private:
-  DFA regex;
-};
+  SSLContextSlot& slot = this->slots[this->nslots];
+  slot.ctx = NULL;
+  slot.spec = NULL;
+  slot.referenced = false;
+  slot.failed = false;
+
+  return this->nslots++;
+}
 
-static char *
-reverse_dns_name(const char * hostname, char (&reversed)[TS_MAX_HOST_NAME_LEN+1])
+int32_t
+SSLContextStorage::add(SSLCertSpec * spec)
 {
-  char * ptr = reversed + sizeof(reversed);
-  const char * part = hostname;
+  ink_assert(this->loader != NULL);
 
-  *(--ptr) = '\0'; // NUL-terminate
+  int32_t slot = this->new_slot();
+  this->slots[slot].spec = spec;
+  return slot;
+}
+
+bool
+SSLContextStorage::insert(SSL_CTX * ctx, const char * name)
+{
+  InkHashTableValue value;
+  int32_t slot;
 
-  while (*part) {
-    ssize_t len = strcspn(part, ".");
-    ssize_t remain = ptr - reversed;
+  // Since we index by name, multiple certificates can be indexed for the same name, so keep a single slot per
+  // context; the slot holds the reference we free the context with.
+  if (ink_hash_table_lookup(this->contexts, (const char *)ctx, &value)) {
+    slot = (int32_t)(intptr_t)value;
+  } else {
+    slot = this->new_slot();
+    this->slots[slot].ctx = ctx;
+    ink_hash_table_insert(this->contexts, (const char *)ctx, (void *)(intptr_t)slot);
+    ++this->ncontexts;
+  }
 
-    // We are going to put the '.' separator back for all components except the first.
-    if (*ptr == '\0') {
-      if (remain < len) {
-        return NULL;
-      }
+  return this->insert(slot, name);
+}
+
+bool
+SSLContextStorage::insert(int32_t slot, const char * name)
+{
+  ink_assert(slot >= 0 && (uint32_t)slot < this->nslots);
+
+  if (this->wildcard.match(name)) {
+    Debug("ssl", "indexed wildcard certificate for '%s' in slot %d", name, slot);
+    return ssl_name_insert(this->names, name + 2, slot, true);
+  }
+
+  Debug("ssl", "indexed '%s' in slot %d", name, slot);
+  return ssl_name_insert(this->names, name, slot, false);
+}
+
+SSL_CTX *
+SSLContextStorage::lookup(const char * name)
+{
+  int32_t i = ssl_name_lookup(this->names, name);
+
+  if (i == -1) {
+    return NULL;
+  }
+
+  SSLContextSlot& slot = this->slots[i];
+  SSL_CTX * ctx = slot.ctx;
+
+  if (slot.spec == NULL) {
+    return ctx;
+  }
+
+  slot.referenced = true;
+  return ctx ? ctx : this->load(i);
+}
+
+SSL_CTX *
+SSLContextStorage::load(int32_t i)
+{
+  SSLContextSlot& slot = this->slots[i];
+  ink_mutex * load_lock = &this->load_locks[i % SSL_CONTEXT_LOAD_LOCKS];
+  SSL_CTX * ctx;
+
+  ink_mutex_acquire(load_lock);
+
+  // Another thread may have loaded it while we waited for the lock.
+  ctx = slot.ctx;
+  if (ctx == NULL && !slot.failed) {
+    // Reading the certificate is the slow part, it is done holding only this slot's lock.
+    ctx = this->loader(this->owner, slot.spec);
+    if (ctx == NULL) {
+      // Don't retry on every handshake, a reload clears this.
+      Error("failed to load SSL certificate %s", slot.spec->cert);
+      slot.failed = true;
     } else {
-      if (remain < (len + 1)) {
-        return NULL;
+      ink_mutex_acquire(&this->mutex);
+
+      if (this->nloaded < this->max_loaded) {
+        this->ring[this->nloaded++] = i;
+      } else {
+        // CLOCK: skip over (and clear) the recently used contexts, release the first one that wasn't.
+        for (unsigned n = 0; n < 2 * this->max_loaded; ++n) {
+          SSLContextSlot& victim = this->slots[this->ring[this->hand]];
+          if (!victim.referenced) {
+            break;
+          }
+          victim.referenced = false;
+          this->hand = (this->hand + 1) % this->max_loaded;
+        }
+
+        SSLContextSlot& victim = this->slots[this->ring[this->hand]];
+        Debug("ssl", "releasing SSL context for %s", victim.spec->cert);
+        this->retire(victim.ctx);
+        victim.ctx = NULL;
+
+        this->ring[this->hand] = i;
+        this->hand = (this->hand + 1) % this->max_loaded;
       }
-      *(--ptr) = '.';
-    }
 
-    ptr -= len;
-    memcpy(ptr, part, len);
+      Debug("ssl", "loaded SSL context %p for %s", ctx, slot.spec->cert);
+      slot.ctx = ctx;
 
-    // Skip to the next domain component. This will take us to either a '.' or a NUL.
-    // If it's a '.' we need to skip over it.
-    part += len;
-    if (*part == '.') {
-      ++part;
+      this->reap(false);
+      ink_mutex_release(&this->mutex);
     }
   }
 
-  return ptr;
+  ink_mutex_release(load_lock);
+
+  return ctx;
 }
 
-SSLContextStorage::SSLContextStorage()
-  :wildcards(), hostnames(ink_hash_table_create(InkHashTableKeyType_String))
+void
+SSLContextStorage::retire(SSL_CTX * ctx)
 {
+  SSLRetiredContext * r = NEW(new SSLRetiredContext);
+
+  r->ctx = ctx;
+  r->when = ink_get_hrtime_internal();
+  this->retired.enqueue(r);
 }
 
-SSLContextStorage::~SSLContextStorage()
+void
+SSLContextStorage::reap(bool all)
 {
-  for (int i = 0; i < this->references.count(); ++i) {
-    SSLReleaseContext(this->references[i]);
+  ink_hrtime now = ink_get_hrtime_internal();
+
+  while (this->retired.head && (all || now - this->retired.head->when > SSL_CONTEXT_RETIRE_TIME)) {
+    SSLRetiredContext * r = this->retired.dequeue();
+    SSLReleaseContext(r->ctx);
+    delete r;
   }
+}
+
+struct SSLCertNameIndex::Entry
+{
+  int64_t mtime;        // nanoseconds
+  int64_t inode;
+  int64_t size;
+  char * names;
+};
 
-  ink_hash_table_destroy(this->hostnames);
+// A certificate replaced within the same second, or by a file of the same
+// size, still differs in one of these.
+static inline int64_t
+cert_mtime_nsec(const struct stat& st)
+{
+#if defined(darwin) || defined(freebsd)
+  return (int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+  return (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
 }
 
+SSLCertNameIndex::SSLCertNameIndex() : entries(ink_hash_table_create(InkHashTableKeyType_String)), nentries(0)
+{
+}
 
-bool
-SSLContextStorage::insert(SSL_CTX * ctx, const char * name)
+SSLCertNameIndex::~SSLCertNameIndex()
 {
-  ats_wildcard_matcher wildcard;
-  bool inserted = true;
-
-  if (wildcard.match(name)) {
-    // We turn wildcards into the reverse DNS form, then insert them into the trie
-    // so that we can do a longest match lookup.
-    char namebuf[TS_MAX_HOST_NAME_LEN + 1];
-    char * reversed;
-    xptr<SSLEntry> entry;
-
-    reversed = reverse_dns_name(name + 2, namebuf);
-    if (!reversed) {
-      Error("wildcard name '%s' is too long", name);
-      return false;
-    }
+  InkHashTableIteratorState state;
 
-    Debug("ssl", "indexed wildcard certificate for '%s' as '%s' with SSL_CTX %p", name, reversed, ctx);
-    entry = new SSLEntry(ctx);
-    inserted = this->wildcards.Insert(reversed, entry, 0 /* rank */, -1 /* keylen */);
-    if (inserted) {
-      entry.release();
-    }
-  } else {
-    Debug("ssl", "indexed '%s' with SSL_CTX %p", name, ctx);
-    ink_hash_table_insert(this->hostnames, name, (void *)ctx);
+  for (InkHashTableEntry * he = ink_hash_table_iterator_first(this->entries, &state); he;
+       he = ink_hash_table_iterator_next(this->entries, &state)) {
+    Entry * e = (Entry *)ink_hash_table_entry_value(this->entries, he);
+    ats_free(e->names);
+    delete e;
   }
 
-  // Keep a unique reference to the SSL_CTX, so that we can free it later. Since we index by name, multiple
-  // certificates can be indexed for the same name. If this happens, we will overwrite the previous pointer
-  // and leak a context. So if we insert a certificate, keep an ownership reference to it.
-  if (inserted) {
-    if (this->references.in(ctx) == NULL) {
-      this->references.push_back(ctx);
+  ink_hash_table_destroy(this->entries);
+}
+
+const char *
+SSLCertNameIndex::find(const char * certfile, const struct stat& st) const
+{
+  InkHashTableValue value;
+
+  if (ink_hash_table_lookup(this->entries, certfile, &value)) {
+    const Entry * e = (const Entry *)value;
+    if (e->mtime == cert_mtime_nsec(st) && e->inode == (int64_t)st.st_ino && e->size == (int64_t)st.st_size) {
+      return e->names;
     }
   }
 
-  return inserted;
+  return NULL;
 }
 
-SSL_CTX *
-SSLContextStorage::lookup(const char * name) const
+void
+SSLCertNameIndex::add(const char * certfile, const struct stat& st, const char * names)
+{
+  this->add(certfile, cert_mtime_nsec(st), st.st_ino, st.st_size, names);
+}
+
+void
+SSLCertNameIndex::add(const char * certfile, int64_t mtime, int64_t inode, int64_t size, const char * names)
 {
   InkHashTableValue value;
+  Entry * e;
 
-  if (ink_hash_table_lookup(const_cast<InkHashTable *>(this->hostnames), name, &value)) {
-    return (SSL_CTX *)value;
+  if (ink_hash_table_lookup(this->entries, certfile, &value)) {
+    e = (Entry *)value;
+    ats_free(e->names);
+  } else {
+    e = NEW(new Entry);
+    ink_hash_table_insert(this->entries, certfile, e);
+    ++this->nentries;
   }
 
-  if (!this->wildcards.Empty()) {
-    char namebuf[TS_MAX_HOST_NAME_LEN + 1];
-    char * reversed;
-    SSLEntry * entry;
+  e->mtime = mtime;
+  e->inode = inode;
+  e->size = size;
+  e->names = ats_strdup(names);
+}
 
-    reversed = reverse_dns_name(name, namebuf);
-    if (!reversed) {
-      Error("failed to reverse hostname name '%s' is too long", name);
-      return NULL;
+// The index is a text file, one certificate per line:
+//    <path> TAB <mtime in ns> TAB <inode> TAB <size> TAB <name> [SPACE <name> ...]
+bool
+SSLCertNameIndex::load(const char * path)
+{
+  xptr<char> buf;
+  char * tok_state = NULL;
+  char * line;
+
+  buf = readIntoBuffer((char *)path, __func__, NULL);
+  if (!buf) {
+    return false;
+  }
+
+  for (line = tokLine(buf, &tok_state); line; line = tokLine(NULL, &tok_state)) {
+    char * fields[5];
+    unsigned n = 0;
+
+    fields[n++] = line;
+    for (char * p = line; *p && n < 5; ++p) {
+      if (*p == '\t') {
+        *p = '\0';
+        fields[n++] = p + 1;
+      }
     }
 
-    Debug("ssl", "attempting wildcard match for %s", reversed);
-    entry = this->wildcards.Search(reversed);
-    if (entry) {
-      return entry->ctx;
+    // Lines without the inode are from an older index, those certificates are just read again.
+    if (n != 5) {
+      if (n != 4) {
+        Warning("ignoring malformed line in SSL certificate index %s", path);
+      }
+      continue;
     }
+
+    this->add(fields[0], strtoll(fields[1], NULL, 10), strtoll(fields[2], NULL, 10), strtoll(fields[3], NULL, 10),
+              fields[4]);
   }
 
-  return NULL;
+  return true;
+}
+
+bool
+SSLCertNameIndex::save(const char * path) const
+{
+  InkHashTableIteratorState state;
+  char tmp[PATH_NAME_MAX + 1];
+  FILE * fp;
+
+  // Write a new file and move it in place so that a crash never leaves a truncated index.
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  if ((fp = fopen(tmp, "w")) == NULL) {
+    Error("failed to write SSL certificate index %s: %s", tmp, strerror(errno));
+    return false;
+  }
+
+  for (InkHashTableEntry * he = ink_hash_table_iterator_first(this->entries, &state); he;
+       he = ink_hash_table_iterator_next(this->entries, &state)) {
+    const char * certfile = (const char *)ink_hash_table_entry_key(this->entries, he);
+    const Entry * e = (const Entry *)ink_hash_table_entry_value(this->entries, he);
+
+    fprintf(fp, "%s\t%" PRId64 "\t%" PRId64 "\t%" PRId64 "\t%s\n", certfile, e->mtime, e->inode, e->size, e->names);
+  }
+
+  if (fclose(fp) != 0 || rename(tmp, path) != 0) {
+    Error("failed to write SSL certificate index %s: %s", path, strerror(errno));
+    unlink(tmp);
+    return false;
+  }
+
+  return true;
 }
 
 #if TS_HAS_TESTS
@@ -298,21 +665,32 @@ REGRESSION_TEST(SSLWildcardMatch)(RegressionTest * t, int atype, int * pstatus)
   box.check(wildcard.match("") == false, "'' is not a wildcard");
 }
 
-REGRESSION_TEST(SSLReverseHostname)(RegressionTest * t, int atype, int * pstatus)
+REGRESSION_TEST(SSLNameLookup)(RegressionTest * t, int atype, int * pstatus)
 {
   TestBox box(t, pstatus);
-
-  char reversed[TS_MAX_HOST_NAME_LEN + 1];
-
-#define _R(name) reverse_dns_name(name, reversed)
+  HostTrie names;
 
   box = REGRESSION_TEST_PASSED;
 
-  box.check(strcmp(_R("foo.com"), "com.foo") == 0, "reversed foo.com");
-  box.check(strcmp(_R("bar.foo.com"), "com.foo.bar") == 0, "reversed bar.foo.com");
-  box.check(strcmp(_R("foo"), "foo") == 0, "reversed foo");
-
-#undef _R
+  box.check(ssl_name_insert(names, "www.foo.com", 1, false), "insert www.foo.com");
+  box.check(ssl_name_insert(names, "foo.com", 2, true), "insert *.foo.com");
+  box.check(ssl_name_insert(names, "b.foo.com", 3, true), "insert *.b.foo.com");
+  box.check(ssl_name_insert(names, "foo.com", 4, true) == false, "insert *.foo.com again");
+  box.check(ssl_name_insert(names, "*", 5, false), "insert *");
+  box.check(ssl_name_insert(names, "bar.org", 6, false), "insert bar.org");
+  box.check(ssl_name_insert(names, "BAR.org", 7, false), "insert BAR.org again");
+
+  box.check(ssl_name_lookup(names, "www.foo.com") == 1, "exact match for www.foo.com");
+  box.check(ssl_name_lookup(names, "WWW.Foo.COM") == 1, "case insensitive match for WWW.Foo.COM");
+  box.check(ssl_name_lookup(names, "a.foo.com") == 2, "wildcard match for a.foo.com");
+  box.check(ssl_name_lookup(names, "foo.com") == 2, "wildcard match for foo.com");
+  box.check(ssl_name_lookup(names, "c.b.foo.com") == 3, "longest wildcard match for c.b.foo.com");
+  box.check(ssl_name_lookup(names, "x.www.foo.com") == 2, "wildcard match below an exact name");
+  box.check(ssl_name_lookup(names, "foo.comx") == -1, "no match on a partial label");
+  box.check(ssl_name_lookup(names, "bar.com") == -1, "no match for bar.com");
+  box.check(ssl_name_lookup(names, "bar.org") == 7, "exact name replaced");
+  box.check(ssl_name_lookup(names, "*") == 5, "exact match for *");
+  box.check(ssl_name_lookup(names, "") == -1, "no match for ''");
 }
 
 #endif // TS_HAS_TESTS
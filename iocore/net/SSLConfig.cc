@@ -42,6 +42,7 @@
 int SSLConfig::configid = 0;
 int SSLCertificateConfig::configid = 0;
 int SSLConfigParams::ssl_maxrecord = 0;
+int SSLConfigParams::ssl_ktls = 0;
 
 static Ptr<ProxyMutex> ssl_certificate_mutex = NULL;
 
@@ -50,17 +51,21 @@ SSLConfigParams::SSLConfigParams()
   serverCertPathOnly =
     serverCertChainFilename =
     configFilePath =
+    certIndexFilePath =
     serverCACertFilename = serverCACertPath =
     clientCertPath = clientKeyPath =
     clientCACertFilename = clientCACertPath =
     cipherSuite =
-    serverKeyPathOnly = NULL;
+    serverKeyPathOnly =
+    ssl_session_cache_filename = NULL;
 
   clientCertLevel = client_verify_depth = verify_depth = clientVerify = 0;
 
   ssl_ctx_options = 0;
+  lazy_contexts = 0;
   ssl_session_cache = SSL_SESSION_CACHE_MODE_SERVER;
   ssl_session_cache_size = 1024*20;
+  ssl_session_cache_timeout = 0;
 }
 
 SSLConfigParams::~SSLConfigParams()
@@ -79,9 +84,11 @@ SSLConfigParams::cleanup()
   ats_free_null(clientCACertFilename);
   ats_free_null(clientCACertPath);
   ats_free_null(configFilePath);
+  ats_free_null(certIndexFilePath);
   ats_free_null(serverCertPathOnly);
   ats_free_null(serverKeyPathOnly);
   ats_free_null(cipherSuite);
+  ats_free_null(ssl_session_cache_filename);
 
   clientCertLevel = client_verify_depth = verify_depth = clientVerify = 0;
 }
@@ -187,6 +194,18 @@ SSLConfigParams::initialize()
   set_paths_helper(Layout::get()->sysconfdir, multicert_config_file, NULL, &configFilePath);
   ats_free(multicert_config_file);
 
+  IOCORE_ReadConfigInteger(lazy_contexts, "proxy.config.ssl.server.lazy_contexts");
+  if (lazy_contexts > 0) {
+    char *filename = NULL;
+    IOCORE_ReadConfigStringAlloc(filename, "proxy.config.ssl.server.cert_index.filename");
+    if (filename) {
+      certIndexFilePath = Layout::relative_to(Layout::get()->runtimedir, filename);
+      ats_free(filename);
+    }
+  } else {
+    lazy_contexts = 0;
+  }
+
   IOCORE_ReadConfigStringAlloc(ssl_server_private_key_path, "proxy.config.ssl.server.private_key.path");
   set_paths_helper(ssl_server_private_key_path, NULL, &serverKeyPathOnly, NULL);
   ats_free(ssl_server_private_key_path);
@@ -199,10 +218,22 @@ SSLConfigParams::initialize()
   // SSL session cache configurations
   IOCORE_ReadConfigInteger(ssl_session_cache, "proxy.config.ssl.session_cache");
   IOCORE_ReadConfigInteger(ssl_session_cache_size, "proxy.config.ssl.session_cache.size");
+  IOCORE_ReadConfigInteger(ssl_session_cache_timeout, "proxy.config.ssl.session_cache.timeout");
+  if (ssl_session_cache == SSL_SESSION_CACHE_MODE_SERVER_SHARED) {
+    char *filename = NULL;
+    IOCORE_ReadConfigStringAlloc(filename, "proxy.config.ssl.session_cache.filename");
+    if (filename) {
+      ssl_session_cache_filename = Layout::relative_to(Layout::get()->runtimedir, filename);
+      ats_free(filename);
+    }
+  }
 
   // SSL record size
   REC_EstablishStaticConfigInt32(ssl_maxrecord, "proxy.config.ssl.max_record_size");
 
+  // Kernel TLS transmit offload
+  REC_EstablishStaticConfigInt32(ssl_ktls, "proxy.config.ssl.ktls");
+
   // ++++++++++++++++++++++++ Client part ++++++++++++++++++++
   client_verify_depth = 7;
   IOCORE_ReadConfigInt32(clientVerify, "proxy.config.ssl.client.verify.server");
@@ -25,6 +25,7 @@
 #include "I_Layout.h"
 #include "I_RecHttp.h"
 #include "P_SSLUtils.h"
+#include "P_SSLSessionCache.h"
 
 //
 // Global Data
@@ -33,6 +34,8 @@
 SSLNetProcessor   ssl_NetProcessor;
 NetProcessor&     sslNetProcessor = ssl_NetProcessor;
 EventType         SSLNetProcessor::ET_SSL;
+int               SSLNetProcessor::handshake_threads = 0;
+EventType         SSLNetProcessor::ET_SSL_HANDSHAKE;
 
 void
 SSLNetProcessor::cleanup(void)
@@ -50,6 +53,20 @@ SSLNetProcessor::start(int number_of_ssl_threads)
   SSLInitializeLibrary();
   SSLConfig::startup();
 
+  // The shared session cache has to be mapped before the server contexts
+  // are built so that they can attach to it.
+  {
+    SSLConfig::scoped_config params;
+
+    if (params->ssl_session_cache == SSLConfigParams::SSL_SESSION_CACHE_MODE_SERVER_SHARED) {
+      ssl_session_cache = SSLSessionCache::open(params->ssl_session_cache_filename, params->ssl_session_cache_size);
+      if (!ssl_session_cache) {
+        Warning("unable to open the shared SSL session cache %s, using a per process cache",
+                params->ssl_session_cache_filename);
+      }
+    }
+  }
+
   if (HttpProxyPort::hasSSL()) {
     SSLCertificateConfig::startup();
   }
@@ -68,6 +85,15 @@ SSLNetProcessor::start(int number_of_ssl_threads)
     return -1;
 
   SSLNetProcessor::ET_SSL = eventProcessor.spawn_event_threads(number_of_ssl_threads, "ET_SSL");
+
+  // The private key operations of a handshake take milliseconds of CPU,
+  // keep them off the threads serving established connections.
+  IOCORE_ReadConfigInteger(handshake_threads, "proxy.config.ssl.handshake_threads");
+  if (handshake_threads > 0) {
+    SSLNetProcessor::ET_SSL_HANDSHAKE = eventProcessor.spawn_event_threads(handshake_threads, "ET_SSL_HANDSHAKE");
+  } else {
+    handshake_threads = 0;
+  }
   return UnixNetProcessor::start();
 }
 
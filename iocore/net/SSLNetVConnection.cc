@@ -173,6 +173,13 @@ ssl_read_from_net(NetHandler * nh, UnixNetVConnection * vc, EThread * lthread, i
     }
 #endif
   }
+
+  // The client renegotiated or OpenSSL raised an alert, neither of which reached it.
+  if (unlikely(sslvc->sslKernelTLSDesync)) {
+    event = SSL_READ_ERROR;
+    ret = EPROTO;
+  }
+
   return (event);
 
 }
@@ -331,6 +338,15 @@ SSLNetVConnection::load_buffer_and_write(int64_t towrite, int64_t &wattempted, i
   int64_t offset = buf.entry->start_offset;
   IOBufferBlock *b = buf.entry->block;
 
+  // With kernel TLS the socket takes plaintext, so write straight from the buffer blocks.
+  if (sslKernelTLS) {
+    r = UnixNetVConnection::load_buffer_and_write(towrite, wattempted, total_wrote, buf);
+    if (r > 0) {
+      NET_SUM_GLOBAL_DYN_STAT(ssl_ktls_bytes_stat, r);
+    }
+    return r;
+  }
+
   do {
     // check if we have done this block
     l = b->read_avail();
@@ -414,7 +430,116 @@ SSLNetVConnection::load_buffer_and_write(int64_t towrite, int64_t &wattempted, i
   }
 }
 
+// struct SSLHandshakeJob
+//
+//   Runs one SSL_accept() step of a server connection on an
+//   ET_SSL_HANDSHAKE thread and then wakes the connection up on its
+//   own net thread.  While it runs it holds the VIO mutexes, so the
+//   connection can't be closed from under it.  The job and the
+//   connection only look at each other under the job mutex; a
+//   connection freed while its job is outstanding detaches it first
+//   (see SSLNetVConnection::free) and the job cleans up after itself.
+//
+struct SSLHandshakeJob: public Continuation
+{
+  SSLNetVConnection *vc;
+  EThread *vc_thread;
+  ink_hrtime queued_at;
+  int ret;
+  int err;
+
+  SSLHandshakeJob(SSLNetVConnection *avc)
+    : Continuation(new_ProxyMutex()), vc(avc), vc_thread(avc->thread), queued_at(ink_get_hrtime()), ret(0), err(0)
+  {
+    SET_HANDLER(&SSLHandshakeJob::handshakeEvent);
+  }
+
+  // On ET_SSL_HANDSHAKE
+  int handshakeEvent(int event, Event *e)
+  {
+    NOWARN_UNUSED(event);
+    if (vc == NULL) {
+      NET_SUM_GLOBAL_DYN_STAT(ssl_handshakes_queued_stat, -1);
+      delete this;
+      return EVENT_DONE;
+    }
+
+    MUTEX_TRY_LOCK(rlock, vc->read.vio.mutex ? (ProxyMutex *) vc->read.vio.mutex : (ProxyMutex *) e->ethread->mutex,
+                   e->ethread);
+    MUTEX_TRY_LOCK(wlock, vc->write.vio.mutex ? (ProxyMutex *) vc->write.vio.mutex : (ProxyMutex *) e->ethread->mutex,
+                   e->ethread);
+    if (!rlock || !wlock ||
+        (vc->read.vio.mutex.m_ptr && rlock.m.m_ptr != vc->read.vio.mutex.m_ptr) ||
+        (vc->write.vio.mutex.m_ptr && wlock.m.m_ptr != vc->write.vio.mutex.m_ptr)) {
+      e->schedule_in(NET_RETRY_DELAY);
+      return EVENT_CONT;
+    }
+
+    NET_SUM_GLOBAL_DYN_STAT(ssl_handshakes_queued_stat, -1);
+    RecIncrRawStatHistogram(ssl_handshake_queue_histogram, e->ethread,
+                            ink_hrtime_to_usec(ink_get_hrtime() - queued_at));
+
+    if (vc->closed) {
+      ret = EVENT_ERROR;
+    } else {
+      ret = vc->sslServerHandShakeEvent(err);
+      // Completion is reported from the net thread, so that a read
+      //   driving the handshake is signalled as it would be inline.
+      if (ret == EVENT_DONE)
+        vc->setSSLHandShakeComplete(false);
+    }
+
+    SET_HANDLER(&SSLHandshakeJob::resumeEvent);
+    vc_thread->schedule_imm(this);
+    return EVENT_DONE;
+  }
+
+  // Back on the connection's net thread
+  int resumeEvent(int event, Event *e)
+  {
+    NOWARN_UNUSED(event);
+    if (vc == NULL) {
+      delete this;
+      return EVENT_DONE;
+    }
+
+    NetHandler *nh = vc->nh;
+    MUTEX_TRY_LOCK(lock, nh->mutex, e->ethread);
+    if (!lock) {
+      e->schedule_in(NET_RETRY_DELAY);
+      return EVENT_CONT;
+    }
+
+    vc->sslHandshakeJob = NULL;
+    // A step that wants more I/O is retried if some came in meanwhile,
+    //   otherwise on the next poll event
+    if (ret == EVENT_DONE || ret == EVENT_ERROR || vc->sslHandshakeJobEvent) {
+      if (ret == EVENT_DONE || ret == EVENT_ERROR) {
+        vc->sslHandshakeJobRet = ret;
+        vc->sslHandshakeJobErr = err;
+      }
+      vc->read.triggered = 1;
+      if (vc->read.enabled)
+        nh->read_ready_list.in_or_enqueue(vc);
+      vc->write.triggered = 1;
+      if (vc->write.enabled)
+        nh->write_ready_list.in_or_enqueue(vc);
+    }
+    vc->sslHandshakeJobEvent = false;
+
+    delete this;
+    return EVENT_DONE;
+  }
+};
+
 SSLNetVConnection::SSLNetVConnection():
+  sslHandshakeJob(NULL),
+  sslHandshakeJobEvent(false),
+  sslHandshakeJobRet(0),
+  sslHandshakeJobErr(0),
+  sslHandshakeBeginTime(0),
+  sslKernelTLS(false),
+  sslKernelTLSDesync(false),
   sslHandShakeComplete(false),
   sslClientConnection(false),
   npnSet(NULL),
@@ -423,8 +548,45 @@ SSLNetVConnection::SSLNetVConnection():
   ssl = NULL;
 }
 
+// struct SSLNetVConnFreeRetry
+//
+//   Frees a connection whose handshake step was running when it was
+//   first freed, once the step has let go of it.
+//
+struct SSLNetVConnFreeRetry: public Continuation
+{
+  SSLNetVConnection *vc;
+
+  SSLNetVConnFreeRetry(SSLNetVConnection *avc)
+    : Continuation(NULL), vc(avc)
+  {
+    SET_HANDLER(&SSLNetVConnFreeRetry::retryEvent);
+  }
+
+  int retryEvent(int event, Event *e)
+  {
+    NOWARN_UNUSED(event);
+    vc->free(e->ethread);
+    delete this;
+    return EVENT_DONE;
+  }
+};
+
 void
 SSLNetVConnection::free(EThread * t) {
+  if (sslHandshakeJob) {
+    // Closed with a handshake step queued.  Detach it under its mutex
+    //   before anything it looks at is reset; the job then frees
+    //   itself.  If the step is running, come back once it is done
+    //   rather than block the net thread.
+    MUTEX_TRY_LOCK(lock, sslHandshakeJob->mutex, t);
+    if (!lock) {
+      t->schedule_in(NEW(new SSLNetVConnFreeRetry(this)), NET_RETRY_DELAY);
+      return;
+    }
+    sslHandshakeJob->vc = NULL;
+    sslHandshakeJob = NULL;
+  }
   NET_SUM_GLOBAL_DYN_STAT(net_connections_currently_open_stat, -1);
   got_remote_addr = 0;
   got_local_addr = 0;
@@ -439,6 +601,11 @@ SSLNetVConnection::free(EThread * t) {
   options.reset();
   closed = 0;
   ink_assert(con.fd == NO_FD);
+  sslHandshakeJobEvent = false;
+  sslHandshakeJobRet = 0;
+  sslHandshakeBeginTime = 0;
+  sslKernelTLS = false;
+  sslKernelTLSDesync = false;
   if (ssl != NULL) {
     /*if (sslHandShakeComplete)
        SSL_set_shutdown(ssl, SSL_SENT_SHUTDOWN|SSL_RECEIVED_SHUTDOWN); */
@@ -457,6 +624,16 @@ SSLNetVConnection::free(EThread * t) {
   }
 }
 
+void
+SSLNetVConnection::do_io_close(int lerrno)
+{
+  // OpenSSL can't send close_notify once the kernel has the keys.
+  if (sslKernelTLS && !sslKernelTLSDesync && lerrno == -1 && con.fd != NO_FD) {
+    SSLKernelTLSCloseNotify(con.fd);
+  }
+  UnixNetVConnection::do_io_close(lerrno);
+}
+
 int
 SSLNetVConnection::sslStartHandShake(int event, int &err)
 {
@@ -474,6 +651,10 @@ SSLNetVConnection::sslStartHandShake(int event, int &err)
       }
     }
 
+    if (sslHandshakeBeginTime == 0)
+      sslHandshakeBeginTime = ink_get_hrtime();
+    if (SSLNetProcessor::handshake_threads > 0)
+      return sslServerHandShakeOffload(err);
     return sslServerHandShakeEvent(err);
   } else {
     ink_assert(event == SSL_EVENT_CLIENT);
@@ -517,6 +698,13 @@ SSLNetVConnection::sslServerHandShakeEvent(int &err)
       X509_free(client_cert);
     }
     sslHandShakeComplete = 1;
+    NET_SUM_GLOBAL_DYN_STAT(SSL_session_reused(ssl) ? ssl_handshakes_resumed_stat : ssl_handshakes_full_stat, 1);
+    if (SSLConfigParams::ssl_ktls) {
+      sslKernelTLS = SSLEnableKernelTLS(ssl, con.fd);
+      NET_SUM_GLOBAL_DYN_STAT(sslKernelTLS ? ssl_ktls_connections_stat : ssl_ktls_fallbacks_stat, 1);
+    }
+    RecIncrRawStatHistogram(ssl_handshake_time_histogram, this_ethread(),
+                            ink_hrtime_to_usec(ink_get_hrtime() - sslHandshakeBeginTime));
 
 #if TS_USE_TLS_NPN
     {
@@ -560,6 +748,33 @@ SSLNetVConnection::sslServerHandShakeEvent(int &err)
 }
 
 
+int
+SSLNetVConnection::sslServerHandShakeOffload(int &err)
+{
+  if (sslHandshakeJob) {
+    // Resumed by the job
+    sslHandshakeJobEvent = true;
+    return SSL_HANDSHAKE_WANT_ACCEPT;
+  }
+
+  if (sslHandshakeJobRet) {
+    int ret = sslHandshakeJobRet;
+    sslHandshakeJobRet = 0;
+    err = sslHandshakeJobErr;
+    if (ret == EVENT_DONE)
+      sslHandShakeComplete = 1;
+    return ret;
+  }
+
+  sslHandshakeJob = NEW(new SSLHandshakeJob(this));
+  sslHandshakeJobEvent = false;
+  NET_SUM_GLOBAL_DYN_STAT(ssl_handshakes_queued_stat, 1);
+  NET_SUM_GLOBAL_DYN_STAT(ssl_handshakes_offloaded_stat, 1);
+  eventProcessor.schedule_imm(sslHandshakeJob, SSLNetProcessor::ET_SSL_HANDSHAKE);
+  return SSL_HANDSHAKE_WANT_ACCEPT;
+}
+
+
 int
 SSLNetVConnection::sslClientHandShakeEvent(int &err)
 {
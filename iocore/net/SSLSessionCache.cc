@@ -0,0 +1,690 @@
+/** @file
+
+  Shared SSL server session cache
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "ink_config.h"
+
+#include "P_Net.h"
+#include "P_SSLSessionCache.h"
+
+#include <sys/mman.h>
+
+#define SSL_SESSION_CACHE_MAGIC    0x53534c43   // "SSLC"
+#define SSL_SESSION_CACHE_VERSION  2
+#define SSL_SESSION_CACHE_ALIGN    64
+
+#define ALIGN_UP(_x, _a)  (((_x) + (_a) - 1) & ~((size_t)(_a) - 1))
+
+SSLSessionCache *ssl_session_cache = NULL;
+
+struct SSLSessionCacheHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t entry_size;
+  uint32_t stripes;
+  int32_t entries_per_stripe;
+  int32_t buckets_per_stripe;   // power of two
+  uint64_t stripe_offset;
+  uint64_t bucket_offset;
+  uint64_t entry_offset;
+  uint64_t total_size;
+};
+
+struct SSLSessionCacheStripe
+{
+  pthread_mutex_t mutex;
+  int32_t lru_head;             // most recently used
+  int32_t lru_tail;
+  int32_t free_head;            // chained through hash_next
+  int32_t updating;             // set while locked, a holder died if found set
+};
+
+struct SSLSessionCacheEntry
+{
+  int32_t hash_next;
+  int32_t lru_prev;
+  int32_t lru_next;
+  uint32_t hash;
+  int64_t expire;               // time_t
+  uint16_t id_len;
+  uint16_t der_len;
+  uint32_t pad;
+  unsigned char id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+  unsigned char der[SSL_SESSION_CACHE_ENTRY_SIZE - 64];
+};
+
+#define SSL_SESSION_DER_MAX ((int) sizeof(((SSLSessionCacheEntry *) 0)->der))
+
+static inline uint32_t
+session_id_hash(const unsigned char *id, unsigned id_len)
+{
+  return ATS_FNV1a32(id, id_len);
+}
+
+SSLSessionCache::SSLSessionCache(int afd, char *abase, size_t asize)
+  : fd(afd), base(abase), size(asize), header((SSLSessionCacheHeader *) abase)
+{
+}
+
+SSLSessionCache::~SSLSessionCache()
+{
+  munmap(base, size);
+  ::close(fd);
+}
+
+inline SSLSessionCacheStripe *
+SSLSessionCache::stripe_for(uint32_t hash)
+{
+  SSLSessionCacheStripe *s = (SSLSessionCacheStripe *) (base + header->stripe_offset);
+  return (SSLSessionCacheStripe *) ((char *) s + (hash % header->stripes) * ALIGN_UP(sizeof(SSLSessionCacheStripe), SSL_SESSION_CACHE_ALIGN));
+}
+
+inline SSLSessionCacheEntry *
+SSLSessionCache::entry(int32_t i)
+{
+  return (SSLSessionCacheEntry *) (base + header->entry_offset + (size_t) i * SSL_SESSION_CACHE_ENTRY_SIZE);
+}
+
+inline int32_t
+SSLSessionCache::stripe_index(SSLSessionCacheStripe *s)
+{
+  return ((char *) s - (base + header->stripe_offset)) / ALIGN_UP(sizeof(SSLSessionCacheStripe), SSL_SESSION_CACHE_ALIGN);
+}
+
+inline int32_t *
+SSLSessionCache::buckets(SSLSessionCacheStripe *s)
+{
+  return (int32_t *) (base + header->bucket_offset) + (size_t) stripe_index(s) * header->buckets_per_stripe;
+}
+
+void
+SSLSessionCache::init_stripe(SSLSessionCacheStripe *s)
+{
+  int32_t first = stripe_index(s) * header->entries_per_stripe;
+  int32_t *b = buckets(s);
+
+  for (int i = 0; i < header->buckets_per_stripe; i++)
+    b[i] = -1;
+  for (int32_t i = 0; i < header->entries_per_stripe; i++) {
+    SSLSessionCacheEntry *e = entry(first + i);
+    e->hash_next = (i + 1 < header->entries_per_stripe) ? first + i + 1 : -1;
+    e->lru_prev = e->lru_next = -1;
+  }
+  s->free_head = first;
+  s->lru_head = s->lru_tail = -1;
+}
+
+// True if the lists of the stripe are sound: every link stays inside
+//   the stripe, every entry is on exactly one of the hash chains or the
+//   free list, and the LRU list holds the hashed entries in order
+bool
+SSLSessionCache::check_stripe(SSLSessionCacheStripe *s)
+{
+  int32_t first = stripe_index(s) * header->entries_per_stripe;
+  int32_t last = first + header->entries_per_stripe;
+  int32_t *b = buckets(s);
+  int32_t i, prev;
+  int used = 0, nfree = 0, lru = 0;
+
+  for (int k = 0; k < header->buckets_per_stripe; k++) {
+    for (i = b[k]; i >= 0; i = entry(i)->hash_next) {
+      if (i < first || i >= last || ++used > header->entries_per_stripe)
+        return false;
+      SSLSessionCacheEntry *e = entry(i);
+      if (((e->hash / header->stripes) & (header->buckets_per_stripe - 1)) != (uint32_t) k ||
+          e->id_len > SSL_MAX_SSL_SESSION_ID_LENGTH || e->der_len > SSL_SESSION_DER_MAX)
+        return false;
+    }
+  }
+  for (i = s->free_head; i >= 0; i = entry(i)->hash_next) {
+    if (i < first || i >= last || used + ++nfree > header->entries_per_stripe)
+      return false;
+  }
+  prev = -1;
+  for (i = s->lru_head; i >= 0; i = entry(i)->lru_next) {
+    if (i < first || i >= last || ++lru > used || entry(i)->lru_prev != prev)
+      return false;
+    prev = i;
+  }
+  return prev == s->lru_tail && lru == used && used + nfree == header->entries_per_stripe;
+}
+
+bool
+SSLSessionCache::lock(SSLSessionCacheStripe *s)
+{
+  int res = pthread_mutex_lock(&s->mutex);
+#if defined(linux)
+  if (res == EOWNERDEAD) {
+    // A process died holding the stripe, its lists can't be trusted
+    Warning("SSL session cache stripe recovered from a dead process, dropping its sessions");
+    init_stripe(s);
+    pthread_mutex_consistent(&s->mutex);
+    res = 0;
+  }
+#endif
+  if (res != 0)
+    return false;
+  if (s->updating) {
+    // The last holder never unlocked it
+    Warning("SSL session cache stripe left half updated, dropping its sessions");
+    init_stripe(s);
+  }
+  s->updating = 1;
+  return true;
+}
+
+inline void
+SSLSessionCache::unlock(SSLSessionCacheStripe *s)
+{
+  s->updating = 0;
+  pthread_mutex_unlock(&s->mutex);
+}
+
+int32_t
+SSLSessionCache::find(SSLSessionCacheStripe *s, uint32_t hash, const unsigned char *id, unsigned id_len)
+{
+  int32_t i = buckets(s)[(hash / header->stripes) & (header->buckets_per_stripe - 1)];
+  while (i >= 0) {
+    SSLSessionCacheEntry *e = entry(i);
+    if (e->hash == hash && e->id_len == id_len && memcmp(e->id, id, id_len) == 0)
+      return i;
+    i = e->hash_next;
+  }
+  return -1;
+}
+
+// Take entry i out of its bucket and the LRU list and free it
+void
+SSLSessionCache::unlink(SSLSessionCacheStripe *s, int32_t i)
+{
+  SSLSessionCacheEntry *e = entry(i);
+  int32_t *p = &buckets(s)[(e->hash / header->stripes) & (header->buckets_per_stripe - 1)];
+
+  while (*p != i) {
+    ink_assert(*p >= 0);
+    p = &entry(*p)->hash_next;
+  }
+  *p = e->hash_next;
+
+  if (e->lru_prev >= 0)
+    entry(e->lru_prev)->lru_next = e->lru_next;
+  else
+    s->lru_head = e->lru_next;
+  if (e->lru_next >= 0)
+    entry(e->lru_next)->lru_prev = e->lru_prev;
+  else
+    s->lru_tail = e->lru_prev;
+
+  e->lru_prev = e->lru_next = -1;
+  e->hash_next = s->free_head;
+  s->free_head = i;
+}
+
+bool
+SSLSessionCache::insert(SSL_SESSION *sess)
+{
+  unsigned id_len;
+  const unsigned char *id = SSL_SESSION_get_id(sess, &id_len);
+  unsigned char der[SSL_SESSION_DER_MAX];
+  unsigned char *p = der;
+
+  if (id_len == 0 || id_len > SSL_MAX_SSL_SESSION_ID_LENGTH)
+    return false;
+  int der_len = i2d_SSL_SESSION(sess, NULL);
+  if (der_len <= 0 || der_len > SSL_SESSION_DER_MAX) {
+    NET_SUM_GLOBAL_DYN_STAT(ssl_session_cache_too_big_stat, 1);
+    return false;
+  }
+  i2d_SSL_SESSION(sess, &p);
+
+  uint32_t hash = session_id_hash(id, id_len);
+  SSLSessionCacheStripe *s = stripe_for(hash);
+  if (!lock(s))
+    return false;
+
+  int32_t i = find(s, hash, id, id_len);
+  if (i >= 0)
+    unlink(s, i);
+  if (s->free_head < 0) {
+    ink_assert(s->lru_tail >= 0);
+    unlink(s, s->lru_tail);
+    NET_SUM_GLOBAL_DYN_STAT(ssl_session_cache_eviction_stat, 1);
+  }
+  i = s->free_head;
+  SSLSessionCacheEntry *e = entry(i);
+  s->free_head = e->hash_next;
+
+  e->hash = hash;
+  e->expire = (int64_t) SSL_SESSION_get_time(sess) + SSL_SESSION_get_timeout(sess);
+  e->id_len = id_len;
+  memcpy(e->id, id, id_len);
+  e->der_len = der_len;
+  memcpy(e->der, der, der_len);
+
+  int32_t *b = &buckets(s)[(hash / header->stripes) & (header->buckets_per_stripe - 1)];
+  e->hash_next = *b;
+  *b = i;
+  e->lru_prev = -1;
+  e->lru_next = s->lru_head;
+  if (s->lru_head >= 0)
+    entry(s->lru_head)->lru_prev = i;
+  else
+    s->lru_tail = i;
+  s->lru_head = i;
+
+  unlock(s);
+  NET_SUM_GLOBAL_DYN_STAT(ssl_session_cache_insert_stat, 1);
+  return true;
+}
+
+SSL_SESSION *
+SSLSessionCache::lookup(const unsigned char *id, unsigned id_len)
+{
+  unsigned char der[SSL_SESSION_DER_MAX];
+  int der_len = 0;
+
+  if (id_len == 0 || id_len > SSL_MAX_SSL_SESSION_ID_LENGTH)
+    return NULL;
+
+  uint32_t hash = session_id_hash(id, id_len);
+  SSLSessionCacheStripe *s = stripe_for(hash);
+  if (!lock(s))
+    return NULL;
+
+  int32_t i = find(s, hash, id, id_len);
+  if (i >= 0) {
+    SSLSessionCacheEntry *e = entry(i);
+    if (e->expire <= (int64_t) time(NULL)) {
+      unlink(s, i);
+      NET_SUM_GLOBAL_DYN_STAT(ssl_session_cache_expired_stat, 1);
+    } else {
+      der_len = e->der_len;
+      memcpy(der, e->der, der_len);
+      if (e->lru_prev >= 0) {
+        // move to the front
+        entry(e->lru_prev)->lru_next = e->lru_next;
+        if (e->lru_next >= 0)
+          entry(e->lru_next)->lru_prev = e->lru_prev;
+        else
+          s->lru_tail = e->lru_prev;
+        e->lru_prev = -1;
+        e->lru_next = s->lru_head;
+        entry(s->lru_head)->lru_prev = i;
+        s->lru_head = i;
+      }
+    }
+  }
+  unlock(s);
+
+  if (der_len == 0) {
+    NET_SUM_GLOBAL_DYN_STAT(ssl_session_cache_miss_stat, 1);
+    return NULL;
+  }
+  NET_SUM_GLOBAL_DYN_STAT(ssl_session_cache_hit_stat, 1);
+
+#if (OPENSSL_VERSION_NUMBER >= 0x0090800fL)
+  const unsigned char *p = der;
+#else
+  unsigned char *p = der;
+#endif
+  return d2i_SSL_SESSION(NULL, &p, der_len);
+}
+
+void
+SSLSessionCache::remove(const unsigned char *id, unsigned id_len)
+{
+  if (id_len == 0 || id_len > SSL_MAX_SSL_SESSION_ID_LENGTH)
+    return;
+
+  uint32_t hash = session_id_hash(id, id_len);
+  SSLSessionCacheStripe *s = stripe_for(hash);
+  if (!lock(s))
+    return;
+  int32_t i = find(s, hash, id, id_len);
+  if (i >= 0)
+    unlink(s, i);
+  unlock(s);
+}
+
+static int
+ssl_session_cache_new(SSL *ssl, SSL_SESSION *sess)
+{
+  NOWARN_UNUSED(ssl);
+  ssl_session_cache->insert(sess);
+  return 0;                     // we don't keep a reference
+}
+
+static SSL_SESSION *
+ssl_session_cache_get(SSL *ssl, unsigned char *id, int id_len, int *copy)
+{
+  NOWARN_UNUSED(ssl);
+  *copy = 0;                    // the session is handed over to OpenSSL
+  return ssl_session_cache->lookup(id, id_len);
+}
+
+static void
+ssl_session_cache_remove(SSL_CTX *ctx, SSL_SESSION *sess)
+{
+  NOWARN_UNUSED(ctx);
+  unsigned id_len;
+  const unsigned char *id = SSL_SESSION_get_id(sess, &id_len);
+  ssl_session_cache->remove(id, id_len);
+}
+
+void
+SSLSessionCache::attach(SSL_CTX *ctx)
+{
+  SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+  SSL_CTX_sess_set_new_cb(ctx, ssl_session_cache_new);
+  SSL_CTX_sess_set_get_cb(ctx, ssl_session_cache_get);
+  SSL_CTX_sess_set_remove_cb(ctx, ssl_session_cache_remove);
+}
+
+//
+// The first process to open the file (the one that can take a write
+//   lock on it) checks and, if needed, rebuilds it, and sets up the
+//   stripe locks afresh since a previous owner may have died holding
+//   them. Everyone then holds a read lock on the file for as long as
+//   they use it, so a later process knows it must take the file as is.
+//
+SSLSessionCache *
+SSLSessionCache::open(const char *path, int nentries)
+{
+  struct flock fl;
+  struct stat st;
+  SSLSessionCacheHeader want;
+  char *base;
+  int fd;
+
+  memset(&want, 0, sizeof(want));
+  want.magic = SSL_SESSION_CACHE_MAGIC;
+  want.version = SSL_SESSION_CACHE_VERSION;
+  want.entry_size = SSL_SESSION_CACHE_ENTRY_SIZE;
+  want.stripes = SSL_SESSION_CACHE_STRIPES;
+  want.entries_per_stripe = (nentries + SSL_SESSION_CACHE_STRIPES - 1) / SSL_SESSION_CACHE_STRIPES;
+  if (want.entries_per_stripe < 1)
+    want.entries_per_stripe = 1;
+  want.buckets_per_stripe = 1;
+  while (want.buckets_per_stripe < want.entries_per_stripe)
+    want.buckets_per_stripe <<= 1;
+  want.stripe_offset = ALIGN_UP(sizeof(SSLSessionCacheHeader), SSL_SESSION_CACHE_ALIGN);
+  want.bucket_offset = want.stripe_offset +
+    want.stripes * ALIGN_UP(sizeof(SSLSessionCacheStripe), SSL_SESSION_CACHE_ALIGN);
+  want.entry_offset = ALIGN_UP(want.bucket_offset + (size_t) want.stripes * want.buckets_per_stripe * sizeof(int32_t),
+                               SSL_SESSION_CACHE_ALIGN);
+  want.total_size = want.entry_offset + (size_t) want.stripes * want.entries_per_stripe * SSL_SESSION_CACHE_ENTRY_SIZE;
+
+  if ((fd = ::open(path, O_RDWR | O_CREAT, 0600)) < 0) {
+    Error("unable to open SSL session cache %s: %s", path, strerror(errno));
+    return NULL;
+  }
+
+  memset(&fl, 0, sizeof(fl));
+  fl.l_type = F_WRLCK;
+  fl.l_whence = SEEK_SET;
+  bool first = fcntl(fd, F_SETLK, &fl) == 0;
+  if (!first) {
+    fl.l_type = F_RDLCK;
+    if (fcntl(fd, F_SETLKW, &fl) < 0) {
+      Error("unable to lock SSL session cache %s: %s", path, strerror(errno));
+      goto Lfail;
+    }
+  }
+
+  if (fstat(fd, &st) < 0)
+    goto Lfail;
+
+  if (first) {
+    SSLSessionCacheHeader old;
+    bool keep = (size_t) st.st_size == want.total_size && pread(fd, &old, sizeof(old), 0) == (ssize_t) sizeof(old) &&
+      memcmp(&old, &want, sizeof(want)) == 0;
+
+    if ((!keep && ftruncate(fd, 0) < 0) || ftruncate(fd, want.total_size) < 0) {
+      Error("unable to size SSL session cache %s: %s", path, strerror(errno));
+      goto Lfail;
+    }
+    base = (char *) mmap(NULL, want.total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == (char *) MAP_FAILED)
+      goto Lmapfail;
+
+    SSLSessionCache *cache = NEW(new SSLSessionCache(fd, base, want.total_size));
+    memcpy(cache->header, &want, sizeof(want));
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+#if defined(linux)
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+#endif
+    int dropped = 0;
+    for (uint32_t i = 0; i < want.stripes; i++) {
+      SSLSessionCacheStripe *s = cache->stripe_for(i);
+      pthread_mutex_init(&s->mutex, &attr);
+      // A process that died in the middle of an update leaves the
+      //   stripe flagged, or its links broken
+      if (!keep) {
+        cache->init_stripe(s);
+      } else if (s->updating || !cache->check_stripe(s)) {
+        cache->init_stripe(s);
+        dropped++;
+      }
+      s->updating = 0;
+    }
+    if (dropped)
+      Warning("SSL session cache %s had %d damaged stripes, dropped their sessions", path, dropped);
+    pthread_mutexattr_destroy(&attr);
+
+    fl.l_type = F_RDLCK;
+    fcntl(fd, F_SETLK, &fl);
+    Note("SSL session cache %s %s, %d sessions", path, keep ? "reused" : "created",
+         want.stripes * want.entries_per_stripe);
+    return cache;
+  }
+
+  // Someone else is using it, take it as it is
+  if ((size_t) st.st_size < sizeof(SSLSessionCacheHeader))
+    goto Lbad;
+  base = (char *) mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == (char *) MAP_FAILED)
+    goto Lmapfail;
+  {
+    SSLSessionCacheHeader *h = (SSLSessionCacheHeader *) base;
+    if (h->magic != SSL_SESSION_CACHE_MAGIC || h->version != SSL_SESSION_CACHE_VERSION ||
+        h->entry_size != SSL_SESSION_CACHE_ENTRY_SIZE || h->total_size != (uint64_t) st.st_size) {
+      munmap(base, st.st_size);
+      goto Lbad;
+    }
+    if (memcmp(h, &want, sizeof(want)) != 0)
+      Warning("SSL session cache %s is in use with a different size, keeping it", path);
+    return NEW(new SSLSessionCache(fd, base, st.st_size));
+  }
+
+Lbad:
+  Error("SSL session cache %s is in use by another process and not usable", path);
+  goto Lfail;
+Lmapfail:
+  Error("unable to map SSL session cache %s: %s", path, strerror(errno));
+Lfail:
+  ::close(fd);
+  return NULL;
+}
+
+#if TS_HAS_TESTS
+
+#include "ts/TestBox.h"
+
+#define TEST_CACHE_ENTRIES 4096     // so no stripe overflows
+#define TEST_SESSIONS      128
+
+static SSL_SESSION *
+test_session(int n)
+{
+  SSL_SESSION *sess = SSL_SESSION_new();
+  unsigned char id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+
+  memset(id, 0, sizeof(id));
+  memcpy(id, &n, sizeof(n));
+  // a session without a version and cipher doesn't encode
+#if (OPENSSL_VERSION_NUMBER >= 0x10101000L)
+  static SSL_CTX *ctx = SSL_CTX_new(SSLv23_server_method());
+  SSL_SESSION_set1_id(sess, id, sizeof(id));
+  SSL_SESSION_set_protocol_version(sess, TLS1_2_VERSION);
+  SSL_SESSION_set_cipher(sess, sk_SSL_CIPHER_value(SSL_CTX_get_ciphers(ctx), 0));
+#else
+  memcpy(sess->session_id, id, sizeof(id));
+  sess->session_id_length = sizeof(id);
+  sess->ssl_version = TLS1_VERSION;
+  sess->cipher_id = 0x0300002F; // TLS_RSA_WITH_AES_128_CBC_SHA
+#endif
+  SSL_SESSION_set_time(sess, time(NULL));
+  SSL_SESSION_set_timeout(sess, 300);
+  return sess;
+}
+
+static bool
+test_session_cached(SSLSessionCache *cache, int n)
+{
+  SSL_SESSION *sess = test_session(n);
+  unsigned id_len;
+  const unsigned char *id = SSL_SESSION_get_id(sess, &id_len);
+  SSL_SESSION *found = cache->lookup(id, id_len);
+  bool ok = false;
+
+  if (found) {
+    unsigned found_len;
+    const unsigned char *found_id = SSL_SESSION_get_id(found, &found_len);
+    ok = found_len == id_len && memcmp(found_id, id, id_len) == 0;
+    SSL_SESSION_free(found);
+  }
+  SSL_SESSION_free(sess);
+  return ok;
+}
+
+static SSLSessionCache *
+test_cache_fill(const char *path)
+{
+  SSLSessionCache *cache = SSLSessionCache::open(path, TEST_CACHE_ENTRIES);
+
+  for (int n = 0; cache && n < TEST_SESSIONS; n++) {
+    SSL_SESSION *sess = test_session(n);
+    cache->insert(sess);
+    SSL_SESSION_free(sess);
+  }
+  return cache;
+}
+
+REGRESSION_TEST(SSLSessionCache_Reopen)(RegressionTest * t, int atype, int * pstatus)
+{
+  NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  char path[64];
+  int found = 0;
+
+  box = REGRESSION_TEST_PASSED;
+  snprintf(path, sizeof(path), "/tmp/ssl_session_cache_test.%d", (int) getpid());
+  unlink(path);
+
+  SSLSessionCache *cache = test_cache_fill(path);
+  box.check(cache != NULL, "cache created");
+  if (cache == NULL)
+    return;
+  delete cache;
+
+  cache = SSLSessionCache::open(path, TEST_CACHE_ENTRIES);
+  box.check(cache != NULL, "cache reopened");
+  if (cache) {
+    for (int n = 0; n < TEST_SESSIONS; n++)
+      found += test_session_cached(cache, n);
+    box.check(found == TEST_SESSIONS, "%d of %d sessions kept over a reopen", found, TEST_SESSIONS);
+    box.check(!test_session_cached(cache, TEST_SESSIONS), "unknown session found");
+    delete cache;
+  }
+  unlink(path);
+}
+
+REGRESSION_TEST(SSLSessionCache_Damaged)(RegressionTest * t, int atype, int * pstatus)
+{
+  NOWARN_UNUSED(atype);
+  TestBox box(t, pstatus);
+  SSLSessionCacheHeader h;
+  char path[64];
+  int kept = 0, missing = 0;
+
+  box = REGRESSION_TEST_PASSED;
+  snprintf(path, sizeof(path), "/tmp/ssl_session_cache_test.%d", (int) getpid());
+  unlink(path);
+
+  SSLSessionCache *cache = test_cache_fill(path);
+  box.check(cache != NULL, "cache created");
+  if (cache == NULL)
+    return;
+  delete cache;
+
+  // Break the file as a process dying in the middle of an update could:
+  //   stripe 0 gets bucket links out of bounds, stripe 1 an LRU cycle
+  //   and stripe 2 is left flagged as being updated
+  int fd = ::open(path, O_RDWR);
+  char *base = (char *) MAP_FAILED;
+  if (fd >= 0 && pread(fd, &h, sizeof(h), 0) == (ssize_t) sizeof(h))
+    base = (char *) mmap(NULL, h.total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  box.check(base != (char *) MAP_FAILED, "cache mapped for damage");
+  if (base != (char *) MAP_FAILED) {
+    size_t stripe_size = ALIGN_UP(sizeof(SSLSessionCacheStripe), SSL_SESSION_CACHE_ALIGN);
+    int32_t *b = (int32_t *) (base + h.bucket_offset);
+    for (int k = 0; k < h.buckets_per_stripe; k++)
+      b[k] = 0x7fffffff;
+    SSLSessionCacheStripe *s = (SSLSessionCacheStripe *) (base + h.stripe_offset + stripe_size);
+    if (s->lru_head >= 0) {
+      SSLSessionCacheEntry *e = (SSLSessionCacheEntry *) (base + h.entry_offset + (size_t) s->lru_head * h.entry_size);
+      e->lru_next = s->lru_head;
+    }
+    s = (SSLSessionCacheStripe *) (base + h.stripe_offset + 2 * stripe_size);
+    s->updating = 1;
+    munmap(base, h.total_size);
+  }
+  if (fd >= 0)
+    ::close(fd);
+
+  cache = SSLSessionCache::open(path, TEST_CACHE_ENTRIES);
+  box.check(cache != NULL, "damaged cache reopened");
+  if (cache) {
+    for (int n = 0; n < TEST_SESSIONS; n++) {
+      SSL_SESSION *sess = test_session(n);
+      unsigned id_len;
+      const unsigned char *id = SSL_SESSION_get_id(sess, &id_len);
+      uint32_t stripe = session_id_hash(id, id_len) % SSL_SESSION_CACHE_STRIPES;
+      bool cached = test_session_cached(cache, n);
+      if (stripe <= 2)
+        kept += cached;
+      else
+        missing += !cached;
+      SSL_SESSION_free(sess);
+    }
+    box.check(kept == 0, "%d sessions kept in damaged stripes", kept);
+    box.check(missing == 0, "%d sessions lost from sound stripes", missing);
+    delete cache;
+  }
+  unlink(path);
+}
+
+#endif // TS_HAS_TESTS
@@ -23,6 +23,7 @@
 #include "libts.h"
 #include "I_Layout.h"
 #include "P_Net.h"
+#include "P_SSLSessionCache.h"
 
 #include <openssl/err.h>
 #include <openssl/bio.h>
@@ -43,6 +44,16 @@
 #include <openssl/ec.h>
 #endif
 
+// Kernel TLS needs the connection keys, which we derive from the OpenSSL 1.0
+// connection state.
+#if HAVE_LINUX_TLS_H && (OPENSSL_VERSION_NUMBER < 0x10100000L)
+#include <netinet/tcp.h>
+#include <linux/tls.h>
+#if defined(TLS_TX)
+#define SSL_KTLS_AVAILABLE 1
+#endif
+#endif
+
 // ssl_multicert.config field names:
 #define SSL_IP_TAG            "dest_ip"
 #define SSL_CERT_TAG          "ssl_cert_name"
@@ -75,11 +86,28 @@ struct ssl_ticket_key_t
   unsigned char aes_key[16];
 };
 
+// The keys loaded from a ticket key file. The first key issues new
+// tickets; the others are still accepted so that tickets issued before a
+// key rotation keep resuming until they are reissued.
+struct ssl_ticket_key_block
+{
+  unsigned num_keys;
+  ssl_ticket_key_t keys[1];
+};
+
 #if TS_USE_TLS_TICKETS
 static int ssl_callback_session_ticket(SSL *, unsigned char *, unsigned char *, EVP_CIPHER_CTX *, HMAC_CTX *, int);
 #endif /* TS_USE_TLS_TICKETS */
 static int ssl_session_ticket_index = 0;
 
+// The ticket keys are freed with the last reference to their context, which
+// may be held by a connection after the context was released by the lookup.
+static void
+ssl_ticket_key_free(void * /* parent */, void * ptr, CRYPTO_EX_DATA * /* ad */, int /* idx */, long /* argl */, void * /* argp */)
+{
+  ats_free(ptr);
+}
+
 
 struct ats_file_bio
 {
@@ -237,9 +265,10 @@ static SSL_CTX *
 ssl_context_enable_tickets(SSL_CTX * ctx, char * ticket_key_path)
 {
 #if TS_USE_TLS_TICKETS
-  xptr<char>          ticket_key_data;
-  int                 ticket_key_len;
-  ssl_ticket_key_t *  ticket_key = NULL;
+  xptr<char>              ticket_key_data;
+  int                     ticket_key_len;
+  unsigned                num_ticket_keys;
+  ssl_ticket_key_block *  keyblock = NULL;
 
   ticket_key_data = readIntoBuffer(ticket_key_path, __func__, &ticket_key_len);
   if (!ticket_key_data) {
@@ -252,10 +281,19 @@ ssl_context_enable_tickets(SSL_CTX * ctx, char * ticket_key_path)
     goto fail;
   }
 
-  ticket_key = NEW(new ssl_ticket_key_t());
-  memcpy(ticket_key->key_name, (const char *)ticket_key_data, 16);
-  memcpy(ticket_key->hmac_secret, (const char *)ticket_key_data + 16, 16);
-  memcpy(ticket_key->aes_key, (const char *)ticket_key_data + 32, 16);
+  // The file holds one or more 48 byte keys, newest first. Trailing bytes
+  // that don't make up a whole key are ignored.
+  num_ticket_keys = ticket_key_len / sizeof(ssl_ticket_key_t);
+  keyblock = (ssl_ticket_key_block *)ats_malloc(sizeof(ssl_ticket_key_block) +
+                                                 (num_ticket_keys - 1) * sizeof(ssl_ticket_key_t));
+  keyblock->num_keys = num_ticket_keys;
+  for (unsigned i = 0; i < num_ticket_keys; ++i) {
+    const char * data = (const char *)ticket_key_data + (i * sizeof(ssl_ticket_key_t));
+    memcpy(keyblock->keys[i].key_name, data, 16);
+    memcpy(keyblock->keys[i].hmac_secret, data + 16, 16);
+    memcpy(keyblock->keys[i].aes_key, data + 32, 16);
+  }
+  Debug("ssl", "loaded %u session ticket keys from %s", num_ticket_keys, (const char *)ticket_key_path);
 
   // Setting the callback can only fail if OpenSSL does not recognize the
   // SSL_CTRL_SET_TLSEXT_TICKET_KEY_CB constant. we set the callback first
@@ -265,7 +303,7 @@ ssl_context_enable_tickets(SSL_CTX * ctx, char * ticket_key_path)
     goto fail;
   }
 
-  if (SSL_CTX_set_ex_data(ctx, ssl_session_ticket_index, ticket_key) == 0) {
+  if (SSL_CTX_set_ex_data(ctx, ssl_session_ticket_index, keyblock) == 0) {
     Error ("failed to set session ticket data to ctx");
     goto fail;
   }
@@ -274,7 +312,7 @@ ssl_context_enable_tickets(SSL_CTX * ctx, char * ticket_key_path)
   return ctx;
 
 fail:
-  delete ticket_key;
+  ats_free(keyblock);
   return ctx;
 
 #else /* TS_USE_TLS_TICKETS */
@@ -302,7 +340,7 @@ SSLInitializeLibrary()
     CRYPTO_set_id_callback(SSL_pthreads_thread_id);
   }
 
-  int iRet = SSL_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+  int iRet = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, ssl_ticket_key_free);
   if (iRet == -1) {
     SSLError("failed to create session ticket index");
   }
@@ -387,11 +425,20 @@ SSLInitServerContext(
   case SSLConfigParams::SSL_SESSION_CACHE_MODE_OFF:
     SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF|SSL_SESS_CACHE_NO_INTERNAL);
     break;
+  case SSLConfigParams::SSL_SESSION_CACHE_MODE_SERVER_SHARED:
+    if (ssl_session_cache) {
+      ssl_session_cache->attach(ctx);
+      break;
+    }
+    // shared cache unavailable, fall back to the per process one
   case SSLConfigParams::SSL_SESSION_CACHE_MODE_SERVER:
     SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
     SSL_CTX_sess_set_cache_size(ctx, params->ssl_session_cache_size);
     break;
   }
+  if (params->ssl_session_cache_timeout > 0) {
+    SSL_CTX_set_timeout(ctx, params->ssl_session_cache_timeout);
+  }
 
 #ifdef SSL_MODE_RELEASE_BUFFERS
   SSL_CTX_set_mode(ctx, SSL_MODE_RELEASE_BUFFERS);
@@ -571,16 +618,35 @@ asn1_strdup(ASN1_STRING * s)
     return ats_strndup((const char *)ASN1_STRING_data(s), ASN1_STRING_length(s));
 }
 
-// Given a certificate and it's corresponding SSL_CTX context, insert hash
-// table aliases for all of the subject and subjectAltNames. Note that we don't
-// deal with wildcards (yet).
-static void
-ssl_index_certificate(SSLCertLookup * lookup, SSL_CTX * ctx, const char * certfile)
+static char *
+ssl_append_name(char * names, const char * name)
+{
+  size_t len = names ? strlen(names) : 0;
+  size_t namelen = strlen(name);
+
+  names = (char *)ats_realloc(names, len + namelen + 2);
+  if (len) {
+    names[len++] = ' ';
+  }
+  memcpy(names + len, name, namelen + 1);
+
+  return names;
+}
+
+// Return the subject CNs and subjectAltNames of a certificate as a space
+// separated list, or NULL if the certificate can't be read.
+static char *
+ssl_certificate_names(const char * certfile)
 {
   X509_NAME * subject = NULL;
+  char * names = NULL;
 
   ats_file_bio bio(certfile, "r");
-  X509* cert = PEM_read_bio_X509_AUX(bio.bio, NULL, NULL, NULL);
+  X509* cert = bio.bio ? PEM_read_bio_X509_AUX(bio.bio, NULL, NULL, NULL) : NULL;
+
+  if (cert == NULL) {
+    return NULL;
+  }
 
   // Insert a key for the subject CN.
   subject = X509_get_subject_name(cert);
@@ -596,31 +662,98 @@ ssl_index_certificate(SSLCertLookup * lookup, SSL_CTX * ctx, const char * certfi
       ASN1_STRING * cn = X509_NAME_ENTRY_get_data(e);
       xptr<char> name(asn1_strdup(cn));
 
-      Debug("ssl", "mapping '%s' to certificate %s", (const char *)name, certfile);
-      lookup->insert(ctx, name);
+      names = ssl_append_name(names, name);
     }
   }
 
 #if HAVE_OPENSSL_TS_H
   // Traverse the subjectAltNames (if any) and insert additional keys for the SSL context.
-  GENERAL_NAMES * names = (GENERAL_NAMES *)X509_get_ext_d2i(cert, NID_subject_alt_name, NULL, NULL);
-  if (names) {
-    unsigned count = sk_GENERAL_NAME_num(names);
+  GENERAL_NAMES * altnames = (GENERAL_NAMES *)X509_get_ext_d2i(cert, NID_subject_alt_name, NULL, NULL);
+  if (altnames) {
+    unsigned count = sk_GENERAL_NAME_num(altnames);
     for (unsigned i = 0; i < count; ++i) {
       GENERAL_NAME * name;
 
-      name = sk_GENERAL_NAME_value(names, i);
+      name = sk_GENERAL_NAME_value(altnames, i);
       if (name->type == GEN_DNS) {
         xptr<char> dns(asn1_strdup(name->d.dNSName));
-        Debug("ssl", "mapping '%s' to certificate %s", (const char *)dns, certfile);
-        lookup->insert(ctx, dns);
+        names = ssl_append_name(names, dns);
       }
     }
 
-    GENERAL_NAMES_free(names);
+    GENERAL_NAMES_free(altnames);
   }
 #endif // HAVE_OPENSSL_TS_H
   X509_free(cert);
+
+  // A certificate without any name is still readable.
+  return names ? names : ats_strdup("");
+}
+
+// Insert lookup aliases for each of the space separated names, for either a
+// context or the handle of a lazily loaded certificate.
+template <typename T> static void
+ssl_index_names(SSLCertLookup * lookup, T key, const char * names, const char * certfile)
+{
+  xptr<char> buf(ats_strdup(names));
+  char * tok_state = NULL;
+
+  for (char * name = strtok_r(buf, " ", &tok_state); name; name = strtok_r(NULL, " ", &tok_state)) {
+    Debug("ssl", "mapping '%s' to certificate %s", name, certfile);
+    lookup->insert(key, name);
+  }
+}
+
+// Given a certificate and it's corresponding SSL_CTX context, insert hash
+// table aliases for all of the subject and subjectAltNames.
+static void
+ssl_index_certificate(SSLCertLookup * lookup, SSL_CTX * ctx, const char * certfile)
+{
+  xptr<char> names(ssl_certificate_names(certfile));
+
+  if (!names) {
+    Error("failed to read SSL certificate %s", certfile);
+    return;
+  }
+
+  ssl_index_names(lookup, ctx, names, certfile);
+}
+
+static SSL_CTX *
+ssl_make_server_context(
+    const SSLConfigParams * params,
+    SSLCertLookup *         lookup,
+    const char * cert,
+    const char * ca,
+    const char * key,
+    const int session_ticket_enabled,
+    const char * ticket_key_filename)
+{
+  SSL_CTX * ctx;
+
+  ctx = ssl_context_enable_sni(SSLInitServerContext(params, cert, ca, key), lookup);
+  if (!ctx) {
+    return NULL;
+  }
+
+#if TS_USE_TLS_NPN
+  SSL_CTX_set_next_protos_advertised_cb(ctx, SSLNetVConnection::advertise_next_protocol, NULL);
+#endif /* TS_USE_TLS_NPN */
+
+#if defined(SSL_OP_NO_TICKET)
+  // Session tickets are enabled by default. Disable if explicitly requested.
+  if (session_ticket_enabled == 0) {
+      SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+      Debug("ssl", "ssl session ticket is disabled");
+  }
+#endif
+  // Load the session ticket key if session tickets are not disabled and we have key name.
+  if (session_ticket_enabled != 0 && ticket_key_filename) {
+    xptr<char> ticket_key_path(Layout::relative_to(params->serverCertPathOnly, ticket_key_filename));
+    ssl_context_enable_tickets(ctx, ticket_key_path);
+  }
+
+  return ctx;
 }
 
 static void
@@ -636,18 +769,13 @@ ssl_store_ssl_context(
 {
   SSL_CTX *   ctx;
   xptr<char>  certpath;
-  xptr<char>  session_key_path;
 
-  ctx = ssl_context_enable_sni(SSLInitServerContext(params, cert, ca, key), lookup);
+  ctx = ssl_make_server_context(params, lookup, cert, ca, key, session_ticket_enabled, ticket_key_filename);
   if (!ctx) {
     SSLError("failed to create new SSL server context");
     return;
   }
 
-#if TS_USE_TLS_NPN
-  SSL_CTX_set_next_protos_advertised_cb(ctx, SSLNetVConnection::advertise_next_protocol, NULL);
-#endif /* TS_USE_TLS_NPN */
-
   certpath = Layout::relative_to(params->serverCertPathOnly, cert);
 
   // Index this certificate by the specified IP(v6) address. If the address is "*", make it the default context.
@@ -666,18 +794,6 @@ ssl_store_ssl_context(
       }
     }
   }
-#if defined(SSL_OP_NO_TICKET)
-  // Session tickets are enabled by default. Disable if explicitly requested.
-  if (session_ticket_enabled == 0) {
-      SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
-      Debug("ssl", "ssl session ticket is disabled");
-  }
-#endif
-  // Load the session ticket key if session tickets are not disabled and we have key name.
-  if (session_ticket_enabled != 0 && ticket_key_filename) {
-    xptr<char> ticket_key_path(Layout::relative_to(params->serverCertPathOnly, ticket_key_filename));
-    ssl_context_enable_tickets(ctx, ticket_key_path);
-  }
 
   // Insert additional mappings. Note that this maps multiple keys to the same value, so when
   // this code is updated to reconfigure the SSL certificates, it will need some sort of
@@ -685,6 +801,59 @@ ssl_store_ssl_context(
   ssl_index_certificate(lookup, ctx, certpath);
 }
 
+static SSL_CTX *
+ssl_load_lazy_context(SSLCertLookup * lookup, const SSLCertSpec * spec)
+{
+  SSLConfig::scoped_config params;
+
+  return ssl_make_server_context(params, lookup, spec->cert, spec->ca, spec->key,
+                                 spec->session_ticket_enabled, spec->ticket_key_filename);
+}
+
+// Index a certificate whose context is created on first use. The names come
+// from the previous index if the certificate file hasn't changed since.
+static void
+ssl_store_lazy_context(
+    const SSLConfigParams *  params,
+    SSLCertLookup *          lookup,
+    const SSLCertNameIndex * index,
+    SSLCertNameIndex *       newindex,
+    xptr<char>& cert,
+    xptr<char>& ca,
+    xptr<char>& key,
+    const int session_ticket_enabled,
+    xptr<char>& ticket_key_filename)
+{
+  xptr<char>    certpath(Layout::relative_to(params->serverCertPathOnly, cert));
+  xptr<char>    names;
+  SSLCertSpec * spec;
+  const char *  known;
+  struct stat   st;
+
+  if (stat(certpath, &st) != 0) {
+    Error("failed to stat SSL certificate %s: %s", (const char *)certpath, strerror(errno));
+    return;
+  }
+
+  known = index->find(certpath, st);
+  names = known ? ats_strdup(known) : ssl_certificate_names(certpath);
+  if (!names) {
+    Error("failed to read SSL certificate %s", (const char *)certpath);
+    return;
+  }
+
+  newindex->add(certpath, st, names);
+
+  spec = NEW(new SSLCertSpec());
+  spec->cert = cert.release();
+  spec->ca = ca.release();
+  spec->key = key.release();
+  spec->ticket_key_filename = ticket_key_filename.release();
+  spec->session_ticket_enabled = session_ticket_enabled;
+
+  ssl_index_names(lookup, lookup->add(spec), names, certpath);
+}
+
 static bool
 ssl_extract_certificate(
     const matcher_line * line_info,
@@ -693,7 +862,7 @@ ssl_extract_certificate(
     xptr<char>& ca,     // CA public certificate
     xptr<char>& key,    // Private key
     int&  session_ticket_enabled,  // session ticket enabled
-    xptr<char>& ticket_key_filename) // session key file. [key_name (16Byte) + HMAC_secret (16Byte) + AES_key (16Byte)]
+    xptr<char>& ticket_key_filename) // session key file. [key_name (16Byte) + HMAC_secret (16Byte) + AES_key (16Byte)], repeated newest first
 {
   for (int i = 0; i < MATCHER_MAX_TOKENS; ++i) {
     const char * label;
@@ -749,6 +918,11 @@ SSLParseCertificateConfiguration(
   xptr<char>  file_buf;
   unsigned    line_num = 0;
   matcher_line line_info;
+  ink_hrtime  start = ink_get_hrtime_internal();
+
+  // Only used when contexts are created on first use.
+  SSLCertNameIndex index;
+  SSLCertNameIndex newindex;
 
   bool alarmAlready = false;
   char errBuf[1024];
@@ -768,6 +942,13 @@ SSLParseCertificateConfiguration(
     return false;
   }
 
+  if (params->lazy_contexts > 0) {
+    lookup->enableLazyContexts(ssl_load_lazy_context, params->lazy_contexts);
+    if (params->certIndexFilePath) {
+      index.load(params->certIndexFilePath);
+    }
+  }
+
   line = tokLine(file_buf, &tok_state);
   while (line != NULL) {
 
@@ -795,7 +976,13 @@ SSLParseCertificateConfiguration(
         IOCORE_SignalError(errBuf, alarmAlready);
       } else {
         if (ssl_extract_certificate(&line_info, addr, cert, ca, key, session_ticket_enabled, ticket_key_filename)) {
-          ssl_store_ssl_context(params, lookup, addr, cert, ca, key, session_ticket_enabled, ticket_key_filename);
+          // Certificates selected by address are needed before there is a name to look up,
+          // so only the ones selected by name are created lazily.
+          if (params->lazy_contexts > 0 && !addr) {
+            ssl_store_lazy_context(params, lookup, &index, &newindex, cert, ca, key, session_ticket_enabled, ticket_key_filename);
+          } else {
+            ssl_store_ssl_context(params, lookup, addr, cert, ca, key, session_ticket_enabled, ticket_key_filename);
+          }
         } else {
           snprintf(errBuf, sizeof(errBuf), "%s: discarding invalid %s entry at line %u",
                        __func__, params->configFilePath, line_num);
@@ -816,6 +1003,13 @@ SSLParseCertificateConfiguration(
     lookup->insert(lookup->ssl_default, "*");
   }
 
+  if (params->lazy_contexts > 0 && params->certIndexFilePath) {
+    newindex.save(params->certIndexFilePath);
+  }
+
+  Note("indexed %u SSL certificates (%u contexts loaded) in %" PRId64 " msec",
+       lookup->count(), lookup->loaded(), (int64_t)ink_hrtime_to_msec(ink_get_hrtime_internal() - start));
+
   return true;
 }
 
@@ -832,49 +1026,253 @@ int ssl_callback_session_ticket(SSL *ssl,
                                HMAC_CTX *hctx,
                                int enc)
 {
-  ssl_ticket_key_t* ssl_ticket_key = (ssl_ticket_key_t*) SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), ssl_session_ticket_index);
-  if (NULL == ssl_ticket_key) {
+  ssl_ticket_key_block* keyblock = (ssl_ticket_key_block*) SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), ssl_session_ticket_index);
+  if (NULL == keyblock) {
     Error("ssl ticket key is null.");
     return -1;
   }
 
   if (enc == 1) {
+    const ssl_ticket_key_t * ssl_ticket_key = &keyblock->keys[0];
+
     memcpy(keyname, ssl_ticket_key->key_name, 16);
     RAND_pseudo_bytes(iv, EVP_MAX_IV_LENGTH);
     EVP_EncryptInit_ex(cipher_ctx, EVP_aes_128_cbc(), NULL,
         ssl_ticket_key->aes_key, iv);
     HMAC_Init_ex(hctx, ssl_ticket_key->hmac_secret, 16, evp_md_func, NULL);
-    Note("create ticket for a new session");
+    Debug("ssl", "create ticket for a new session");
 
     return 0;
   } else if (enc == 0) {
-    if (memcmp(keyname, ssl_ticket_key->key_name, 16)) {
-      Error("keyname is not consistent.");
-      return 0;
-    }
+    for (unsigned i = 0; i < keyblock->num_keys; ++i) {
+      const ssl_ticket_key_t * ssl_ticket_key = &keyblock->keys[i];
 
-    EVP_DecryptInit_ex(cipher_ctx, EVP_aes_128_cbc(), NULL,
-        ssl_ticket_key->aes_key, iv);
-    HMAC_Init_ex(hctx, ssl_ticket_key->hmac_secret, 16, evp_md_func, NULL);
+      if (memcmp(keyname, ssl_ticket_key->key_name, 16) == 0) {
+        EVP_DecryptInit_ex(cipher_ctx, EVP_aes_128_cbc(), NULL,
+            ssl_ticket_key->aes_key, iv);
+        HMAC_Init_ex(hctx, ssl_ticket_key->hmac_secret, 16, evp_md_func, NULL);
 
-    Note("verify the ticket for an existing session." );
-    return 1;
+        Debug("ssl", "verify the ticket for an existing session with key %u", i);
+        // Returning 2 has OpenSSL issue a fresh ticket under the current key.
+        return (i == 0) ? 1 : 2;
+      }
+    }
+
+    Debug("ssl", "no matching key for the session ticket, doing a full handshake");
+    return 0;
   }
 
   return -1;
 }
 #endif
 
-void
-SSLReleaseContext(SSL_CTX * ctx)
+#if SSL_KTLS_AVAILABLE
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+#ifndef TLS_SET_RECORD_TYPE
+#define TLS_SET_RECORD_TYPE 1
+#endif
+
+// The TLS 1.2 PRF (RFC 5246 section 5): P_hash with HMAC over the handshake digest.
+static void
+ssl_tls12_prf(const EVP_MD * md, const unsigned char * secret, int secret_len,
+              const unsigned char * seed, int seed_len, unsigned char * out, int out_len)
+{
+  unsigned char a[EVP_MAX_MD_SIZE + 128];   // A(i) followed by the seed
+  unsigned char chunk[EVP_MAX_MD_SIZE];
+  unsigned alen, clen;
+
+  ink_release_assert(seed_len <= 128);
+
+  // A(1) = HMAC(secret, seed)
+  HMAC(md, secret, secret_len, seed, seed_len, a, &alen);
+  while (out_len > 0) {
+    memcpy(a + alen, seed, seed_len);
+    HMAC(md, secret, secret_len, a, alen + seed_len, chunk, &clen);
+
+    int n = MIN((int)clen, out_len);
+    memcpy(out, chunk, n);
+    out += n;
+    out_len -= n;
+
+    // A(i + 1) = HMAC(secret, A(i))
+    HMAC(md, secret, secret_len, a, alen, chunk, &clen);
+    memcpy(a, chunk, clen);
+    alen = clen;
+  }
+
+  OPENSSL_cleanse(a, sizeof(a));
+  OPENSSL_cleanse(chunk, sizeof(chunk));
+}
+
+template <typename T> static bool
+ssl_set_ktls_tx(int fd, unsigned cipher_type, const unsigned char * key, const unsigned char * salt, const unsigned char * seq)
+{
+  T info;
+  bool ok;
+
+  memset(&info, 0, sizeof(info));
+  info.info.version = TLS_1_2_VERSION;
+  info.info.cipher_type = cipher_type;
+  memcpy(info.key, key, sizeof(info.key));
+  memcpy(info.salt, salt, sizeof(info.salt));
+  // The explicit nonce OpenSSL uses for GCM is the record sequence number.
+  memcpy(info.iv, seq, sizeof(info.iv));
+  memcpy(info.rec_seq, seq, sizeof(info.rec_seq));
+
+  ok = setsockopt(fd, SOL_TLS, TLS_TX, &info, sizeof(info)) == 0;
+  OPENSSL_cleanse(&info, sizeof(info));
+  return ok;
+}
+
+// Once the kernel has the keys, a record OpenSSL writes itself (a renegotiation, an alert) would reuse
+// a sequence number the kernel owns. Those writes go nowhere, and the read side closes the connection.
+static void
+ssl_ktls_info_callback(const SSL * ssl, int where, int ret)
+{
+  NOWARN_UNUSED(ret);
+
+  if (where & (SSL_CB_HANDSHAKE_START | SSL_CB_WRITE_ALERT)) {
+    SSLNetVConnection * netvc = (SSLNetVConnection *)SSL_get_app_data(ssl);
+    Debug("ssl", "OpenSSL wrote to a kernel TLS connection (where=%#x), closing it", where);
+    netvc->sslKernelTLSDesync = true;
+  }
+}
+
+#endif /* SSL_KTLS_AVAILABLE */
+
+bool
+SSLEnableKernelTLS(SSL * ssl, int fd)
 {
-  ssl_ticket_key_t * ssl_ticket_key = (ssl_ticket_key_t*)SSL_CTX_get_ex_data(ctx, ssl_session_ticket_index);
+#if SSL_KTLS_AVAILABLE
+  static const char label[] = "key expansion";
+
+  const SSL_CIPHER * cipher = SSL_get_current_cipher(ssl);
+  SSL_SESSION * session = SSL_get_session(ssl);
+  const EVP_MD * md;
+  unsigned keylen;
+  unsigned char seed[sizeof(label) - 1 + 2 * SSL3_RANDOM_SIZE];
+  unsigned char keyblock[2 * 32 + 2 * 4];
+  bool ok = false;
+
+  // Anything OpenSSL still has buffered would go out after the kernel's records.
+  if (cipher == NULL || session == NULL || SSL_version(ssl) != TLS1_2_VERSION || ssl->s3->wbuf.left != 0) {
+    return false;
+  }
 
-  // Free the ticket if this is the last reference.
-  if (ctx->references == 1 && ssl_ticket_key) {
-    delete ssl_ticket_key;
+  switch (SSL_CIPHER_get_id(cipher)) {
+  case TLS1_CK_RSA_WITH_AES_128_GCM_SHA256:
+  case TLS1_CK_DHE_RSA_WITH_AES_128_GCM_SHA256:
+  case TLS1_CK_ECDHE_RSA_WITH_AES_128_GCM_SHA256:
+  case TLS1_CK_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256:
+    md = EVP_sha256();
+    keylen = 16;
+    break;
+#if defined(TLS_CIPHER_AES_GCM_256)
+  case TLS1_CK_RSA_WITH_AES_256_GCM_SHA384:
+  case TLS1_CK_DHE_RSA_WITH_AES_256_GCM_SHA384:
+  case TLS1_CK_ECDHE_RSA_WITH_AES_256_GCM_SHA384:
+  case TLS1_CK_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384:
+    md = EVP_sha384();
+    keylen = 32;
+    break;
+#endif
+  default:
+    Debug("ssl", "cipher %s can't be offloaded to the kernel", SSL_CIPHER_get_name(cipher));
+    return false;
   }
 
+  // key_block = PRF(master_secret, "key expansion", server_random + client_random). With an AEAD
+  // cipher there are no MAC keys, so it is client_write_key, server_write_key, client_write_IV,
+  // server_write_IV, and we send with the server ones.
+  memcpy(seed, label, sizeof(label) - 1);
+  memcpy(seed + sizeof(label) - 1, ssl->s3->server_random, SSL3_RANDOM_SIZE);
+  memcpy(seed + sizeof(label) - 1 + SSL3_RANDOM_SIZE, ssl->s3->client_random, SSL3_RANDOM_SIZE);
+  ssl_tls12_prf(md, session->master_key, session->master_key_length, seed, sizeof(seed), keyblock, 2 * keylen + 8);
+
+  if (setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) == 0) {
+    const unsigned char * key = keyblock + keylen;
+    const unsigned char * salt = keyblock + 2 * keylen + 4;
+
+    if (keylen == 16) {
+      ok = ssl_set_ktls_tx<tls12_crypto_info_aes_gcm_128>(fd, TLS_CIPHER_AES_GCM_128, key, salt, ssl->s3->write_sequence);
+    }
+#if defined(TLS_CIPHER_AES_GCM_256)
+    else {
+      ok = ssl_set_ktls_tx<tls12_crypto_info_aes_gcm_256>(fd, TLS_CIPHER_AES_GCM_256, key, salt, ssl->s3->write_sequence);
+    }
+#endif
+  }
+
+  // If only the ULP was attached, the socket still passes plain writes through and we carry
+  // on encrypting with OpenSSL.
+  if (ok) {
+#if defined(SSL_OP_NO_RENEGOTIATION)
+    SSL_set_options(ssl, SSL_OP_NO_RENEGOTIATION);
+#endif
+    SSL_set_info_callback(ssl, ssl_ktls_info_callback);
+    SSL_set_bio(ssl, SSL_get_rbio(ssl), BIO_new(BIO_s_null()));
+  } else {
+    Debug("ssl", "failed to enable kernel TLS on fd %d: %s", fd, strerror(errno));
+  }
+
+  OPENSSL_cleanse(keyblock, sizeof(keyblock));
+  return ok;
+#else
+  NOWARN_UNUSED(ssl);
+  NOWARN_UNUSED(fd);
+  return false;
+#endif
+}
+
+bool
+SSLKernelTLSCloseNotify(int fd)
+{
+#if SSL_KTLS_AVAILABLE
+  // The alert goes out as its own record, the kernel is told the record type in a control message.
+  unsigned char alert[2] = { SSL3_AL_WARNING, SSL_AD_CLOSE_NOTIFY };
+  char control[CMSG_SPACE(sizeof(unsigned char))];
+  struct iovec iov;
+  struct msghdr msg;
+  struct cmsghdr * cmsg;
+
+  memset(&msg, 0, sizeof(msg));
+  iov.iov_base = alert;
+  iov.iov_len = sizeof(alert);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_TLS;
+  cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(unsigned char));
+  *CMSG_DATA(cmsg) = SSL3_RT_ALERT;
+
+  if (sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t)sizeof(alert)) {
+    Debug("ssl", "failed to send close_notify on fd %d: %s", fd, strerror(errno));
+    return false;
+  }
+
+  return true;
+#else
+  NOWARN_UNUSED(fd);
+  return false;
+#endif
+}
+
+void
+SSLReleaseContext(SSL_CTX * ctx)
+{
+  // The ticket keys are freed by ssl_ticket_key_free() along with the context.
   SSL_CTX_free(ctx);
 }
 
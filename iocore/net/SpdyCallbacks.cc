@@ -10,7 +10,6 @@ spdy_callbacks_init(spdylay_session_callbacks *callbacks)
   memset(callbacks, 0, sizeof(spdylay_session_callbacks));
 
   callbacks->send_callback = spdy_send_callback;
-  callbacks->recv_callback = spdy_recv_callback;
   callbacks->on_ctrl_recv_callback = spdy_on_ctrl_recv_callback;
   callbacks->on_invalid_ctrl_recv_callback = spdy_on_invalid_ctrl_recv_callback;
   callbacks->on_data_chunk_recv_callback = spdy_on_data_chunk_recv_callback;
@@ -31,8 +30,12 @@ spdy_callbacks_init(spdylay_session_callbacks *callbacks)
 void
 spdy_prepare_status_response(SpdySM *sm, int stream_id, const char *status)
 {
-  SpdyRequest *req = sm->req_map[stream_id];
+  SpdyRequest *req = sm->find_request(stream_id);
   string date_str = http_date(time(0));
+
+  if (!req)
+    return;
+
   const char **nv = new const char*[8+req->headers.size()*2+1];
 
   nv[0] = ":status";
@@ -143,6 +146,14 @@ spdy_show_ctl_frame(const char *head_str, spdylay_session *session, spdylay_fram
   return;
 }
 
+//
+// Every stream is handed to the HTTP state machine through a FetchSM,
+// which writes the request out through a PluginVC pair for HttpSM to
+// parse again and copies the response back through the FetchSM buffer.
+// Attaching a stream to an HttpSM directly needs a client session type
+// that is not backed by a NetVConnection and an HttpSM entry point that
+// takes an already parsed HTTPHdr; neither exists yet.
+//
 static int
 spdy_fetcher_launch(SpdyRequest *req, TSFetchMethod method)
 {
@@ -199,46 +210,6 @@ spdy_send_callback(spdylay_session *session, const uint8_t *data, size_t length,
   return length;
 }
 
-ssize_t
-spdy_recv_callback(spdylay_session *session, uint8_t *buf, size_t length,
-                   int flags, void *user_data)
-{
-  const char *start;
-  TSIOBufferBlock blk, next_blk;
-  int64_t already, blk_len, need, wavail;
-
-  SpdySM  *sm = (SpdySM*)user_data;
-
-  already = 0;
-  blk = TSIOBufferReaderStart(sm->req_reader);
-
-  while (blk) {
-
-    wavail = length - already;
-
-    next_blk = TSIOBufferBlockNext(blk);
-    start = TSIOBufferBlockReadStart(blk, sm->req_reader, &blk_len);
-
-    need = blk_len > wavail ? wavail : blk_len;
-
-    memcpy(&buf[already], start, need);
-    already += need;
-
-    if (already >= (int64_t)length)
-      break;
-
-    blk = next_blk;
-  }
-
-  TSIOBufferReaderConsume(sm->req_reader, already);
-  TSVIOReenable(sm->read_vio);
-
-  if (!already)
-    return SPDYLAY_ERR_WOULDBLOCK;
-
-  return already;
-}
-
 static void
 spdy_process_syn_stream_frame(SpdySM *sm, SpdyRequest *req)
 {
@@ -310,8 +281,9 @@ spdy_on_ctrl_recv_callback(spdylay_session *session, spdylay_frame_type type,
 
   case SPDYLAY_HEADERS:
     stream_id = frame->syn_stream.stream_id;
-    req = sm->req_map[stream_id];
-    req->append_nv(frame->headers.nv);
+    req = sm->find_request(stream_id);
+    if (req)
+      req->append_nv(frame->headers.nv);
     break;
 
   case SPDYLAY_WINDOW_UPDATE:
@@ -340,7 +312,7 @@ spdy_on_data_chunk_recv_callback(spdylay_session *session, uint8_t flags,
                                  size_t len, void *user_data)
 {
   SpdySM *sm = (SpdySM *)user_data;
-  SpdyRequest *req = sm->req_map[stream_id];
+  SpdyRequest *req = sm->find_request(stream_id);
 
   //
   // SpdyRequest has been deleted on error, drop this data;
@@ -359,7 +331,7 @@ spdy_on_data_recv_callback(spdylay_session *session, uint8_t flags,
                            int32_t stream_id, int32_t length, void *user_data)
 {
   SpdySM *sm = (SpdySM *)user_data;
-  SpdyRequest *req = sm->req_map[stream_id];
+  SpdyRequest *req = sm->find_request(stream_id);
 
   spdy_show_data_frame("++++RECV", session, flags, stream_id, length, user_data);
 
@@ -74,6 +74,8 @@ SpdySM::clear()
   map<int, SpdyRequest*>::iterator endIter = req_map.end();
   for(; iter != endIter; ++iter) {
     SpdyRequest *req = iter->second;
+    if (!req)
+      continue;
     req->clear();
     spdyRequestAllocator.free(req);
   }
@@ -228,7 +230,39 @@ out:
 static int
 spdy_process_read(TSEvent event, SpdySM *sm)
 {
-  return spdylay_session_recv(sm->session);
+  ssize_t ret;
+  const char *start;
+  TSIOBufferBlock blk, next_blk;
+  int64_t already, blk_len;
+
+  //
+  // Parse frames in place from the IOBuffer blocks instead of
+  // copying them into spdylay's receive buffer first.
+  //
+  already = 0;
+  blk = TSIOBufferReaderStart(sm->req_reader);
+
+  while (blk) {
+    next_blk = TSIOBufferBlockNext(blk);
+    start = TSIOBufferBlockReadStart(blk, sm->req_reader, &blk_len);
+
+    if (blk_len > 0) {
+      ret = spdylay_session_mem_recv(sm->session, (const uint8_t *)start, blk_len);
+      if (ret < 0)
+        return ret;
+
+      already += ret;
+      if (ret < blk_len)
+        break;
+    }
+
+    blk = next_blk;
+  }
+
+  TSIOBufferReaderConsume(sm->req_reader, already);
+  TSVIOReenable(sm->read_vio);
+
+  return 0;
 }
 
 static int
@@ -330,7 +364,7 @@ spdy_read_fetch_body_callback(spdylay_session *session, int32_t stream_id,
   //
   // req has been deleted, ignore this data.
   //
-  if (req != sm->req_map[stream_id]) {
+  if (req != sm->find_request(stream_id)) {
     Debug("spdy", "    stream_id:%d, call:%d, req has been deleted, return 0\n",
           stream_id, g_call_cnt);
     *eof = 1;
@@ -24,6 +24,7 @@
 #include "P_SSLCertLookup.h"
 #include "ts/TestBox.h"
 #include <fstream>
+#include <sys/resource.h>
 
 static IpEndpoint
 make_endpoint(const char * address)
@@ -130,8 +131,62 @@ REGRESSION_TEST(SSLAddressLookup)(RegressionTest* t, int atype, int * pstatus)
   box.check(lookup.findInfoInHash(endpoint.ip4p) == context.ip4p, "IPv4 longest match lookup w/ port");
 }
 
+static SSL_CTX *
+load_test_context(SSLCertLookup * /* lookup */, const SSLCertSpec * spec)
+{
+  return strcmp(spec->cert, "broken.pem") == 0 ? NULL : SSL_CTX_new(SSLv23_server_method());
+}
+
+static SSLCertSpec *
+make_spec(const char * cert)
+{
+  SSLCertSpec * spec = new SSLCertSpec();
+
+  spec->cert = ats_strdup(cert);
+  return spec;
+}
+
+REGRESSION_TEST(SSLLazyContextLookup)(RegressionTest* t, int atype, int * pstatus)
+{
+  TestBox       box(t, pstatus);
+  SSLCertLookup lookup;
+  SSL_CTX *     ctx;
+
+  box = REGRESSION_TEST_PASSED;
+
+  lookup.enableLazyContexts(load_test_context, 2);
+
+  int a = lookup.add(make_spec("a.pem"));
+  int b = lookup.add(make_spec("b.pem"));
+  int c = lookup.add(make_spec("c.pem"));
+  int broken = lookup.add(make_spec("broken.pem"));
+
+  box.check(lookup.insert(a, "www.a.com"), "insert www.a.com");
+  box.check(lookup.insert(a, "*.a.com"), "insert *.a.com");
+  box.check(lookup.insert(b, "www.b.com"), "insert www.b.com");
+  box.check(lookup.insert(c, "www.c.com"), "insert www.c.com");
+  box.check(lookup.insert(broken, "www.broken.com"), "insert www.broken.com");
+
+  box.check(lookup.count() == 4, "4 certificates indexed");
+  box.check(lookup.loaded() == 0, "no context loaded before a lookup");
+
+  // Both names of a certificate share its context.
+  ctx = lookup.findInfoInHash("www.a.com");
+  box.check(ctx != NULL, "lazy load for www.a.com");
+  box.check(lookup.findInfoInHash("x.a.com") == ctx, "wildcard lookup shares the www.a.com context");
+  box.check(lookup.loaded() == 1, "1 context loaded");
+
+  box.check(lookup.findInfoInHash("www.b.com") != NULL, "lazy load for www.b.com");
+  box.check(lookup.findInfoInHash("www.c.com") != NULL, "lazy load for www.c.com");
+  box.check(lookup.loaded() == 2, "loaded contexts are bounded");
+
+  box.check(lookup.findInfoInHash("www.broken.com") == NULL, "failed load for www.broken.com");
+  box.check(lookup.findInfoInHash("www.broken.com") == NULL, "failed load is remembered");
+  box.check(lookup.findInfoInHash("www.d.com") == NULL, "no match for www.d.com");
+}
+
 static unsigned
-load_hostnames_csv(const char * fname, SSLCertLookup& lookup)
+load_hostnames_csv(const char * fname, SSLCertLookup& lookup, bool lazy)
 {
   std::fstream infile(fname, std::ios_base::in);
   unsigned count = 0;
@@ -161,13 +216,15 @@ load_hostnames_csv(const char * fname, SSLCertLookup& lookup)
       break;
     }
 
+    // No comma? Assume the whole line is the hostname
     pos = line.find_first_of(',');
-    if (pos != std::string::npos) {
-      std::string host(line.substr(pos + 1));
-      lookup.insert(ctx, host.c_str());
+    std::string host(pos != std::string::npos ? line.substr(pos + 1) : line);
+
+    if (lazy) {
+      // One certificate per name, as when every customer brings their own.
+      lookup.insert(lookup.add(make_spec(host.c_str())), host.c_str());
     } else {
-      // No comma? Assume the whole line is the hostname
-      lookup.insert(ctx, line.c_str());
+      lookup.insert(ctx, host.c_str());
     }
 
     ++count;
@@ -195,12 +252,29 @@ int main(int argc, const char ** argv)
   if (argc > 1) {
     SSLCertLookup lookup;
     unsigned count = 0;
+    unsigned lazy = 0;
+    struct rusage before, after;
+    int i = 1;
+
+    // test_certlookup [-l MAXLOADED] FILE... indexes a certificate per name, created on first use.
+    if (argc > 2 && strcmp(argv[1], "-l") == 0) {
+      lazy = atoi(argv[2]);
+      lookup.enableLazyContexts(load_test_context, lazy);
+      i = 3;
+    }
+
+    getrusage(RUSAGE_SELF, &before);
+    ink_hrtime start = ink_get_hrtime_internal();
 
-    for (int i = 1; i < argc; ++i) {
-      count += load_hostnames_csv(argv[i], lookup);
+    for (; i < argc; ++i) {
+      count += load_hostnames_csv(argv[i], lookup, lazy > 0);
     }
 
-    printf("loaded %u host names\n", count);
+    ink_hrtime elapsed = ink_get_hrtime_internal() - start;
+    getrusage(RUSAGE_SELF, &after);
+
+    printf("loaded %u host names in %" PRId64 " msec, max RSS grew by %ld KB\n", count,
+           (int64_t)ink_hrtime_to_msec(elapsed), after.ru_maxrss - before.ru_maxrss);
 
   } else {
     // Standard regression tests.
@@ -148,6 +148,16 @@ struct RecRawStat
 };
 
 
+// Thread-local raw-stat storage. Only the sum and count live in the
+// per-thread area so that a thread's whole block is dense and can be
+// aggregated with a single linear scan.
+struct RecRawStatSlot
+{
+  int64_t sum;
+  int64_t count;
+};
+
+
 // WARNING!  It's advised that developers do not modify the contents of
 // the RecRawStatBlock.  ^_^
 struct RecRawStatBlock
@@ -157,9 +167,35 @@ struct RecRawStatBlock
   int num_stats;            // number of stats in this block
   int max_stats;            // maximum number of stats for this block
   ink_mutex mutex;
+  RecRawStatSlot *totals;   // scratch space for aggregating the thread-local values
+  volatile int64_t sync_generation; // sync pass in which this block was last aggregated
+  struct RecRawStatHistogram *histogram; // window state if the block is a histogram
 };
 
 
+//-------------------------------------------------------------------------
+// RawStat Histograms
+//-------------------------------------------------------------------------
+// A histogram is a RecRawStatBlock with one raw-stat per bucket, so the
+// buckets are thread-local and are merged with the rest of the raw-stats.
+// Buckets are log-linear: values below REC_HISTOGRAM_SUB_BUCKETS get a
+// bucket each, and every power of two above that is split into
+// REC_HISTOGRAM_SUB_BUCKETS / 2 buckets, which bounds the relative error
+// of a reported percentile to about 3%. Values are clamped to
+// 2^REC_HISTOGRAM_MAX_BITS - 1.
+//
+// The exported stats cover a sliding window of between half and all of
+// REC_HISTOGRAM_WINDOW_MS: the window start moves up by half a window
+// every half window.
+#define REC_HISTOGRAM_SUB_BUCKET_BITS  5
+#define REC_HISTOGRAM_SUB_BUCKETS      (1 << REC_HISTOGRAM_SUB_BUCKET_BITS)
+#define REC_HISTOGRAM_MAX_BITS         40
+#define REC_HISTOGRAM_BUCKETS          (REC_HISTOGRAM_SUB_BUCKETS + \
+                                        (REC_HISTOGRAM_MAX_BITS - REC_HISTOGRAM_SUB_BUCKET_BITS) * \
+                                        (REC_HISTOGRAM_SUB_BUCKETS / 2))
+#define REC_HISTOGRAM_WINDOW_MS        60000
+
+
 //-------------------------------------------------------------------------
 // RecCore Callback Types
 //-------------------------------------------------------------------------
@@ -49,6 +49,13 @@ RecRawStatBlock *RecAllocateRawStatBlock(int num_stats);
 int RecRegisterRawStat(RecRawStatBlock * rsb, RecT rec_type, const char *name, RecDataT data_type, RecPersistT persist_type, int id, RecRawStatSyncCb sync_cb);
 
 
+// Histograms are exported as <name>.count, <name>.p50, <name>.p90,
+// <name>.p99 and <name>.p999 integer stats, taken over the last
+// REC_HISTOGRAM_WINDOW_MS or so.
+RecRawStatBlock *RecAllocateRawStatHistogram();
+int RecRegisterRawStatHistogram(RecRawStatBlock * rsb, RecT rec_type, const char *name, RecPersistT persist_type);
+
+
 // RecRawStatRange* RecAllocateRawStatRange (int num_buckets);
 
 // int RecRegisterRawStatRange (RecRawStatRange *rsr,
@@ -70,6 +77,7 @@ int RecRawStatSyncHrTimeAvg(const char *name, RecDataT data_type, RecData * data
 int RecRawStatSyncIntMsecsToFloatSeconds(const char *name, RecDataT data_type,
                                          RecData * data, RecRawStatBlock * rsb, int id);
 int RecRawStatSyncMHrTimeAvg(const char *name, RecDataT data_type, RecData * data, RecRawStatBlock * rsb, int id);
+int RecRawStatSyncHistogram(const char *name, RecDataT data_type, RecData * data, RecRawStatBlock * rsb, int id);
 
 
 //-------------------------------------------------------------------------
@@ -83,6 +91,7 @@ inline int RecIncrRawStat(RecRawStatBlock * rsb, EThread * ethread, int id, int6
 inline int RecIncrRawStatSum(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t incr = 1);
 inline int RecIncrRawStatCount(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t incr = 1);
 int RecIncrRawStatBlock(RecRawStatBlock * rsb, EThread * ethread, RecRawStat * stat_array);
+inline int RecIncrRawStatHistogram(RecRawStatBlock * rsb, EThread * ethread, int64_t value);
 
 int RecSetRawStatSum(RecRawStatBlock * rsb, int id, int64_t data);
 int RecSetRawStatCount(RecRawStatBlock * rsb, int id, int64_t data);
@@ -115,20 +124,20 @@ int64_t *RecGetGlobalRawStatCountPtr(RecRawStatBlock * rsb, int id);
 //-------------------------------------------------------------------------
 // inlined functions that are used very frequently.
 // FIXME: move it to Inline.cc
-inline RecRawStat *
+inline RecRawStatSlot *
 raw_stat_get_tlp(RecRawStatBlock * rsb, int id, EThread * ethread)
 {
   ink_debug_assert((id >= 0) && (id < rsb->max_stats));
   if (ethread == NULL) {
     ethread = this_ethread();
   }
-  return (((RecRawStat *) ((char *) (ethread) + rsb->ethr_stat_offset)) + id);
+  return (((RecRawStatSlot *) ((char *) (ethread) + rsb->ethr_stat_offset)) + id);
 }
 
 inline int
 RecIncrRawStat(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t incr)
 {
-  RecRawStat *tlp = raw_stat_get_tlp(rsb, id, ethread);
+  RecRawStatSlot *tlp = raw_stat_get_tlp(rsb, id, ethread);
   tlp->sum += incr;
   tlp->count += 1;
   return REC_ERR_OKAY;
@@ -138,7 +147,7 @@ RecIncrRawStat(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t incr)
 inline int
 RecDecrRawStat(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t decr)
 {
-  RecRawStat *tlp = raw_stat_get_tlp(rsb, id, ethread);
+  RecRawStatSlot *tlp = raw_stat_get_tlp(rsb, id, ethread);
   if (decr <= tlp->sum) {       // Assure that we stay positive
     tlp->sum -= decr;
     tlp->count += 1;
@@ -149,7 +158,7 @@ RecDecrRawStat(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t decr)
 inline int
 RecIncrRawStatSum(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t incr)
 {
-  RecRawStat *tlp = raw_stat_get_tlp(rsb, id, ethread);
+  RecRawStatSlot *tlp = raw_stat_get_tlp(rsb, id, ethread);
   tlp->sum += incr;
   return REC_ERR_OKAY;
 }
@@ -157,9 +166,35 @@ RecIncrRawStatSum(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t incr
 inline int
 RecIncrRawStatCount(RecRawStatBlock * rsb, EThread * ethread, int id, int64_t incr)
 {
-  RecRawStat *tlp = raw_stat_get_tlp(rsb, id, ethread);
+  RecRawStatSlot *tlp = raw_stat_get_tlp(rsb, id, ethread);
   tlp->count += incr;
   return REC_ERR_OKAY;
 }
 
+//-------------------------------------------------------------------------
+// RecIncrRawStatHistogram
+//-------------------------------------------------------------------------
+inline int
+RecRawStatHistogramBucket(int64_t value)
+{
+  int shift;
+
+  if (value < REC_HISTOGRAM_SUB_BUCKETS) {
+    return value < 0 ? 0 : (int) value;
+  }
+  if (value >= (1LL << REC_HISTOGRAM_MAX_BITS)) {
+    value = (1LL << REC_HISTOGRAM_MAX_BITS) - 1;
+  }
+  // keep the top REC_HISTOGRAM_SUB_BUCKET_BITS bits of the value
+  shift = (63 - __builtin_clzll((uint64_t) value)) - REC_HISTOGRAM_SUB_BUCKET_BITS + 1;
+  return REC_HISTOGRAM_SUB_BUCKETS + (shift - 1) * (REC_HISTOGRAM_SUB_BUCKETS / 2) +
+    (int) (value >> shift) - (REC_HISTOGRAM_SUB_BUCKETS / 2);
+}
+
+inline int
+RecIncrRawStatHistogram(RecRawStatBlock * rsb, EThread * ethread, int64_t value)
+{
+  return RecIncrRawStat(rsb, ethread, RecRawStatHistogramBucket(value), value);
+}
+
 #endif /* !_I_REC_PROCESS_H_ */
@@ -25,6 +25,7 @@
 #define _P_REC_DEFS_H_
 
 #include "ink_bool.h"
+#include "ink_hrtime.h"
 
 #include "I_RecDefs.h"
 
@@ -97,6 +98,19 @@ struct RecStatMeta
   RecPersistT persist_type;
 };
 
+// Window state of a raw-stat histogram. The globals of the block's
+// buckets are counts since startup; the window is the difference from
+// the counts taken at its start.
+struct RecRawStatHistogram
+{
+  int64_t *window_start;        // bucket counts when the window started
+  int64_t *half;                // bucket counts half a window later
+  int64_t *window;              // bucket counts in the window
+  int64_t window_total;         // samples in the window
+  ink_hrtime rotated;           // when half was last taken
+  int64_t sync_generation;      // sync pass the window was computed in
+};
+
 struct RecConfigMeta
 {
   unsigned char update_required;
@@ -39,6 +39,7 @@ static EventNotify g_force_req_notify;
 static int g_rec_raw_stat_sync_interval_ms = REC_RAW_STAT_SYNC_INTERVAL_MS;
 static int g_rec_config_update_interval_ms = REC_CONFIG_UPDATE_INTERVAL_MS;
 static int g_rec_remote_sync_interval_ms = REC_REMOTE_SYNC_INTERVAL_MS;
+static volatile int64_t g_rec_raw_stat_sync_generation = 0;
 
 //-------------------------------------------------------------------------
 // i_am_the_record_owner, only used for librecprocess.a
@@ -95,6 +96,16 @@ RecProcess_set_remote_sync_interval_ms(int ms) {
   g_rec_remote_sync_interval_ms = ms;
 }
 
+//-------------------------------------------------------------------------
+// raw_stat_thread_block
+//-------------------------------------------------------------------------
+static inline RecRawStatSlot *
+raw_stat_thread_block(RecRawStatBlock *rsb, EThread *ethread)
+{
+  return (RecRawStatSlot *) ((char *) ethread + rsb->ethr_stat_offset);
+}
+
+
 //-------------------------------------------------------------------------
 // raw_stat_get_total
 //-------------------------------------------------------------------------
@@ -102,7 +113,7 @@ static int
 raw_stat_get_total(RecRawStatBlock *rsb, int id, RecRawStat *total)
 {
   int i;
-  RecRawStat *tlp;
+  RecRawStatSlot *tlp;
 
   total->sum = 0;
   total->count = 0;
@@ -113,13 +124,13 @@ raw_stat_get_total(RecRawStatBlock *rsb, int id, RecRawStat *total)
 
   // get thread local values
   for (i = 0; i < eventProcessor.n_ethreads; i++) {
-    tlp = ((RecRawStat *) ((char *) (eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
+    tlp = raw_stat_thread_block(rsb, eventProcessor.all_ethreads[i]) + id;
     total->sum += tlp->sum;
     total->count += tlp->count;
   }
 
   for (i = 0; i < eventProcessor.n_dthreads; i++) {
-    tlp = ((RecRawStat *) ((char *) (eventProcessor.all_dthreads[i]) + rsb->ethr_stat_offset)) + id;
+    tlp = raw_stat_thread_block(rsb, eventProcessor.all_dthreads[i]) + id;
     total->sum += tlp->sum;
     total->count += tlp->count;
   }
@@ -129,52 +140,91 @@ raw_stat_get_total(RecRawStatBlock *rsb, int id, RecRawStat *total)
 
 
 //-------------------------------------------------------------------------
-// raw_stat_sync_to_global
+// raw_stat_sum_thread_block
 //-------------------------------------------------------------------------
-static int
-raw_stat_sync_to_global(RecRawStatBlock *rsb, int id)
+static inline void
+raw_stat_sum_thread_block(RecRawStatBlock *rsb, EThread *ethread, int num_stats)
 {
-  int i;
-  RecRawStat *tlp;
-  RecRawStat total;
+  RecRawStatSlot *tlp = raw_stat_thread_block(rsb, ethread);
+
+  for (int id = 0; id < num_stats; id++) {
+    rsb->totals[id].sum += tlp[id].sum;
+    rsb->totals[id].count += tlp[id].count;
+  }
+}
+
+
+//-------------------------------------------------------------------------
+// raw_stat_sync_block
+//
+// Aggregate every stat in the block into the globals. Each thread's
+// block is contiguous, so this walks every thread's slots linearly
+// once instead of striding across all threads for every stat.
+//-------------------------------------------------------------------------
+static void
+raw_stat_sync_block(RecRawStatBlock *rsb, int64_t generation)
+{
+  int i, id;
+
+  // lock so the setting of the globals and last values are atomic
+  ink_mutex_acquire(&(rsb->mutex));
 
-  total.sum = 0;
-  total.count = 0;
+  // someone else aggregated this block during the current pass
+  if (rsb->sync_generation == generation) {
+    ink_mutex_release(&(rsb->mutex));
+    return;
+  }
+
+  memset(rsb->totals, 0, rsb->max_stats * sizeof(RecRawStatSlot));
 
   // sum the thread local values
   for (i = 0; i < eventProcessor.n_ethreads; i++) {
-    tlp = ((RecRawStat *) ((char *) (eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
-    total.sum += tlp->sum;
-    total.count += tlp->count;
+    raw_stat_sum_thread_block(rsb, eventProcessor.all_ethreads[i], rsb->max_stats);
   }
 
   for (i = 0; i < eventProcessor.n_dthreads; i++) {
-    tlp = ((RecRawStat *) ((char *) (eventProcessor.all_dthreads[i]) + rsb->ethr_stat_offset)) + id;
-    total.sum += tlp->sum;
-    total.count += tlp->count;
+    raw_stat_sum_thread_block(rsb, eventProcessor.all_dthreads[i], rsb->max_stats);
   }
 
-  // lock so the setting of the globals and last values are atomic
-  ink_mutex_acquire(&(rsb->mutex));
-
-  // get the delta from the last sync
-  RecRawStat delta;
-  delta.sum = total.sum - rsb->global[id]->last_sum;
-  delta.count = total.count - rsb->global[id]->last_count;
+  for (id = 0; id < rsb->max_stats; id++) {
+    RecRawStat *global = rsb->global[id];
 
-  // This is too verbose now, so leaving it out / leif
-  //Debug("stats", "raw_stat_sync_to_global(): rsb pointer:%p id:%d delta:%" PRId64 " total:%" PRId64 " last:%" PRId64 " global:%" PRId64 "\n",
-  //rsb, id, delta.sum, total.sum, rsb->global[id]->last_sum, rsb->global[id]->sum);
+    if (global == NULL) {
+      continue;
+    }
 
-  // increment the global values by the delta
-  ink_atomic_increment64(&(rsb->global[id]->sum), delta.sum);
-  ink_atomic_increment64(&(rsb->global[id]->count), delta.count);
+    // increment the global values by the delta from the last sync
+    ink_atomic_increment64(&(global->sum), rsb->totals[id].sum - global->last_sum);
+    ink_atomic_increment64(&(global->count), rsb->totals[id].count - global->last_count);
 
-  // set the new totals as the last values seen
-  ink_atomic_swap64(&(rsb->global[id]->last_sum), total.sum);
-  ink_atomic_swap64(&(rsb->global[id]->last_count), total.count);
+    // set the new totals as the last values seen
+    ink_atomic_swap64(&(global->last_sum), rsb->totals[id].sum);
+    ink_atomic_swap64(&(global->last_count), rsb->totals[id].count);
+  }
 
+  rsb->sync_generation = generation;
   ink_mutex_release(&(rsb->mutex));
+}
+
+
+//-------------------------------------------------------------------------
+// raw_stat_sync_to_global
+//
+// Called for every stat with a sync callback, so each such block is
+// aggregated on every sync pass; the first of its stats pays for the
+// whole block, and the rest of the block's stats are then served from
+// the globals.
+//-------------------------------------------------------------------------
+static int
+raw_stat_sync_to_global(RecRawStatBlock *rsb, int id)
+{
+  REC_NOWARN_UNUSED(id);
+
+  int64_t generation = g_rec_raw_stat_sync_generation;
+
+  if (rsb->sync_generation != generation) {
+    raw_stat_sync_block(rsb, generation);
+  }
 
   return REC_ERR_OKAY;
 }
@@ -196,14 +246,14 @@ raw_stat_clear_sum(RecRawStatBlock *rsb, int id)
   ink_mutex_release(&(rsb->mutex));
 
   // reset the local stats
-  RecRawStat *tlp;
+  RecRawStatSlot *tlp;
   for (int i = 0; i < eventProcessor.n_ethreads; i++) {
-    tlp = ((RecRawStat *) ((char *) (eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
+    tlp = raw_stat_thread_block(rsb, eventProcessor.all_ethreads[i]) + id;
     ink_atomic_swap64(&(tlp->sum), 0);
   }
 
   for (int i = 0; i < eventProcessor.n_dthreads; i++) {
-    tlp = ((RecRawStat *) ((char *) (eventProcessor.all_dthreads[i]) + rsb->ethr_stat_offset)) + id;
+    tlp = raw_stat_thread_block(rsb, eventProcessor.all_dthreads[i]) + id;
     ink_atomic_swap64(&(tlp->sum), (int64_t)0);
   }
 
@@ -227,14 +277,14 @@ raw_stat_clear_count(RecRawStatBlock *rsb, int id)
   ink_mutex_release(&(rsb->mutex));
 
   // reset the local stats
-  RecRawStat *tlp;
+  RecRawStatSlot *tlp;
   for (int i = 0; i < eventProcessor.n_ethreads; i++) {
-    tlp = ((RecRawStat *) ((char *) (eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
+    tlp = raw_stat_thread_block(rsb, eventProcessor.all_ethreads[i]) + id;
     ink_atomic_swap64(&(tlp->count), 0);
   }
 
   for (int i = 0; i < eventProcessor.n_dthreads; i++) {
-    tlp = ((RecRawStat *) ((char *) (eventProcessor.all_dthreads[i]) + rsb->ethr_stat_offset)) + id;
+    tlp = raw_stat_thread_block(rsb, eventProcessor.all_dthreads[i]) + id;
     ink_atomic_swap64(&(tlp->count), (int64_t)0);
   }
 
@@ -461,8 +511,11 @@ RecAllocateRawStatBlock(int num_stats)
   off_t ethr_stat_offset;
   RecRawStatBlock *rsb;
 
-  // allocate thread-local raw-stat memory
-  if ((ethr_stat_offset = eventProcessor.allocate(num_stats * sizeof(RecRawStat))) == -1) {
+  // allocate thread-local raw-stat memory. Each thread's copy lives in its
+  // own EThread, so threads never write to the same lines; the offset is
+  // only 8 byte aligned, so a block may share lines with other data of the
+  // same thread.
+  if ((ethr_stat_offset = eventProcessor.allocate(num_stats * sizeof(RecRawStatSlot))) == -1) {
     return NULL;
   }
   // create the raw-stat-block structure
@@ -473,6 +526,8 @@ RecAllocateRawStatBlock(int num_stats)
   memset(rsb->global, 0, num_stats * sizeof(RecRawStat *));
   rsb->num_stats = 0;
   rsb->max_stats = num_stats;
+  rsb->totals = (RecRawStatSlot *)ats_malloc(num_stats * sizeof(RecRawStatSlot));
+  rsb->sync_generation = -1;
   ink_mutex_init(&(rsb->mutex),"net stat mutex");
   return rsb;
 }
@@ -521,6 +576,147 @@ Ldone:
 }
 
 
+//-------------------------------------------------------------------------
+// RecAllocateRawStatHistogram
+//-------------------------------------------------------------------------
+RecRawStatBlock *
+RecAllocateRawStatHistogram()
+{
+  RecRawStatBlock *rsb;
+  RecRawStat *buckets;
+  RecRawStatHistogram *h;
+  int64_t *counts;
+
+  if ((rsb = RecAllocateRawStatBlock(REC_HISTOGRAM_BUCKETS)) == NULL) {
+    return NULL;
+  }
+  // the buckets aren't records of their own, so the block owns their globals
+  buckets = (RecRawStat *)ats_malloc(REC_HISTOGRAM_BUCKETS * sizeof(RecRawStat));
+  memset(buckets, 0, REC_HISTOGRAM_BUCKETS * sizeof(RecRawStat));
+  for (int i = 0; i < REC_HISTOGRAM_BUCKETS; i++) {
+    rsb->global[i] = &buckets[i];
+  }
+  rsb->num_stats = REC_HISTOGRAM_BUCKETS;
+
+  h = (RecRawStatHistogram *)ats_malloc(sizeof(RecRawStatHistogram));
+  memset(h, 0, sizeof(RecRawStatHistogram));
+  counts = (int64_t *)ats_malloc(3 * REC_HISTOGRAM_BUCKETS * sizeof(int64_t));
+  memset(counts, 0, 3 * REC_HISTOGRAM_BUCKETS * sizeof(int64_t));
+  h->window_start = counts;
+  h->half = counts + REC_HISTOGRAM_BUCKETS;
+  h->window = counts + 2 * REC_HISTOGRAM_BUCKETS;
+  h->sync_generation = -1;
+  rsb->histogram = h;
+  return rsb;
+}
+
+
+//-------------------------------------------------------------------------
+// RecRegisterRawStatHistogram
+//-------------------------------------------------------------------------
+// The sync id of each exported stat is its index in this table.
+struct RecRawStatHistogramStat
+{
+  const char *suffix;
+  int percentile;               // parts per 10000, 0 for the sample count
+};
+
+static const RecRawStatHistogramStat rec_histogram_stats[] = {
+  { "count", 0 },
+  { "p50", 5000 },
+  { "p90", 9000 },
+  { "p99", 9900 },
+  { "p999", 9990 }
+};
+
+int
+RecRegisterRawStatHistogram(RecRawStatBlock *rsb, RecT rec_type, const char *name, RecPersistT persist_type)
+{
+  char stat_name[PATH_NAME_MAX + 1];
+  RecRecord *r;
+  RecData data_default;
+  memset(&data_default, 0, sizeof(RecData));
+
+  ink_debug_assert(rsb->max_stats == REC_HISTOGRAM_BUCKETS);
+
+  for (unsigned i = 0; i < SIZE(rec_histogram_stats); i++) {
+    snprintf(stat_name, sizeof(stat_name), "%s.%s", name, rec_histogram_stats[i].suffix);
+    Debug("stats", "RecRegisterRawStatHistogram(%s): rsb pointer:%p\n", stat_name, rsb);
+
+    if ((r = RecRegisterStat(rec_type, stat_name, RECD_INT, data_default, persist_type)) == NULL) {
+      return REC_ERR_FAIL;
+    }
+    if (i_am_the_record_owner(r->rec_type)) {
+      r->sync_required = r->sync_required | REC_PEER_SYNC_REQUIRED;
+    } else {
+      send_register_message(r);
+    }
+    RecRegisterRawStatSyncCb(stat_name, RecRawStatSyncHistogram, rsb, i);
+  }
+
+  return REC_ERR_OKAY;
+}
+
+
+//-------------------------------------------------------------------------
+// raw_stat_histogram_value
+//
+// The value reported for a bucket is the middle of its range.
+//-------------------------------------------------------------------------
+static int64_t
+raw_stat_histogram_value(int bucket)
+{
+  int shift;
+  int64_t top;
+
+  if (bucket < REC_HISTOGRAM_SUB_BUCKETS) {
+    return bucket;
+  }
+  bucket -= REC_HISTOGRAM_SUB_BUCKETS;
+  shift = bucket / (REC_HISTOGRAM_SUB_BUCKETS / 2) + 1;
+  top = bucket % (REC_HISTOGRAM_SUB_BUCKETS / 2) + (REC_HISTOGRAM_SUB_BUCKETS / 2);
+  return (top << shift) + ((1LL << shift) >> 1);
+}
+
+
+//-------------------------------------------------------------------------
+// raw_stat_histogram_window
+//
+// Recompute the window counts once per sync pass, after the buckets'
+// globals have been aggregated.
+//-------------------------------------------------------------------------
+static void
+raw_stat_histogram_window(RecRawStatBlock *rsb, ink_hrtime now)
+{
+  RecRawStatHistogram *h = rsb->histogram;
+  int i;
+
+  ink_mutex_acquire(&(rsb->mutex));
+  if (h->sync_generation == rsb->sync_generation) {
+    ink_mutex_release(&(rsb->mutex));
+    return;
+  }
+
+  // every half window, the window starts where the previous half started
+  if (now - h->rotated >= HRTIME_MSECONDS(REC_HISTOGRAM_WINDOW_MS / 2)) {
+    memcpy(h->window_start, h->half, REC_HISTOGRAM_BUCKETS * sizeof(int64_t));
+    for (i = 0; i < REC_HISTOGRAM_BUCKETS; i++) {
+      h->half[i] = rsb->global[i]->count;
+    }
+    h->rotated = now;
+  }
+
+  h->window_total = 0;
+  for (i = 0; i < REC_HISTOGRAM_BUCKETS; i++) {
+    h->window[i] = rsb->global[i]->count - h->window_start[i];
+    h->window_total += h->window[i];
+  }
+
+  h->sync_generation = rsb->sync_generation;
+  ink_mutex_release(&(rsb->mutex));
+}
+
+
 //-------------------------------------------------------------------------
 // RecRawStatSync...
 //-------------------------------------------------------------------------
@@ -637,6 +833,38 @@ RecRawStatSyncMHrTimeAvg(const char *name, RecDataT data_type, RecData *data, Re
 }
 
 
+int
+RecRawStatSyncHistogram(const char *name, RecDataT data_type, RecData *data, RecRawStatBlock *rsb, int id)
+{
+  REC_NOWARN_UNUSED(name);
+  const RecRawStatHistogramStat *stat = &rec_histogram_stats[id];
+  RecRawStatHistogram *h = rsb->histogram;
+  int64_t rank, seen = 0;
+  int64_t r = 0;
+  int i;
+
+  Debug("stats", "raw sync:histogram for %s", name);
+  raw_stat_sync_to_global(rsb, id);
+  raw_stat_histogram_window(rsb, ink_get_hrtime_internal());
+
+  if (stat->percentile == 0) {
+    r = h->window_total;
+  } else if (h->window_total > 0) {
+    // smallest bucket that holds at least percentile / 10000 of the samples
+    rank = (h->window_total * stat->percentile + 9999) / 10000;
+    for (i = 0; i < REC_HISTOGRAM_BUCKETS; i++) {
+      seen += h->window[i];
+      if (seen >= rank) {
+        break;
+      }
+    }
+    r = raw_stat_histogram_value(i < REC_HISTOGRAM_BUCKETS ? i : REC_HISTOGRAM_BUCKETS - 1);
+  }
+  RecDataSetFromInk64(data_type, data, r);
+  return REC_ERR_OKAY;
+}
+
+
 //-------------------------------------------------------------------------
 // RecIncrRawStatXXX
 //-------------------------------------------------------------------------
@@ -826,6 +1054,9 @@ RecExecRawStatSyncCbs()
   RecRecord *r;
   int i, num_records;
 
+  // start a new sync pass, each raw-stat block is aggregated at most once
+  ink_atomic_increment64(&g_rec_raw_stat_sync_generation, 1);
+
   num_records = g_num_records;
   for (i = 0; i < num_records; i++) {
     r = &(g_records[i]);
@@ -841,3 +1072,209 @@ RecExecRawStatSyncCbs()
 
   return REC_ERR_OKAY;
 }
+
+
+//-------------------------------------------------------------------------
+// Regression: raw-stat increment and sync cost
+//-------------------------------------------------------------------------
+static int64_t
+raw_stat_bench_strided(RecRawStatBlock *rsb, int nthreads)
+{
+  int64_t total = 0;
+
+  for (int id = 0; id < rsb->max_stats; id++) {
+    for (int i = 0; i < nthreads; i++) {
+      total += (raw_stat_thread_block(rsb, eventProcessor.all_ethreads[i]) + id)->sum;
+    }
+  }
+  return total;
+}
+
+static int64_t
+raw_stat_bench_linear(RecRawStatBlock *rsb, int nthreads)
+{
+  int64_t total = 0;
+
+  memset(rsb->totals, 0, rsb->max_stats * sizeof(RecRawStatSlot));
+  for (int i = 0; i < nthreads; i++) {
+    raw_stat_sum_thread_block(rsb, eventProcessor.all_ethreads[i], rsb->max_stats);
+  }
+  for (int id = 0; id < rsb->max_stats; id++) {
+    total += rsb->totals[id].sum;
+  }
+  return total;
+}
+
+REGRESSION_TEST(RecRawStat_SyncCost) (RegressionTest *t, int atype, int *pstatus)
+{
+  REC_NOWARN_UNUSED(atype);
+
+  // the thread-local space of a raw-stat block is never given back, so
+  // keep the block small
+  const int num_stats = 64;
+  const int num_incrs = 1000000;
+  const int num_passes = 16;
+
+  RecRawStatBlock *rsb;
+  RecRawStat *globals;
+  EThread *ethread = this_ethread();
+  ink_hrtime start;
+  int64_t sum;
+
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  if (eventProcessor.n_ethreads < 1 || (rsb = RecAllocateRawStatBlock(num_stats)) == NULL) {
+    rprintf(t, "no event threads or thread-local space for the raw-stat block\n");
+    *pstatus = REGRESSION_TEST_FAILED;
+    return;
+  }
+
+  globals = (RecRawStat *)ats_malloc(num_stats * sizeof(RecRawStat));
+  memset(globals, 0, num_stats * sizeof(RecRawStat));
+  for (int id = 0; id < num_stats; id++) {
+    rsb->global[id] = &globals[id];
+  }
+  if (ethread == NULL) {
+    ethread = eventProcessor.all_ethreads[0];
+  }
+
+  // thread-local increment
+  start = ink_get_hrtime_internal();
+  for (int i = 0; i < num_incrs; i++) {
+    RecIncrRawStat(rsb, ethread, i % num_stats, 1);
+  }
+  rprintf(t, "thread-local increment: %.2f ns\n",
+          (double)(ink_get_hrtime_internal() - start) / num_incrs);
+
+  // global (atomic) increment
+  start = ink_get_hrtime_internal();
+  for (int i = 0; i < num_incrs; i++) {
+    RecIncrGlobalRawStat(rsb, i % num_stats, 1);
+  }
+  rprintf(t, "global increment: %.2f ns\n",
+          (double)(ink_get_hrtime_internal() - start) / num_incrs);
+
+  // aggregation cost as the number of threads grows
+  for (int nthreads = 1; nthreads <= eventProcessor.n_ethreads; nthreads *= 2) {
+    ink_hrtime strided = 0, linear = 0;
+
+    for (int pass = 0; pass < num_passes; pass++) {
+      start = ink_get_hrtime_internal();
+      sum = raw_stat_bench_strided(rsb, nthreads);
+      strided += ink_get_hrtime_internal() - start;
+
+      start = ink_get_hrtime_internal();
+      if (raw_stat_bench_linear(rsb, nthreads) != sum) {
+        rprintf(t, "linear and strided aggregation disagree with %d threads\n", nthreads);
+        *pstatus = REGRESSION_TEST_FAILED;
+      }
+      linear += ink_get_hrtime_internal() - start;
+    }
+    rprintf(t, "%d stats x %d threads: per-stat sync %" PRId64 " ns, per-block sync %" PRId64 " ns\n",
+            num_stats, nthreads, (int64_t)(strided / num_passes), (int64_t)(linear / num_passes));
+  }
+
+  // a full sync must fold the thread-local increments into the globals
+  raw_stat_sync_block(rsb, ink_atomic_increment64(&g_rec_raw_stat_sync_generation, 1) + 1);
+  sum = 0;
+  for (int id = 0; id < num_stats; id++) {
+    sum += globals[id].sum;
+  }
+  if (sum != 2 * (int64_t)num_incrs) {
+    rprintf(t, "synced sum %" PRId64 " != %d\n", sum, 2 * num_incrs);
+    *pstatus = REGRESSION_TEST_FAILED;
+  }
+
+  // the block itself is leaked with its thread-local space
+  for (int id = 0; id < num_stats; id++) {
+    rsb->global[id] = NULL;
+  }
+  ats_free(globals);
+}
+
+REGRESSION_TEST(RecRawStat_Histogram) (RegressionTest *t, int atype, int *pstatus)
+{
+  REC_NOWARN_UNUSED(atype);
+
+  int last = 0, bucket;
+  int64_t value, reported;
+
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  // buckets are dense, monotonic and report values within the error bound
+  for (value = 0; value < (1LL << REC_HISTOGRAM_MAX_BITS); value = value < 4096 ? value + 1 : value + value / 37) {
+    bucket = RecRawStatHistogramBucket(value);
+    if (bucket < last || bucket > last + 1 || bucket >= REC_HISTOGRAM_BUCKETS) {
+      rprintf(t, "value %" PRId64 " mapped to bucket %d after bucket %d\n", value, bucket, last);
+      *pstatus = REGRESSION_TEST_FAILED;
+      return;
+    }
+    reported = raw_stat_histogram_value(bucket);
+    if ((reported > value ? reported - value : value - reported) * REC_HISTOGRAM_SUB_BUCKETS > value) {
+      rprintf(t, "value %" PRId64 " reported as %" PRId64 "\n", value, reported);
+      *pstatus = REGRESSION_TEST_FAILED;
+    }
+    last = bucket;
+  }
+  if (RecRawStatHistogramBucket((1LL << REC_HISTOGRAM_MAX_BITS) - 1) != REC_HISTOGRAM_BUCKETS - 1 ||
+      RecRawStatHistogramBucket(INT64_MAX) != REC_HISTOGRAM_BUCKETS - 1) {
+    rprintf(t, "largest values don't map to the last bucket\n");
+    *pstatus = REGRESSION_TEST_FAILED;
+  }
+}
+
+REGRESSION_TEST(RecRawStat_HistogramWindow) (RegressionTest *t, int atype, int *pstatus)
+{
+  REC_NOWARN_UNUSED(atype);
+
+  RecRawStatBlock *rsb = RecAllocateRawStatHistogram();
+  RecRawStatHistogram *h;
+  ink_hrtime half = HRTIME_MSECONDS(REC_HISTOGRAM_WINDOW_MS / 2);
+  ink_hrtime now = half;
+
+  *pstatus = REGRESSION_TEST_PASSED;
+  if (rsb == NULL) {
+    rprintf(t, "couldn't allocate a histogram\n");
+    *pstatus = REGRESSION_TEST_FAILED;
+    return;
+  }
+  h = rsb->histogram;
+
+  // stand in for the sync passes by setting the bucket globals directly
+  rsb->sync_generation++;
+  raw_stat_histogram_window(rsb, now);
+  rsb->global[1]->count = 10;
+  rsb->sync_generation++;
+  raw_stat_histogram_window(rsb, now + half / 2);
+  if (h->window_total != 10) {
+    rprintf(t, "first window holds %" PRId64 " samples, not 10\n", h->window_total);
+    *pstatus = REGRESSION_TEST_FAILED;
+  }
+
+  // the window after the next half still sees the first half's samples
+  rsb->global[2]->count = 5;
+  rsb->sync_generation++;
+  raw_stat_histogram_window(rsb, now += half);
+  if (h->window_total != 15 || h->window[1] != 10 || h->window[2] != 5) {
+    rprintf(t, "second window holds %" PRId64 " samples, not 15\n", h->window_total);
+    *pstatus = REGRESSION_TEST_FAILED;
+  }
+
+  // and the one after that has dropped them
+  rsb->global[2]->count = 8;
+  rsb->sync_generation++;
+  raw_stat_histogram_window(rsb, now += half);
+  if (h->window_total != 3 || h->window[1] != 0) {
+    rprintf(t, "third window holds %" PRId64 " samples, not 3\n", h->window_total);
+    *pstatus = REGRESSION_TEST_FAILED;
+  }
+
+  // nothing moves within a sync pass
+  rsb->global[2]->count = 50;
+  raw_stat_histogram_window(rsb, now += half);
+  if (h->window_total != 3) {
+    rprintf(t, "window recomputed within a sync pass\n");
+    *pstatus = REGRESSION_TEST_FAILED;
+  }
+  // the block itself is leaked with its thread-local space
+}
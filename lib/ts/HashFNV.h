@@ -0,0 +1,87 @@
+/** @file
+
+  FNV-1a hashes
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef _HashFNV_h_
+#define _HashFNV_h_
+
+#include "ink_port.h"
+
+/**
+  FNV-1a (Fowler, Noll, Vo), 32 and 64 bit.
+
+  A fast non-cryptographic hash of a byte string, for in memory tables.
+  ATS_FNV1a32() and ATS_FNV1a64() hash a buffer. A key made of several
+  parts, or one that is case folded on the way, is hashed by starting
+  from ATS_FNV1a32_INIT or ATS_FNV1a64_INIT and feeding the parts in
+  order with the _update() and _byte() steps.
+*/
+#define ATS_FNV1a32_INIT 2166136261U
+#define ATS_FNV1a64_INIT 14695981039346656037ULL
+
+static inline uint32_t
+ATS_FNV1a32_byte(uint32_t h, unsigned char c)
+{
+  return (h ^ c) * 16777619U;
+}
+
+static inline uint32_t
+ATS_FNV1a32_update(uint32_t h, const void *data, size_t len)
+{
+  const unsigned char *p = (const unsigned char *) data;
+  const unsigned char *end = p + len;
+
+  while (p < end)
+    h = ATS_FNV1a32_byte(h, *p++);
+  return h;
+}
+
+static inline uint32_t
+ATS_FNV1a32(const void *data, size_t len)
+{
+  return ATS_FNV1a32_update(ATS_FNV1a32_INIT, data, len);
+}
+
+static inline uint64_t
+ATS_FNV1a64_byte(uint64_t h, unsigned char c)
+{
+  return (h ^ c) * 1099511628211ULL;
+}
+
+static inline uint64_t
+ATS_FNV1a64_update(uint64_t h, const void *data, size_t len)
+{
+  const unsigned char *p = (const unsigned char *) data;
+  const unsigned char *end = p + len;
+
+  while (p < end)
+    h = ATS_FNV1a64_byte(h, *p++);
+  return h;
+}
+
+static inline uint64_t
+ATS_FNV1a64(const void *data, size_t len)
+{
+  return ATS_FNV1a64_update(ATS_FNV1a64_INIT, data, len);
+}
+
+#endif
@@ -31,6 +31,7 @@
 
 #include "libts.h"
 #include "HostLookup.h"
+#include "HostTrie.h"
 #include "MatcherUtils.h"
 
 // bool domaincmp(const char* hostname, const char* domain)
@@ -157,217 +158,33 @@ hostcmp(const char *c1, const char *c2)
   return 0;
 }
 
-// static const unsigned char asciiToTable[256]
-//
-//   Used to Map Legal hostname characters into
-//     to indexes used by char_table to
-//     index strings
-//
-//   Legal hostname characters are 0-9, A-Z, a-z and '-'
-//   '_' is also included although it is not in the spec (RFC 883)
-//
-//   Uppercase and lowercase "a-z" both map to same indexes
-//     since hostnames are not case sensative
-//
-//   Illegal characters map to 255
-//
-static const unsigned char asciiToTable[256] = {
-  255, 255, 255, 255, 255, 255, 255, 255,       // 0 - 7
-  255, 255, 255, 255, 255, 255, 255, 255,       // 8 - 15
-  255, 255, 255, 255, 255, 255, 255, 255,       // 16 - 23
-  255, 255, 255, 255, 255, 255, 255, 255,       // 24 - 31
-  255, 255, 255, 255, 255, 255, 255, 255,       // 32 - 39
-  255, 255, 255, 255, 255, 0, 255, 255, // 40 - 47 ('-')
-  1, 2, 3, 4, 5, 6, 7, 8,       // 48 - 55 (0-7)
-  9, 10, 255, 255, 255, 255, 255, 255,  // 56 - 63 (8-9)
-  255, 11, 12, 13, 14, 15, 16, 17,      // 64 - 71 (A-G)
-  18, 19, 20, 21, 22, 23, 24, 25,       // 72 - 79 (H-O)
-  26, 27, 28, 29, 30, 31, 32, 33,       // 80 - 87 (P-W)
-  34, 35, 36, 255, 255, 255, 255, 37,   // 88 - 95 (X-Z, '_')
-  255, 11, 12, 13, 14, 15, 16, 17,      // 96 - 103 (a-g)
-  18, 19, 20, 21, 22, 23, 24, 25,       // 104 - 111 (h-0)
-  26, 27, 28, 29, 30, 31, 32, 33,       // 112 - 119 (p-w)
-  34, 35, 36, 255, 255, 255, 255, 255,  // 120 - 127 (x-z)
-  255, 255, 255, 255, 255, 255, 255, 255,
-  255, 255, 255, 255, 255, 255, 255, 255,
-  255, 255, 255, 255, 255, 255, 255, 255,
-  255, 255, 255, 255, 255, 255, 255, 255,
-  255, 255, 255, 255, 255, 255, 255, 255,
-  255, 255, 255, 255, 255, 255, 255, 255,
-  255, 255, 255, 255, 255, 255, 255, 255,
-  255, 255, 255, 255, 255, 255, 255, 255,
-  255, 255, 255, 255, 255, 255, 255, 255,
-  255, 255, 255, 255, 255, 255, 255, 255,
-  255, 255, 255, 255, 255, 255, 255, 255,
-  255, 255, 255, 255, 255, 255, 255, 255,
-  255, 255, 255, 255, 255, 255, 255, 255,
-  255, 255, 255, 255, 255, 255, 255, 255,
-  255, 255, 255, 255, 255, 255, 255, 255,
-  255, 255, 255, 255, 255, 255, 255, 255
-};
-
-// Number of legal characters in the acssiToTable array
-static const int numLegalChars = 38;
-
-// struct charIndex_el
-//
-//   Used by class charIndex.  Forms a single level
-//    in charIndex tree
-//
-struct charIndex_el
-{
-  charIndex_el();
-  ~charIndex_el();
-  HostBranch *branch_array[numLegalChars];
-  charIndex_el *next_level[numLegalChars];
-};
-
-charIndex_el::charIndex_el()
-{
-  memset(branch_array, 0, sizeof(branch_array));
-  memset(next_level, 0, sizeof(next_level));
-}
-
-charIndex_el::~charIndex_el()
-{
-  int i;
-
-  // Recursively delete all the lower levels of the
-  //   data structure
-  for (i = 0; i < numLegalChars; i++) {
-    if (next_level[i] != NULL) {
-      delete next_level[i];
-    }
-  }
-}
-
-// struct charIndexIterInternal
-//
-//  An internal struct to charIndexIterState
-//    Stores the location of an element in
-//    class charIndex
-//
-struct charIndexIterInternal
-{
-  charIndex_el *ptr;
-  int index;
-};
-
-// Used as a default return element for DynArray in
-//   struct charIndexIterState
-static charIndexIterInternal default_iter = { NULL, -1 };
-
-// struct charIndexIterState
+// class charIndex - A constant time string matcher intended for
+//    short strings in a sparsely populated DNS paritition
 //
-//    struct for the callee to keep interation state
-//      for class charIndex
+//    The strings are the labels of the first level of the table,
+//      ie: com, edu, jp, fr, bound in a HostTrie.  Finding one
+//      is a probe of the trie's child table, the trie's node
+//      array is what the iteration walks
 //
 struct charIndexIterState
 {
-  charIndexIterState();
-
-  // Where that level we are in interation
-  int cur_level;
+  charIndexIterState():cur(HostTrie::NO_NODE)
+  { }
 
-  // Where we got the last element from
-  int cur_index;
-  charIndex_el *cur_el;
-
-  //  Queue of the above levels
-    DynArray<charIndexIterInternal> q;
+  HostTrie::Node cur;
 };
 
-charIndexIterState::charIndexIterState():cur_level(-1), cur_index(-1), cur_el(NULL), q(&default_iter, 6)
-{
-}
-
-
-// class charIndex - A constant time string matcher intended for
-//    short strings in a sparsely populated DNS paritition
-//
-//    Creates a look up table for character in data string
-//
-//    Mapping from character to table index is done by
-//      asciiToTable[]
-//
-//    The illegalKey hash table is side structure for any
-//     entries that contain illegal hostname characters that
-//     we can not index into the normal table
-//
-//    Example: com
-//      c maps to 13, o maps to 25, m maps to 23
-//
-//                             charIndex_el         charIndex_el
-//                             -----------         ------------
-//                           0 |    |    |         |    |     |
-//                           . |    |    |         |    |     |
-//    charIndex_el           . |    |    |         |    |     |
-//    ----------             . |    |    |         |    |     |
-//  0 |   |    |             . |    |    |   |-->23| ptr|  0  |  (ptr is to the
-//  . |   |    |   |-------->25| 0  |   -----|     |    |     |   hostBranch for
-//  . |   |    |   |         . |    |    |         |    |     |   domain com)
-// 13 | 0 |  --|---|         . |    |    |         |    |     |
-//  . |   |    |             . |    |    |         |    |     |
-//  . |   |    |               |    |    |         |    |     |
-//  . |   |    |               |    |    |         |    |     |
-//    |   |    |               -----------         -----------|
-//    |   |    |
-//    |   |    |
-//    |   |    |
-//    |--------|
-//
-//
-//
-class
-  charIndex
+class charIndex
 {
 public:
-  charIndex();
-  ~
-  charIndex();
-  void
-  Insert(const char *match_data, HostBranch * toInsert);
-  HostBranch *
-  Lookup(const char *match_data);
-  HostBranch *
-  iter_first(charIndexIterState * s);
-  HostBranch *
-  iter_next(charIndexIterState * s);
+  void Insert(const char *match_data, HostBranch * toInsert);
+  HostBranch *Lookup(const char *match_data);
+  HostBranch *iter_first(charIndexIterState * s);
+  HostBranch *iter_next(charIndexIterState * s);
 private:
-  charIndex_el *
-    root;
-  InkHashTable *
-    illegalKey;
+  HostTrie trie;
 };
 
-charIndex::charIndex():illegalKey(NULL)
-{
-  root = NEW(new charIndex_el);
-}
-
-charIndex::~charIndex()
-{
-  InkHashTableIteratorState ht_iter;
-  InkHashTableEntry *ht_entry = NULL;
-  HostBranch *tmp;
-
-  delete root;
-
-  // Destroy the illegalKey hashtable if there is one and free
-  //   up all of its values
-  if (illegalKey != NULL) {
-    ht_entry = ink_hash_table_iterator_first(illegalKey, &ht_iter);
-
-    while (ht_entry != NULL) {
-      tmp = (HostBranch *) ink_hash_table_entry_value(illegalKey, ht_entry);
-      ink_assert(tmp != NULL);
-      delete tmp;
-      ht_entry = ink_hash_table_iterator_next(illegalKey, &ht_iter);
-    }
-    ink_hash_table_destroy(illegalKey);
-  }
-}
-
 // void charIndex::Insert(const char* match_data, HostBranch* toInsert)
 //
 //   Places a binding for match_data to toInsert into the index
@@ -375,55 +192,18 @@ charIndex::~charIndex()
 void
 charIndex::Insert(const char *match_data, HostBranch * toInsert)
 {
-  unsigned char index;
-  const char *match_start = match_data;
-  charIndex_el *cur = root;
-  charIndex_el *next;
-
   if (*match_data == '\0') {
     // Should not happen
     ink_assert(0);
     return;
   }
 
-  while (1) {
-    index = asciiToTable[(unsigned char) (*match_data)];
-
-    // Check to see if our index into table is for an
-    //  'illegal' DNS character
-    if (index == 255) {
-      // Insert into illgals hash table
-      if (illegalKey == NULL) {
-        illegalKey = ink_hash_table_create(InkHashTableKeyType_String);
-      }
-      ink_hash_table_insert(illegalKey, (char *) match_start, toInsert);
-      break;
-    }
-
-    // Check to see if are at the level we supposed be at
-    if (*(match_data + 1) == '\0') {
-      // The slot should always be emtpy, no duplicate
-      //   keys are allowed
-      ink_assert(cur->branch_array[index] == NULL);
-      cur->branch_array[index] = toInsert;
-      break;
-    } else {
-      // We need to find the next level in the table
-
-      next = cur->next_level[index];
-
-      // Check to see if we need to expand the table
-      if (next == NULL) {
-        next = NEW(new charIndex_el);
-        cur->next_level[index] = next;
-      }
-      cur = next;
-    }
-    match_data++;
-  }
+  // No duplicate keys are allowed
+  bool inserted = trie.Insert(match_data, strlen(match_data), toInsert);
+  ink_assert(inserted);
+  NOWARN_UNUSED(inserted);
 }
 
-
 // HostBranch* charIndex::Lookup(const char* match_data)
 //
 //  Searches the charIndex on key match_data
@@ -433,50 +213,14 @@ charIndex::Insert(const char *match_data, HostBranch * toInsert)
 HostBranch *
 charIndex::Lookup(const char *match_data)
 {
-  unsigned char index;
-  charIndex_el *cur = root;
-  void *hash_lookup;
-  const char *match_start = match_data;
-
-  if (root == NULL || *match_data == '\0') {
+  if (*match_data == '\0') {
     return NULL;
   }
-
-  while (1) {
-
-    index = asciiToTable[(unsigned char) (*match_data)];
-
-    // Check to see if our index into table is for an
-    //  'illegal' DNS character
-    if (index == 255) {
-      if (illegalKey == NULL) {
-        return NULL;
-      } else {
-        if (ink_hash_table_lookup(illegalKey, (char *) match_start, &hash_lookup)) {
-          return (HostBranch *) hash_lookup;
-        } else {
-          return NULL;
-        }
-      }
-    }
-    // Check to see if we are looking for the next level or
-    //    a HostBranch
-    if (*(match_data + 1) == '\0') {
-      return cur->branch_array[index];
-    } else {
-      cur = cur->next_level[index];
-
-      if (cur == NULL) {
-        return NULL;
-      }
-    }
-
-    match_data++;
-  }
+  return (HostBranch *) trie.Lookup(match_data, strlen(match_data));
 }
 
 //
-// HostBranch* charIndex::iter_next(charIndexIterState* s)
+// HostBranch* charIndex::iter_first(charIndexIterState* s)
 //
 //    Initialize iterator state and returns the first element
 //     found in the charTable.  If none is found, NULL
@@ -485,11 +229,8 @@ charIndex::Lookup(const char *match_data)
 HostBranch *
 charIndex::iter_first(charIndexIterState * s)
 {
-  s->cur_level = 0;
-  s->cur_index = -1;
-  s->cur_el = root;
-
-  return iter_next(s);
+  s->cur = trie.iter_first();
+  return s->cur != HostTrie::NO_NODE ? (HostBranch *) trie.value(s->cur) : NULL;
 }
 
 //
@@ -502,71 +243,11 @@ charIndex::iter_first(charIndexIterState * s)
 HostBranch *
 charIndex::iter_next(charIndexIterState * s)
 {
-  int index;
-  charIndex_el *current_el = s->cur_el;
-  intptr_t level = s->cur_level;
-  charIndexIterInternal stored_state;
-  HostBranch *r = NULL;
-  bool first_element;
-
-  // bool first_element is used to tell if first elemente
-  //  pointed to by s has already been returned to caller
-  //  it has unless we are being called from iter_first
-  if (s->cur_index < 0) {
-    first_element = false;
-    index = s->cur_index + 1;
-  } else {
-    first_element = true;
-    index = s->cur_index;
-  }
-
-  while (1) {
-
-    // Check to see if we need to go back up a level
-    if (index >= numLegalChars) {
-      if (level <= 0) {
-        // No more levels so bail out
-        break;
-      } else {
-        // Go back up to a stored level
-        stored_state = s->q[level - 1];
-        ink_assert(stored_state.ptr != NULL);
-        ink_assert(stored_state.index >= 0);
-        level--;
-        current_el = stored_state.ptr;
-        index = stored_state.index + 1;
-      }
-    } else {
-      // Check to see if there is something to return
-      //
-      //  Note: we check for something to return before a descending
-      //    a level so that when we come back up we will
-      //    be done with this index
-      //
-      if (current_el->branch_array[index] != NULL && first_element == false) {
-        r = current_el->branch_array[index];
-        s->cur_level = level;
-        s->cur_index = index;
-        s->cur_el = current_el;
-        break;
-      } else if (current_el->next_level[index] != NULL) {
-        // There is a lower level to iterate over, store our
-        //   current state and descend
-        stored_state.ptr = current_el;
-        stored_state.index = index;
-        s->q(level) = stored_state;
-        current_el = current_el->next_level[index];
-        index = 0;
-        level++;
-      } else {
-        // Nothing here so advance to next index
-        index++;
-      }
-    }
-    first_element = false;
+  if (s->cur == HostTrie::NO_NODE) {
+    return NULL;
   }
-
-  return r;
+  s->cur = trie.iter_next(s->cur);
+  return s->cur != HostTrie::NO_NODE ? (HostBranch *) trie.value(s->cur) : NULL;
 }
 
 // class hostArray
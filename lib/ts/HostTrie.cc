@@ -0,0 +1,264 @@
+/** @file
+
+  A compact, label granular hostname trie
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/*****************************************************************************
+ *
+ *  HostTrie.cc - Hostname trie shared by the host matchers
+ *
+ *
+ ****************************************************************************/
+
+#include "libts.h"
+#include "HostTrie.h"
+
+#define HOST_TRIE_MIN_NODES  16
+#define HOST_TRIE_MIN_LABELS 256
+
+static inline unsigned char
+lower(unsigned char c)
+{
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+HostTrie::HostTrie()
+  : num_nodes(1), nodes_size(HOST_TRIE_MIN_NODES), labels_len(0), labels_size(HOST_TRIE_MIN_LABELS),
+    slot_mask(2 * HOST_TRIE_MIN_NODES - 1), num_keys(0)
+{
+  nodes = (TrieNode *) ats_malloc(sizeof(TrieNode) * nodes_size);
+  labels = (char *) ats_malloc(labels_size);
+  slots = (Slot *) ats_malloc(sizeof(Slot) * (slot_mask + 1));
+  memset(slots, 0, sizeof(Slot) * (slot_mask + 1));
+
+  nodes[ROOT].value = NULL;
+  nodes[ROOT].parent = NO_NODE;
+  nodes[ROOT].label = 0;
+  nodes[ROOT].label_len = 0;
+}
+
+HostTrie::~HostTrie()
+{
+  ats_free(nodes);
+  ats_free(labels);
+  ats_free(slots);
+}
+
+uint32_t
+HostTrie::hash(Node parent, const char *label, int len)
+{
+  uint32_t h = ATS_FNV1a32_INIT;
+
+  h = ATS_FNV1a32_byte(h, parent & 0xff);
+  h = ATS_FNV1a32_byte(h, (parent >> 8) & 0xff);
+  h = ATS_FNV1a32_byte(h, (parent >> 16) & 0xff);
+  h = ATS_FNV1a32_byte(h, parent >> 24);
+  for (int i = 0; i < len; i++) {
+    h = ATS_FNV1a32_byte(h, lower(label[i]));
+  }
+  return h;
+}
+
+HostTrie::Node
+HostTrie::child(Node parent, const char *label, int len) const
+{
+  uint32_t h = hash(parent, label, len);
+  uint32_t i = h & slot_mask;
+
+  while (slots[i].node != 0) {
+    if (slots[i].hash == h) {
+      const TrieNode *n = nodes + slots[i].node;
+      if (n->parent == parent && n->label_len == (uint32_t) len && strncasecmp(labels + n->label, label, len) == 0) {
+        return slots[i].node;
+      }
+    }
+    i = (i + 1) & slot_mask;
+  }
+  return NO_NODE;
+}
+
+// void HostTrie::growSlots()
+//
+//   Doubles the child table, keeping it at most half full
+//
+void
+HostTrie::growSlots()
+{
+  uint32_t old_size = slot_mask + 1;
+  Slot *old_slots = slots;
+
+  slot_mask = 2 * old_size - 1;
+  slots = (Slot *) ats_malloc(sizeof(Slot) * (slot_mask + 1));
+  memset(slots, 0, sizeof(Slot) * (slot_mask + 1));
+
+  for (uint32_t j = 0; j < old_size; j++) {
+    if (old_slots[j].node != 0) {
+      uint32_t i = old_slots[j].hash & slot_mask;
+      while (slots[i].node != 0) {
+        i = (i + 1) & slot_mask;
+      }
+      slots[i] = old_slots[j];
+    }
+  }
+  ats_free(old_slots);
+}
+
+HostTrie::Node
+HostTrie::addChild(Node parent, const char *label, int len, uint32_t h)
+{
+  if (num_nodes == nodes_size) {
+    nodes_size *= 2;
+    nodes = (TrieNode *) ats_realloc(nodes, sizeof(TrieNode) * nodes_size);
+  }
+  if (labels_len + len > labels_size) {
+    while (labels_len + len > labels_size) {
+      labels_size *= 2;
+    }
+    labels = (char *) ats_realloc(labels, labels_size);
+  }
+  if (2 * (num_nodes + 1) > slot_mask + 1) {
+    growSlots();
+  }
+
+  Node n = num_nodes++;
+  nodes[n].value = NULL;
+  nodes[n].parent = parent;
+  nodes[n].label = labels_len;
+  nodes[n].label_len = len;
+  memcpy(labels + labels_len, label, len);
+  labels_len += len;
+
+  uint32_t i = h & slot_mask;
+  while (slots[i].node != 0) {
+    i = (i + 1) & slot_mask;
+  }
+  slots[i].hash = h;
+  slots[i].node = n;
+  return n;
+}
+
+bool
+HostTrie::Insert(const char *key, int len, void *value, bool replace)
+{
+  Node cur = ROOT;
+  const char *end = key + len;
+  const char *p;
+
+  ink_assert(value != NULL);
+  if (len <= 0) {
+    return false;
+  }
+
+  // Walk the labels from the last one
+  while (true) {
+    p = end;
+    while (p > key && *(p - 1) != '.') {
+      p--;
+    }
+
+    Node next = child(cur, p, end - p);
+    if (next == NO_NODE) {
+      next = addChild(cur, p, end - p, hash(cur, p, end - p));
+    }
+    cur = next;
+
+    if (p == key) {
+      break;
+    }
+    end = p - 1;
+  }
+
+  if (nodes[cur].value != NULL) {
+    if (!replace) {
+      return false;
+    }
+  } else {
+    num_keys++;
+  }
+  nodes[cur].value = value;
+  return true;
+}
+
+void *
+HostTrie::Lookup(const char *key, int len) const
+{
+  Node cur = ROOT;
+  const char *end = key + len;
+  const char *p;
+
+  if (len <= 0) {
+    return NULL;
+  }
+
+  while (true) {
+    p = end;
+    while (p > key && *(p - 1) != '.') {
+      p--;
+    }
+
+    cur = child(cur, p, end - p);
+    if (cur == NO_NODE) {
+      return NULL;
+    }
+
+    if (p == key) {
+      return nodes[cur].value;
+    }
+    end = p - 1;
+  }
+}
+
+HostTrie::Node
+HostTrie::iter_next(Node n) const
+{
+  for (n++; n < num_nodes; n++) {
+    if (nodes[n].value != NULL) {
+      return n;
+    }
+  }
+  return NO_NODE;
+}
+
+int
+HostTrie::getKey(Node n, char *buf, int size) const
+{
+  int len = 0;
+
+  for (Node cur = n; cur != ROOT; cur = nodes[cur].parent) {
+    const TrieNode *node = nodes + cur;
+    if (len + (int) node->label_len + 2 > size) {
+      return -1;
+    }
+    memcpy(buf + len, labels + node->label, node->label_len);
+    len += node->label_len;
+    if (node->parent != ROOT) {
+      buf[len++] = '.';
+    }
+  }
+  buf[len] = '\0';
+  return len;
+}
+
+size_t
+HostTrie::getMemorySize() const
+{
+  return sizeof(*this) + sizeof(TrieNode) * nodes_size + labels_size + sizeof(Slot) * (slot_mask + 1);
+}
@@ -0,0 +1,126 @@
+/** @file
+
+  A compact, label granular hostname trie
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/*****************************************************************************
+ *
+ *  HostTrie.h - Hostname trie shared by the host matchers
+ *
+ *
+ ****************************************************************************/
+
+#ifndef _HOST_TRIE_H_
+#define _HOST_TRIE_H_
+
+#include "ink_port.h"
+
+// class HostTrie
+//
+//   Binds hostnames to opaque data. A node stands for a whole label and
+//   the labels of a name are walked from the last one, so www.example.com
+//   is com -> example -> www and every name under a domain shares the
+//   domain's nodes. Labels compare without regard to case.
+//
+//   Everything lives in three arrays: the nodes, the label bytes and an
+//   open addressed table from (parent node, label) to the child node.
+//   Finding a child is one probe of the table and a compare of the
+//   label, instead of a node per character of a 64 way array each.
+//   Nodes are referred to by index, the root being 0; nodes are never
+//   removed.
+//
+//   The walk itself is left to the users, which differ in how a domain
+//   matches the names under it, through child().
+//
+class HostTrie
+{
+public:
+  typedef uint32_t Node;
+  static const Node ROOT = 0;
+  static const Node NO_NODE = 0xffffffff;
+
+  HostTrie();
+  ~HostTrie();
+
+  // Binds key to value, which must not be NULL.  Returns false
+  //   if key is empty, or already bound and not to be replaced
+  bool Insert(const char *key, int len, void *value, bool replace = false);
+  void *Lookup(const char *key, int len) const;
+
+  // The child of parent for label, NO_NODE if there is none
+  Node child(Node parent, const char *label, int len) const;
+  void *value(Node n) const
+  {
+    return nodes[n].value;
+  }
+
+  // Iterates over the bound nodes, in insertion order
+  Node iter_first() const
+  {
+    return iter_next(ROOT);
+  }
+  Node iter_next(Node n) const;
+
+  // Writes the name bound at n to buf, returns its length or -1 if
+  //   it does not fit
+  int getKey(Node n, char *buf, int size) const;
+
+  int getCount() const
+  {
+    return num_keys;
+  }
+  size_t getMemorySize() const;
+
+private:
+  struct TrieNode
+  {
+    void *value;
+    Node parent;
+    uint32_t label;             // offset into labels
+    uint32_t label_len;
+  };
+
+  struct Slot
+  {
+    uint32_t hash;
+    Node node;                  // 0 (the root is nobody's child) if free
+  };
+
+  static uint32_t hash(Node parent, const char *label, int len);
+  Node addChild(Node parent, const char *label, int len, uint32_t h);
+  void growSlots();
+
+  TrieNode *nodes;
+  uint32_t num_nodes;
+  uint32_t nodes_size;
+  char *labels;
+  uint32_t labels_len;
+  uint32_t labels_size;
+  Slot *slots;
+  uint32_t slot_mask;
+  int num_keys;
+
+  // No copies
+  HostTrie(const HostTrie &);
+  HostTrie & operator=(const HostTrie &);
+};
+
+#endif
@@ -0,0 +1,106 @@
+/** @file
+
+    A brief file description
+
+    @section license License
+
+    Licensed to the Apache Software Foundation (ASF) under one
+    or more contributor license agreements.  See the NOTICE file
+    distributed with this work for additional information
+    regarding copyright ownership.  The ASF licenses this file
+    to you under the Apache License, Version 2.0 (the
+    "License"); you may not use this file except in compliance
+    with the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <ts/libts.h>
+#include <ts/HostTrie.h>
+#include <ts/TestBox.h>
+
+REGRESSION_TEST(HostTrie_Basic)(RegressionTest* t, int atype, int* pstatus) {
+  NOWARN_UNUSED(atype);
+  TestBox tb(t, pstatus);
+  HostTrie trie;
+  void* const markA = reinterpret_cast<void*>(1);
+  void* const markB = reinterpret_cast<void*>(2);
+  void* const markC = reinterpret_cast<void*>(3);
+  char buf[256];
+
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  tb.check(trie.Insert("www.example.com", 15, markA), "Insert failed");
+  tb.check(trie.Insert(".example.com", 12, markB), "Insert of a domain failed");
+  tb.check(trie.Insert("com", 3, markC), "Insert of a shared prefix failed");
+  tb.check(!trie.Insert("WWW.Example.COM", 15, markC), "Duplicate differing in case was inserted");
+  tb.check(!trie.Insert("", 0, markC), "Empty key was inserted");
+  tb.check(trie.getCount() == 3, "Count is %d, not 3", trie.getCount());
+  tb.check(trie.Insert("COM", 3, markA, true) && trie.Lookup("com", 3) == markA, "Replace failed");
+  tb.check(trie.Insert("com", 3, markC, true) && trie.getCount() == 3, "Replace changed the count");
+
+  tb.check(trie.Lookup("www.EXAMPLE.com", 15) == markA, "Lookup ignoring case failed");
+  tb.check(trie.Lookup(".example.com", 12) == markB, "Lookup of a domain failed");
+  tb.check(trie.Lookup("example.com", 11) == NULL, "Lookup of an unbound inner node");
+  tb.check(trie.Lookup("ww.example.com", 14) == NULL, "Lookup matched part of a label");
+  tb.check(trie.Lookup("a.www.example.com", 17) == NULL, "Lookup matched a longer name");
+
+  HostTrie::Node n = trie.child(HostTrie::ROOT, "COM", 3);
+  tb.check(n != HostTrie::NO_NODE && trie.value(n) == markC, "Child walk failed");
+  n = trie.child(n, "example", 7);
+  tb.check(n != HostTrie::NO_NODE && trie.value(n) == NULL, "Child walk to an inner node failed");
+  tb.check(trie.child(n, "", 0) != HostTrie::NO_NODE, "Child walk to the domain failed");
+
+  int count = 0;
+  for (n = trie.iter_first(); n != HostTrie::NO_NODE; n = trie.iter_next(n)) {
+    count++;
+    if (trie.value(n) == markB) {
+      tb.check(trie.getKey(n, buf, sizeof(buf)) == 12 && strcmp(buf, ".example.com") == 0,
+               "Key of the domain is '%s'", buf);
+    }
+  }
+  tb.check(count == 3, "Iteration found %d names, not 3", count);
+}
+
+REGRESSION_TEST(HostTrie_Large)(RegressionTest* t, int atype, int* pstatus) {
+  NOWARN_UNUSED(atype);
+  TestBox tb(t, pstatus);
+  const int nhosts = 1000000;
+  const int nlookups = 1000000;
+  HostTrie trie;
+  char host[64];
+  int len;
+
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  // Names spread over 1000 domains under 4 top level domains
+  static const char* tlds[] = { "com", "net", "org", "cn" };
+  bool inserted = true;
+  for (intptr_t i = 0; i < nhosts; i++) {
+    len = snprintf(host, sizeof(host), "img%ld.site%ld.%s", (long)(i / 1000), (long)(i % 1000), tlds[i % 4]);
+    inserted = trie.Insert(host, len, reinterpret_cast<void*>(i + 1)) && inserted;
+  }
+  tb.check(inserted && trie.getCount() == nhosts, "%d of %d names inserted", trie.getCount(), nhosts);
+
+  bool found = true;
+  ink_hrtime start = ink_get_hrtime_internal();
+  for (int i = 0; i < nlookups; i++) {
+    long k = (long)(i * 7919L) % nhosts;
+    len = snprintf(host, sizeof(host), "img%ld.site%ld.%s", k / 1000, k % 1000, tlds[k % 4]);
+    if (trie.Lookup(host, len) != reinterpret_cast<void*>(k + 1)) {
+      found = false;
+    }
+  }
+  ink_hrtime elapsed = ink_get_hrtime_internal() - start;
+
+  rprintf(t, "%d lookups over %d names: %.1f ns per lookup, %.1f bytes per name\n",
+          nlookups, nhosts, (double)elapsed / (double)nlookups, (double)trie.getMemorySize() / (double)nhosts);
+  tb.check(found, "Every name found with its value");
+  tb.check(trie.Lookup("img1000.site0.com", 17) == NULL, "Unknown name found");
+}
@@ -1,4 +1,5 @@
 # include "IpMap.h"
+# include "ink_memory.h"
 
 /** @file
     IP address map support.
@@ -765,7 +766,7 @@ IpMapBase<N>::mark(ArgType min, ArgType max, void* payload) {
       // Can only have left skew overlap, otherwise disjoint.
       // Clip if overlap.
       if (n->_max >= min) n->setMax(min_1);
-      else if (next(n) && n->_max <= max) {
+      else if (next(n) && next(n)->_max <= max) {
         // request region covers next span so we can re-use that node.
         x = next(n);
         x->setMin(min).setMax(max).setData(payload);
@@ -817,8 +818,8 @@ IpMapBase<N>::mark(ArgType min, ArgType max, void* payload) {
       y = n;
       n = next(n);
       this->remove(y);
-    } else if (n->_min <= max) { // skew overlap different payload
-      n->setMin(max_plus);
+    } else { // skew overlap or adj., different payload
+      if (n->_min <= max) n->setMin(max_plus);
       break;
     }
   }
@@ -963,6 +964,7 @@ typedef Interval<in_addr_t, in_addr_t> Ip4Span;
 */
 class Ip4Node : public IpMap::Node, protected Ip4Span {
   friend struct IpMapBase<Ip4Node>;
+  friend class IpFlatMap;
 public:
   typedef Ip4Node self; ///< Self reference type.
 
@@ -1089,6 +1091,7 @@ typedef Interval<sockaddr_in6> Ip6Span;
 */
 class Ip6Node : public IpMap::Node, protected Ip6Span {
   friend struct IpMapBase<Ip6Node>;
+  friend class IpFlatMap;
 public:
   typedef Ip6Node self; ///< Self reference type.
   /// Override @c ArgType from @c Interval because the convention
@@ -1237,11 +1240,181 @@ class Ip6Map : public IpMapBase<Ip6Node> {
   friend class ::IpMap;
 };
 
+//----------------------------------------------------------------------------
+/** Key for an IPv6 address in a compiled map.
+    The address is held in host order as two integers so that it
+    compares without a byte by byte loop.
+*/
+struct Ip6Key {
+  uint64_t _hi; ///< Upper 64 bits.
+  uint64_t _lo; ///< Lower 64 bits.
+
+  Ip6Key() {}
+  /// Construct from an address (network order).
+  explicit Ip6Key(sockaddr_in6 const* addr) : _hi(0), _lo(0) {
+    uint8_t const* b = addr->sin6_addr.s6_addr;
+    for ( int i = 0 ; i < 8 ; ++i ) {
+      _hi = (_hi << 8) | b[i];
+      _lo = (_lo << 8) | b[i + 8];
+    }
+  }
+  bool operator <= (Ip6Key const& that) const {
+    return _hi < that._hi || (_hi == that._hi && _lo <= that._lo);
+  }
+};
+
+/** Compiled ranges of one address family.
+
+    The ranges in a map are disjoint and sorted, so the range that
+    holds an address is the one with the largest minimum that is not
+    greater than the address. The minimums are stored in Eytzinger
+    (breadth first) order, node @c k having children @c 2k and
+    @c 2k+1, which makes the search a branch free descent from the
+    root. The top levels of the tree share a few cache lines and the
+    line four levels down is prefetched on the way, instead of
+    chasing a pointer per level of a red/black tree. The maximums and
+    client data are kept in the same order in separate arrays, as
+    they are read once per search.
+*/
+template <
+  typename K ///< Key (address) type.
+> struct IpFlatSpans {
+  typedef IpFlatSpans self; ///< Self reference type.
+
+  IpFlatSpans() : _n(0), _min(0), _max(0), _data(0) {}
+  ~IpFlatSpans() {
+    ats_memalign_free(_min);
+    ats_free(_max);
+    ats_free(_data);
+  }
+
+  /// Load @a n ranges, given in order.
+  void load(
+    K const* min, ///< Minimums.
+    K const* max, ///< Maximums.
+    void* const* data, ///< Client data.
+    size_t n ///< Number of ranges.
+  ) {
+    _n = n;
+    // Index 0 is not used, the root is 1.
+    _min = static_cast<K*>(ats_memalign(LINE_SIZE, sizeof(K) * (n + 1)));
+    _max = static_cast<K*>(ats_malloc(sizeof(K) * (n + 1)));
+    _data = static_cast<void**>(ats_malloc(sizeof(void*) * (n + 1)));
+    this->place(min, max, data, 0, 1);
+  }
+
+  /** Test for membership.
+      @return @c true if @a x is in a range, and then @c *ptr is set
+      to its client data if @a ptr is not @c NULL.
+  */
+  bool contains(K const& x, void** ptr) const {
+    size_t k = 1;
+    while (k <= _n) {
+      __builtin_prefetch(_min + PREFETCH_SCALE * k);
+      k = 2 * k + (_min[k] <= x);
+    }
+    // The low bits of k are the path taken, a set bit for each step
+    // right. The last step right was from the range we want.
+    k >>= __builtin_ffsll(k);
+    if (k && x <= _max[k]) {
+      if (ptr) *ptr = _data[k];
+      return true;
+    }
+    return false;
+  }
+
+  /// Place the ranges in the subtree at @a k, from sorted index @a i.
+  /// @return The sorted index after the subtree.
+  size_t place(K const* min, K const* max, void* const* data, size_t i, size_t k) {
+    if (k <= _n) {
+      i = this->place(min, max, data, i, 2 * k);
+      _min[k] = min[i];
+      _max[k] = max[i];
+      _data[k] = data[i];
+      ++i;
+      i = this->place(min, max, data, i, 2 * k + 1);
+    }
+    return i;
+  }
+
+  static size_t const LINE_SIZE = 64; ///< Cache line size.
+  /// Multiplier for the node four levels down from a node, which is
+  /// the first of the 16 there and on the same line as the rest when
+  /// they fit.
+  static size_t const PREFETCH_SCALE = 16;
+
+  size_t _n; ///< Number of ranges.
+  K* _min; ///< Range minimums, Eytzinger order.
+  K* _max; ///< Range maximums, same order.
+  void** _data; ///< Client data, same order.
+};
+
+/** Compiled form of an @c IpMap.
+*/
+class IpFlatMap {
+  friend class ::IpMap;
+public:
+  /// Construct from the maps, either of which may be @c NULL.
+  IpFlatMap(Ip4Map* m4, Ip6Map* m6);
+protected:
+  IpFlatSpans<in_addr_t> _v4; ///< IPv4 ranges, host order.
+  IpFlatSpans<Ip6Key> _v6; ///< IPv6 ranges.
+};
+
+IpFlatMap::IpFlatMap(Ip4Map* m4, Ip6Map* m6) {
+  if (m4 && m4->getCount()) {
+    size_t n = m4->getCount();
+    in_addr_t* min = static_cast<in_addr_t*>(ats_malloc(sizeof(in_addr_t) * n));
+    in_addr_t* max = static_cast<in_addr_t*>(ats_malloc(sizeof(in_addr_t) * n));
+    void** data = static_cast<void**>(ats_malloc(sizeof(void*) * n));
+    size_t i = 0;
+    for ( Ip4Node* spot = m4->getHead() ; spot ; spot = m4->next(spot), ++i ) {
+      min[i] = ntohl(ats_ip4_addr_cast(spot->min()));
+      max[i] = ntohl(ats_ip4_addr_cast(spot->max()));
+      data[i] = spot->data();
+    }
+    _v4.load(min, max, data, n);
+    ats_free(min);
+    ats_free(max);
+    ats_free(data);
+  }
+  if (m6 && m6->getCount()) {
+    size_t n = m6->getCount();
+    Ip6Key* min = static_cast<Ip6Key*>(ats_malloc(sizeof(Ip6Key) * n));
+    Ip6Key* max = static_cast<Ip6Key*>(ats_malloc(sizeof(Ip6Key) * n));
+    void** data = static_cast<void**>(ats_malloc(sizeof(void*) * n));
+    size_t i = 0;
+    for ( Ip6Node* spot = m6->getHead() ; spot ; spot = m6->next(spot), ++i ) {
+      min[i] = Ip6Key(ats_ip6_cast(spot->min()));
+      max[i] = Ip6Key(ats_ip6_cast(spot->max()));
+      data[i] = spot->data();
+    }
+    _v6.load(min, max, data, n);
+    ats_free(min);
+    ats_free(max);
+    ats_free(data);
+  }
+}
+
 }} // end ts::detail
 //----------------------------------------------------------------------------
 IpMap::~IpMap() {
   delete _m4;
   delete _m6;
+  delete _flat;
+}
+
+void
+IpMap::decompile() {
+  delete _flat;
+  _flat = 0;
+}
+
+IpMap&
+IpMap::compile() {
+  this->decompile();
+  _flat = new ts::detail::IpFlatMap(_m4, _m6);
+  return *this;
 }
 
 inline ts::detail::Ip4Map*
@@ -1260,15 +1433,20 @@ bool
 IpMap::contains(sockaddr const* target, void** ptr) const {
   bool zret = false;
   if (AF_INET == target->sa_family) {
-    zret = _m4 && _m4->contains(ntohl(ats_ip4_addr_cast(target)), ptr);
+    in_addr_t x = ntohl(ats_ip4_addr_cast(target));
+    zret = _flat ? _flat->_v4.contains(x, ptr) : _m4 && _m4->contains(x, ptr);
   } else if (AF_INET6 == target->sa_family) {
-    zret = _m6 && _m6->contains(ats_ip6_cast(target), ptr);
+    if (_flat)
+      zret = _flat->_v6.contains(ts::detail::Ip6Key(ats_ip6_cast(target)), ptr);
+    else
+      zret = _m6 && _m6->contains(ats_ip6_cast(target), ptr);
   }
   return zret;
 }
 
 bool
 IpMap::contains(in_addr_t target, void** ptr) const {
+  if (_flat) return _flat->_v4.contains(ntohl(target), ptr);
   return _m4 && _m4->contains(ntohl(target), ptr);
 }
 
@@ -1278,6 +1456,7 @@ IpMap::mark(
   sockaddr const* max,
   void* data
 ) {
+  this->decompile();
   ink_assert(min->sa_family == max->sa_family);
   if (AF_INET == min->sa_family) {
     this->force4()->mark(
@@ -1293,6 +1472,7 @@ IpMap::mark(
 
 IpMap&
 IpMap::mark(in_addr_t min, in_addr_t max, void* data) {
+  this->decompile();
   this->force4()->mark(ntohl(min), ntohl(max), data);
   return *this;
 }
@@ -1302,6 +1482,7 @@ IpMap::unmark(
   sockaddr const* min,
   sockaddr const* max
 ) {
+  this->decompile();
   ink_assert(min->sa_family == max->sa_family);
   if (AF_INET == min->sa_family) {
     if (_m4)
@@ -1317,6 +1498,7 @@ IpMap::unmark(
 
 IpMap&
 IpMap::unmark(in_addr_t min, in_addr_t max) {
+  this->decompile();
   if (_m4) _m4->unmark(ntohl(min), ntohl(max));
   return *this;
 }
@@ -1327,6 +1509,7 @@ IpMap::fill(
   sockaddr const* max,
   void* data
 ) {
+  this->decompile();
   ink_assert(min->sa_family == max->sa_family);
   if (AF_INET == min->sa_family) {
     this->force4()->fill(
@@ -1342,6 +1525,7 @@ IpMap::fill(
 
 IpMap&
 IpMap::fill(in_addr_t min, in_addr_t max, void* data) {
+  this->decompile();
   this->force4()->fill(ntohl(min), ntohl(max), data);
   return *this;
 }
@@ -1356,6 +1540,7 @@ IpMap::getCount() const {
 
 IpMap&
 IpMap::clear() {
+  this->decompile();
   if (_m4) _m4->clear();
   if (_m6) _m6->clear();
   return *this;
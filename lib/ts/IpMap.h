@@ -55,6 +55,7 @@ namespace ts { namespace detail {
 
   class Ip4Map; // Forward declare.
   class Ip6Map; // Forward declare.
+  class IpFlatMap; // Forward declare.
 
   /** A node in a red/black tree.
 
@@ -461,6 +462,23 @@ public:
     void **ptr = 0 ///< Client data return.
   ) const;
 
+  /** Compile the map for lookup.
+
+      The ranges are copied to sorted arrays laid out for searching,
+      which @c contains uses instead of the trees from then on. This
+      is meant to be called once the map is loaded, before it is
+      shared for lookups. Changing the ranges (@c mark, @c unmark,
+      @c fill, @c clear) discards the compiled form. Client data set
+      through an iterator after this is not seen by @c contains
+      until the map is compiled again.
+
+      @return This object.
+  */
+  self& compile();
+
+  /// @return @c true if the map is compiled.
+  bool isCompiled() const;
+
   /** Remove all addresses from the map.
 
       @note This is much faster than @c unmark.
@@ -491,9 +509,12 @@ protected:
   /// Force the IPv6 map to exist.
   /// @return The IPv6 map.
   ts::detail::Ip6Map* force6();
+  /// Discard the compiled form, if any.
+  void decompile();
   
   ts::detail::Ip4Map* _m4; ///< Map of IPv4 addresses.
   ts::detail::Ip6Map* _m6; ///< Map of IPv6 addresses.
+  ts::detail::IpFlatMap* _flat; ///< Compiled form, if any.
   
 };
 
@@ -555,6 +576,10 @@ IpMap::iterator::operator -> () {
   return _node;
 }
 
-inline IpMap::IpMap() : _m4(0), _m6(0) {}
+inline bool IpMap::isCompiled() const {
+  return 0 != _flat;
+}
+
+inline IpMap::IpMap() : _m4(0), _m6(0), _flat(0) {}
 
 # endif // TS_IP_MAP_HEADER
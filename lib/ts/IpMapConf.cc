@@ -167,5 +167,7 @@ Load_IpMap_From_File(IpMap* map, FILE* f, const char *key_str)
       }
     }
   }
+  // Loaded, from here on it is only searched.
+  map->compile();
   return 0;
 }
@@ -22,6 +22,7 @@
 */
 
 #include <ts/IpMap.h>
+#include <ts/ink_hrtime.h>
 #include <ts/TestBox.h>
 
 void
@@ -103,6 +104,30 @@ REGRESSION_TEST(IpMap_Basic)(RegressionTest* t, int atype, int* pstatus) {
   map.mark(ip150, ip160, markB);
   map.mark(ip0, ipmax, markC);
   tb.check(map.getCount() == 1, "IpMap: Full range fill left extra ranges.");
+
+  // A span that fits between two others must not take over the next one.
+  map.clear();
+  map.mark(ip10, ip20, markA);
+  map.mark(ip100, ip200, markB);
+  map.mark(ip50, ip60, markC);
+  tb.check(map.getCount() == 3, "Test 5 failed [expected 3, got %d].", map.getCount());
+  tb.check(map.contains(ip150, &mark), "Test 5 - next span overwritten.");
+  tb.check(mark == markB, "Test 5 - wrong data on next span.");
+  tb.check(map.contains(ip50, &mark), "Test 5 - new span missing.");
+  tb.check(mark == markC, "Test 5 - wrong data on new span.");
+
+  // A span adjacent to the next one with different data.
+  map.clear();
+  map.mark(ip100, ip200, markB);
+  map.mark(ip50, htonl(99), markC);
+  tb.check(map.getCount() == 2, "Test 6 failed [expected 2, got %d].", map.getCount());
+  tb.check(map.contains(ip100, &mark), "Test 6 - adjacent span missing.");
+  tb.check(mark == markB, "Test 6 - adjacent span data changed.");
+  map.mark(ip10, ip20, markA);
+  map.mark(ip20, htonl(49), markA);
+  tb.check(map.getCount() == 3, "Test 6 failed [expected 3, got %d].", map.getCount());
+  tb.check(map.contains(ip50, &mark), "Test 6 - middle span missing.");
+  tb.check(mark == markC, "Test 6 - middle span data changed.");
 }
 
 REGRESSION_TEST(IpMap_Unmark)(RegressionTest* t, int atype, int* pstatus) {
@@ -293,3 +318,82 @@ REGRESSION_TEST(IpMap_Fill)(RegressionTest* t, int atype, int* pstatus) {
            "IpMap Fill[v6-2]: ::1 has bad mark.");
  
 }
+
+REGRESSION_TEST(IpMap_Compiled)(RegressionTest* t, int atype, int* pstatus) {
+  TestBox tb(t, pstatus);
+  IpMap map;
+  int const nranges = 100000;
+  int const nlookups = 1000000;
+  uint32_t seed = 1;
+  void* mark;
+
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  // Ranges of up to 256 addresses at random, later ones overwriting.
+  // Bases are aligned so that no range wraps; some end up adjacent.
+  in_addr_t* bases = static_cast<in_addr_t*>(ats_malloc(sizeof(in_addr_t) * nranges));
+  for ( int i = 0 ; i < nranges ; ++i ) {
+    seed = seed * 1103515245 + 12345;
+    bases[i] = seed & ~0xffU;
+    map.mark(htonl(bases[i]), htonl(bases[i] | (seed >> 24)), reinterpret_cast<void*>(i + 1));
+  }
+  IpEndpoint a6_min, a6_max;
+  ats_ip_pton("2001:db8::", &a6_min);
+  for ( int i = 0 ; i < 1000 ; ++i ) {
+    a6_min.sin6.sin6_addr.s6_addr[13] = i >> 8;
+    a6_min.sin6.sin6_addr.s6_addr[14] = i & 0xff;
+    a6_max = a6_min;
+    a6_max.sin6.sin6_addr.s6_addr[15] = 0x7f;
+    map.mark(&a6_min, &a6_max, reinterpret_cast<void*>(i + 1));
+  }
+
+  // Half of the targets near a range minimum, half anywhere.
+  in_addr_t* targets = static_cast<in_addr_t*>(ats_malloc(sizeof(in_addr_t) * nlookups));
+  for ( int i = 0 ; i < nlookups ; ++i ) {
+    seed = seed * 1103515245 + 12345;
+    targets[i] = htonl((i & 1) ? seed : bases[seed % nranges] + (seed >> 28));
+  }
+
+  void** found = static_cast<void**>(ats_malloc(sizeof(void*) * nlookups));
+  ink_hrtime start = ink_get_hrtime_internal();
+  for ( int i = 0 ; i < nlookups ; ++i ) {
+    if (!map.contains(targets[i], &found[i])) found[i] = 0;
+  }
+  ink_hrtime tree_time = ink_get_hrtime_internal() - start;
+
+  map.compile();
+  tb.check(map.isCompiled(), "Map not compiled");
+
+  bool same = true;
+  start = ink_get_hrtime_internal();
+  for ( int i = 0 ; i < nlookups ; ++i ) {
+    if (!map.contains(targets[i], &mark)) mark = 0;
+    if (mark != found[i]) same = false;
+  }
+  ink_hrtime flat_time = ink_get_hrtime_internal() - start;
+
+  rprintf(t, "%d lookups over %zu ranges: tree %.1f ns, compiled %.1f ns per lookup\n",
+    nlookups, map.getCount(), (double)tree_time / nlookups, (double)flat_time / nlookups);
+  tb.check(same, "Compiled map differs from the tree");
+
+  a6_min.sin6.sin6_addr.s6_addr[13] = 3;
+  a6_min.sin6.sin6_addr.s6_addr[14] = 7;
+  a6_min.sin6.sin6_addr.s6_addr[15] = 0x7f;
+  tb.check(map.contains(&a6_min, &mark) && mark == reinterpret_cast<void*>(3 * 256 + 7 + 1),
+    "IPv6 range max not found.");
+  a6_min.sin6.sin6_addr.s6_addr[15] = 0x80;
+  tb.check(!map.contains(&a6_min), "Address past IPv6 range found.");
+
+  map.mark(htonl(0), htonl(0), reinterpret_cast<void*>(-1));
+  tb.check(!map.isCompiled(), "Change did not discard the compiled map");
+  map.compile();
+  tb.check(map.contains(htonl(0), &mark) && mark == reinterpret_cast<void*>(-1), "Minimum address not found.");
+
+  map.clear();
+  map.compile();
+  tb.check(!map.contains(targets[0]), "Empty compiled map has an address");
+
+  ats_free(bases);
+  ats_free(targets);
+  ats_free(found);
+}
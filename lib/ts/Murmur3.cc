@@ -0,0 +1,181 @@
+/** @file
+
+  MurmurHash3, 128 bit x64 variant
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include <string.h>
+#include "ink_platform.h"
+#include "Murmur3.h"
+
+#define C1 0x87c37b91114253d5ULL
+#define C2 0x4cf5ad432745937fULL
+
+static inline uint64_t
+rotl64(uint64_t x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t
+fmix64(uint64_t k)
+{
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+static inline void
+murmur3_block(MURMUR3_CTX * ctx, const unsigned char *p)
+{
+  uint64_t k1, k2;
+
+  // unaligned loads, compiled to plain moves where the CPU allows it
+  memcpy(&k1, p, 8);
+  memcpy(&k2, p + 8, 8);
+
+  k1 *= C1;
+  k1 = rotl64(k1, 31);
+  k1 *= C2;
+  ctx->h1 ^= k1;
+  ctx->h1 = rotl64(ctx->h1, 27);
+  ctx->h1 += ctx->h2;
+  ctx->h1 = ctx->h1 * 5 + 0x52dce729;
+
+  k2 *= C2;
+  k2 = rotl64(k2, 33);
+  k2 *= C1;
+  ctx->h2 ^= k2;
+  ctx->h2 = rotl64(ctx->h2, 31);
+  ctx->h2 += ctx->h1;
+  ctx->h2 = ctx->h2 * 5 + 0x38495ab5;
+}
+
+int
+ink_code_incr_murmur3_init(MURMUR3_CTX * ctx)
+{
+  ctx->h1 = 0;
+  ctx->h2 = 0;
+  ctx->buffer_size = 0;
+  ctx->length = 0;
+  return 0;
+}
+
+int
+ink_code_incr_murmur3_update(MURMUR3_CTX * ctx, const char *ainput, int input_length)
+{
+  const unsigned char *in = (const unsigned char *) ainput;
+  const unsigned char *end = in + input_length;
+
+  ctx->length += input_length;
+
+  // finish a block left over from the last update
+  if (ctx->buffer_size) {
+    int n = 16 - ctx->buffer_size;
+    if (n > input_length) {
+      n = input_length;
+    }
+    memcpy(ctx->buffer + ctx->buffer_size, in, n);
+    ctx->buffer_size += n;
+    in += n;
+    if (ctx->buffer_size < 16) {
+      return 0;
+    }
+    murmur3_block(ctx, ctx->buffer);
+    ctx->buffer_size = 0;
+  }
+
+  while (end - in >= 16) {
+    murmur3_block(ctx, in);
+    in += 16;
+  }
+
+  if (in < end) {
+    memcpy(ctx->buffer, in, end - in);
+    ctx->buffer_size = end - in;
+  }
+  return 0;
+}
+
+int
+ink_code_incr_murmur3_final(char *presult, MURMUR3_CTX * ctx)
+{
+  const unsigned char *tail = ctx->buffer;
+  uint64_t k1 = 0;
+  uint64_t k2 = 0;
+  uint64_t h1 = ctx->h1;
+  uint64_t h2 = ctx->h2;
+
+  // the tail is read little endian, as in the reference
+  switch (ctx->buffer_size) {
+  case 15: k2 ^= ((uint64_t) tail[14]) << 48;
+  case 14: k2 ^= ((uint64_t) tail[13]) << 40;
+  case 13: k2 ^= ((uint64_t) tail[12]) << 32;
+  case 12: k2 ^= ((uint64_t) tail[11]) << 24;
+  case 11: k2 ^= ((uint64_t) tail[10]) << 16;
+  case 10: k2 ^= ((uint64_t) tail[9]) << 8;
+  case 9:
+    k2 ^= ((uint64_t) tail[8]);
+    k2 *= C2;
+    k2 = rotl64(k2, 33);
+    k2 *= C1;
+    h2 ^= k2;
+  case 8: k1 ^= ((uint64_t) tail[7]) << 56;
+  case 7: k1 ^= ((uint64_t) tail[6]) << 48;
+  case 6: k1 ^= ((uint64_t) tail[5]) << 40;
+  case 5: k1 ^= ((uint64_t) tail[4]) << 32;
+  case 4: k1 ^= ((uint64_t) tail[3]) << 24;
+  case 3: k1 ^= ((uint64_t) tail[2]) << 16;
+  case 2: k1 ^= ((uint64_t) tail[1]) << 8;
+  case 1:
+    k1 ^= ((uint64_t) tail[0]);
+    k1 *= C1;
+    k1 = rotl64(k1, 31);
+    k1 *= C2;
+    h1 ^= k1;
+  }
+
+  h1 ^= ctx->length;
+  h2 ^= ctx->length;
+  h1 += h2;
+  h2 += h1;
+  h1 = fmix64(h1);
+  h2 = fmix64(h2);
+  h1 += h2;
+  h2 += h1;
+
+  memcpy(presult, &h1, 8);
+  memcpy(presult + 8, &h2, 8);
+  ctx->buffer_size = 0;
+  return 0;
+}
+
+int
+ink_code_murmur3(unsigned char *input, int len, unsigned char *sixteen_byte_hash)
+{
+  MURMUR3_CTX ctx;
+  ink_code_incr_murmur3_init(&ctx);
+  ink_code_incr_murmur3_update(&ctx, (const char *) input, len);
+  ink_code_incr_murmur3_final((char *) sixteen_byte_hash, &ctx);
+  return 0;
+}
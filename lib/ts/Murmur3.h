@@ -0,0 +1,54 @@
+/** @file
+
+  MurmurHash3, 128 bit x64 variant
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef _Murmur3_h_
+#define _Murmur3_h_
+
+#include "ink_port.h"
+#include "ink_apidefs.h"
+
+/**
+  Incremental MurmurHash3_x64_128 (Austin Appleby, public domain).
+
+  A non-cryptographic 128 bit hash, for cache keys where MD5 costs
+  more than it is worth. It takes 16 bytes a step with two 64 bit
+  multiplies per half, against MD5's 64 rounds per 64 bytes, and
+  gives the same values as the reference one-shot implementation
+  with seed 0. Like MMH, values differ between big and little endian
+  machines.
+*/
+struct MURMUR3_CTX
+{
+  uint64_t h1;
+  uint64_t h2;
+  unsigned char buffer[16];
+  int buffer_size;
+  uint64_t length;
+};
+
+int inkcoreapi ink_code_incr_murmur3_init(MURMUR3_CTX * context);
+int inkcoreapi ink_code_incr_murmur3_update(MURMUR3_CTX * context, const char *input, int input_length);
+int inkcoreapi ink_code_incr_murmur3_final(char *sixteen_byte_hash_pointer, MURMUR3_CTX * context);
+int inkcoreapi ink_code_murmur3(unsigned char *input, int len, unsigned char *sixteen_byte_hash);
+
+#endif
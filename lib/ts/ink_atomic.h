@@ -91,6 +91,15 @@ static inline int ink_atomic_increment(pvint32 mem, int value) { return ((uint32
 static inline int64_t ink_atomic_increment64(pvint64 mem, int64_t value) { return ((uint64_s)atomic_add_64_nv((pvuint64_s)mem, (uint64_s)value)) - value; }
 static inline void *ink_atomic_increment_ptr(pvvoidp mem, intptr_t value) { return (void*)(((char*)atomic_add_ptr_nv((vvoidp)mem, (ssize_t)value)) - value); }
 
+// ink_atomic_load_acquire(ptr)
+// Reads @ptr; reads and writes after it are not moved before it.
+template <typename T> static inline T
+ink_atomic_load_acquire(volatile T * mem) {
+  T value = *mem;
+  membar_consumer();
+  return value;
+}
+
 /* not used for Intel Processors or Sparc which are mostly sequentally consistent */
 #define INK_WRITE_MEMORY_BARRIER
 #define INK_MEMORY_BARRIER
@@ -144,6 +153,19 @@ ink_atomic_decrement(volatile Type * mem, Amount count) {
   return __sync_fetch_and_sub(mem, (Type)count);
 }
 
+// ink_atomic_load_acquire(ptr)
+// Reads @ptr; reads and writes after it are not moved before it.
+template <typename T> static inline T
+ink_atomic_load_acquire(volatile T * mem) {
+  T value = *mem;
+#if defined(__i386__) || defined(__x86_64__)
+  __asm__ __volatile__("" : : : "memory"); // x86 doesn't reorder a load with later accesses
+#else
+  __sync_synchronize();
+#endif
+  return value;
+}
+
 // Special hacks for ARM 32-bit
 #if defined(__arm__) && (SIZEOF_VOIDP == 4)
 extern ProcessMutex __global_death;
@@ -95,6 +95,8 @@
 #include "List.h"
 #include "INK_MD5.h"
 #include "MMH.h"
+#include "Murmur3.h"
+#include "HashFNV.h"
 #include "Map.h"
 #include "MimeTable.h"
 #include "ParseRules.h"
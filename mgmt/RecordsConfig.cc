@@ -376,6 +376,30 @@ RecordElement RecordsConfig[] = {
   ,
   {RECT_CONFIG, "proxy.config.http.congestion_control.default.congestion_scheme", RECD_STRING, "per_ip", RECU_NULL, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
+  {RECT_CONFIG, "proxy.config.http.origin_health.enabled", RECD_INT, "0", RECU_DYNAMIC, RR_NULL, RECC_INT, "[0-1]", RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.http.origin_health.table_size", RECD_INT, "16384", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.http.origin_health.window", RECD_INT, "60", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.http.origin_health.consecutive_errors", RECD_INT, "5", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.http.origin_health.consecutive_5xx", RECD_INT, "5", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.http.origin_health.latency_threshold", RECD_INT, "0", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.http.origin_health.latency_percentile", RECD_INT, "99", RECU_DYNAMIC, RR_NULL, RECC_INT, "[1-100]", RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.http.origin_health.latency_min_samples", RECD_INT, "20", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.http.origin_health.ejection_time", RECD_INT, "30", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.http.origin_health.max_ejection_time", RECD_INT, "300", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.http.origin_health.max_ejection_percent", RECD_INT, "10", RECU_DYNAMIC, RR_NULL, RECC_INT, "[0-100]", RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.http.origin_health.latency_weighted", RECD_INT, "0", RECU_DYNAMIC, RR_NULL, RECC_INT, "[0-1]", RECA_NULL}
+  ,
 
   //        ###########
   //        # Parsing #
@@ -905,6 +929,8 @@ RecordElement RecordsConfig[] = {
   ,
   {RECT_CONFIG, "proxy.config.cluster.read_buffer_size", RECD_INT, "2097152", RECU_RESTART_TS, RR_NULL, RECC_INT, "[65536-2097152]", RECA_NULL}
   ,
+  {RECT_CONFIG, "proxy.config.cluster.write_max_combine_bytes", RECD_INT, "262144", RECU_RESTART_TS, RR_NULL, RECC_INT, "[4096-4194304]", RECA_NULL}
+  ,
   {RECT_CONFIG, "proxy.config.cluster.cluster_configuration", RECD_STRING, "cluster.config", RECU_NULL, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
   {RECT_CONFIG, "proxy.config.cluster.default_cluster_configuration", RECD_STRING, "default_cluster.config", RECU_NULL, RR_NULL, RECC_NULL, NULL, RECA_NULL}
@@ -927,6 +953,12 @@ RecordElement RecordsConfig[] = {
   ,
   {RECT_CONFIG, "proxy.config.cluster.rpc_cache_cluster", RECD_INT, "0", RECU_NULL, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
+  //# hash_method: 0 = bucket table, 1 = consistent hash ring
+  {RECT_CONFIG, "proxy.config.cluster.hash_method", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-1]", RECA_NULL}
+  ,
+  //# number of points each machine gets on the consistent hash ring
+  {RECT_CONFIG, "proxy.config.cluster.hash_virtual_nodes", RECD_INT, "128", RECU_RESTART_TS, RR_NULL, RECC_INT, "[1-4096]", RECA_NULL}
+  ,
 
   //##################################################################
   //# Cluster interconnect load monitoring configuration options.
@@ -985,7 +1017,13 @@ RecordElement RecordsConfig[] = {
   ,
   //  # 0 - MD5 hash
   //  # 1 - MMH hash
-  {RECT_CONFIG, "proxy.config.cache.url_hash_method", RECD_INT, "1", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  //  # 2 - MurmurHash3 (x64, 128 bit)
+  //  # changing it clears every cache volume, documents keyed with the old
+  //  # hash could not be found again. Objects stored under a key a plugin
+  //  # set through the API are cleared too, although their keys don't
+  //  # change. There is one method for the whole cache: the key hash also
+  //  # picks the volume, so it can't differ by volume
+  {RECT_CONFIG, "proxy.config.cache.url_hash_method", RECD_INT, "1", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-2]", RECA_NULL}
   ,
   //  # default the ram cache size to AUTO_SIZE (-1)
   //  # alternatively: 20971520 (20MB)
@@ -1000,6 +1038,9 @@ RecordElement RecordsConfig[] = {
   //  # how often should the directory be synced (seconds)
   {RECT_CONFIG, "proxy.config.cache.dir.sync_frequency", RECD_INT, "60", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
+  //  # bytes per second the periodic directory sync may write, 0 = paced by a fixed delay per 2MB
+  {RECT_CONFIG, "proxy.config.cache.dir.sync_max_write_rate", RECD_INT, "0", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
   {RECT_CONFIG, "proxy.config.cache.hostdb.disable_reverse_lookup", RECD_INT, "0", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
   {RECT_CONFIG, "proxy.config.cache.select_alternate", RECD_INT, "1", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
@@ -1363,6 +1404,10 @@ RecordElement RecordsConfig[] = {
   ,
   {RECT_CONFIG, "proxy.config.ssl.number.threads", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
+  //  # number of threads server side SSL handshakes are offloaded to,
+  //  # 0 runs them on the net threads
+  {RECT_CONFIG, "proxy.config.ssl.handshake_threads", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
   {RECT_CONFIG, "proxy.config.ssl.server.cipher_suite", RECD_STRING, "RC4-SHA:AES128-SHA:DES-CBC3-SHA:AES256-SHA:ALL:!aNULL:!EXP:!LOW:!MD5:!SSLV2:!NULL", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
   {RECT_CONFIG, "proxy.config.ssl.server.honor_cipher_order", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-1]", RECA_NULL}
@@ -1377,6 +1422,14 @@ RecordElement RecordsConfig[] = {
   ,
   {RECT_CONFIG, "proxy.config.ssl.server.multicert.filename", RECD_STRING, "ssl_multicert.config", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
+  //  # 0 - create every certificate context at load, N - create them on
+  //  # first use and keep at most N of them
+  {RECT_CONFIG, "proxy.config.ssl.server.lazy_contexts", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
+  //  # names of each certificate, kept across reloads when lazy_contexts
+  //  # is set. Relative to the runtime directory.
+  {RECT_CONFIG, "proxy.config.ssl.server.cert_index.filename", RECD_STRING, "ssl_cert_index.db", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
   {RECT_CONFIG, "proxy.config.ssl.server.private_key.path", RECD_STRING, NULL, RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
   {RECT_CONFIG, "proxy.config.ssl.CA.cert.filename", RECD_STRING, NULL, RECU_RESTART_TS, RR_NULL, RECC_STR, "^[^[:space:]]*$", RECA_NULL}
@@ -1397,12 +1450,24 @@ RecordElement RecordsConfig[] = {
   ,
   {RECT_CONFIG, "proxy.config.ssl.client.CA.cert.path", RECD_STRING, NULL, RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
-  {RECT_CONFIG, "proxy.config.ssl.session_cache", RECD_INT, "1", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  //  # 0 - off, 1 - OpenSSL per process cache, 2 - cache shared through
+  //  # proxy.config.ssl.session_cache.filename
+  {RECT_CONFIG, "proxy.config.ssl.session_cache", RECD_INT, "1", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-2]", RECA_NULL}
   ,
   {RECT_CONFIG, "proxy.config.ssl.session_cache.size", RECD_INT, "20480", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
+  //  # session lifetime in seconds, 0 keeps the OpenSSL default (300)
+  {RECT_CONFIG, "proxy.config.ssl.session_cache.timeout", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
+  //  # shared cache file, relative to the runtime directory
+  {RECT_CONFIG, "proxy.config.ssl.session_cache.filename", RECD_STRING, "ssl_session_cache.db", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
   {RECT_CONFIG, "proxy.config.ssl.max_record_size", RECD_INT, "0", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
+  //  # hand the transmit side of TLS 1.2 AES-GCM client connections to the
+  //  # kernel (Linux TLS_TX) once the handshake is done
+  {RECT_CONFIG, "proxy.config.ssl.ktls", RECD_INT, "0", RECU_DYNAMIC, RR_NULL, RECC_INT, "[0-1]", RECA_NULL}
+  ,
 
   //##############################################################################
   //# ICP Configuration
@@ -2127,6 +2192,12 @@ RecordElement RecordsConfig[] = {
   ,
   {RECT_CONFIG, "proxy.config.http.hoturls.keep_days", RECD_INT, "1", RECU_NULL, RR_NULL, RECC_INT, "[1-31]", RECA_NULL}
   ,
+  {RECT_CONFIG, "proxy.config.http.hoturls.max_error", RECD_FLOAT, "0.005", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.http.hoturls.window_intervals", RECD_INT, "6", RECU_DYNAMIC, RR_NULL, RECC_INT, "[1-16]", RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.http.hoturls.replica_ttl", RECD_INT, "3600", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
 
   //##############################################################################
   //#
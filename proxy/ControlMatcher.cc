@@ -950,6 +950,10 @@ template<class Data, class Result> int ControlMatcher<Data, Result>::BuildTableF
 
   ink_assert(second_pass == numEntries);
 
+  if (ipMatch != NULL) {
+    ipMatch->ip_map.compile();
+  }
+
   if (is_debug_tag_set("matcher")) {
     Print();
   }
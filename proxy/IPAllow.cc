@@ -332,6 +332,8 @@ IpAllow::BuildTable()
     ) {
       spot->setData(&_acls[reinterpret_cast<size_t>(spot->data())]);
     }
+    // Compile after the coloring, the compiled map has copies of the data.
+    _map.compile();
   }
 
   if (is_debug_tag_set("ip-allow")) {
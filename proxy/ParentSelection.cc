@@ -33,6 +33,8 @@
 #include "ProxyConfig.h"
 #include "HTTP.h"
 #include "HttpTransact.h"
+#include "congest/OriginHealth.h"
+#include "ts/TestBox.h"
 
 #define PARENT_RegisterConfigUpdateFunc REC_RegisterConfigUpdateFunc
 #define PARENT_ReadConfigInteger REC_ReadConfigInteger
@@ -62,9 +64,81 @@ static const char *ParentResultStr[] = {
 static const char *ParentRRStr[] = {
   "false",
   "strict",
-  "true"
+  "true",
+  "consistent_hash",
+  "latency"
 };
 
+//
+//  Per parent stats
+//
+//    proxy.process.http.parent_proxy.<host>:<port>.{selections,spillovers,failovers}
+//    A parent keeps its stats across reloads; the block has room for
+//    PARENT_STATS_MAX_PARENTS distinct parents, the ones after that
+//    aren't counted.
+//
+#define PARENT_STATS_MAX_PARENTS 256
+
+enum ParentStat_t
+{
+  PARENT_SELECTIONS_STAT,       // requests sent to the parent
+  PARENT_SPILLOVERS_STAT,       // requests hashed to the parent sent elsewhere, it was over its load bound
+  PARENT_FAILOVERS_STAT,        // requests hashed to the parent sent elsewhere, it was down
+  PARENT_STAT_COUNT
+};
+
+static const char *ParentStatStr[] = {
+  "selections",
+  "spillovers",
+  "failovers"
+};
+
+static RecRawStatBlock *parent_rsb = NULL;
+static InkHashTable *parent_stat_ids = NULL;
+static int parent_stat_count = 0;
+static ink_mutex parent_stat_mutex;
+
+static int
+parent_stat_id(const char *hostname, int port)
+{
+  char name[MAXDNAME + 64];
+  InkHashTableValue value;
+  int id = -1;
+
+  if (parent_rsb == NULL) {
+    return -1;
+  }
+
+  snprintf(name, sizeof(name), "%s:%d", hostname, port);
+  ink_mutex_acquire(&parent_stat_mutex);
+  if (ink_hash_table_lookup(parent_stat_ids, name, &value)) {
+    id = (int) (intptr_t) value;
+  } else if (parent_stat_count < PARENT_STATS_MAX_PARENTS) {
+    char stat_name[MAXDNAME + 128];
+
+    id = parent_stat_count++;
+    for (int i = 0; i < PARENT_STAT_COUNT; i++) {
+      snprintf(stat_name, sizeof(stat_name), "proxy.process.http.parent_proxy.%s.%s", name, ParentStatStr[i]);
+      RecRegisterRawStat(parent_rsb, RECT_PROCESS, stat_name, RECD_COUNTER, RECP_NON_PERSISTENT,
+                         id * PARENT_STAT_COUNT + i, RecRawStatSyncCount);
+    }
+    ink_hash_table_insert(parent_stat_ids, name, (InkHashTableValue) (intptr_t) id);
+  }
+  ink_mutex_release(&parent_stat_mutex);
+
+  return id;
+}
+
+static inline void
+parent_stat_incr(const pRecord *p, ParentStat_t stat)
+{
+  EThread *ethread = this_ethread();
+
+  if (p->stat_id >= 0 && ethread != NULL) {
+    RecIncrRawStat(parent_rsb, ethread, p->stat_id * PARENT_STAT_COUNT + stat, 1);
+  }
+}
+
 //
 //  Config Callback Prototypes
 //
@@ -106,6 +180,13 @@ ParentConfig::startup()
 {
   reconfig_mutex = new_ProxyMutex();
 
+  // Per parent stats, registered as the parents are read
+  if (parent_rsb == NULL) {
+    ink_mutex_init(&parent_stat_mutex, "parent_stats");
+    parent_stat_ids = ink_hash_table_create(InkHashTableKeyType_String);
+    parent_rsb = RecAllocateRawStatBlock(PARENT_STATS_MAX_PARENTS * PARENT_STAT_COUNT);
+  }
+
   // Load the initial configuration
   reconfigure();
 
@@ -492,6 +573,11 @@ ParentRecord::FindParent(bool first_call, ParentResult * result, RD * rdata, Par
 
   ink_assert(num_parents > 0 || go_direct == true);
 
+  if (round_robin == P_CONSISTENT_HASH && ring != NULL) {
+    FindHashedParent(first_call, result, request_info, config, bypass_ok);
+    return;
+  }
+
   if (first_call == true) {
     if (parents == NULL) {
       // We should only get into this state if
@@ -522,6 +608,9 @@ ParentRecord::FindParent(bool first_call, ParentResult * result, RD * rdata, Par
       case P_NO_ROUND_ROBIN:
         cur_index = result->start_parent = 0;
         break;
+      case P_LATENCY_ROUND_ROBIN:
+        cur_index = result->start_parent = PickFastestParent(request_info, config);
+        break;
       default:
         ink_release_assert(0);
       }
@@ -548,7 +637,10 @@ ParentRecord::FindParent(bool first_call, ParentResult * result, RD * rdata, Par
   //   should be retried
   do {
     // DNS ParentOnly inhibits bypassing the parent so always return that t
-    if ((parents[cur_index].failedAt == 0) || (parents[cur_index].failCount < config->FailThreshold)) {
+    if (!result->wrap_around && origin_health_down(parents[cur_index].health_key, (int32_t) request_info->xact_start)) {
+      Debug("parent_select", "Parent %s:%d is down", parents[cur_index].hostname, parents[cur_index].port);
+      parentUp = false;
+    } else if ((parents[cur_index].failedAt == 0) || (parents[cur_index].failCount < config->FailThreshold)) {
       Debug("parent_select", "config->FailThreshold = %d", config->FailThreshold);
       Debug("parent_select", "Selecting a down parent due to little failCount"
             "(faileAt: %u failCount: %d)", parents[cur_index].failedAt, parents[cur_index].failCount);
@@ -575,6 +667,7 @@ ParentRecord::FindParent(bool first_call, ParentResult * result, RD * rdata, Par
       result->retry = parentRetry;
       ink_assert(result->hostname != NULL);
       ink_assert(result->port != 0);
+      parent_stat_incr(&parents[cur_index], PARENT_SELECTIONS_STAT);
       Debug("parent_select", "Chosen parent = %s.%d", result->hostname, result->port);
       return;
     }
@@ -601,6 +694,295 @@ NO_PARENTS:
   result->port = 0;
 }
 
+// int ParentRecord::PickFastestParent(...)
+//
+//    Picks among the parents which are up, weighted by the inverse
+//      of their response latency, so the faster parents get more of
+//      the requests without the slower ones going cold. Falls back
+//      to plain round robin when none is up or there are too many
+//      parents to weigh; the caller's loop then sorts it out.
+//
+int
+ParentRecord::PickFastestParent(HttpRequestData * request_info, ParentConfigParams * config)
+{
+  OriginHealth *candidates[PARENT_RING_MAX_PARENTS];
+  int index[PARENT_RING_MAX_PARENTS];
+  int32_t now = (int32_t) request_info->xact_start;
+  uint32_t r = (uint32_t) this_ethread()->generator.random();
+  int n = 0;
+
+  if (originHealthTable == NULL || num_parents > PARENT_RING_MAX_PARENTS) {
+    return r % num_parents;
+  }
+
+  for (int i = 0; i < num_parents; i++) {
+    if (parents[i].failedAt != 0 && parents[i].failCount >= config->FailThreshold &&
+        (time_t) (parents[i].failedAt + config->ParentRetryTime) >= request_info->xact_start) {
+      continue;
+    }
+    if (origin_health_down(parents[i].health_key, now)) {
+      continue;
+    }
+    candidates[n] = originHealthTable->lookup(parents[i].health_key);
+    index[n++] = i;
+  }
+
+  if (n == 0) {
+    return r % num_parents;
+  }
+  return index[origin_health_pick(candidates, n, r)];
+}
+
+// void ParentRecord::FindHashedParent(...)
+//
+//    FindParent() for consistent hashing. start_parent is the
+//      ring position the url hashed to and tried the set of parents
+//      already handed out for this request, so a retry walks on along
+//      the ring to the next parent not yet tried.
+//
+void
+ParentRecord::FindHashedParent(bool first_call, ParentResult * result, HttpRequestData * request_info,
+                               ParentConfigParams * config, bool bypass_ok)
+{
+  uint64_t all = (num_parents == PARENT_RING_MAX_PARENTS) ? ~(uint64_t) 0 : (((uint64_t) 1 << num_parents) - 1);
+  uint64_t up = 0;
+  uint64_t retry = 0;
+  uint64_t seen = 0;
+  uint64_t candidates;
+  float up_weight = 0;
+  int hashed = -1;
+  int spill = -1;
+  int cur_index = -1;
+
+  if (first_call == true) {
+    uint32_t key = 0;
+    URL *url = (request_info->hdr != NULL && request_info->hdr->valid()) ? request_info->hdr->url_get() : NULL;
+
+    if (url != NULL && url->valid()) {
+      INK_MD5 md5;
+
+      url->MD5_get(&md5);
+      key = (uint32_t) md5.fold();
+    } else if (request_info->get_client_ip() != NULL) {
+      key = ats_ip_hash(request_info->get_client_ip());
+    }
+    // The first virtual node at or after the key
+    int lo = 0, hi = ring_size;
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if (ring[mid].hash < key) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    result->start_parent = lo % ring_size;
+    result->tried = 0;
+    result->wrap_around = false;
+    hashed = ring[result->start_parent].parent;
+  } else {
+    result->tried |= (uint64_t) 1 << result->last_parent;
+    if ((result->tried & all) == all) {
+      // Every parent has been tried, bypass if we can
+      if (bypass_ok == true) {
+        goto NO_PARENTS;
+      }
+      result->wrap_around = true;
+      result->tried = 0;
+    }
+  }
+
+  for (int i = 0; i < num_parents; i++) {
+    uint64_t bit = (uint64_t) 1 << i;
+
+    if (!result->wrap_around && origin_health_down(parents[i].health_key, (int32_t) request_info->xact_start)) {
+      continue;
+    }
+    if ((parents[i].failedAt == 0) || (parents[i].failCount < config->FailThreshold)) {
+      up |= bit;
+      up_weight += parents[i].weight;
+    } else if (result->wrap_around || ((parents[i].failedAt + config->ParentRetryTime) < request_info->xact_start)) {
+      up |= bit;
+      retry |= bit;
+      up_weight += parents[i].weight;
+    }
+  }
+
+  candidates = up & ~result->tried;
+  if (candidates == 0) {
+    if (bypass_ok == true) {
+      goto NO_PARENTS;
+    }
+    // We can't bypass so retry, taking any parent that we can
+    result->wrap_around = true;
+    candidates = all & ~result->tried;
+    if (candidates == 0) {
+      result->tried = 0;
+      candidates = all;
+    }
+    retry |= candidates & ~up;
+    up_weight = total_weight;
+  }
+
+  for (int n = 0; n < ring_size && seen != all; n++) {
+    int i = ring[(result->start_parent + n) % ring_size].parent;
+    uint64_t bit = (uint64_t) 1 << i;
+
+    if (seen & bit) {
+      continue;
+    }
+    seen |= bit;
+    if (!(candidates & bit)) {
+      continue;
+    }
+    if (!(retry & bit) && OverLoaded(i, up_weight)) {
+      Debug("parent_select", "Parent %s:%d over its load bound (%d of %d)", parents[i].hostname, parents[i].port,
+            parents[i].load, load_total);
+      if (spill < 0) {
+        spill = i;
+      }
+      continue;
+    }
+    cur_index = i;
+    break;
+  }
+
+  // Every parent left is over its bound, take the nearest one
+  if (cur_index < 0) {
+    cur_index = spill;
+  }
+  ink_assert(cur_index >= 0);
+
+  if (hashed >= 0 && hashed != cur_index) {
+    parent_stat_incr(&parents[hashed], (up & ((uint64_t) 1 << hashed)) ? PARENT_SPILLOVERS_STAT : PARENT_FAILOVERS_STAT);
+  }
+  parent_stat_incr(&parents[cur_index], PARENT_SELECTIONS_STAT);
+  NoteLoad(cur_index, request_info->xact_start);
+
+  result->r = PARENT_SPECIFIED;
+  result->hostname = parents[cur_index].hostname;
+  result->port = parents[cur_index].port;
+  result->last_parent = cur_index;
+  result->retry = (retry & ((uint64_t) 1 << cur_index)) != 0;
+  Debug("parent_select", "Chosen parent = %s.%d (hashed to %s)", result->hostname, result->port,
+        hashed >= 0 ? parents[hashed].hostname : "-");
+  return;
+
+NO_PARENTS:
+  if (this->go_direct == true) {
+    result->r = PARENT_DIRECT;
+  } else {
+    result->r = PARENT_FAIL;
+  }
+
+  result->hostname = NULL;
+  result->port = 0;
+}
+
+// bool ParentRecord::OverLoaded(int index, float up_weight)
+//
+//    Whether the parent took more than load_factor times its
+//      weighted share of the recent selections. Not enforced until
+//      the record has seen some traffic, so that the odd request
+//      still has its affinity.
+//
+bool
+ParentRecord::OverLoaded(int index, float up_weight)
+{
+  int32_t total = load_total;
+
+  if (load_factor <= 0 || up_weight <= 0 || total < num_parents * PARENT_LOAD_MIN_SELECTIONS) {
+    return false;
+  }
+
+  double bound = ceil(load_factor * (parents[index].weight / up_weight) * (total + 1));
+  return parents[index].load + 1 > bound;
+}
+
+// void ParentRecord::NoteLoad(int index, time_t now)
+//
+//    Counts a selection of the parent. The counts are halved for
+//      every second gone by, so they follow the recent load. The
+//      aging isn't atomic with the increments; losing the odd count
+//      is fine for a load estimate.
+//
+void
+ParentRecord::NoteLoad(int index, time_t now)
+{
+  int32_t epoch = load_epoch;
+
+  if ((int32_t) now != epoch && ink_atomic_cas(&load_epoch, epoch, (int32_t) now)) {
+    int32_t shift = (int32_t) now - epoch;
+
+    if (shift < 0 || shift > 30) {
+      shift = 31;
+    }
+    for (int i = 0; i < num_parents; i++) {
+      parents[i].load >>= shift;
+    }
+    load_total >>= shift;
+  }
+
+  ink_atomic_increment(&parents[index].load, 1);
+  ink_atomic_increment(&load_total, 1);
+}
+
+static int
+ring_node_cmp(const void *a, const void *b)
+{
+  uint32_t ha = ((const pRingNode *) a)->hash;
+  uint32_t hb = ((const pRingNode *) b)->hash;
+
+  return (ha < hb) ? -1 : ((ha > hb) ? 1 : 0);
+}
+
+// const char* ParentRecord::BuildRing()
+//
+//    Places the virtual nodes of the parents on the consistent
+//      hash ring. A node is the hash of "host:port-n", so a parent
+//      keeps its points whatever the other parents are.
+//
+//    Returns NULL on success and a static error string
+//      on failure
+//
+const char *
+ParentRecord::BuildRing()
+{
+  char buf[MAXDNAME + 32];
+  int nodes = 0;
+
+  if (num_parents > PARENT_RING_MAX_PARENTS) {
+    return "Too many parents for consistent_hash";
+  }
+
+  total_weight = 0;
+  for (int i = 0; i < num_parents; i++) {
+    total_weight += parents[i].weight;
+    nodes += MAX(1, (int) (parents[i].weight * PARENT_RING_VNODES + 0.5));
+  }
+
+  ats_free(ring);
+  ring = (pRingNode *)ats_malloc(sizeof(pRingNode) * nodes);
+  ring_size = 0;
+
+  for (int i = 0; i < num_parents; i++) {
+    int vnodes = MAX(1, (int) (parents[i].weight * PARENT_RING_VNODES + 0.5));
+
+    for (int v = 0; v < vnodes; v++) {
+      INK_MD5 md5;
+      int len = snprintf(buf, sizeof(buf), "%s:%d-%d", parents[i].hostname, parents[i].port, v);
+
+      md5.encodeBuffer(buf, len);
+      ring[ring_size].hash = (uint32_t) md5.fold();
+      ring[ring_size].parent = i;
+      ring_size++;
+    }
+  }
+
+  qsort(ring, ring_size, sizeof(pRingNode), ring_node_cmp);
+  return NULL;
+}
+
 // const char* ParentRecord::ProcessParents(char* val)
 //
 //   Reads in the value of a "round-robin" or "order"
@@ -617,6 +999,7 @@ ParentRecord::ProcessParents(char *val)
   int numTok;
   const char *current;
   int port;
+  double weight;
   char *tmp;
   const char *errPtr;
 
@@ -651,9 +1034,20 @@ ParentRecord::ProcessParents(char *val)
       goto MERROR;
     }
     // Make sure that is no garbage beyond the parent
-    //   port
+    //   port, but for an optional "|weight"
     char *scan = tmp + 1;
     for (; *scan != '\0' && ParseRules::is_digit(*scan); scan++);
+    weight = 1.0;
+    if (*scan == '|') {
+      char *end;
+
+      weight = strtod(scan + 1, &end);
+      if (end == scan + 1 || weight <= 0 || weight > 100) {
+        errPtr = "Malformed parent weight";
+        goto MERROR;
+      }
+      scan = end;
+    }
     for (; *scan != '\0' && ParseRules::is_wslfcr(*scan); scan++);
     if (*scan != '\0') {
       errPtr = "Garbage trailing entry or invalid separator";
@@ -674,6 +1068,10 @@ ParentRecord::ProcessParents(char *val)
     this->parents[i].port = port;
     this->parents[i].failedAt = 0;
     this->parents[i].scheme = scheme;
+    this->parents[i].weight = (float) weight;
+    this->parents[i].load = 0;
+    this->parents[i].stat_id = parent_stat_id(this->parents[i].hostname, port);
+    this->parents[i].health_key = OriginHealthTable::make_key(this->parents[i].hostname, port);
   }
 
   num_parents = numTok;
@@ -759,6 +1157,10 @@ ParentRecord::Init(matcher_line * line_info)
         round_robin = P_STRICT_ROUND_ROBIN;
       } else if (strcasecmp(val, "false") == 0) {
         round_robin = P_NO_ROUND_ROBIN;
+      } else if (strcasecmp(val, "consistent_hash") == 0) {
+        round_robin = P_CONSISTENT_HASH;
+      } else if (strcasecmp(val, "latency") == 0) {
+        round_robin = P_LATENCY_ROUND_ROBIN;
       } else {
         round_robin = P_NO_ROUND_ROBIN;
         errPtr = "invalid argument to round_robin directive";
@@ -776,6 +1178,14 @@ ParentRecord::Init(matcher_line * line_info)
         go_direct = true;
       }
       used = true;
+    } else if (strcasecmp(label, "load_factor") == 0) {
+      char *end;
+
+      load_factor = (float) strtod(val, &end);
+      if (end == val || *end != '\0' || (load_factor != 0 && load_factor < 1)) {
+        errPtr = "invalid argument to load_factor directive, 0 or at least 1";
+      }
+      used = true;
     }
     // Report errors generated by ProcessParents();
     if (errPtr != NULL) {
@@ -796,6 +1206,14 @@ ParentRecord::Init(matcher_line * line_info)
     snprintf(errBuf, errBufLen, "%s No parent specified in parent.config at line %d", modulePrefix, line_num);
     return errBuf;
   }
+
+  if (round_robin == P_CONSISTENT_HASH && this->parents != NULL) {
+    if ((errPtr = BuildRing()) != NULL) {
+      errBuf = (char *)ats_malloc(errBufLen * sizeof(char));
+      snprintf(errBuf, errBufLen, "%s %s at line %d", modulePrefix, errPtr, line_num);
+      return errBuf;
+    }
+  }
   // Process any modifiers to the directive, if they exist
   if (line_info->num_el > 0) {
     tmp = ProcessModifiers(line_info);
@@ -838,6 +1256,7 @@ ParentRecord::UpdateMatch(ParentResult * result, RD * rdata)
 ParentRecord::~ParentRecord()
 {
   ats_free(parents);
+  ats_free(ring);
 }
 
 void
@@ -845,9 +1264,17 @@ ParentRecord::Print()
 {
   printf("\t\t");
   for (int i = 0; i < num_parents; i++) {
-    printf(" %s:%d ", parents[i].hostname, parents[i].port);
+    if (parents[i].weight != 1.0) {
+      printf(" %s:%d|%g ", parents[i].hostname, parents[i].port, parents[i].weight);
+    } else {
+      printf(" %s:%d ", parents[i].hostname, parents[i].port);
+    }
+  }
+  printf(" rr=%s direct=%s", ParentRRStr[round_robin], (go_direct == true) ? "true" : "false");
+  if (round_robin == P_CONSISTENT_HASH) {
+    printf(" load_factor=%g", load_factor);
   }
-  printf(" rr=%s direct=%s\n", ParentRRStr[round_robin], (go_direct == true) ? "true" : "false");
+  printf("\n");
 }
 
 
@@ -1285,6 +1712,143 @@ EXCLUSIVE_REGRESSION_TEST(PARENTSELECTION) (RegressionTest * t, int intensity_le
   *pstatus = (!fails ? REGRESSION_TEST_PASSED : REGRESSION_TEST_FAILED);
 }
 
+// Look up the parent for url, returns its index or -1 for none
+static int
+chash_find(ParentConfigParams * params, const char *url, ParentResult * result)
+{
+  HttpRequestData request;
+
+  br(&request, "www.example.com");
+  request.hdr->url_set(url, strlen(url));
+  *result = ParentResult();
+  params->findParent(&request, result);
+
+  request.hdr->destroy();
+  delete request.hdr;
+  delete request.api_info;
+  ats_free(request.hostname_str);
+
+  return (result->r == PARENT_SPECIFIED) ? (int) result->last_parent : -1;
+}
+
+static ParentConfigParams *
+chash_params(const char *line)
+{
+  char tbl[512];
+  ParentConfigParams *params = new ParentConfigParams();
+
+  params->FailThreshold = 1;
+  params->ParentRetryTime = 300;
+  params->ParentEnable = true;
+  ink_strlcpy(tbl, line, sizeof(tbl));
+  params->ParentTable = new P_table("", "ParentSelection Unit Test Table", &http_dest_tags,
+                                    ALLOW_HOST_TABLE | ALLOW_REGEX_TABLE | ALLOW_URL_TABLE | ALLOW_IP_TABLE | DONT_BUILD_TABLE);
+  params->ParentTable->BuildTableFromString(tbl);
+  return params;
+}
+
+REGRESSION_TEST(ParentConsistentHash) (RegressionTest * t, int atype, int *pstatus)
+{
+  NOWARN_UNUSED(atype);
+
+  const int nurls = 400;
+  TestBox box(t, pstatus);
+  ParentConfigParams *params;
+  ParentResult result;
+  int before[nurls];
+  int share[4];
+  char url[64];
+  bool stable = true, moved_only_down = true, all_tried = true;
+
+  box = REGRESSION_TEST_PASSED;
+
+  // Affinity and balance
+  params = chash_params("dest_domain=. parent=a:80,b:80,c:80,d:80 round_robin=consistent_hash load_factor=0\n");
+  memset(share, 0, sizeof(share));
+  for (int i = 0; i < nurls; i++) {
+    snprintf(url, sizeof(url), "http://www.example.com/object/%d", i);
+    before[i] = chash_find(params, url, &result);
+    if (before[i] < 0 || chash_find(params, url, &result) != before[i]) {
+      stable = false;
+      continue;
+    }
+    share[before[i]]++;
+  }
+  box.check(stable, "every url maps to one parent");
+  for (int p = 0; p < 4; p++) {
+    box.check(share[p] > nurls / 8 && share[p] < nurls / 2, "parent %d has %d of %d urls", p, share[p], nurls);
+  }
+
+  // Only the down parent's urls move
+  int down = chash_find(params, "http://www.example.com/object/0", &result);
+  params->markParentDown(&result);
+  for (int i = 0; i < nurls; i++) {
+    snprintf(url, sizeof(url), "http://www.example.com/object/%d", i);
+    int after = chash_find(params, url, &result);
+    if ((before[i] != down && after != before[i]) || (before[i] == down && (after < 0 || after == down))) {
+      moved_only_down = false;
+    }
+  }
+  box.check(moved_only_down, "only the urls of the down parent moved");
+  delete params;
+
+  // Retries walk the ring through every parent, then go direct
+  params = chash_params("dest_domain=. parent=a:80,b:80,c:80,d:80 round_robin=consistent_hash\n");
+  for (int i = 0; i < 16; i++) {
+    HttpRequestData request;
+    uint32_t seen = 0;
+
+    snprintf(url, sizeof(url), "http://www.example.com/retry/%d", i);
+    br(&request, "www.example.com");
+    request.hdr->url_set(url, strlen(url));
+    result = ParentResult();
+    params->findParent(&request, &result);
+    while (result.r == PARENT_SPECIFIED) {
+      if (seen & (1 << result.last_parent)) {
+        break;
+      }
+      seen |= 1 << result.last_parent;
+      params->nextParent(&request, &result);
+    }
+    if (seen != 0xf || result.r != PARENT_DIRECT) {
+      all_tried = false;
+    }
+    request.hdr->destroy();
+    delete request.hdr;
+    delete request.api_info;
+    ats_free(request.hostname_str);
+  }
+  box.check(all_tried, "retries try every parent once");
+  delete params;
+
+  // A hot url spills over to the ring neighbors
+  params = chash_params("dest_domain=. parent=a:80,b:80,c:80,d:80 round_robin=consistent_hash load_factor=1.25\n");
+  memset(share, 0, sizeof(share));
+  int hashed = chash_find(params, "http://www.example.com/hot", &result);
+  for (int i = 0; i < 400; i++) {
+    int p = chash_find(params, "http://www.example.com/hot", &result);
+    if (p >= 0) {
+      share[p]++;
+    }
+  }
+  box.check(share[hashed] >= 4 * PARENT_LOAD_MIN_SELECTIONS && share[hashed] < 400,
+            "hashed parent took %d of 400 requests for a hot url", share[hashed]);
+  delete params;
+
+  // Weights
+  params = chash_params("dest_domain=. parent=a:80|3,b:80 round_robin=consistent_hash load_factor=0\n");
+  memset(share, 0, sizeof(share));
+  for (int i = 0; i < nurls; i++) {
+    snprintf(url, sizeof(url), "http://www.example.com/object/%d", i);
+    int p = chash_find(params, url, &result);
+    if (p >= 0) {
+      share[p]++;
+    }
+  }
+  box.check(share[0] > nurls * 6 / 10 && share[0] < nurls * 9 / 10, "weight 3 parent has %d of %d urls", share[0], nurls);
+  delete params;
+}
+
 // verify returns 1 iff the test passes
 int
 verify(ParentResult * r, ParentResultType e, const char *h, int p)
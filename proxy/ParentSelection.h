@@ -62,7 +62,7 @@ struct ParentResult
 {
   ParentResult()
     : r(PARENT_UNDEFINED), hostname(NULL), port(0), line_number(0), epoch(NULL), rec(NULL),
-      last_parent(0), start_parent(0), wrap_around(false), retry(false)
+      last_parent(0), start_parent(0), wrap_around(false), retry(false), tried(0)
   { };
 
   // For outside consumption
@@ -76,9 +76,10 @@ struct ParentResult
   P_table *epoch;               // A pointer to the table used.
   ParentRecord *rec;
   uint32_t last_parent;
-  uint32_t start_parent;
+  uint32_t start_parent;        // ring position for consistent hashing
   bool wrap_around;
   bool retry;
+  uint64_t tried;               // parents already given out, consistent hashing only
 };
 
 class HttpRequestData;
@@ -163,15 +164,39 @@ struct pRecord
   int failCount;
   int32_t upAt;
   const char *scheme;           // for which parent matches (if any)
+  float weight;                 // share of the hash ring, "host:port|weight"
+  int stat_id;                  // per parent stats, -1 if none
+  volatile int32_t load;        // recent selections, halved every second
+  uint64_t health_key;          // in the origin health table
+};
+
+// struct pRingNode
+//
+//    A virtual node of the consistent hash ring
+//
+struct pRingNode
+{
+  uint32_t hash;
+  int parent;
 };
 
 enum ParentRR_t
 {
   P_NO_ROUND_ROBIN = 0,
   P_STRICT_ROUND_ROBIN,
-  P_HASH_ROUND_ROBIN
+  P_HASH_ROUND_ROBIN,
+  P_CONSISTENT_HASH,
+  P_LATENCY_ROUND_ROBIN
 };
 
+// Virtual nodes per unit of parent weight on the consistent hash ring
+#define PARENT_RING_VNODES          160
+// The tried set of a ParentResult is a 64 bit mask
+#define PARENT_RING_MAX_PARENTS     64
+#define PARENT_DEFAULT_LOAD_FACTOR  1.25
+// Recent selections per parent before the load bound applies
+#define PARENT_LOAD_MIN_SELECTIONS  16
+
 // class ParentRecord : public ControlBase
 //
 //   A record for a configuration line in the parent.config
@@ -181,7 +206,9 @@ class ParentRecord: public ControlBase
 {
 public:
   ParentRecord()
-    : parents(NULL), num_parents(0), round_robin(P_NO_ROUND_ROBIN), rr_next(0), go_direct(true)
+    : parents(NULL), num_parents(0), round_robin(P_NO_ROUND_ROBIN), rr_next(0), go_direct(true),
+      ring(NULL), ring_size(0), total_weight(0), load_factor(PARENT_DEFAULT_LOAD_FACTOR),
+      load_epoch(0), load_total(0)
   { }
 
   ~ParentRecord();
@@ -202,6 +229,31 @@ public:
   ParentRR_t round_robin;
   volatile uint32_t rr_next;
   bool go_direct;
+
+  // Consistent hashing
+  //
+  //   Each parent owns weight * PARENT_RING_VNODES points of a 32 bit
+  //   ring and a request goes to the owner of the first point at or
+  //   after the hash of its url. When that parent is down the walk goes
+  //   on to the next parent along the ring, so only the down parent's
+  //   share moves. With a load_factor, a parent which took more than
+  //   load_factor times its share of the recent selections is passed
+  //   over the same way (consistent hashing with bounded loads).
+  const char *BuildRing();
+  void FindHashedParent(bool first_call, ParentResult *result, HttpRequestData *request_info,
+                        ParentConfigParams *config, bool bypass_ok);
+  bool OverLoaded(int index, float up_weight);
+  void NoteLoad(int index, time_t now);
+
+  // First parent for round_robin=latency
+  int PickFastestParent(HttpRequestData *request_info, ParentConfigParams *config);
+
+  pRingNode *ring;
+  int ring_size;
+  float total_weight;
+  float load_factor;            // 0 turns off the load bound
+  volatile int32_t load_epoch;  // second the load counts were last aged
+  volatile int32_t load_total;
 };
 
 // Helper Functions
@@ -184,12 +184,13 @@ void
 reloadUrlRewrite()
 {
   UrlRewrite *newTable;
+  ink_hrtime start = ink_get_hrtime();
 
   Debug("url_rewrite", "remap.config updated, reloading...");
   newTable = new UrlRewrite("proxy.config.url_remap.filename");
   if (newTable->is_valid()) {
     eventProcessor.schedule_in(new UR_FreerContinuation(rewrite_table), URL_REWRITE_TIMEOUT, ET_TASK);
-    Debug("url_rewrite", "remap.config done reloading!");
+    Debug("url_rewrite", "remap.config done reloading in %" PRId64 " ms!", ink_hrtime_to_msec(ink_get_hrtime() - start));
     ink_atomic_swap_ptr(&rewrite_table, newTable);
   } else {
     static const char* msg = "failed to reload remap.config, not replacing!";
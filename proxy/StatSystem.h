@@ -67,7 +67,7 @@ public:
   ////////////////////////////////////////////////////////
   ink_hrtime server_first_connect;
   ink_hrtime server_connect;
-  // ink_hrtime  server_connect_end;
+  ink_hrtime server_connect_end;
   // ink_hrtime  server_begin_write;            //  http only
   ink_hrtime server_first_read; //  http only
   ink_hrtime server_read_header_done;   //  http only
@@ -65,6 +65,13 @@ public:
   {
     return m_unsatisfiable_range;
   }
+  // the input starts at 'offset' of the document instead of 0,
+  // used when the cache read seeks to the first range
+  void set_input_offset(int64_t offset)
+  {
+    ink_debug_assert(m_num_range_fields > 0 && offset <= m_ranges[0]._start);
+    m_ranges[0]._done_byte = offset - 1;
+  }
 
   typedef struct _RangeRecord
   {
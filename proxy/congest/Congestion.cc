@@ -67,8 +67,7 @@ char *DEFAULT_congestion_scheme_str = NULL;
 int DEFAULT_congestion_scheme = PER_IP;
 
 /* congestion control limits */
-#define CONG_RULE_MAX_max_connection_failures \
-             (1<<(sizeof(cong_hist_t) * 8))
+#define CONG_RULE_MAX_max_connection_failures (1<<16)
 
 #define CONG_RULE_ULIMITED_max_connection_failures -1
 #define CONG_RULE_ULIMITED_mac_connection -1
@@ -383,6 +382,8 @@ initCongestionControl()
   ink_assert(CongestionMatcher == NULL);
 // register the stats variables
   register_congest_stats();
+// the origin health table, also read by parent selection
+  initOriginHealth();
 // you must grab this mutex before reconfig the congestion control matcher table
   reconfig_mutex = new_ProxyMutex();
 
@@ -550,60 +551,23 @@ make_key(char *hostname, int len, sockaddr const* ip, char *prefix, int prelen,
 // FailHistory Implementation
 //----------------------------------------------------------
 void
-FailHistory::init(int window)
+FailHistory::init(int window_len)
 {
-  bin_len = (window + CONG_HIST_ENTRIES) / CONG_HIST_ENTRIES;
-  if (bin_len <= 0)
-    bin_len = 1;
-  length = bin_len * CONG_HIST_ENTRIES;
-  for (int i = 0; i < CONG_HIST_ENTRIES; i++) {
-    bins[i] = 0;
-  }
+  window.init(window_len);
   last_event = 0;
-  cur_index = 0;
-  events = 0;
-  start = 0;
-}
-
-void
-FailHistory::init_event(long t, int n)
-{
-  last_event = t;
-  cur_index = 0;
-  events = n;
-  bins[0] = n;
-  for (int i = 1; i < CONG_HIST_ENTRIES; i++) {
-    bins[i] = 0;
-  }
-  start = (last_event + bin_len) - last_event % bin_len - length;
 }
 
 int
 FailHistory::regist_event(long t, int n)
 {
-  if (t < start)
-    return events;
-  if (t > last_event + length) {
-    init_event(t, n);
-    return events;
-  }
-  if (t < start + length) {
-    bins[((t - start) / bin_len + 1 + cur_index) % CONG_HIST_ENTRIES] += n;
-  } else {
-    do {
-      start += bin_len;
-      cur_index++;
-      if (cur_index == CONG_HIST_ENTRIES)
-        cur_index = 0;
-      events -= bins[cur_index];
-      bins[cur_index] = 0;
-    } while (start + length < t);
-    bins[cur_index] = n;
-  }
-  events += n;
-  if (last_event < t)
-    last_event = t;
-  return events;
+  long last = last_event;
+
+  if (t + window.length() <= last)
+    return events();
+  window.add(t, n);
+  while (last < t && !ink_atomic_cas(&last_event, last, t))
+    last = last_event;
+  return events();
 }
 
 //----------------------------------------------------------
@@ -624,7 +588,6 @@ m_M_congested(0), m_last_M_congested(0), m_num_connections(0), m_stat_congested_
   rule->get();
   pRecord = rule;
   clearFailHistory();
-  m_hist_lock = new_ProxyMutex();
 }
 
 void
@@ -690,7 +653,7 @@ CongestionEntry::applyNewRule(CongestionControlRecord * rule)
     if (ink_atomic_swap(&m_congested, 0)) {
       // action not congested?
     }
-  } else if (mcf > pRecord->max_connection_failures && m_history.events >= pRecord->max_connection_failures) {
+  } else if (mcf > pRecord->max_connection_failures && m_history.events() >= pRecord->max_connection_failures) {
     if (!ink_atomic_swap(&m_congested, 1)) {
       // action congested?
     }
@@ -744,7 +707,7 @@ CongestionEntry::sprint(char *buf, int buflen, int format)
         len += snprintf(buf + len, buflen - len, "|%ld", m_history.last_event);
 
         if (format > 3) {
-          len += snprintf(buf + len, buflen - len, "|%d|%d|%d", m_history.events, m_ref_count, m_num_connections);
+          len += snprintf(buf + len, buflen - len, "|%d|%d|%d", m_history.events(), m_ref_count, m_num_connections);
         }
       }
     }
@@ -754,9 +717,9 @@ CongestionEntry::sprint(char *buf, int buflen, int format)
 }
 
 //-------------------------------------------------------------
-// When a connection failure happened, try to get the lock
-//  first and change register the event, if we can not get
-//  the lock, discard the event
+// Register a connection failure. The history is lock free, so
+//  no failure is lost to contention when an origin goes down
+//  under load.
 //-------------------------------------------------------------
 void
 CongestionEntry::failed_at(ink_hrtime t)
@@ -766,19 +729,14 @@ CongestionEntry::failed_at(ink_hrtime t)
   // long time = ink_hrtime_to_sec(t);
   long time = t;
   Debug("congestion_control", "failed_at: %ld", time);
-  MUTEX_TRY_LOCK(lock, m_hist_lock, this_ethread());
-  if (lock) {
-    m_history.regist_event(time);
-    if (!m_congested) {
-      int32_t new_congested = compCongested();
-      // TODO: This used to signal via SNMP
-      if (new_congested && !ink_atomic_swap(&m_congested, 1)) {
-        m_last_congested = m_history.last_event;
-        // action congested ?
-      }
+  m_history.regist_event(time);
+  if (!m_congested) {
+    int32_t new_congested = compCongested();
+    // TODO: This used to signal via SNMP
+    if (new_congested && !ink_atomic_swap(&m_congested, 1)) {
+      m_last_congested = m_history.last_event;
+      // action congested ?
     }
-  } else {
-    Debug("congestion_control", "failure info lost due to lock contention(Entry: %p, Time: %ld)", (void *) this, time);
   }
 }
 
@@ -36,6 +36,7 @@
 #include "ControlBase.h"
 #include "ControlMatcher.h"
 #include "CongestionStats.h"
+#include "OriginHealth.h"
 
 #define CONGESTION_EVENT_CONGESTED_ON_M      (CONGESTION_EVENT_EVENTS_START + 1)
 #define CONGESTION_EVENT_CONGESTED_ON_F      (CONGESTION_EVENT_EVENTS_START + 2)
@@ -169,30 +170,25 @@ CongestionControlRecord::cleanup()
   ats_free(error_page), error_page = NULL;
 }
 
-typedef unsigned short cong_hist_t;
-#define CONG_HIST_ENTRIES 17
-
 // CongestionEntry
+//
+//   The connection failures of the last fail_window seconds before the
+//   latest one. Updated without a lock (see HealthWindow), so that
+//   failures aren't dropped when many transactions fail at once.
 struct FailHistory
 {
-  long start;
-  int bin_len;
-  int length;
-  cong_hist_t bins[CONG_HIST_ENTRIES];
-  int cur_index;
-  long last_event;
-  int events;
-
-    FailHistory():start(0), bin_len(0), length(0), cur_index(0), last_event(0), events(0)
+  HealthWindow window;
+  volatile long last_event;
+
+    FailHistory():last_event(0)
   {
-    bzero((void *) &bins, sizeof(bins));
+    window.init(1);
   }
-  void init(int window);
-  void init_event(long t, int n = 1);
+  void init(int window_len);
   int regist_event(long t, int n = 1);
-  int get_bin_events(int index)
+  int events() const
   {
-    return bins[(index + 1 + cur_index) % CONG_HIST_ENTRIES];
+    return window.sum(last_event);
   }
 };
 
@@ -211,7 +207,6 @@ struct CongestionEntry: public RequestData
 
   // State -- connection failures
   FailHistory m_history;
-  ProxyMutexPtr m_hist_lock;
   ink_hrtime m_last_congested;
   volatile int m_congested;     //0 | 1
   int m_stat_congested_conn_failures;
@@ -301,7 +296,7 @@ inline bool CongestionEntry::usefulInfo(ink_hrtime t)
 {
   return (m_ref_count > 1 ||
           m_congested != 0 ||
-          m_num_connections > 0 || (m_history.last_event + pRecord->fail_window > t && m_history.events > 0));
+          m_num_connections > 0 || (m_history.last_event + pRecord->fail_window > t && m_history.events() > 0));
 }
 
 inline int
@@ -382,7 +377,7 @@ inline bool CongestionEntry::compCongested()
     return true;
   if (pRecord->max_connection_failures == -1)
     return false;
-  return pRecord->max_connection_failures <= m_history.events;
+  return pRecord->max_connection_failures <= m_history.events();
 }
 
 // return true when max_conn state changed
@@ -416,7 +411,6 @@ m_stat_congested_conn_failures(0),
 m_M_congested(0), m_last_M_congested(0), m_num_connections(0), m_stat_congested_max_conn(0), m_ref_count(1)
 {
   memset(&m_ip, 0, sizeof(m_ip));
-  m_hist_lock = new_ProxyMutex();
 }
 
 
@@ -424,7 +418,6 @@ inline CongestionEntry::~CongestionEntry()
 {
   if (m_hostname)
     ats_free(m_hostname), m_hostname = NULL;
-  m_hist_lock = NULL;
   if (pRecord)
     pRecord->put(), pRecord = NULL;
 }
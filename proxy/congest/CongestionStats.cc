@@ -49,4 +49,14 @@ do { \
                      "proxy.process.congestion.congested_on_max_connection",
                      RECD_INT, RECP_NON_PERSISTENT, (int) congested_on_M_stat, RecRawStatSyncSum);
   CONGEST_CLEAR_DYN_STAT(congested_on_M_stat);
+
+  RecRegisterRawStat(congest_rsb, RECT_PROCESS,
+                     "proxy.process.congestion.congested_on_origin_health",
+                     RECD_INT, RECP_NON_PERSISTENT, (int) congested_on_H_stat, RecRawStatSyncSum);
+  CONGEST_CLEAR_DYN_STAT(congested_on_H_stat);
+
+  RecRegisterRawStat(congest_rsb, RECT_PROCESS,
+                     "proxy.process.congestion.origin_ejections",
+                     RECD_INT, RECP_NON_PERSISTENT, (int) origin_ejections_stat, RecRawStatSyncSum);
+  CONGEST_CLEAR_DYN_STAT(origin_ejections_stat);
 }
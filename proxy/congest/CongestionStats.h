@@ -43,6 +43,8 @@ enum
 {
   congested_on_F_stat,
   congested_on_M_stat,
+  congested_on_H_stat,
+  origin_ejections_stat,
   congest_num_stats
 };
 #define CONGEST_SUM_GLOBAL_DYN_STAT(_x, _y) RecIncrGlobalRawStatSum(congest_rsb, (int) _x, _y)
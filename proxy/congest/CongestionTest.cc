@@ -302,20 +302,21 @@ CCFailHistoryTestCont::check_history(bool print)
     rprintf(test, "Verify the result\n");
     rprintf(test, "Content of history\n");
     int e = 0;
-    for (int i = 0; i < CONG_HIST_ENTRIES; i++) {
-      e += entry->m_history.bins[i];
-      rprintf(test, "bucket %d => events %d , sum = %d\n", i, entry->m_history.bins[i], e);
+    for (int i = 0; i < HEALTH_WINDOW_BINS; i++) {
+      e += entry->m_history.window.bins[i].count;
+      rprintf(test, "bucket %d (bin %d) => events %d , sum = %d\n", i,
+              entry->m_history.window.bins[i].epoch, entry->m_history.window.bins[i].count, e);
     }
-    fprintf(stderr, "Events: %d, CurIndex: %d, LastEvent: %ld, HistLen: %d, BinLen: %d, Start: %ld\n",
-            entry->m_history.events,
-            entry->m_history.cur_index,
-            entry->m_history.last_event, entry->m_history.length, entry->m_history.bin_len, entry->m_history.start);
+    fprintf(stderr, "Events: %d, LastEvent: %ld, HistLen: %d, BinLen: %d\n",
+            entry->m_history.events(),
+            entry->m_history.last_event, entry->m_history.window.length(), entry->m_history.window.bin_len);
     char buf[1024];
     entry->sprint(buf, 1024, 10);
     rprintf(test, "%s", buf);
   }
-  if (test_mode == CCFailHistoryTestCont::SIMPLE_TEST && entry->m_history.events == 65536)
-    return 0;
+  // No event is dropped any more, all of the simple test's are in the window
+  if (test_mode == CCFailHistoryTestCont::SIMPLE_TEST && entry->m_history.events() != 65536)
+    return 1;
   return 0;
 }
 
@@ -550,10 +551,227 @@ EXCLUSIVE_REGRESSION_TEST(Congestion_CongestionDB) (RegressionTest * t, int atyp
  * 1. Match rules
  * 2. Apply new rules
  */
+//-------------------------------------------------------------
+// Test the OriginHealth table
+//-------------------------------------------------------------
+/* Record responses and failures for a few origins from several
+ * threads at once: no update may be lost within a bin. Reports the
+ * cost of an update under contention, then exercises the ejection
+ * rules.
+ */
+#define OH_STRESS_THREADS 8
+#define OH_STRESS_ORIGINS 8
+
+struct OHStressArg
+{
+  OriginHealthTable *table;
+  uint64_t *keys;
+  int32_t now;
+  int iterations;
+};
+
+static void *
+origin_health_stress(void *data)
+{
+  OHStressArg *arg = (OHStressArg *) data;
+
+  for (int i = 0; i < arg->iterations; i++) {
+    OriginHealth *h = arg->table->get(arg->keys[i % OH_STRESS_ORIGINS]);
+    if ((i / OH_STRESS_ORIGINS) % 4 == 3)
+      h->record_failure(arg->now);
+    else
+      h->record_response(arg->now, 200, HRTIME_MSECONDS(5));
+  }
+  return NULL;
+}
+
+REGRESSION_TEST(Congestion_OriginHealth) (RegressionTest * t, int atype, int *pstatus) {
+  NOWARN_UNUSED(atype);
+  const int iterations = 1000000;
+  OriginHealthTable *table = new OriginHealthTable(64);
+  uint64_t keys[OH_STRESS_ORIGINS];
+  OHStressArg arg;
+  ink_thread threads[OH_STRESS_THREADS];
+  char host[64];
+  int32_t now = (int32_t) time(NULL);
+  int status = REGRESSION_TEST_PASSED;
+
+  // Claim the origins and their current bins up front, so the counts are exact
+  for (int i = 0; i < OH_STRESS_ORIGINS; i++) {
+    snprintf(host, sizeof(host), "origin%d.example.com", i);
+    keys[i] = OriginHealthTable::make_key(host, 80);
+    table->get(keys[i])->requests.add(now, 0);
+    table->get(keys[i])->errors.add(now, 0);
+  }
+
+  arg.table = table;
+  arg.keys = keys;
+  arg.now = now;
+  arg.iterations = iterations;
+  ink_hrtime start = ink_get_hrtime_internal();
+  for (int i = 0; i < OH_STRESS_THREADS; i++) {
+    threads[i] = ink_thread_create(origin_health_stress, &arg);
+  }
+  for (int i = 0; i < OH_STRESS_THREADS; i++) {
+    ink_thread_join(threads[i]);
+  }
+  ink_hrtime elapsed = ink_get_hrtime_internal() - start;
+  rprintf(t, "%d threads, %d updates each over %d origins: %.1f ns per update\n",
+          OH_STRESS_THREADS, iterations, OH_STRESS_ORIGINS, (double) elapsed / iterations);
+
+  for (int i = 0; i < OH_STRESS_ORIGINS; i++) {
+    OriginHealth *h = table->lookup(keys[i]);
+    int32_t expected = OH_STRESS_THREADS * iterations / OH_STRESS_ORIGINS;
+    if (h == NULL || h->requests.sum(now) != expected || h->errors.sum(now) != expected / 4) {
+      rprintf(t, "origin %d: %d requests %d errors, expected %d and %d\n", i,
+              h ? h->requests.sum(now) : -1, h ? h->errors.sum(now) : -1, expected, expected / 4);
+      status = REGRESSION_TEST_FAILED;
+    }
+  }
+  if (table->lookup(OriginHealthTable::make_key("unknown.example.com", 80)) != NULL)
+    status = REGRESSION_TEST_FAILED;
+
+  // Ejection on connect failures in a row, with backoff; a response
+  // breaks the run
+  int32_t saved_errors = OriginHealthConfig::consecutive_errors;
+  int32_t saved_5xx = OriginHealthConfig::consecutive_5xx;
+  int32_t saved_threshold = OriginHealthConfig::latency_threshold;
+  int32_t saved_percent = OriginHealthConfig::max_ejection_percent;
+  OriginHealthConfig::consecutive_errors = 5;
+  OriginHealthConfig::consecutive_5xx = 3;
+  OriginHealthConfig::latency_threshold = 0;
+  OriginHealthConfig::max_ejection_percent = 100;
+
+  table->sweep(now);               // count what the stress run ejected
+  OriginHealth *h = table->get(OriginHealthTable::make_key("flaky.example.com", 80));
+  for (int i = 0; i < 4; i++)
+    h->record_failure(now);
+  h->record_response(now, 200, HRTIME_MSECONDS(5));
+  for (int i = 0; i < 4; i++)
+    h->record_failure(now);
+  if (h->ejected(now))
+    status = REGRESSION_TEST_FAILED;
+  h->record_failure(now);
+  if (!h->ejected(now) || h->ejected(now + OriginHealthConfig::ejection_time))
+    status = REGRESSION_TEST_FAILED;
+
+  int32_t later = now + OriginHealthConfig::ejection_time;
+  table->sweep(later);
+  for (int i = 0; i < 5; i++)
+    h->record_failure(later);
+  if (!h->ejected(later + OriginHealthConfig::ejection_time) || h->ejected(later + 2 * OriginHealthConfig::ejection_time))
+    status = REGRESSION_TEST_FAILED;
+
+  // Ejection on 5xx responses in a row, counted apart from connect
+  // failures; any other status breaks the run
+  h = table->get(OriginHealthTable::make_key("broken.example.com", 80));
+  h->record_response(now, 503, HRTIME_MSECONDS(5));
+  h->record_response(now, 500, HRTIME_MSECONDS(5));
+  h->record_response(now, 404, HRTIME_MSECONDS(5));
+  for (int i = 0; i < 4; i++)
+    h->record_failure(now);
+  h->record_response(now, 502, HRTIME_MSECONDS(5));
+  h->record_response(now, 502, HRTIME_MSECONDS(5));
+  if (h->ejected(now) || h->consecutive_errors != 0)
+    status = REGRESSION_TEST_FAILED;
+  h->record_response(now, 502, HRTIME_MSECONDS(5));
+  if (!h->ejected(now))
+    status = REGRESSION_TEST_FAILED;
+
+  // Ejection on latency
+  OriginHealthConfig::latency_threshold = 100;
+  h = table->get(OriginHealthTable::make_key("slow.example.com", 80));
+  for (int i = 0; i < 50; i++)
+    h->record_response(now, 200, HRTIME_MSECONDS(10));
+  if (h->ejected(now))
+    status = REGRESSION_TEST_FAILED;
+  for (int i = 0; i < 5; i++)
+    h->record_response(now, 200, HRTIME_MSECONDS(500));
+  if (!h->ejected(now))
+    status = REGRESSION_TEST_FAILED;
+
+  // Health checks: a failed probe holds for its ttl, a good one clears it
+  h = table->get(OriginHealthTable::make_key("probed.example.com", 80));
+  h->record_probe(now, false, 0, 20);
+  if (!h->down(now) || h->ejected(now) || h->down(now + 20))
+    status = REGRESSION_TEST_FAILED;
+  h->record_probe(now + 1, true, HRTIME_MSECONDS(2), 20);
+  if (h->down(now + 1) || h->ewma != 2000)
+    status = REGRESSION_TEST_FAILED;
+
+  // Latency weighted picks: 1ms, 10ms and one not known yet, which
+  // weighs as the fastest
+  OriginHealth *candidates[3];
+  int picks[3] = { 0, 0, 0 };
+  candidates[0] = table->get(OriginHealthTable::make_key("fast.example.com", 80));
+  candidates[1] = table->get(OriginHealthTable::make_key("slower.example.com", 80));
+  candidates[2] = NULL;
+  for (int i = 0; i < 50; i++) {
+    candidates[0]->record_response(now, 200, HRTIME_MSECONDS(1));
+    candidates[1]->record_response(now, 200, HRTIME_MSECONDS(10));
+  }
+  for (uint32_t i = 0; i < 21000; i++)
+    picks[origin_health_pick(candidates, 3, i * (uint32_t) 204522)]++;
+  rprintf(t, "latency weighted picks: 1ms %d, 10ms %d, unknown %d\n", picks[0], picks[1], picks[2]);
+  if (picks[0] < 9 * picks[1] || picks[0] > 11 * picks[1] || picks[2] < 9 * picks[1] || picks[2] > 11 * picks[1])
+    status = REGRESSION_TEST_FAILED;
+  delete table;
+
+  // At most max_ejection_percent of the origins are ejected at once
+  OriginHealthConfig::max_ejection_percent = 25;
+  table = new OriginHealthTable(64);
+  int ejected = 0;
+  for (int i = 0; i < 8; i++) {
+    snprintf(host, sizeof(host), "down%d.example.com", i);
+    h = table->get(OriginHealthTable::make_key(host, 80));
+    for (int j = 0; j < 5; j++)
+      h->record_failure(now);
+    if (h->ejected(now))
+      ejected++;
+  }
+  if (ejected != 2) {
+    rprintf(t, "%d of 8 origins ejected, expected 2\n", ejected);
+    status = REGRESSION_TEST_FAILED;
+  }
+
+  // and none at all at 0
+  OriginHealthConfig::max_ejection_percent = 0;
+  h = table->get(OriginHealthTable::make_key("down.example.net", 80));
+  for (int j = 0; j < 5; j++)
+    h->record_failure(now);
+  if (h->ejected(now))
+    status = REGRESSION_TEST_FAILED;
+  OriginHealthConfig::max_ejection_percent = 25;
+
+  // The sweep gives back idle slots, an origin past a reclaimed slot is
+  // still found and the slot is claimed again
+  int32_t idle_after = now + 2 * OriginHealthConfig::max_ejection_time + h->requests.length() + 1;
+  uint64_t first = OriginHealthTable::make_key("first.example.com", 80);
+  uint64_t second = first + 64;         // the next slot of the same chain
+  table->get(first)->record_failure(now);
+  table->get(second)->record_failure(idle_after);
+  table->sweep(idle_after);
+  if (table->lookup(first) != NULL || table->lookup(second) == NULL || table->ntracked != 1 || table->nejected != 0) {
+    rprintf(t, "sweep left %d origins, %d ejected, expected 1 and 0\n", table->ntracked, table->nejected);
+    status = REGRESSION_TEST_FAILED;
+  }
+  h = table->get(first);
+  if (h == NULL || h == table->lookup(second) || h->consecutive_errors != 0 || table->lookup(first) != h)
+    status = REGRESSION_TEST_FAILED;
+
+  OriginHealthConfig::consecutive_errors = saved_errors;
+  OriginHealthConfig::consecutive_5xx = saved_5xx;
+  OriginHealthConfig::latency_threshold = saved_threshold;
+  OriginHealthConfig::max_ejection_percent = saved_percent;
+  delete table;
+  *pstatus = status;
+}
+
 void
 init_CongestionRegressionTest()
 {
   (void) regressionTest_Congestion_HashTable;
   (void) regressionTest_Congestion_FailHistory;
   (void) regressionTest_Congestion_CongestionDB;
+  (void) regressionTest_Congestion_OriginHealth;
 }
@@ -0,0 +1,479 @@
+/** @file
+
+  A brief file description
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/*****************************************************************************
+ *
+ *  OriginHealth.cc - Passive health of the servers we talk to
+ *
+ *
+ ****************************************************************************/
+
+#include "libts.h"
+#include "P_EventSystem.h"
+#include "I_Tasks.h"
+#include "P_RecProcess.h"
+#include "OriginHealth.h"
+#include "CongestionStats.h"
+
+OriginHealthTable *originHealthTable = NULL;
+
+int32_t OriginHealthConfig::enabled = 0;
+int32_t OriginHealthConfig::window = 60;
+int32_t OriginHealthConfig::consecutive_errors = 5;
+int32_t OriginHealthConfig::consecutive_5xx = 5;
+int32_t OriginHealthConfig::latency_threshold = 0;
+int32_t OriginHealthConfig::latency_percentile = 99;
+int32_t OriginHealthConfig::latency_min_samples = 20;
+int32_t OriginHealthConfig::ejection_time = 30;
+int32_t OriginHealthConfig::max_ejection_time = 300;
+int32_t OriginHealthConfig::max_ejection_percent = 10;
+int32_t OriginHealthConfig::latency_weighted = 0;
+
+//----------------------------------------------------------
+// HealthWindow Implementation
+//----------------------------------------------------------
+void
+HealthWindow::init(int window)
+{
+  bin_len = (window + HEALTH_WINDOW_BINS - 1) / HEALTH_WINDOW_BINS;
+  if (bin_len <= 0)
+    bin_len = 1;
+  for (int i = 0; i < HEALTH_WINDOW_BINS; i++) {
+    bins[i].epoch = -1;
+    bins[i].count = 0;
+  }
+}
+
+void
+HealthWindow::add(int32_t t, int32_t n)
+{
+  int32_t e = t / bin_len;
+  Bin *b = &bins[e % HEALTH_WINDOW_BINS];
+  int32_t old = b->epoch;
+
+  if (old != e) {
+    if (old > e) {
+      // the bin already moved past this event
+      return;
+    }
+    if (ink_atomic_cas(&b->epoch, old, e)) {
+      ink_atomic_swap(&b->count, 0);
+    }
+  }
+  ink_atomic_increment(&b->count, n);
+}
+
+int32_t
+HealthWindow::sum(int32_t t) const
+{
+  int32_t e = t / bin_len;
+  int32_t s = 0;
+
+  for (int i = 0; i < HEALTH_WINDOW_BINS; i++) {
+    int32_t be = bins[i].epoch;
+    if (be <= e && be > e - HEALTH_WINDOW_BINS)
+      s += bins[i].count;
+  }
+  return s;
+}
+
+//----------------------------------------------------------
+// OriginHealth Implementation
+//----------------------------------------------------------
+// Any response ends a run of connect failures. 5xx responses count as a
+// run of their own, with their own limit.
+void
+OriginHealth::record_response(int32_t now, int status, ink_hrtime elapsed)
+{
+  requests.add(now);
+  if (consecutive_errors)
+    consecutive_errors = 0;
+  if (status >= 500 && status <= 599) {
+    int32_t n = ink_atomic_increment(&consecutive_5xx, 1) + 1;
+    if (OriginHealthConfig::consecutive_5xx > 0 && n >= OriginHealthConfig::consecutive_5xx) {
+      eject(now, "consecutive 5xx responses");
+    }
+  } else if (consecutive_5xx) {
+    consecutive_5xx = 0;
+  }
+  update_ewma(elapsed);
+  // An origin that stays healthy for an ejection time after coming back
+  // starts over with the shortest ejection.
+  if (ejections && ejected_until + OriginHealthConfig::ejection_time < now)
+    ejections = 0;
+
+  if (OriginHealthConfig::latency_threshold > 0) {
+    record_latency(now, elapsed);
+    if (latency_percentile(OriginHealthConfig::latency_percentile) > OriginHealthConfig::latency_threshold) {
+      eject(now, "latency");
+    }
+  }
+}
+
+void
+OriginHealth::record_failure(int32_t now)
+{
+  requests.add(now);
+  errors.add(now);
+  int32_t n = ink_atomic_increment(&consecutive_errors, 1) + 1;
+  if (OriginHealthConfig::consecutive_errors > 0 && n >= OriginHealthConfig::consecutive_errors) {
+    eject(now, "consecutive connect failures");
+  }
+}
+
+void
+OriginHealth::record_probe(int32_t now, bool up, ink_hrtime elapsed, int32_t ttl)
+{
+  if (up) {
+    if (probe_down_until)
+      probe_down_until = 0;
+    update_ewma(elapsed);
+  } else {
+    errors.add(now);
+    probe_down_until = now + (ttl > 0 ? ttl : OriginHealthConfig::ejection_time);
+  }
+}
+
+// Moves 1/8 of the way to the new sample. Concurrent updates may
+// overwrite each other, which only drops samples.
+void
+OriginHealth::update_ewma(ink_hrtime elapsed)
+{
+  int32_t us = (int32_t) MIN(ink_hrtime_to_usec(elapsed), (ink_hrtime) INT32_MAX);
+  int32_t old = ewma;
+
+  if (us <= 0)
+    us = 1;
+  ewma = old ? old + (us - old) / 8 : us;
+}
+
+// The histogram is halved every window, so it follows the recent
+// responses.
+void
+OriginHealth::record_latency(int32_t now, ink_hrtime elapsed)
+{
+  int32_t epoch = now / OriginHealthConfig::window;
+  int32_t old = latency_epoch;
+
+  if (old != epoch && ink_atomic_cas(&latency_epoch, old, epoch)) {
+    for (int i = 0; i < HEALTH_LATENCY_BUCKETS; i++) {
+      latency[i] >>= 1;
+    }
+  }
+
+  int64_t ms = ink_hrtime_to_msec(elapsed);
+  int b = 0;
+  while (ms > 0 && b < HEALTH_LATENCY_BUCKETS - 1) {
+    ms >>= 1;
+    b++;
+  }
+  ink_atomic_increment(&latency[b], 1);
+}
+
+int32_t
+OriginHealth::latency_percentile(int pct) const
+{
+  int32_t total = 0;
+  int32_t seen = 0;
+
+  for (int i = 0; i < HEALTH_LATENCY_BUCKETS; i++) {
+    total += latency[i];
+  }
+  if (total < OriginHealthConfig::latency_min_samples)
+    return 0;
+
+  for (int i = 0; i < HEALTH_LATENCY_BUCKETS; i++) {
+    seen += latency[i];
+    if ((int64_t) seen * 100 >= (int64_t) total * pct) {
+      // the upper bound of bucket i
+      return i == 0 ? 0 : (1 << i) - 1;
+    }
+  }
+  return (1 << (HEALTH_LATENCY_BUCKETS - 1)) - 1;
+}
+
+bool
+OriginHealth::idle(int32_t now) const
+{
+  return requests.sum(now) == 0 && errors.sum(now) == 0 && probe_down_until <= now &&
+    ejected_until + OriginHealthConfig::max_ejection_time < now;
+}
+
+void
+OriginHealth::reset()
+{
+  requests.init(OriginHealthConfig::window);
+  errors.init(OriginHealthConfig::window);
+  consecutive_errors = 0;
+  consecutive_5xx = 0;
+  latency_epoch = 0;
+  for (int i = 0; i < HEALTH_LATENCY_BUCKETS; i++) {
+    latency[i] = 0;
+  }
+  ejected_until = 0;
+  ejections = 0;
+  probe_down_until = 0;
+  ewma = 0;
+}
+
+void
+OriginHealth::eject(int32_t now, const char *why)
+{
+  int32_t until = ejected_until;
+  if (until > now)
+    return;
+
+  if (!table->start_ejection()) {
+    Debug("origin_health", "origin %" PRIx64 " not ejected on %s, too many are", key, why);
+    return;
+  }
+
+  int32_t n = ejections;
+  int32_t len = OriginHealthConfig::ejection_time;
+  for (int i = 0; i < n && len < OriginHealthConfig::max_ejection_time; i++) {
+    len <<= 1;
+  }
+  if (len > OriginHealthConfig::max_ejection_time)
+    len = OriginHealthConfig::max_ejection_time;
+
+  // Only the thread that moves ejected_until ejects
+  if (!ink_atomic_cas(&ejected_until, until, now + len)) {
+    ink_atomic_increment(&table->nejected, -1);
+    return;
+  }
+
+  ink_atomic_increment(&ejections, 1);
+  consecutive_errors = 0;
+  consecutive_5xx = 0;
+  for (int i = 0; i < HEALTH_LATENCY_BUCKETS; i++) {
+    latency[i] = 0;
+  }
+  CONGEST_SUM_GLOBAL_DYN_STAT(origin_ejections_stat, 1);
+  Debug("origin_health", "origin %" PRIx64 " ejected for %d seconds on %s", key, len, why);
+}
+
+//----------------------------------------------------------
+// OriginHealthTable Implementation
+//----------------------------------------------------------
+OriginHealthTable::OriginHealthTable(int size)
+  : ntracked(0), nejected(0)
+{
+  uint32_t n = 1;
+  while (n < (uint32_t) size)
+    n <<= 1;
+
+  mask = n - 1;
+  slots = (OriginHealth *)ats_malloc(sizeof(OriginHealth) * n);
+  memset(slots, 0, sizeof(OriginHealth) * n);
+  for (uint32_t i = 0; i < n; i++) {
+    slots[i].table = this;
+    slots[i].reset();
+  }
+}
+
+OriginHealthTable::~OriginHealthTable()
+{
+  ats_free(slots);
+}
+
+OriginHealth *
+OriginHealthTable::lookup(uint64_t key) const
+{
+  for (uint32_t i = 0; i < ORIGIN_HEALTH_PROBES; i++) {
+    OriginHealth *h = &slots[(key + i) & mask];
+    uint64_t k = h->key;
+    if (k == key)
+      return h;
+    if (k == ORIGIN_HEALTH_FREE)
+      return NULL;
+  }
+  return NULL;
+}
+
+// The origin may sit past a reclaimed slot, which is only claimed once
+// the probe shows the origin has no slot. Two threads claiming for the
+// same origin at once may end up with a slot each; lookup() then finds
+// the first and the other is reclaimed once idle.
+OriginHealth *
+OriginHealthTable::get(uint64_t key)
+{
+  OriginHealth *h = lookup(key);
+  if (h != NULL)
+    return h;
+
+  for (uint32_t i = 0; i < ORIGIN_HEALTH_PROBES; i++) {
+    h = &slots[(key + i) & mask];
+    uint64_t k = h->key;
+    if ((k == ORIGIN_HEALTH_FREE || k == ORIGIN_HEALTH_RECLAIMED) && ink_atomic_cas(&h->key, k, key)) {
+      ink_atomic_increment(&ntracked, 1);
+      return h;
+    }
+    // reread, the slot may just have been claimed for the same key
+    if (h->key == key)
+      return h;
+  }
+  return NULL;
+}
+
+bool
+OriginHealthTable::start_ejection()
+{
+  int32_t limit = (int32_t) ((int64_t) ntracked * OriginHealthConfig::max_ejection_percent / 100);
+
+  if (OriginHealthConfig::max_ejection_percent <= 0)
+    return false;
+  if (limit < 1)
+    limit = 1;
+  if (ink_atomic_increment(&nejected, 1) >= limit) {
+    ink_atomic_increment(&nejected, -1);
+    return false;
+  }
+  return true;
+}
+
+// Runs on one thread at a time. A slot is cleared before it is given
+// back, so the next origin starts from nothing.
+void
+OriginHealthTable::sweep(int32_t now)
+{
+  int32_t tracked = 0;
+  int32_t ejected = 0;
+
+  for (uint32_t i = 0; i <= mask; i++) {
+    OriginHealth *h = &slots[i];
+    uint64_t k = h->key;
+
+    if (k == ORIGIN_HEALTH_FREE || k == ORIGIN_HEALTH_RECLAIMED)
+      continue;
+    if (h->idle(now)) {
+      h->reset();
+      if (ink_atomic_cas(&h->key, k, (uint64_t) ORIGIN_HEALTH_RECLAIMED)) {
+        Debug("origin_health", "origin %" PRIx64 " idle, slot reclaimed", k);
+        continue;
+      }
+    }
+    tracked++;
+    if (h->ejected(now))
+      ejected++;
+  }
+
+  ntracked = tracked;
+  nejected = ejected;
+}
+
+// FNV-1a of the lower cased name and the port; never ORIGIN_HEALTH_FREE
+// or ORIGIN_HEALTH_RECLAIMED
+uint64_t
+OriginHealthTable::make_key(const char *hostname, int port)
+{
+  uint64_t h = ATS_FNV1a64_INIT;
+
+  for (const unsigned char *p = (const unsigned char *) hostname; *p; p++) {
+    h = ATS_FNV1a64_byte(h, ParseRules::ink_tolower(*p));
+  }
+  h = ATS_FNV1a64_byte(h, port & 0xff);
+  h = ATS_FNV1a64_byte(h, (port >> 8) & 0xff);
+  return h > ORIGIN_HEALTH_RECLAIMED ? h : ORIGIN_HEALTH_RECLAIMED + 1;
+}
+
+uint64_t
+OriginHealthTable::make_key(sockaddr const* ip, int port)
+{
+  uint64_t h = ATS_FNV1a64(ats_ip_addr8_cast(ip), ats_ip_addr_size(ip));
+
+  h = ATS_FNV1a64_byte(h, port & 0xff);
+  h = ATS_FNV1a64_byte(h, (port >> 8) & 0xff);
+  return h > ORIGIN_HEALTH_RECLAIMED ? h : ORIGIN_HEALTH_RECLAIMED + 1;
+}
+
+int
+origin_health_pick(OriginHealth * const *candidates, int n, uint32_t r)
+{
+  int32_t fastest = INT32_MAX;
+  double total = 0;
+  double x;
+
+  for (int i = 0; i < n; i++) {
+    if (candidates[i] != NULL && candidates[i]->ewma > 0 && candidates[i]->ewma < fastest)
+      fastest = candidates[i]->ewma;
+  }
+  if (fastest == INT32_MAX)
+    return r % n;
+
+  for (int i = 0; i < n; i++) {
+    int32_t l = (candidates[i] != NULL && candidates[i]->ewma > 0) ? candidates[i]->ewma : fastest;
+    total += 1.0 / l;
+  }
+  x = total * ((double) r / 4294967296.0);
+  for (int i = 0; i < n; i++) {
+    int32_t l = (candidates[i] != NULL && candidates[i]->ewma > 0) ? candidates[i]->ewma : fastest;
+    x -= 1.0 / l;
+    if (x < 0)
+      return i;
+  }
+  return n - 1;
+}
+
+struct OriginHealthSweeper: public Continuation
+{
+  OriginHealthSweeper()
+    : Continuation(new_ProxyMutex())
+  {
+    SET_HANDLER(&OriginHealthSweeper::sweepEvent);
+  }
+
+  int sweepEvent(int event, Event *e)
+  {
+    NOWARN_UNUSED(event);
+    NOWARN_UNUSED(e);
+    originHealthTable->sweep((int32_t) ink_hrtime_to_sec(ink_get_hrtime()));
+    return EVENT_CONT;
+  }
+};
+
+#define OH_EstablishStaticConfigInteger(v, n) REC_EstablishStaticConfigInt32(v, n)
+
+void
+initOriginHealth()
+{
+  int32_t size = 16384;
+
+  OH_EstablishStaticConfigInteger(OriginHealthConfig::enabled, "proxy.config.http.origin_health.enabled");
+  OH_EstablishStaticConfigInteger(OriginHealthConfig::window, "proxy.config.http.origin_health.window");
+  OH_EstablishStaticConfigInteger(OriginHealthConfig::consecutive_errors, "proxy.config.http.origin_health.consecutive_errors");
+  OH_EstablishStaticConfigInteger(OriginHealthConfig::consecutive_5xx, "proxy.config.http.origin_health.consecutive_5xx");
+  OH_EstablishStaticConfigInteger(OriginHealthConfig::latency_threshold, "proxy.config.http.origin_health.latency_threshold");
+  OH_EstablishStaticConfigInteger(OriginHealthConfig::latency_percentile, "proxy.config.http.origin_health.latency_percentile");
+  OH_EstablishStaticConfigInteger(OriginHealthConfig::latency_min_samples, "proxy.config.http.origin_health.latency_min_samples");
+  OH_EstablishStaticConfigInteger(OriginHealthConfig::ejection_time, "proxy.config.http.origin_health.ejection_time");
+  OH_EstablishStaticConfigInteger(OriginHealthConfig::max_ejection_time, "proxy.config.http.origin_health.max_ejection_time");
+  OH_EstablishStaticConfigInteger(OriginHealthConfig::max_ejection_percent, "proxy.config.http.origin_health.max_ejection_percent");
+  OH_EstablishStaticConfigInteger(OriginHealthConfig::latency_weighted, "proxy.config.http.origin_health.latency_weighted");
+  REC_ReadConfigInt32(size, "proxy.config.http.origin_health.table_size");
+
+  if (OriginHealthConfig::window <= 0)
+    OriginHealthConfig::window = 60;
+
+  originHealthTable = NEW(new OriginHealthTable(size));
+  eventProcessor.schedule_every(NEW(new OriginHealthSweeper), ORIGIN_HEALTH_SWEEP_INTERVAL, ET_TASK);
+}
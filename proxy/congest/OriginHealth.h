@@ -0,0 +1,239 @@
+/** @file
+
+  A brief file description
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+/*****************************************************************************
+ *
+ *  OriginHealth.h - Passive health of the servers we talk to
+ *
+ *
+ ****************************************************************************/
+
+/*
+ * Every response from, and every failure to reach, an origin server or
+ * parent proxy is recorded in a table shared by all threads, without
+ * locks. An origin that fails too many connections in a row, or whose
+ * response header latency percentile goes over the limit, is ejected
+ * for a while (outlier ejection); an error response still means the
+ * origin is reachable and doesn't count. No more than
+ * max_ejection_percent of the tracked origins are ejected at once. The
+ * health checker publishes its probes in the same table, so an origin
+ * whose probe failed is down before any client request goes to it.
+ * HostDB round robin passes over down members and can prefer the lower
+ * latency ones; congestion control refuses to connect to a down parent
+ * only when another parent, or the origin, can take the request.
+ * Reading the state of an origin is a probe of the table and a compare.
+ */
+#ifndef ORIGIN_HEALTH_H_
+#define ORIGIN_HEALTH_H_
+
+#include "libts.h"
+
+#define HEALTH_WINDOW_BINS      16
+#define HEALTH_LATENCY_BUCKETS  20      // log2 of milliseconds
+#define ORIGIN_HEALTH_PROBES    16
+#define ORIGIN_HEALTH_SWEEP_INTERVAL HRTIME_SECONDS(10)
+
+// Slot keys with a special meaning, OriginHealthTable::make_key() never returns them
+#define ORIGIN_HEALTH_FREE      0       // never used, ends a probe
+#define ORIGIN_HEALTH_RECLAIMED 1       // given back by the sweep, a probe goes on past it
+
+// HealthWindow
+//
+//   Event counts over the last HEALTH_WINDOW_BINS bins of bin_len
+//   seconds, updated with atomics only. A bin is tagged with the bin
+//   number (time / bin_len) it counts; the first update of a newer bin
+//   claims it with a compare and swap and clears it. An update racing
+//   the claim may be lost, which is fine for these counts.
+//
+struct HealthWindow
+{
+  struct Bin
+  {
+    volatile int32_t epoch;
+    volatile int32_t count;
+  };
+
+  int32_t bin_len;
+  Bin bins[HEALTH_WINDOW_BINS];
+
+  // window is the length in seconds
+  void init(int window);
+  void add(int32_t t, int32_t n = 1);
+  // events in the window ending at t
+  int32_t sum(int32_t t) const;
+  int32_t length() const
+  {
+    return bin_len * HEALTH_WINDOW_BINS;
+  }
+};
+
+struct OriginHealthConfig
+{
+  static int32_t enabled;
+  static int32_t window;
+  static int32_t consecutive_errors;    // connect failures in a row, 0 for no limit
+  static int32_t consecutive_5xx;       // 5xx responses in a row, 0 for no limit
+  static int32_t latency_threshold;     // milliseconds, 0 for no limit
+  static int32_t latency_percentile;
+  static int32_t latency_min_samples;
+  static int32_t ejection_time;         // seconds, doubled on every ejection in a row
+  static int32_t max_ejection_time;
+  static int32_t max_ejection_percent;  // of the tracked origins, 0 for none; otherwise at least one may be ejected
+  static int32_t latency_weighted;      // HostDB round robin by latency
+};
+
+class OriginHealthTable;
+
+// OriginHealth
+//
+//   The health of one origin server or parent, a slot of the
+//   OriginHealthTable. Only ever reached through the table and never
+//   freed; every field is updated with atomics.
+//
+struct OriginHealth
+{
+  volatile uint64_t key;        // ORIGIN_HEALTH_FREE or ORIGIN_HEALTH_RECLAIMED while the slot is free
+  OriginHealthTable *table;
+  HealthWindow requests;
+  HealthWindow errors;
+  volatile int32_t consecutive_errors;  // connect failures
+  volatile int32_t consecutive_5xx;
+  volatile int32_t latency_epoch;       // window the histogram was last aged in
+  volatile int32_t latency[HEALTH_LATENCY_BUCKETS];
+  volatile int32_t ejected_until;       // seconds
+  volatile int32_t ejections;           // in a row, for the backoff
+  volatile int32_t probe_down_until;    // the last health check failed, seconds
+  volatile int32_t ewma;                // response latency in microseconds, 0 until known
+
+  bool ejected(int32_t now) const
+  {
+    return ejected_until > now;
+  }
+  bool down(int32_t now) const
+  {
+    return ejected_until > now || probe_down_until > now;
+  }
+
+  // A response header with status came back elapsed after the request went out
+  void record_response(int32_t now, int status, ink_hrtime elapsed);
+  // The connection failed or timed out
+  void record_failure(int32_t now);
+  // A health check came back up or down; a failed one holds for ttl seconds
+  void record_probe(int32_t now, bool up, ink_hrtime elapsed, int32_t ttl);
+  // Milliseconds under which pct percent of the recent responses came
+  int32_t latency_percentile(int pct) const;
+
+  // Nothing was recorded for a window and no ejection or failed probe is remembered
+  bool idle(int32_t now) const;
+  void reset();
+
+private:
+  void record_latency(int32_t now, ink_hrtime elapsed);
+  void update_ewma(ink_hrtime elapsed);
+  void eject(int32_t now, const char *why);
+};
+
+// OriginHealthTable
+//
+//   An open addressed table of OriginHealth, keyed by a hash of the
+//   origin name and port. A new origin claims a free or reclaimed slot
+//   with a compare and swap; an origin that doesn't find one within
+//   ORIGIN_HEALTH_PROBES isn't tracked. sweep() gives back the slots of
+//   idle origins, leaving ORIGIN_HEALTH_RECLAIMED so that the probes
+//   of the others still reach them, and counts the origins tracked and
+//   ejected for the ejection cap. An update through a slot pointer
+//   fetched just before its origin was swept lands on the slot's next
+//   origin; since the origin was idle for a whole window that is rare
+//   and only moves a count.
+//
+class OriginHealthTable
+{
+public:
+  OriginHealthTable(int size);
+  ~OriginHealthTable();
+
+  // The origin's slot or NULL
+  OriginHealth *lookup(uint64_t key) const;
+  // The origin's slot, claiming one for a new origin, or NULL if full
+  OriginHealth *get(uint64_t key);
+
+  // Whether one more origin may be ejected, counting it if so
+  bool start_ejection();
+  // Reclaims the idle slots and recounts the tracked and ejected origins
+  void sweep(int32_t now);
+
+  static uint64_t make_key(const char *hostname, int port);
+  static uint64_t make_key(sockaddr const* ip, int port);
+
+  // Between sweeps only go up, so an ejection that ran out is counted until the next one
+  volatile int32_t ntracked;
+  volatile int32_t nejected;
+
+private:
+  OriginHealth *slots;
+  uint32_t mask;
+};
+
+extern OriginHealthTable *originHealthTable;
+
+void initOriginHealth();
+
+inline bool
+origin_health_down(uint64_t key, int32_t now)
+{
+  if (!OriginHealthConfig::enabled || originHealthTable == NULL) {
+    return false;
+  }
+  OriginHealth *h = originHealthTable->lookup(key);
+  return h != NULL && h->down(now);
+}
+
+inline bool
+origin_health_down(const char *hostname, int port, int32_t now)
+{
+  if (!OriginHealthConfig::enabled || originHealthTable == NULL || hostname == NULL) {
+    return false;
+  }
+  return origin_health_down(OriginHealthTable::make_key(hostname, port), now);
+}
+
+// Refusing a connection to a down parent is only worth it when the
+// request has somewhere else to go: another parent, or the origin when
+// the parent may be bypassed. Round robin origins already pass over
+// down members when the address is picked, and a lone origin is better
+// tried than failed.
+inline bool
+origin_health_refuse_parent(const char *hostname, int port, int nparents, bool go_direct, int32_t now)
+{
+  if (nparents < 2 && !go_direct) {
+    return false;
+  }
+  return origin_health_down(hostname, port, now);
+}
+
+// Picks one of n candidates at random, weighted by the inverse of their
+// latency EWMA; a candidate not known yet (NULL or no EWMA) weighs as
+// the fastest known one, so that it gets tried. r is a random number.
+int origin_health_pick(OriginHealth * const *candidates, int n, uint32_t r);
+
+#endif /* ORIGIN_HEALTH_H_ */
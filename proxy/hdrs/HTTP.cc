@@ -913,13 +913,15 @@ http_parser_parse_req(HTTPParser *parser, HdrHeap *heap, HTTPHdrImpl *hh, const
     ink_assert((end - cur) >= 0);
     ink_assert((end - cur) < UINT16_MAX);
 
-    must_copy_strings = (must_copy_strings || (!line_is_real));
+    // A line put together by the scanner has to be copied, the
+    // header fields after it need not be
+    bool line_must_copy = (must_copy_strings || (!line_is_real));
 
 #if ENABLE_SAVE_ORIGINAL_REQUEST
     mime_str_u16_set(heap, line_start, strlen(line_start),
                      &(hh->u.req.m_url_impl->the_request),
                      &(hh->u.req.m_url_impl->the_request_len),
-                     must_copy_strings);
+                     line_must_copy);
 #endif
 
 #if (ENABLE_PARSER_FAST_PATHS)
@@ -940,11 +942,11 @@ http_parser_parse_req(HTTPParser *parser, HdrHeap *heap, HTTPHdrImpl *hh, const
 
       int32_t version = HTTP_VERSION(end[-5] - '0', end[-3] - '0');
 
-      http_hdr_method_set(heap, hh, &(cur[0]), hdrtoken_wks_to_index(HTTP_METHOD_GET), 3, must_copy_strings);
+      http_hdr_method_set(heap, hh, &(cur[0]), hdrtoken_wks_to_index(HTTP_METHOD_GET), 3, line_must_copy);
       ink_debug_assert(hh->u.req.m_url_impl != NULL);
       url = hh->u.req.m_url_impl;
       url_start = &(cur[4]);
-      err =::url_parse(heap, url, &url_start, &(end[-11]), must_copy_strings);
+      err =::url_parse(heap, url, &url_start, &(end[-11]), line_must_copy);
       if (err < 0)
         return err;
       http_hdr_version_set(hh, version);
@@ -1061,7 +1063,7 @@ http_parser_parse_req(HTTPParser *parser, HdrHeap *heap, HTTPHdrImpl *hh, const
 
     int method_wks_idx = hdrtoken_tokenize(method_start,
                                            (int) (method_end - method_start));
-    http_hdr_method_set(heap, hh, method_start, method_wks_idx, (int) (method_end - method_start), must_copy_strings);
+    http_hdr_method_set(heap, hh, method_start, method_wks_idx, (int) (method_end - method_start), line_must_copy);
 
     if (!url_start || !url_end)
       return PARSE_ERROR;
@@ -1069,7 +1071,7 @@ http_parser_parse_req(HTTPParser *parser, HdrHeap *heap, HTTPHdrImpl *hh, const
     ink_debug_assert(hh->u.req.m_url_impl != NULL);
 
     url = hh->u.req.m_url_impl;
-    err =::url_parse(heap, url, &url_start, url_end, must_copy_strings);
+    err =::url_parse(heap, url, &url_start, url_end, line_must_copy);
 
     if (err < 0)
       return err;
@@ -1132,7 +1134,9 @@ http_parser_parse_resp(HTTPParser *parser, HdrHeap *heap, HTTPHdrImpl *hh, const
     ink_assert((end - cur) >= 0);
     ink_assert((end - cur) < UINT16_MAX);
 
-    must_copy_strings = (must_copy_strings || (!line_is_real));
+    // A line put together by the scanner has to be copied, the
+    // header fields after it need not be
+    bool line_must_copy = (must_copy_strings || (!line_is_real));
 
 #if (ENABLE_PARSER_FAST_PATHS)
     // first try fast path
@@ -1155,7 +1159,7 @@ http_parser_parse_resp(HTTPParser *parser, HdrHeap *heap, HTTPHdrImpl *hh, const
 
       http_hdr_version_set(hh, version);
       http_hdr_status_set(hh, status);
-      http_hdr_reason_set(heap, hh, reason_start, (int) (reason_end - reason_start), must_copy_strings);
+      http_hdr_reason_set(heap, hh, reason_start, (int) (reason_end - reason_start), line_must_copy);
 
       end = real_end;
       parser->m_parsing_http = false;
@@ -1260,7 +1264,7 @@ http_parser_parse_resp(HTTPParser *parser, HdrHeap *heap, HTTPHdrImpl *hh, const
       http_hdr_status_set(hh, http_parse_status(status_start, status_end));
 
     if (reason_start && reason_end) {
-      http_hdr_reason_set(heap, hh, reason_start, (int) (reason_end - reason_start), must_copy_strings);
+      http_hdr_reason_set(heap, hh, reason_start, (int) (reason_end - reason_start), line_must_copy);
     }
 
     end = real_end;
@@ -1644,8 +1648,8 @@ ClassAllocator<HTTPCacheAlt> httpCacheAltAllocator("httpCacheAltAllocator");
 HTTPCacheAlt::HTTPCacheAlt():
 m_magic(CACHE_ALT_MAGIC_ALIVE), m_writeable(1),
 m_unmarshal_len(-1),
-m_id(-1), m_rid(-1), m_request_hdr(),
-m_response_hdr(), m_request_sent_time(0), m_response_received_time(0), m_ext_buffer(NULL)
+m_id(-1), m_rid(-1), m_vary_fingerprint(0), m_request_hdr(),
+m_response_hdr(), m_request_busy(0), m_response_busy(0), m_request_sent_time(0), m_response_received_time(0), m_ext_buffer(NULL)
 {
 
   m_object_key[0] = 0;
@@ -1672,6 +1676,7 @@ void
 HTTPCacheAlt::copy(HTTPCacheAlt *to_copy)
 {
 
+  to_copy->unmarshal_hdrs();
   m_magic = to_copy->m_magic;
   // m_writeable =      to_copy->m_writeable;
   m_unmarshal_len = to_copy->m_unmarshal_len;
@@ -1683,6 +1688,7 @@ HTTPCacheAlt::copy(HTTPCacheAlt *to_copy)
   m_object_key[3] = to_copy->m_object_key[3];
   m_object_size[0] = to_copy->m_object_size[0];
   m_object_size[1] = to_copy->m_object_size[1];
+  m_vary_fingerprint = to_copy->m_vary_fingerprint;
 
   if (to_copy->m_request_hdr.valid()) {
     m_request_hdr.copy(&to_copy->m_request_hdr);
@@ -1698,6 +1704,112 @@ HTTPCacheAlt::copy(HTTPCacheAlt *to_copy)
 
 const int HTTP_ALT_MARSHAL_SIZE = ROUND(sizeof(HTTPCacheAlt), HDR_PTR_SIZE);
 
+/*-------------------------------------------------------------------------
+  Fingerprint of the request headers alternate selection looks at: the
+  Accept family and every header named in the response's Vary. Values
+  are hashed with whitespace removed and case folded, an absent header
+  hashes differently from an empty one. Vary: * has no fingerprint (0).
+  -------------------------------------------------------------------------*/
+
+static inline uint64_t
+fnv64_normalized(uint64_t h, const char *s, int len)
+{
+  for (int i = 0; i < len; i++) {
+    if (ParseRules::is_ws(s[i]))
+      continue;
+    h = ATS_FNV1a64_byte(h, ParseRules::ink_tolower(s[i]));
+  }
+  return h;
+}
+
+static inline uint64_t
+fnv64_field(uint64_t h, HTTPHdr *request, const char *name, int name_len)
+{
+  h = fnv64_normalized(h, name, name_len);
+  MIMEField *field = request->field_find(name, name_len);
+  if (!field)
+    h = ATS_FNV1a64_byte(h, 1);
+  for (; field; field = field->m_next_dup) {
+    int len;
+    const char *value = field->value_get(&len);
+    h = fnv64_normalized(h, value, len);
+    h = ATS_FNV1a64_byte(h, ',');
+  }
+  return ATS_FNV1a64_byte(h, 0);
+}
+
+uint64_t
+http_vary_fingerprint(HTTPHdr *request, HTTPHdr *response)
+{
+  uint64_t h = ATS_FNV1a64_INIT;
+
+  h = fnv64_field(h, request, MIME_FIELD_ACCEPT, MIME_LEN_ACCEPT);
+  h = fnv64_field(h, request, MIME_FIELD_ACCEPT_CHARSET, MIME_LEN_ACCEPT_CHARSET);
+  h = fnv64_field(h, request, MIME_FIELD_ACCEPT_ENCODING, MIME_LEN_ACCEPT_ENCODING);
+  h = fnv64_field(h, request, MIME_FIELD_ACCEPT_LANGUAGE, MIME_LEN_ACCEPT_LANGUAGE);
+
+  for (MIMEField *vary = response->field_find(MIME_FIELD_VARY, MIME_LEN_VARY); vary; vary = vary->m_next_dup) {
+    int len;
+    const char *s = vary->value_get(&len);
+    const char *e = s + len;
+    while (s < e) {
+      while (s < e && (ParseRules::is_ws(*s) || *s == ','))
+        s++;
+      const char *name = s;
+      while (s < e && *s != ',' && !ParseRules::is_ws(*s))
+        s++;
+      if (s == name)
+        continue;
+      if (s - name == 1 && *name == '*')
+        return 0;
+      h = fnv64_field(h, request, name, s - name);
+    }
+  }
+  return h ? h : 1;
+}
+
+/*-------------------------------------------------------------------------
+  Headers of an alt left by HTTPInfo::unmarshal_lazy() are swizzled the
+  first time they are asked for. The alt lives in a buffer shared by
+  every reader of the object (ram cache), so whoever takes the header's
+  busy word does the work and the readers of that header wait for it.
+  m_http is set last, a header with m_http set is ready to use and the
+  accessors return it without writing to the alt.
+  -------------------------------------------------------------------------*/
+
+void
+HTTPCacheAlt::unmarshal_hdr(HTTPHdr *hdr)
+{
+  int32_t *busy = (hdr == &m_request_hdr) ? &m_request_busy : &m_response_busy;
+
+  while (!hdr_ready(hdr)) {
+    if (!ink_atomic_cas((pvint32) busy, 0, 1)) {
+      sched_yield();
+      continue;
+    }
+    HdrHeap *heap = hdr->m_heap;
+    if (!hdr->m_http && heap) {
+      HTTPHdrImpl *hh = NULL;
+      int tmp = heap->unmarshal(heap->unmarshal_size(), HDR_HEAP_OBJ_HTTP_HEADER, (HdrHeapObjImpl **) & hh, NULL);
+      if (hh == NULL || tmp < 0) {
+        ink_assert(!"HTTPCacheAlt::unmarshal_hdr failed");
+        hdr->m_heap = NULL;
+      } else {
+        hdr->m_mime = hh->m_fields_impl;
+        if (hdr == &m_request_hdr)
+          hdr->m_url_cached.m_heap = heap;
+        INK_WRITE_MEMORY_BARRIER;
+        ink_atomic_swap_ptr((vvoidp) &hdr->m_http, hh);
+      }
+    }
+    ink_atomic_swap((pvint32) busy, 0);
+  }
+
+  // once both are done the accessors don't need to look at the headers
+  if (m_magic == CACHE_ALT_MAGIC_LAZY && hdr_ready(&m_request_hdr) && hdr_ready(&m_response_hdr))
+    m_magic = CACHE_ALT_MAGIC_ALIVE;
+}
+
 void
 HTTPInfo::create()
 {
@@ -1722,6 +1834,8 @@ HTTPInfo::marshal_length()
 {
   int len = HTTP_ALT_MARSHAL_SIZE;
 
+  m_alt->unmarshal_hdrs();
+
   if (m_alt->m_request_hdr.valid()) {
     len += m_alt->m_request_hdr.m_heap->marshal_length();
   }
@@ -1740,8 +1854,12 @@ HTTPInfo::marshal(char *buf, int len)
   int used = 0;
   HTTPCacheAlt *marshal_alt = (HTTPCacheAlt *) buf;
 
+  m_alt->unmarshal_hdrs();
   ink_debug_assert(m_alt->m_magic == CACHE_ALT_MAGIC_ALIVE);
 
+  if (m_alt->m_request_hdr.valid() && m_alt->m_response_hdr.valid())
+    m_alt->m_vary_fingerprint = http_vary_fingerprint(&m_alt->m_request_hdr, &m_alt->m_response_hdr);
+
   // Make sure the buffer is aligned
 //    ink_debug_assert(((intptr_t)buf) & 0x3 == 0);
 
@@ -1801,6 +1919,9 @@ HTTPInfo::unmarshal(char *buf, int len, RefCountObj *block_ref)
     ink_assert(alt->m_unmarshal_len > 0);
     ink_assert(alt->m_unmarshal_len <= len);
     return alt->m_unmarshal_len;
+  } else if (alt->m_magic == CACHE_ALT_MAGIC_LAZY) {
+    alt->unmarshal_hdrs();
+    return alt->m_unmarshal_len;
   } else if (alt->m_magic != CACHE_ALT_MAGIC_MARSHALED) {
     ink_assert(!"HTTPInfo::unmarshal bad magic");
     return -1;
@@ -1847,6 +1968,75 @@ HTTPInfo::unmarshal(char *buf, int len, RefCountObj *block_ref)
   return alt->m_unmarshal_len;
 }
 
+static int
+unmarshal_lazy_hdr(HTTPHdr *hdr, char *buf, int len, int used, RefCountObj *block_ref)
+{
+  hdr->m_http = NULL;
+  hdr->m_mime = NULL;
+  if (hdr->m_heap == NULL)
+    return 0;
+
+  intptr_t offset = (intptr_t) hdr->m_heap;
+  if (offset < used || offset >= len) {
+    ink_assert(!"HTTPInfo::unmarshal_lazy bad heap offset");
+    return -1;
+  }
+  HdrHeap *heap = (HdrHeap *) (buf + offset);
+  int size = heap->unmarshal_size();
+  if (size < 0 || offset + size > len) {
+    ink_assert(!"HTTPInfo::unmarshal_lazy truncated header");
+    return -1;
+  }
+  hdr->m_heap = heap;
+  if (block_ref)
+    heap->m_ronly_heap[0].m_ref_count_ptr.m_ptr = block_ref;
+  return size;
+}
+
+// int HTTPInfo::unmarshal_lazy(char* buf, int len, RefCountObj* block_ref)
+//
+//   Like unmarshal() but only finds the extent of the alt and its
+//    header heaps, the heaps themselves are swizzled when the
+//    request or response is first asked for.  Most hits look at
+//    the response only and the alts not selected are never looked
+//    at, so the pointer fixup for those is skipped.
+//
+int
+HTTPInfo::unmarshal_lazy(char *buf, int len, RefCountObj *block_ref)
+{
+  HTTPCacheAlt *alt = (HTTPCacheAlt *) buf;
+
+  if (alt->m_magic == CACHE_ALT_MAGIC_ALIVE || alt->m_magic == CACHE_ALT_MAGIC_LAZY) {
+    // Already done, must be a ram cache hit
+    ink_assert(alt->m_unmarshal_len > 0);
+    ink_assert(alt->m_unmarshal_len <= len);
+    return alt->m_unmarshal_len;
+  } else if (alt->m_magic != CACHE_ALT_MAGIC_MARSHALED) {
+    ink_assert(!"HTTPInfo::unmarshal_lazy bad magic");
+    return -1;
+  }
+
+  ink_assert(alt->m_unmarshal_len < 0);
+  ink_assert(alt->m_writeable == 0);
+  int used = HTTP_ALT_MARSHAL_SIZE;
+  if (used > len)
+    return -1;
+
+  int tmp = unmarshal_lazy_hdr(&alt->m_request_hdr, buf, len, used, block_ref);
+  if (tmp < 0)
+    return -1;
+  used += tmp;
+  tmp = unmarshal_lazy_hdr(&alt->m_response_hdr, buf, len, used, block_ref);
+  if (tmp < 0)
+    return -1;
+  used += tmp;
+
+  alt->m_request_busy = alt->m_response_busy = 0;
+  alt->m_unmarshal_len = used;
+  alt->m_magic = CACHE_ALT_MAGIC_LAZY;
+  return used;
+}
+
 // bool HTTPInfo::check_marshalled(char* buf, int len)
 //  Checks a marhshalled HTTPInfo buffer to make
 //    sure it's sane.  Returns true if sane, false otherwise
@@ -1939,7 +2129,7 @@ HTTPInfo::get_handle(char *buf, int len)
   //  need to do is set m_alt and make sure things are sane
   HTTPCacheAlt *a = (HTTPCacheAlt *) buf;
 
-  if (a->m_magic == CACHE_ALT_MAGIC_ALIVE) {
+  if (a->m_magic == CACHE_ALT_MAGIC_ALIVE || a->m_magic == CACHE_ALT_MAGIC_LAZY) {
     m_alt = a;
     ink_assert(m_alt->m_unmarshal_len > 0);
     ink_assert(m_alt->m_unmarshal_len <= len);
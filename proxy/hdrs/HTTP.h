@@ -1244,9 +1244,14 @@ enum
 {
   CACHE_ALT_MAGIC_ALIVE = 0xabcddeed,
   CACHE_ALT_MAGIC_MARSHALED = 0xdcbadeed,
-  CACHE_ALT_MAGIC_DEAD = 0xdeadeed
+  CACHE_ALT_MAGIC_DEAD = 0xdeadeed,
+  // Read from the cache but headers not yet (fully) swizzled, see
+  //   HTTPInfo::unmarshal_lazy()
+  CACHE_ALT_MAGIC_LAZY = 0xdcbad1ed
 };
 
+uint64_t http_vary_fingerprint(HTTPHdr *request, HTTPHdr *response);
+
 // struct HTTPCacheAlt
 struct HTTPCacheAlt
 {
@@ -1254,6 +1259,36 @@ struct HTTPCacheAlt
   void copy(HTTPCacheAlt *to_copy);
   void destroy();
 
+  // Swizzle a header of a lazily unmarshalled alt on first use
+  void unmarshal_hdr(HTTPHdr *hdr);
+  void unmarshal_hdrs()
+  {
+    if (m_magic != CACHE_ALT_MAGIC_ALIVE) {
+      if (!hdr_ready(&m_request_hdr))
+        unmarshal_hdr(&m_request_hdr);
+      if (!hdr_ready(&m_response_hdr))
+        unmarshal_hdr(&m_response_hdr);
+    }
+  }
+  HTTPHdr *request_hdr()
+  {
+    if (m_magic != CACHE_ALT_MAGIC_ALIVE && !hdr_ready(&m_request_hdr))
+      unmarshal_hdr(&m_request_hdr);
+    return &m_request_hdr;
+  }
+  HTTPHdr *response_hdr()
+  {
+    if (m_magic != CACHE_ALT_MAGIC_ALIVE && !hdr_ready(&m_response_hdr))
+      unmarshal_hdr(&m_response_hdr);
+    return &m_response_hdr;
+  }
+  // m_http is stored last when a header is swizzled, a header without a
+  //  heap is absent
+  static bool hdr_ready(HTTPHdr *hdr)
+  {
+    return ink_atomic_load_acquire(&hdr->m_http) != NULL || hdr->m_heap == NULL;
+  }
+
   uint32_t m_magic;
 
   // Writeable is set to true is we reside
@@ -1270,9 +1305,17 @@ struct HTTPCacheAlt
   int32_t m_object_key[4];
   int32_t m_object_size[2];
 
+  // http_vary_fingerprint() of the request/response, set when marshalled,
+  // 0 if unknown
+  uint64_t m_vary_fingerprint;
+
   HTTPHdr m_request_hdr;
   HTTPHdr m_response_hdr;
 
+  // Held while the request/response header of a LAZY alt is swizzled
+  int32_t m_request_busy;
+  int32_t m_response_busy;
+
   time_t m_request_sent_time;
   time_t m_response_received_time;
 
@@ -1313,6 +1356,7 @@ public:
   inkcoreapi int marshal_length();
   inkcoreapi int marshal(char *buf, int len);
   static int unmarshal(char *buf, int len, RefCountObj *block_ref);
+  static int unmarshal_lazy(char *buf, int len, RefCountObj *block_ref);
   void set_buffer_reference(RefCountObj *block_ref);
   int get_handle(char *buf, int len);
 
@@ -1327,13 +1371,13 @@ public:
   bool compare_object_key(const INK_MD5 *);
   int64_t object_size_get();
 
-  void request_get(HTTPHdr *hdr) { hdr->copy_shallow(&m_alt->m_request_hdr); }
-  void response_get(HTTPHdr *hdr) { hdr->copy_shallow(&m_alt->m_response_hdr); }
+  void request_get(HTTPHdr *hdr) { hdr->copy_shallow(m_alt->request_hdr()); }
+  void response_get(HTTPHdr *hdr) { hdr->copy_shallow(m_alt->response_hdr()); }
 
-  HTTPHdr *request_get() { return &m_alt->m_request_hdr; }
-  HTTPHdr *response_get() { return &m_alt->m_response_hdr; }
+  HTTPHdr *request_get() { return m_alt->request_hdr(); }
+  HTTPHdr *response_get() { return m_alt->response_hdr(); }
 
-  URL *request_url_get(URL *url = NULL) { return m_alt->m_request_hdr.url_get(url); }
+  URL *request_url_get(URL *url = NULL) { return m_alt->request_hdr()->url_get(url); }
 
   time_t request_sent_time_get() { return m_alt->m_request_sent_time; }
   time_t response_received_time_get() { return m_alt->m_response_received_time; }
@@ -1341,6 +1385,8 @@ public:
   void object_key_set(INK_MD5 & md5);
   void object_size_set(int64_t size);
 
+  uint64_t vary_fingerprint_get() const { return m_alt->m_vary_fingerprint; }
+
   void request_set(const HTTPHdr *req) { m_alt->m_request_hdr.copy(req); }
   void response_set(const HTTPHdr *resp) { m_alt->m_response_hdr.copy(resp); }
 
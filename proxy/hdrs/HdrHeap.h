@@ -200,6 +200,13 @@ public:
   inkcoreapi int marshal_length();
   inkcoreapi int marshal(char *buf, int length);
   int unmarshal(int buf_length, int obj_type, HdrHeapObjImpl ** found_obj, RefCountObj * block_ref);
+  // Bytes unmarshal() will consume, -1 if this is not a marshalled heap
+  int unmarshal_size() const
+  {
+    if (m_magic != HDR_BUF_MAGIC_MARSHALED)
+      return -1;
+    return ROUND(m_size + m_ronly_heap[0].m_heap_len, HDR_PTR_SIZE);
+  }
 
   void inherit_string_heaps(const HdrHeap * inherit_from);
   int attach_block(IOBufferBlock * b, const char *use_start);
@@ -44,6 +44,46 @@
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 
+// Longest partial line given back to the reader. A line arriving a few
+//   bytes at a time is scanned again on every read, so past this it is
+//   cheaper to let the scanner copy it.
+#define HTTP_PARSER_UNSCAN_MAX 1024
+
+// int http_parser_unscan_partial_line(...)
+//
+//    When a read ends part way through a line, the scanner keeps what
+//      it has of the line and later hands over the whole line from its
+//      own buffer, so every string in the line is copied into the heap.
+//      If the rest of the line can only land in the same block (it is
+//      the last block with data and has room left), give the partial
+//      line back to the reader instead: the next parse scans it again in
+//      place and its strings point into the block like the rest of the
+//      header. A full block is never left holding unconsumed data, the
+//      buffer would be over its water mark and get no block to read into.
+//
+//    Only a line started in this read can be given back, only if the
+//      scanner holds exactly the bytes at the end of it, and only up to
+//      HTTP_PARSER_UNSCAN_MAX bytes.
+//
+//    Returns the number of bytes given back
+//
+static int
+http_parser_unscan_partial_line(HTTPParser * parser, IOBufferReader * r, int line_length_before, const char *start,
+                                const char *tmp)
+{
+  MIMEScanner *scanner = &parser->m_mime_parser.m_scanner;
+  int len = scanner->m_line_length;
+
+  if (len == 0 || len > HTTP_PARSER_UNSCAN_MAX || line_length_before != 0 || len > tmp - start ||
+      r->get_current_block()->write_avail() <= 0 || memcmp(scanner->m_line, tmp - len, len) != 0) {
+    return 0;
+  }
+
+  scanner->m_line_length = 0;
+  scanner->m_state = MIME_PARSE_BEFORE;
+  return len;
+}
+
 MIMEParseResult
 HTTPHdr::parse_req(HTTPParser * parser, IOBufferReader * r, int *bytes_used, bool eof)
 {
@@ -52,6 +92,8 @@ HTTPHdr::parse_req(HTTPParser * parser, IOBufferReader * r, int *bytes_used, boo
   const char *tmp;
   const char *end;
   int used;
+  int line_length;
+  int unscanned = 0;
 
   ink_debug_assert(valid());
   ink_debug_assert(m_http->m_polarity == HTTP_TYPE_REQUEST);
@@ -72,8 +114,13 @@ HTTPHdr::parse_req(HTTPParser * parser, IOBufferReader * r, int *bytes_used, boo
 
     int heap_slot = m_heap->attach_block(r->get_current_block(), start);
 
+    line_length = parser->m_mime_parser.m_scanner.m_line_length;
     m_heap->lock_ronly_str_heap(heap_slot);
     state = http_parser_parse_req(parser, m_heap, m_http, &tmp, end, false, eof);
+    if (state == PARSE_CONT && !eof && r->read_avail() == b_avail) {
+      unscanned = http_parser_unscan_partial_line(parser, r, line_length, start, tmp);
+      tmp -= unscanned;
+    }
     m_heap->set_ronly_str_heap_end(heap_slot, tmp);
     m_heap->unlock_ronly_str_heap(heap_slot);
 
@@ -81,7 +128,7 @@ HTTPHdr::parse_req(HTTPParser * parser, IOBufferReader * r, int *bytes_used, boo
     r->consume(used);
     *bytes_used += used;
 
-  } while (state == PARSE_CONT);
+  } while (state == PARSE_CONT && unscanned == 0);
 
   return state;
 }
@@ -93,6 +140,8 @@ HTTPHdr::parse_resp(HTTPParser * parser, IOBufferReader * r, int *bytes_used, bo
   const char *tmp;
   const char *end;
   int used;
+  int line_length;
+  int unscanned = 0;
 
   ink_debug_assert(valid());
   ink_debug_assert(m_http->m_polarity == HTTP_TYPE_RESPONSE);
@@ -112,8 +161,13 @@ HTTPHdr::parse_resp(HTTPParser * parser, IOBufferReader * r, int *bytes_used, bo
 
     int heap_slot = m_heap->attach_block(r->get_current_block(), start);
 
+    line_length = parser->m_mime_parser.m_scanner.m_line_length;
     m_heap->lock_ronly_str_heap(heap_slot);
     state = http_parser_parse_resp(parser, m_heap, m_http, &tmp, end, false, eof);
+    if (state == PARSE_CONT && !eof && r->read_avail() == b_avail) {
+      unscanned = http_parser_unscan_partial_line(parser, r, line_length, start, tmp);
+      tmp -= unscanned;
+    }
     m_heap->set_ronly_str_heap_end(heap_slot, tmp);
     m_heap->unlock_ronly_str_heap(heap_slot);
 
@@ -121,7 +175,7 @@ HTTPHdr::parse_resp(HTTPParser * parser, IOBufferReader * r, int *bytes_used, bo
     r->consume(used);
     *bytes_used += used;
 
-  } while (state == PARSE_CONT);
+  } while (state == PARSE_CONT && unscanned == 0);
 
   return state;
 }
@@ -170,6 +224,10 @@ RETRY:
   //   first available slot, one you find an empty slot
   //   it's not possible that a heap ptr for this block
   //   exists in a later slot
+  //
+  // A header that comes in over several reads into the same
+  //   block finds its slot by the block's data, as the slot
+  //   starts where the first read did rather than at buf()
   for (int i = 0; i < HDR_BUF_RONLY_HEAPS; i++) {
     if (m_ronly_heap[i].m_heap_start == NULL) {
       // Add block to heap in this slot
@@ -181,10 +239,10 @@ RETRY:
 //                 m_ronly_heap[i].m_heap_len,
 //                 i);
       return i;
-    } else if (m_ronly_heap[i].m_heap_start == b->buf()) {
+    } else if (m_ronly_heap[i].m_ref_count_ptr.m_ptr == b->data.m_ptr && m_ronly_heap[i].m_heap_start <= use_start) {
       // This block is already on the heap so just extend
       //   it's range
-      m_ronly_heap[i].m_heap_len = (int) (b->end() - b->buf());
+      m_ronly_heap[i].m_heap_len = (int) (b->end() - m_ronly_heap[i].m_heap_start);
 //          printf("Extending block at %X to %d in slot %d\n",
 //                 m_ronly_heap[i].m_heap_start,
 //                 m_ronly_heap[i].m_heap_len,
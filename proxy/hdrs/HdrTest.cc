@@ -41,6 +41,7 @@
 #include "Resource.h"
 #include "URL.h"
 #include "HttpCompat.h"
+#include "P_EventSystem.h"
 
 #include "HdrTest.h"
 
@@ -71,12 +72,15 @@ HdrTest::go(RegressionTest * t, int atype)
   status = status & test_insert_comma_vals();
   status = status & test_accept_language_match();
   status = status & test_accept_charset_match();
+  status = status & test_vary_fingerprint();
+  status = status & test_http_info_lazy_unmarshal();
   status = status & test_parse_date();
   status = status & test_format_date();
   status = status & test_url();
   status = status & test_arena();
   status = status & test_regex();
   status = status & test_http_parser_eos_boundary_cases();
+  status = status & test_http_parse_iobuffer();
   status = status & test_http_mutation();
   status = status & test_mime();
   status = status & test_http();
@@ -1760,6 +1764,366 @@ HdrTest::test_accept_charset_match()
   return (failures_to_status("test_accept_charset_match", failures));
 }
 
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+int
+HdrTest::test_vary_fingerprint()
+{
+  bri_box("test_vary_fingerprint");
+
+  static struct
+  {
+    const char *vary;
+    const char *accept_encoding_a;
+    const char *user_agent_a;
+    const char *accept_encoding_b;
+    const char *user_agent_b;
+    bool same;
+  } test_cases[] = {
+    { "Accept-Encoding", "gzip, deflate", "a", "GZIP,deflate", "b", true },
+    { "Accept-Encoding", "gzip", "a", "deflate", "a", false },
+    { "Accept-Encoding", "gzip", "a", NULL, "a", false },
+    { "Accept-Encoding, User-Agent", "gzip", "a", "gzip", "b", false },
+    { "accept-encoding ,user-agent", "gzip", "Mozilla/5.0", "gzip", "mozilla/5.0", true },
+    { NULL, NULL, NULL, NULL, NULL, false }
+  };
+
+  int failures = 0;
+
+  for (int i = 0; test_cases[i].vary; i++) {
+    HTTPHdr resp, a, b;
+    resp.create(HTTP_TYPE_RESPONSE);
+    a.create(HTTP_TYPE_REQUEST);
+    b.create(HTTP_TYPE_REQUEST);
+    resp.value_set(MIME_FIELD_VARY, MIME_LEN_VARY, test_cases[i].vary, (int) strlen(test_cases[i].vary));
+    if (test_cases[i].accept_encoding_a)
+      a.value_set(MIME_FIELD_ACCEPT_ENCODING, MIME_LEN_ACCEPT_ENCODING, test_cases[i].accept_encoding_a,
+                  (int) strlen(test_cases[i].accept_encoding_a));
+    if (test_cases[i].accept_encoding_b)
+      b.value_set(MIME_FIELD_ACCEPT_ENCODING, MIME_LEN_ACCEPT_ENCODING, test_cases[i].accept_encoding_b,
+                  (int) strlen(test_cases[i].accept_encoding_b));
+    a.value_set(MIME_FIELD_USER_AGENT, MIME_LEN_USER_AGENT, test_cases[i].user_agent_a,
+                (int) strlen(test_cases[i].user_agent_a));
+    b.value_set(MIME_FIELD_USER_AGENT, MIME_LEN_USER_AGENT, test_cases[i].user_agent_b,
+                (int) strlen(test_cases[i].user_agent_b));
+
+    uint64_t fa = http_vary_fingerprint(&a, &resp);
+    uint64_t fb = http_vary_fingerprint(&b, &resp);
+    if (!fa || !fb || (fa == fb) != test_cases[i].same) {
+      printf("FAILED: (#%d) Vary: %s, fingerprints %" PRIx64 " %" PRIx64 ", expected %s\n",
+             i, test_cases[i].vary, fa, fb, test_cases[i].same ? "equal" : "different");
+      ++failures;
+    }
+    resp.destroy();
+    a.destroy();
+    b.destroy();
+  }
+
+  HTTPHdr resp, req;
+  resp.create(HTTP_TYPE_RESPONSE);
+  req.create(HTTP_TYPE_REQUEST);
+  resp.value_set(MIME_FIELD_VARY, MIME_LEN_VARY, "Accept-Encoding, *", 18);
+  if (http_vary_fingerprint(&req, &resp) != 0) {
+    printf("FAILED: Vary: * should have no fingerprint\n");
+    ++failures;
+  }
+  resp.destroy();
+  req.destroy();
+
+  return (failures_to_status("test_vary_fingerprint", failures));
+}
+
+// Bytes of the header's strings that were copied into its writable
+//   string heap rather than left in the buffer they were parsed from
+static int
+hdr_heap_copied_str_size(HdrHeap * heap)
+{
+  HdrStrHeap *rw = heap->m_read_write_heap;
+
+  return rw ? (int) (rw->m_heap_size - STR_HEAP_HDR_SIZE - rw->m_free_size) : 0;
+}
+
+int
+HdrTest::test_http_parse_iobuffer()
+{
+  static const char request[] =
+    "GET http://www.example.com/images/logo.png?size=large HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:10.0) Gecko/20100101 Firefox/10.0\r\n"
+    "Accept: image/png,image/*;q=0.8,*/*;q=0.5\r\n"
+    "Accept-Language: en-us,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Connection: keep-alive\r\n"
+    "Referer: http://www.example.com/index.html\r\n"
+    "Cookie: session=0123456789abcdef; theme=dark\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "\r\n";
+  static const int chunks[] = { 3, 7, 40, 64, 0 };
+  const int len = sizeof(request) - 1;
+  const int iterations = 100000;
+
+  int failures = 0;
+  HTTPParser parser;
+
+  bri_box("test_http_parse_iobuffer");
+
+  http_parser_init(&parser);
+
+  // Arriving a few bytes at a time into one block, nothing is copied
+  for (int c = 0; chunks[c] != 0; c++) {
+    HTTPHdr req_hdr;
+    MIOBuffer *buf = new_MIOBuffer(BUFFER_SIZE_INDEX_4K);
+    IOBufferReader *reader = buf->alloc_reader();
+    MIMEParseResult ret = PARSE_CONT;
+    int bytes_used, total_used = 0;
+
+    req_hdr.create(HTTP_TYPE_REQUEST);
+    http_parser_clear(&parser);
+
+    for (int off = 0; off < len && ret == PARSE_CONT; off += chunks[c]) {
+      buf->write(request + off, min(chunks[c], len - off));
+      ret = req_hdr.parse_req(&parser, reader, &bytes_used, false);
+      total_used += bytes_used;
+    }
+
+    int host_len, ua_len;
+    const char *host = req_hdr.url_get()->host_get(&host_len);
+    const char *ua = req_hdr.value_get(MIME_FIELD_USER_AGENT, MIME_LEN_USER_AGENT, &ua_len);
+    if (ret != PARSE_DONE || total_used != len || req_hdr.method_get_wksidx() != HTTP_WKSIDX_GET ||
+        !host || host_len != 15 || memcmp(host, "www.example.com", 15) ||
+        !ua || ua_len != 68 || memcmp(ua, "Mozilla/5.0", 11) || req_hdr.fields_count() != 10) {
+      printf("FAILED: %d byte chunks, result %d, %d of %d bytes used\n", chunks[c], ret, total_used, len);
+      ++failures;
+    } else if (hdr_heap_copied_str_size(req_hdr.m_heap) != 0) {
+      printf("FAILED: %d byte chunks, %d bytes of strings copied\n", chunks[c],
+             hdr_heap_copied_str_size(req_hdr.m_heap));
+      ++failures;
+    }
+
+    req_hdr.destroy();
+    free_MIOBuffer(buf);
+  }
+
+  // A header larger than a block, read the way the net read fills the
+  // buffer: only into the room write_avail() gives, with no water mark.
+  // A partial line left in a full block would keep the buffer from ever
+  // getting another block.
+  static const int big_chunks[] = { 7, 100, 1000, 0 };
+  char big[2048];
+  int big_len = snprintf(big, sizeof(big), "GET http://www.example.com/ HTTP/1.1\r\nHost: www.example.com\r\nCookie: ");
+  int cookie_start = big_len;
+  while (big_len < 1500) {
+    big[big_len] = 'a' + big_len % 26;
+    big_len++;
+  }
+  int cookie_len = big_len - cookie_start;
+  big_len += snprintf(big + big_len, sizeof(big) - big_len, "\r\nAccept: */*\r\n\r\n");
+
+  for (int c = 0; big_chunks[c] != 0; c++) {
+    HTTPHdr req_hdr;
+    MIOBuffer *buf = new_MIOBuffer(BUFFER_SIZE_INDEX_128);
+    IOBufferReader *reader = buf->alloc_reader();
+    MIMEParseResult ret = PARSE_CONT;
+    int bytes_used, total_used = 0;
+    int off = 0;
+
+    req_hdr.create(HTTP_TYPE_REQUEST);
+    http_parser_clear(&parser);
+
+    while (off < big_len && ret == PARSE_CONT) {
+      int64_t room = buf->write_avail();
+      if (room <= 0) {
+        break;
+      }
+      int n = (int) min((int64_t) min(big_chunks[c], big_len - off), room);
+      buf->write(big + off, n);
+      off += n;
+      ret = req_hdr.parse_req(&parser, reader, &bytes_used, false);
+      total_used += bytes_used;
+    }
+
+    int value_len;
+    const char *value = req_hdr.value_get(MIME_FIELD_COOKIE, MIME_LEN_COOKIE, &value_len);
+    if (ret != PARSE_DONE || total_used != big_len || !value || value_len != cookie_len ||
+        memcmp(value, big + cookie_start, cookie_len) || req_hdr.fields_count() != 3) {
+      printf("FAILED: %d byte header in 128 byte blocks, %d byte chunks, result %d, %d of %d bytes read, %d used\n",
+             big_len, big_chunks[c], ret, off, big_len, total_used);
+      ++failures;
+    }
+
+    req_hdr.destroy();
+    free_MIOBuffer(buf);
+  }
+
+  // Parse cost against the string parser, which copies every string
+  ink_hrtime buf_time = 0, str_time = 0;
+  int buf_copied = 0, str_copied = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    ink_hrtime start = ink_get_hrtime_internal();
+    for (int i = 0; i < iterations; i++) {
+      HTTPHdr req_hdr;
+      MIMEParseResult ret;
+
+      req_hdr.create(HTTP_TYPE_REQUEST);
+      http_parser_clear(&parser);
+      if (pass == 0) {
+        MIOBuffer *buf = new_MIOBuffer(BUFFER_SIZE_INDEX_4K);
+        IOBufferReader *reader = buf->alloc_reader();
+        int bytes_used;
+
+        buf->write(request, len);
+        ret = req_hdr.parse_req(&parser, reader, &bytes_used, false);
+        buf_copied = hdr_heap_copied_str_size(req_hdr.m_heap);
+        req_hdr.destroy();
+        free_MIOBuffer(buf);
+      } else {
+        const char *s = request;
+
+        ret = req_hdr.parse_req(&parser, &s, s + len, false);
+        str_copied = hdr_heap_copied_str_size(req_hdr.m_heap);
+        req_hdr.destroy();
+      }
+      if (ret != PARSE_DONE) {
+        ++failures;
+        break;
+      }
+    }
+    (pass == 0 ? buf_time : str_time) = ink_get_hrtime_internal() - start;
+  }
+  printf("    %d parses, %d byte request: from IOBuffer %" PRId64 " ns/parse, %d bytes copied;"
+         " from string %" PRId64 " ns/parse, %d bytes copied\n",
+         iterations, len, (int64_t)(buf_time / iterations), buf_copied, (int64_t)(str_time / iterations), str_copied);
+
+  return (failures_to_status("test_http_parse_iobuffer", failures));
+}
+
+/*-------------------------------------------------------------------------
+  Checks that an alt unmarshalled lazily reads back the same as a fully
+  unmarshalled one and reports the cost of each on a cache hit (find
+  the alt, look at the response status and a header).
+  -------------------------------------------------------------------------*/
+
+int
+HdrTest::test_http_info_lazy_unmarshal()
+{
+  bri_box("test_http_info_lazy_unmarshal");
+
+  static const char *req_fields[][2] = {
+    { "Host", "www.example.com" },
+    { "User-Agent", "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)" },
+    { "Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8" },
+    { "Accept-Encoding", "gzip, deflate" },
+    { "Accept-Language", "en-US,en;q=0.5" },
+    { "Cookie", "session=0123456789abcdef; prefs=compact" },
+    { NULL, NULL }
+  };
+  static const char *resp_fields[][2] = {
+    { "Date", "Mon, 15 Apr 2013 18:00:00 GMT" },
+    { "Server", "Apache" },
+    { "Last-Modified", "Mon, 15 Apr 2013 12:00:00 GMT" },
+    { "ETag", "\"4a2f-54c-4d9a1b2c\"" },
+    { "Cache-Control", "max-age=3600, public" },
+    { "Content-Type", "text/html; charset=UTF-8" },
+    { "Content-Length", "1356" },
+    { "Vary", "Accept-Encoding" },
+    { NULL, NULL }
+  };
+  static const char url[] = "http://www.example.com/index.html?a=1";
+  const int iterations = 10000;
+
+  int failures = 0;
+  HTTPHdr req, resp;
+  HTTPInfo info;
+
+  req.create(HTTP_TYPE_REQUEST);
+  req.method_set(HTTP_METHOD_GET, HTTP_LEN_GET);
+  req.url_set(url, sizeof(url) - 1);
+  req.version_set(HTTPVersion(1, 1));
+  for (int i = 0; req_fields[i][0]; i++)
+    req.value_set(req_fields[i][0], strlen(req_fields[i][0]), req_fields[i][1], strlen(req_fields[i][1]));
+  resp.create(HTTP_TYPE_RESPONSE);
+  resp.status_set(HTTP_STATUS_OK);
+  resp.version_set(HTTPVersion(1, 1));
+  for (int i = 0; resp_fields[i][0]; i++)
+    resp.value_set(resp_fields[i][0], strlen(resp_fields[i][0]), resp_fields[i][1], strlen(resp_fields[i][1]));
+
+  info.create();
+  info.request_set(&req);
+  info.response_set(&resp);
+  int len = info.marshal_length();
+  char *image = (char *)ats_malloc(len);
+  char *work = (char *)ats_malloc(len);
+  len = info.marshal(image, len);
+
+  // Same contents either way
+  HTTPInfo full, lazy;
+  char *full_buf = (char *)ats_malloc(len);
+  memcpy(full_buf, image, len);
+  memcpy(work, image, len);
+  int full_len = HTTPInfo::unmarshal(full_buf, len, NULL);
+  int lazy_len = HTTPInfo::unmarshal_lazy(work, len, NULL);
+  if (full_len <= 0 || full_len != lazy_len || full.get_handle(full_buf, len) < 0 || lazy.get_handle(work, len) < 0) {
+    printf("FAILED: unmarshal lengths full %d lazy %d\n", full_len, lazy_len);
+    ++failures;
+  } else {
+    int full_ct_len, lazy_ct_len;
+    const char *full_ct = full.response_get()->value_get(MIME_FIELD_CONTENT_TYPE, MIME_LEN_CONTENT_TYPE, &full_ct_len);
+    const char *lazy_ct = lazy.response_get()->value_get(MIME_FIELD_CONTENT_TYPE, MIME_LEN_CONTENT_TYPE, &lazy_ct_len);
+    if (lazy.m_alt->m_magic != CACHE_ALT_MAGIC_LAZY || lazy.m_alt->m_request_hdr.m_http ||
+        lazy.m_alt->m_response_busy) {
+      printf("FAILED: request header swizzled before it was asked for\n");
+      ++failures;
+    }
+    if (full.response_get()->status_get() != lazy.response_get()->status_get() ||
+        !full_ct || !lazy_ct || full_ct_len != lazy_ct_len || memcmp(full_ct, lazy_ct, full_ct_len)) {
+      printf("FAILED: lazy response differs\n");
+      ++failures;
+    }
+    int full_host_len, lazy_host_len;
+    const char *full_host = full.request_url_get()->host_get(&full_host_len);
+    const char *lazy_host = lazy.request_url_get()->host_get(&lazy_host_len);
+    if (lazy.m_alt->m_magic != CACHE_ALT_MAGIC_ALIVE || !full_host || !lazy_host ||
+        full_host_len != lazy_host_len || memcmp(full_host, lazy_host, full_host_len)) {
+      printf("FAILED: lazy request differs\n");
+      ++failures;
+    }
+  }
+
+  // Hit path cost
+  ink_hrtime full_time = 0, lazy_time = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    ink_hrtime start = ink_get_hrtime_internal();
+    for (int i = 0; i < iterations; i++) {
+      HTTPInfo hit;
+      int ct_len;
+      memcpy(work, image, len);
+      if (pass == 0)
+        HTTPInfo::unmarshal(work, len, NULL);
+      else
+        HTTPInfo::unmarshal_lazy(work, len, NULL);
+      hit.get_handle(work, len);
+      if (hit.response_get()->status_get() != HTTP_STATUS_OK ||
+          !hit.response_get()->value_get(MIME_FIELD_CONTENT_TYPE, MIME_LEN_CONTENT_TYPE, &ct_len)) {
+        ++failures;
+        break;
+      }
+    }
+    (pass == 0 ? full_time : lazy_time) = ink_get_hrtime_internal() - start;
+  }
+  printf("    %d hits, %d byte alt: full unmarshal %" PRId64 " ns/hit, lazy %" PRId64 " ns/hit\n",
+         iterations, len, (int64_t)(full_time / iterations), (int64_t)(lazy_time / iterations));
+
+  ats_free(full_buf);
+  ats_free(work);
+  ats_free(image);
+  info.destroy();
+  req.destroy();
+  resp.destroy();
+
+  return (failures_to_status("test_http_info_lazy_unmarshal", failures));
+}
+
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 
@@ -57,10 +57,13 @@ private:
   int test_format_date();
   int test_url();
   int test_http_parser_eos_boundary_cases();
+  int test_http_parse_iobuffer();
   int test_arena();
   int test_regex();
   int test_accept_language_match();
   int test_accept_charset_match();
+  int test_vary_fingerprint();
+  int test_http_info_lazy_unmarshal();
   int test_comma_vals();
   int test_set_comma_vals();
   int test_delete_comma_vals();
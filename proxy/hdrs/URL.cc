@@ -1635,25 +1635,77 @@ memcpy_tolower(char *d, const char *s, int n)
 }
 
 
+union URLHashContext
+{
+  INK_DIGEST_CTX md5_ctx;
+  MMH_CTX mmh_ctx;
+  MURMUR3_CTX murmur3_ctx;
+};
+
+// The hash is picked by url_hash_method once, at startup; anything
+// unknown falls back to MMH, as it always has
+
+static inline void
+url_hash_init(URLHashContext * context)
+{
+  switch (url_hash_method) {
+  case URL_HASH_MD5:
+    ink_code_incr_md5_init(&context->md5_ctx);
+    break;
+  case URL_HASH_MURMUR3:
+    ink_code_incr_murmur3_init(&context->murmur3_ctx);
+    break;
+  default:
+    ink_code_incr_MMH_init(&context->mmh_ctx);
+    break;
+  }
+}
+
+static inline void
+url_hash_update(URLHashContext * context, const char *input, int input_length)
+{
+  switch (url_hash_method) {
+  case URL_HASH_MD5:
+    ink_code_incr_md5_update(&context->md5_ctx, input, input_length);
+    break;
+  case URL_HASH_MURMUR3:
+    ink_code_incr_murmur3_update(&context->murmur3_ctx, input, input_length);
+    break;
+  default:
+    ink_code_incr_MMH_update(&context->mmh_ctx, input, input_length);
+    break;
+  }
+}
+
+static inline void
+url_hash_final(INK_MD5 * md5, URLHashContext * context)
+{
+  switch (url_hash_method) {
+  case URL_HASH_MD5:
+    ink_code_incr_md5_final((char *) md5, &context->md5_ctx);
+    break;
+  case URL_HASH_MURMUR3:
+    ink_code_incr_murmur3_final((char *) md5, &context->murmur3_ctx);
+    break;
+  default:
+    ink_code_incr_MMH_final((char *) md5, &context->mmh_ctx);
+    break;
+  }
+}
+
+
 #define BUFSIZE 512
 
-// fast path for MMH, HTTP, no user/password/params/query,
+// fast path for HTTP, no user/password/params/query,
 // no buffer overflow, no unescaping needed
 
 static inline void
-url_MMH_get_fast(URLImpl * url, INK_MD5 * md5)
+url_MD5_get_fast(URLImpl * url, INK_MD5 * md5)
 {
-  union
-  {
-    INK_DIGEST_CTX md5_ctx;
-    MMH_CTX mmh_ctx;
-  } context;
-
+  URLHashContext context;
   char buffer[BUFSIZE];
   char *p;
 
-  ink_code_incr_MMH_init(&context.mmh_ctx);
-
   p = buffer;
   memcpy_tolower(p, url->m_ptr_scheme, url->m_len_scheme);
   p += url->m_len_scheme;
@@ -1679,20 +1731,16 @@ url_MMH_get_fast(URLImpl * url, INK_MD5 * md5)
   *p++ = ((char *) &port)[0];
   *p++ = ((char *) &port)[1];
 
-  ink_code_incr_MMH_update(&context.mmh_ctx, buffer, p - buffer);
-  ink_code_incr_MMH_final((char *) md5, &context.mmh_ctx);
+  url_hash_init(&context);
+  url_hash_update(&context, buffer, p - buffer);
+  url_hash_final(md5, &context);
 }
 
 
 static inline void
 url_MD5_get_general(URLImpl * url, INK_MD5 * md5)
 {
-  union
-  {
-    INK_DIGEST_CTX md5_ctx;
-    MMH_CTX mmh_ctx;
-  } context;
-
+  URLHashContext context;
   char buffer[BUFSIZE];
   char *p, *e;
   const char *strs[13], *ends[13];
@@ -1732,11 +1780,7 @@ url_MD5_get_general(URLImpl * url, INK_MD5 * md5)
   p = buffer;
   e = buffer + BUFSIZE;
 
-  if (url_hash_method == 0) {
-    ink_code_incr_md5_init(&context.md5_ctx);
-  } else {
-    ink_code_incr_MMH_init(&context.mmh_ctx);
-  }
+  url_hash_init(&context);
 
   for (i = 0; i < 13; i++) {
     if (strs[i]) {
@@ -1751,11 +1795,7 @@ url_MD5_get_general(URLImpl * url, INK_MD5 * md5)
         }
 
         if (p == e) {
-          if (url_hash_method == 0) {
-            ink_code_incr_md5_update(&context.md5_ctx, buffer, BUFSIZE);
-          } else {
-            ink_code_incr_MMH_update(&context.mmh_ctx, buffer, BUFSIZE);
-          }
+          url_hash_update(&context, buffer, BUFSIZE);
           p = buffer;
         }
       }
@@ -1763,22 +1803,13 @@ url_MD5_get_general(URLImpl * url, INK_MD5 * md5)
   }
 
   if (p != buffer) {
-    if (url_hash_method == 0) {
-      ink_code_incr_md5_update(&context.md5_ctx, buffer, p - buffer);
-    } else {
-      ink_code_incr_MMH_update(&context.mmh_ctx, buffer, p - buffer);
-    }
+    url_hash_update(&context, buffer, p - buffer);
   }
 
   port = url_canonicalize_port(url->m_url_type, url->m_port);
 
-  if (url_hash_method == 0) {
-    ink_code_incr_md5_update(&context.md5_ctx, (char *) &port, sizeof(port));
-    ink_code_incr_md5_final((char *) md5, &context.md5_ctx);
-  } else {
-    ink_code_incr_MMH_update(&context.mmh_ctx, (char *) &port, sizeof(port));
-    ink_code_incr_MMH_final((char *) md5, &context.mmh_ctx);
-  }
+  url_hash_update(&context, (char *) &port, sizeof(port));
+  url_hash_final(md5, &context);
 }
 
 
@@ -1787,8 +1818,9 @@ url_MD5_get_general(URLImpl * url, INK_MD5 * md5)
 void
 url_MD5_get(URLImpl * url, INK_MD5 * md5)
 {
-  if ((url_hash_method != 0) &&
-      (url->m_url_type == URL_TYPE_HTTP) &&
+  // The fast path feeds the hash the same bytes as the general one,
+  // so it serves every hash method
+  if ((url->m_url_type == URL_TYPE_HTTP) &&
       ((url->m_len_user + url->m_len_password + url->m_len_params + url->m_len_query) == 0) &&
       (3 + 1 + 1 + 1 + 1 + 1 + 2 +
        url->m_len_scheme +
@@ -1796,7 +1828,7 @@ url_MD5_get(URLImpl * url, INK_MD5 * md5)
        url->m_len_path < BUFSIZE) &&
       (memchr(url->m_ptr_host, '%', url->m_len_host) == NULL) &&
       (memchr(url->m_ptr_path, '%', url->m_len_path) == NULL)) {
-    url_MMH_get_fast(url, md5);
+    url_MD5_get_fast(url, md5);
 
 #ifdef DEBUG
     INK_MD5 md5_general;
@@ -1816,53 +1848,24 @@ url_MD5_get(URLImpl * url, INK_MD5 * md5)
 void
 url_host_MD5_get(URLImpl * url, INK_MD5 * md5)
 {
-  union
-  {
-    INK_DIGEST_CTX md5_ctx;
-    MMH_CTX mmh_ctx;
-  } context;
-
-  if (url_hash_method == 0) {
-    ink_code_incr_md5_init(&context.md5_ctx);
-  } else {
-    ink_code_incr_MMH_init(&context.mmh_ctx);
-  }
+  URLHashContext context;
+
+  url_hash_init(&context);
 
   if (url->m_ptr_scheme) {
-    if (url_hash_method == 0) {
-      ink_code_incr_md5_update(&context.md5_ctx, url->m_ptr_scheme, url->m_len_scheme);
-    } else {
-      ink_code_incr_MMH_update(&context.mmh_ctx, url->m_ptr_scheme, url->m_len_scheme);
-    }
+    url_hash_update(&context, url->m_ptr_scheme, url->m_len_scheme);
   }
 
-  if (url_hash_method == 0) {
-    ink_code_incr_md5_update(&context.md5_ctx, "://", 3);
-  } else {
-    ink_code_incr_MMH_update(&context.mmh_ctx, "://", 3);
-  }
+  url_hash_update(&context, "://", 3);
 
   if (url->m_ptr_host) {
-    if (url_hash_method == 0) {
-      ink_code_incr_md5_update(&context.md5_ctx, url->m_ptr_host, url->m_len_host);
-    } else {
-      ink_code_incr_MMH_update(&context.mmh_ctx, url->m_ptr_host, url->m_len_host);
-    }
+    url_hash_update(&context, url->m_ptr_host, url->m_len_host);
   }
 
-  if (url_hash_method == 0) {
-    ink_code_incr_md5_update(&context.md5_ctx, ":", 1);
-  } else {
-    ink_code_incr_MMH_update(&context.mmh_ctx, ":", 1);
-  }
+  url_hash_update(&context, ":", 1);
 
   int port = url_canonicalize_port(url->m_url_type, url->m_port);
 
-  if (url_hash_method == 0) {
-    ink_code_incr_md5_update(&context.md5_ctx, (char *) &port, sizeof(port));
-    ink_code_incr_md5_final((char *) md5, &context.md5_ctx);
-  } else {
-    ink_code_incr_MMH_update(&context.mmh_ctx, (char *) &port, sizeof(port));
-    ink_code_incr_MMH_final((char *) md5, &context.mmh_ctx);
-  }
+  url_hash_update(&context, (char *) &port, sizeof(port));
+  url_hash_final(md5, &context);
 }
@@ -147,7 +147,14 @@ extern int URL_LEN_MMS;
 extern int URL_LEN_MMSU;
 extern int URL_LEN_MMST;
 
-/* 0 = INK_MD5, 1 = MMH */
+/* Cache key hash, proxy.config.cache.url_hash_method */
+enum URLHashMethod
+{
+  URL_HASH_MD5 = 0,
+  URL_HASH_MMH = 1,
+  URL_HASH_MURMUR3 = 2
+};
+
 extern int url_hash_method;
 
 
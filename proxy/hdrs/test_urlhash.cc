@@ -33,6 +33,7 @@
 #include "Resource.h"
 #include "URL.h"
 #include "HttpCompat.h"
+#include "ink_hrtime.h"
 
 static void
 test_url()
@@ -77,6 +78,72 @@ test_url()
   printf("*** %s ***\n", (failed ? "FAILED" : "PASSED"));
 }
 
+static void
+test_murmur3()
+{
+  // reference value of MurmurHash3_x64_128 with seed 0
+  static const unsigned char expected[16] = {
+    0x6c, 0x1b, 0x07, 0xbc, 0x7b, 0xbc, 0x4b, 0xe3,
+    0x47, 0x93, 0x9a, 0xc4, 0xa9, 0x3c, 0x43, 0x7a
+  };
+  const char *str = "The quick brown fox jumps over the lazy dog";
+  int len = strlen(str);
+  unsigned char hash[16], incr_hash[16];
+  MURMUR3_CTX ctx;
+  int i, failed;
+
+  ink_code_murmur3((unsigned char *) str, len, hash);
+  failed = memcmp(hash, expected, sizeof(hash)) != 0;
+
+  // the same in pieces that do not line up with the 16 byte blocks
+  ink_code_incr_murmur3_init(&ctx);
+  for (i = 0; i < len; i += 5) {
+    ink_code_incr_murmur3_update(&ctx, str + i, (len - i < 5) ? len - i : 5);
+  }
+  ink_code_incr_murmur3_final((char *) incr_hash, &ctx);
+  failed = failed || memcmp(incr_hash, expected, sizeof(incr_hash)) != 0;
+
+  printf("*** murmur3 %s ***\n", (failed ? "FAILED" : "PASSED"));
+}
+
+static void
+bench_url_hash()
+{
+  static const char *strs[] = {
+    "http://npdev:19080/1.6664000000/4000",
+    "http://www.example.com/images/2012/logo-small.png",
+    "http://static.cdn.example.net/js/jquery.min.js?v=1.7.2",
+    "http://Media.Example.COM/video/a%20b/segment-00042.ts"
+  };
+  static const char *methods[] = { "MD5", "MMH", "Murmur3" };
+  static int nstrs = sizeof(strs) / sizeof(strs[0]);
+  const int iterations = 1000000;
+  URL urls[sizeof(strs) / sizeof(strs[0])];
+  const char *start;
+  INK_MD5 md5;
+  int i, j, m;
+
+  for (i = 0; i < nstrs; i++) {
+    start = strs[i];
+    urls[i].create(NULL);
+    urls[i].parse(&start, start + strlen(strs[i]));
+  }
+
+  for (m = URL_HASH_MD5; m <= URL_HASH_MURMUR3; m++) {
+    url_hash_method = m;
+    ink_hrtime begin = ink_get_hrtime_internal();
+    for (j = 0; j < iterations; j++) {
+      urls[j % nstrs].MD5_get(&md5);
+    }
+    ink_hrtime elapsed = ink_get_hrtime_internal() - begin;
+    printf("%-8s %.1f ns per url\n", methods[m], (double) elapsed / iterations);
+  }
+
+  for (i = 0; i < nstrs; i++) {
+    urls[i].destroy();
+  }
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -86,6 +153,8 @@ main(int argc, char *argv[])
   http_init();
 
   test_url();
+  test_murmur3();
+  bench_url_hash();
 
   return 0;
 }
@@ -60,6 +60,7 @@
 
 
 RecRawStatBlock *http_rsb;
+RecRawStatBlock *http_histograms[http_histogram_count];
 #define HTTP_CLEAR_DYN_STAT(x) \
 do { \
 	RecSetRawStatSum(http_rsb, x, 0); \
@@ -842,6 +843,14 @@ register_stat_callbacks()
                      "proxy.process.http.cache_read_errors",
                      RECD_INT, RECP_NULL, (int) http_cache_read_errors, RecRawStatSyncSum);
 
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.range_cache_read_bytes",
+                     RECD_INT, RECP_NULL, (int) http_range_cache_read_bytes_stat, RecRawStatSyncSum);
+
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.range_user_agent_bytes",
+                     RECD_INT, RECP_NULL, (int) http_range_user_agent_bytes_stat, RecRawStatSyncSum);
+
   ////////////////////////////////////////////////////////////////////////////////
   // status code counts
   ////////////////////////////////////////////////////////////////////////////////
@@ -1141,6 +1150,26 @@ register_stat_callbacks()
                      RECD_FLOAT, RECP_NULL,
                      (int) http_server_first_response_time_stat, RecRawStatSyncIntMsecsToFloatSeconds);
 
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.hoturls.replica_hits",
+                     RECD_COUNTER, RECP_NULL, (int) http_hot_url_replica_hits_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.hoturls.replica_bytes_saved",
+                     RECD_INT, RECP_NULL, (int) http_hot_url_replica_bytes_stat, RecRawStatSyncSum);
+
+  // Latency histograms
+  static const char *histogram_names[http_histogram_count] = {
+    "proxy.process.http.latency.ttfb_us",
+    "proxy.process.http.latency.cache_lookup_us",
+    "proxy.process.http.latency.dns_lookup_us",
+    "proxy.process.http.latency.origin_connect_us",
+    "proxy.process.http.latency.total_us"
+  };
+
+  for (int i = 0; i < http_histogram_count; i++) {
+    http_histograms[i] = RecAllocateRawStatHistogram();
+    RecRegisterRawStatHistogram(http_histograms[i], RECT_PROCESS, histogram_names[i], RECP_NON_PERSISTENT);
+  }
 }
 
 
@@ -302,6 +302,10 @@ enum
   http_cache_write_errors,
   http_cache_read_errors,
 
+  // Range hits: body bytes read from cache and sent to the client
+  http_range_cache_read_bytes_stat,
+  http_range_user_agent_bytes_stat,
+
   // status code stats
   http_response_status_100_count_stat,
   http_response_status_101_count_stat,
@@ -348,12 +352,30 @@ enum
   http_response_status_505_count_stat,
   http_response_status_5xx_count_stat,
 
+  // Responses served from a hot url copy diffused from its owner
+  http_hot_url_replica_hits_stat,
+  http_hot_url_replica_bytes_stat,
+
   http_stat_count
 };
 
 extern RecRawStatBlock *http_rsb;
 extern volatile int g_current_active_client_connections;
 
+// Latency histograms over the transaction milestones, in microseconds
+enum HttpLatencyHistogram_t
+{
+  http_ttfb_histogram,              // ua_begin -> ua_begin_write
+  http_cache_lookup_histogram,      // cache_open_read_begin -> cache_open_read_end
+  http_dns_lookup_histogram,        // dns_lookup_begin -> dns_lookup_end
+  http_origin_connect_histogram,    // server_connect -> server_connect_end
+  http_total_histogram,             // sm_start -> sm_finish
+
+  http_histogram_count
+};
+
+extern RecRawStatBlock *http_histograms[http_histogram_count];
+
 /* Stats should only be accessed using these macros */
 #define HTTP_INCREMENT_DYN_STAT(x) RecIncrRawStat(http_rsb, mutex->thread_holding, (int) x, 1)
 #define HTTP_DECREMENT_DYN_STAT(x) RecIncrRawStat(http_rsb, mutex->thread_holding, (int) x, -1)
@@ -368,6 +390,7 @@ do { \
 
 #define HTTP_READ_DYN_SUM(x, S) RecGetRawStatSum(http_rsb, (int)x, &S) // This aggregates threads too
 #define HTTP_READ_GLOBAL_DYN_SUM(x, S) RecGetGlobalRawStatSum(http_rsb, (int)x, &S)
+#define HTTP_RECORD_LATENCY(x, t) RecIncrRawStatHistogram(http_histograms[x], mutex->thread_holding, ink_hrtime_to_usec(t))
 
 #define HTTP_ConfigReadInteger         REC_ConfigReadInteger
 #define HTTP_ConfigReadString          REC_ConfigReadString
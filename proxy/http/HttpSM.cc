@@ -1078,12 +1078,12 @@ HttpSM::state_raw_http_server_open(int event, void *data)
 {
   STATE_ENTER(&HttpSM::state_raw_http_server_open, event);
   ink_assert(server_entry == NULL);
-  // milestones.server_connect_end = ink_get_hrtime();
   NetVConnection *netvc = NULL;
 
   pending_action = NULL;
   switch (event) {
   case NET_EVENT_OPEN:
+    milestones.server_connect_end = ink_get_hrtime();
 
     if (t_state.pCongestionEntry != NULL) {
       t_state.pCongestionEntry->connection_opened();
@@ -1631,11 +1631,11 @@ HttpSM::state_http_server_open(int event, void *data)
   // TODO decide whether to uncomment after finish testing redirect
   // ink_assert(server_entry == NULL);
   pending_action = NULL;
-  // milestones.server_connect_end = ink_get_hrtime();
   HttpServerSession *session;
 
   switch (event) {
   case NET_EVENT_OPEN:
+    milestones.server_connect_end = ink_get_hrtime();
     session = (2 == t_state.txn_conf->share_server_sessions) ? 
       THREAD_ALLOC_INIT(httpServerSessionAllocator, mutex->thread_holding) :
       httpServerSessionAllocator.alloc();
@@ -2073,6 +2073,40 @@ HttpSM::process_srv_info(HostDBInfo * r)
   return;
 }
 
+// Passes over round robin members whose health check failed or which
+// were ejected, and with latency_weighted picks among the rest by their
+// response latency. Keeps best when none of the others is any better.
+static HostDBInfo *
+origin_health_select_rr(HostDBRoundRobin * rr, HostDBInfo * best, int port, int32_t now)
+{
+  OriginHealth *candidates[HOST_DB_MAX_ROUND_ROBIN_INFO];
+  int index[HOST_DB_MAX_ROUND_ROBIN_INFO];
+  int n = 0;
+
+  if (!OriginHealthConfig::enabled || originHealthTable == NULL) {
+    return best;
+  }
+  if (!OriginHealthConfig::latency_weighted &&
+      (best == NULL || !origin_health_down(OriginHealthTable::make_key(best->ip(), port), now))) {
+    return best;
+  }
+
+  for (int i = 0; i < rr->good && n < HOST_DB_MAX_ROUND_ROBIN_INFO; i++) {
+    uint64_t key = OriginHealthTable::make_key(rr->info[i].ip(), port);
+    if (!origin_health_down(key, now)) {
+      candidates[n] = originHealthTable->lookup(key);
+      index[n++] = i;
+    }
+  }
+  if (n == 0) {
+    return best;
+  }
+  if (!OriginHealthConfig::latency_weighted) {
+    return &rr->info[index[this_ethread()->generator.random() % n]];
+  }
+  return &rr->info[index[origin_health_pick(candidates, n, (uint32_t) this_ethread()->generator.random())]];
+}
+
 void
 HttpSM::process_hostdb_info(HostDBInfo * r)
 {
@@ -2095,7 +2129,7 @@ HttpSM::process_hostdb_info(HostDBInfo * r)
           if ((entry = find_entry(hostname)) != NULL) {
             for (int i = 0; i < rr->good; ++i) {
               HCSM *hcsm = HCSM::allocate();
-              hcsm->init(entry, &rr->info[i]);
+              hcsm->init(entry, &rr->info[i], false);
               eventProcessor.schedule_imm(hcsm, ET_TASK);
             }
           }
@@ -2106,6 +2140,8 @@ HttpSM::process_hostdb_info(HostDBInfo * r)
         ink_debug_assert(r->md5_high == ret->md5_high && r->md5_low == ret->md5_low &&
                 r->md5_low_low == ret->md5_low_low);
       }
+      ret = origin_health_select_rr(rr, ret, t_state.current.server ? t_state.current.server->port : t_state.server_info.port,
+                                    (int32_t) ink_cluster_time());
     } else {
       ret = r;
       t_state.dns_info.round_robin = false;
@@ -4135,6 +4171,14 @@ HttpSM::do_range_setup_if_necessary(bool from_server)
           return;
         } else if (from_server)
           t_state.api_info.cache_untransformed = true;
+        else if (cache_sm.cache_read_vc->is_pread_capable()) {
+          // multiple ranges: don't read the object before the first range
+          // or after the last one from disk
+          t_state.range_in_cache = true;
+          t_state.single_range._start = range_trans->m_ranges[0]._start;
+          t_state.single_range._end = range_trans->m_ranges[range_trans->m_num_range_fields - 1]._end;
+          range_trans->set_input_offset(t_state.single_range._start);
+        }
         api_hooks.append(TS_HTTP_RESPONSE_TRANSFORM_HOOK, range_trans);
         t_state.range_setup = HttpTransact::RANGE_TRANSFORM;
       } else if (res)
@@ -4406,6 +4450,16 @@ HttpSM::do_http_server_open(bool raw)
       CONGEST_INCREMENT_DYN_STAT(congested_on_M_stat);
       handleEvent(CONGESTION_EVENT_CONGESTED_ON_M, NULL);
       return;
+    } else if (t_state.current.request_to == HttpTransact::PARENT_PROXY && t_state.parent_result.rec != NULL &&
+               origin_health_refuse_parent(t_state.current.server->name, t_state.current.server->port,
+                                           t_state.parent_result.rec->num_parents, t_state.parent_result.rec->bypass_ok(),
+                                           (int32_t) ink_hrtime_to_sec(milestones.server_connect))) {
+      // A down parent is handled as one congested on failures, the next parent or the origin is tried
+      t_state.congestion_congested_or_failed = 1;
+      t_state.pCongestionEntry->stat_inc_F();
+      CONGEST_INCREMENT_DYN_STAT(congested_on_H_stat);
+      handleEvent(CONGESTION_EVENT_CONGESTED_ON_F, NULL);
+      return;
     }
   }
   // If this is not a raw connection, we try to get a session from the
@@ -5649,7 +5703,10 @@ HttpSM::setup_cache_transfer_to_transform()
   // grab this here
   cache_response_hdr_bytes = t_state.hdr_info.cache_response.length_get();
 
-  doc_size = t_state.cache_info.object_read->object_size_get();
+  if (t_state.range_in_cache) {
+    doc_size = t_state.single_range._end - t_state.single_range._start + 1;
+  } else
+    doc_size = t_state.cache_info.object_read->object_size_get();
   alloc_index = buffer_size_to_index(doc_size);
   MIOBuffer *buf = new_MIOBuffer(alloc_index);
   IOBufferReader *buf_start = buf->alloc_reader();
@@ -6388,6 +6445,19 @@ HttpSM::kill_this()
 
             HotUrlStats::incSendBytes(cache_url, length, write_bytes);
           }
+
+          // A hit on a copy diffused from a remote owner saves pulling
+          // the body across the cluster
+          if (HotUrlStats::enabled() && !t_state.txn_conf->cache_cluster_cache_local &&
+              t_state.cache_control.cluster_cache_local == CACHE_CONTROL_LOCAL &&
+              t_state.source == HttpTransact::SOURCE_CACHE) {
+            INK_MD5 cache_key;
+            t_state.cache_info.lookup_url->MD5_get(&cache_key);
+            if (!cacheProcessor.belong_to_me(&cache_key)) {
+              HTTP_INCREMENT_DYN_STAT(http_hot_url_replica_hits_stat);
+              HTTP_SUM_DYN_STAT(http_hot_url_replica_bytes_stat, client_response_body_bytes);
+            }
+          }
         }
       }
     }
@@ -6515,6 +6585,28 @@ HttpSM::update_stats()
                                            server_response_body_bytes,
                                            pushed_response_hdr_bytes,
                                            pushed_response_body_bytes, t_state.cache_info.action);
+
+  HTTP_RECORD_LATENCY(http_total_histogram, total_time);
+  if (cache_lookup_time >= 0) {
+    HTTP_RECORD_LATENCY(http_cache_lookup_histogram, cache_lookup_time);
+  }
+  if (milestones.ua_begin != 0 && milestones.ua_begin_write >= milestones.ua_begin) {
+    HTTP_RECORD_LATENCY(http_ttfb_histogram, milestones.ua_begin_write - milestones.ua_begin);
+  }
+  if (milestones.dns_lookup_begin != 0 && milestones.dns_lookup_end >= milestones.dns_lookup_begin) {
+    HTTP_RECORD_LATENCY(http_dns_lookup_histogram, milestones.dns_lookup_end - milestones.dns_lookup_begin);
+  }
+  if (milestones.server_connect != 0 && milestones.server_connect_end >= milestones.server_connect) {
+    HTTP_RECORD_LATENCY(http_origin_connect_histogram, milestones.server_connect_end - milestones.server_connect);
+  }
+
+  // range hits: how much was read from cache vs. sent to the client
+  if (cache_response_body_bytes > 0 &&
+      (t_state.range_setup == HttpTransact::RANGE_TRANSFORM ||
+       t_state.range_setup == HttpTransact::RANGE_HANDLED_NO_TRANSFORM)) {
+    HTTP_SUM_DYN_STAT(http_range_cache_read_bytes_stat, cache_response_body_bytes);
+    HTTP_SUM_DYN_STAT(http_range_user_agent_bytes_stat, client_response_body_bytes);
+  }
 /*
     if (is_action_tag_set("http_handler_times")) {
 	print_all_http_handler_times();
@@ -3449,6 +3449,7 @@ HttpTransact::handle_response_from_parent(State* s)
   HTTP_RELEASE_ASSERT(s->current.server == &s->parent_info);
 
   s->parent_info.state = s->current.state;
+  update_origin_health(s);
   switch (s->current.state) {
   case CONNECTION_ALIVE:
     DebugTxn("http_trans", "[hrfp] connection alive");
@@ -3569,6 +3570,7 @@ HttpTransact::handle_response_from_server(State* s)
 
   // plugin call
   s->server_info.state = s->current.state;
+  update_origin_health(s);
   if (s->fp_tsremap_os_response)
     s->fp_tsremap_os_response(s->remap_plugin_instance, reinterpret_cast<TSHttpTxn>(s->state_machine), s->current.state);
 
@@ -3660,6 +3662,53 @@ HttpTransact::handle_response_from_server(State* s)
   return;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Name       : update_origin_health
+// Description: feeds the outcome of talking to the current server, a
+//              response header or a failure, to the origin health table
+//
+///////////////////////////////////////////////////////////////////////////////
+void
+HttpTransact::update_origin_health(State* s)
+{
+  if (!OriginHealthConfig::enabled || originHealthTable == NULL || s->current.server->name == NULL)
+    return;
+
+  switch (s->current.state) {
+  case CONGEST_CONTROL_CONGESTED_ON_F:
+  case CONGEST_CONTROL_CONGESTED_ON_M:
+    // we never talked to it
+    return;
+  default:
+    break;
+  }
+
+  // The host, and the address for a round robin one, which is what its
+  // health checks and round robin selection go by
+  OriginHealth *h[2];
+  int n = 0;
+  int status = s->hdr_info.server_response.valid() ? s->hdr_info.server_response.status_get() : HTTP_STATUS_NONE;
+
+  h[n] = originHealthTable->get(OriginHealthTable::make_key(s->current.server->name, s->current.server->port));
+  if (h[n] != NULL)
+    n++;
+  if (s->dns_info.round_robin && ats_is_ip(&s->current.server->addr)) {
+    h[n] = originHealthTable->get(OriginHealthTable::make_key(&s->current.server->addr.sa, s->current.server->port));
+    if (h[n] != NULL)
+      n++;
+  }
+
+  for (int i = 0; i < n; i++) {
+    if (s->current.state == CONNECTION_ALIVE) {
+      HttpSM *sm = s->state_machine;
+      ink_hrtime elapsed = sm->milestones.server_read_header_done - sm->milestones.server_connect;
+      h[i]->record_response((int32_t) s->current.now, status, elapsed > 0 ? elapsed : 0);
+    } else {
+      h[i]->record_failure((int32_t) s->current.now);
+    }
+  }
+}
+
 //void
 //HttpTransact::delete_srv_entry(State* s, int max_retries)
 //{
@@ -1002,6 +1002,9 @@ public:
     // for Range: to avoid write transfomed Range response into cache
     RangeSetup_t range_setup;
     RangeRecord single_range;
+    // multiple ranges from cache: the cache read seeks to single_range._start
+    // and stops at single_range._end, the transform skips the gaps
+    bool range_in_cache;
 
     // for authenticated content caching
     CacheAuth_t www_auth_content;
@@ -1136,6 +1139,7 @@ public:
         first_stats(),
         current_stats(NULL),
         range_setup(RANGE_NONE),
+        range_in_cache(false),
         www_auth_content(CACHE_AUTH_NONE),
         fp_tsremap_os_response(NULL),
         remap_plugin_instance(0),
@@ -1362,6 +1366,7 @@ public:
   static void handle_response_from_icp_suggested_host(State* s);
   static void handle_response_from_parent(State* s);
   static void handle_response_from_server(State* s);
+  static void update_origin_health(State* s);
   static void delete_server_rr_entry(State* s, int max_retries);
 //  static void delete_srv_entry(State* s, int max_retries);
   static void retry_server_connection_not_open(State* s, ServerState_t conn_state, int max_retries);
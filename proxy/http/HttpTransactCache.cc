@@ -153,6 +153,59 @@ is_empty(char *s)
   return (s[0] == NUL);
 }
 
+/**
+  The fingerprint of a client request to compare with those of the
+  alternates, per http_vary_fingerprint(). It depends on the Vary of
+  the alternate's response, which is nearly always the same for every
+  alternate of a URL, so it is only recomputed when an alternate's Vary
+  differs from that of the last one it was computed for.
+
+*/
+struct ClientVaryFingerprint
+{
+  HTTPHdr *client_request;
+  bool valid;
+  uint64_t fp;
+  const char *vary;
+  int vary_len;
+
+  ClientVaryFingerprint(HTTPHdr * request)
+    : client_request(request), valid(false), fp(0), vary(NULL), vary_len(0)
+  { }
+
+  // True if the alternate was stored for a request whose Accept* and
+  // Vary'd headers are the same as the client request's
+  bool match(CacheHTTPInfo * obj)
+  {
+    if (obj->object_key_get() == zero_key)
+      return false;
+    uint64_t alt_fp = obj->vary_fingerprint_get();
+    return alt_fp && alt_fp == get(obj->response_get());
+  }
+
+  uint64_t get(HTTPHdr * response)
+  {
+    MIMEField *field = response->field_find(MIME_FIELD_VARY, MIME_LEN_VARY);
+    const char *value = NULL;
+    int len = 0;
+
+    // several Vary fields are rare, don't bother remembering them
+    if (field && field->m_next_dup) {
+      valid = false;
+      return http_vary_fingerprint(client_request, response);
+    }
+    if (field)
+      value = field->value_get(&len);
+    if (!valid || len != vary_len || (len && memcmp(value, vary, len))) {
+      fp = http_vary_fingerprint(client_request, response);
+      vary = value;
+      vary_len = len;
+      valid = true;
+    }
+    return fp;
+  }
+};
+
 /**
   Given a set of alternates, select the best match.
 
@@ -201,12 +254,43 @@ HttpTransactCache::SelectFromAlternates(CacheHTTPInfoVector * cache_vector,
     return 0;
   }
 
+  // Alternates carry a fingerprint of the Accept* and Vary'd headers of
+  // the request they were stored for. If exactly one of them was stored
+  // for a request identical to this one, take it after a single quality
+  // check. Several identical ones are a tie and only those go through
+  // the full matching below, unless none of them is acceptable. Plugins
+  // on the select alternate hook see every alternate, so there is no
+  // shortcut for them.
+  ClientVaryFingerprint client_fp(client_request);
+  int fp_matches = 0;
+  int fp_index = -1;
+  if (alt_count > 1 && !http_global_hooks->get(TS_HTTP_SELECT_ALT_HOOK)) {
+    for (int i = 0; i < alt_count; i++) {
+      if (client_fp.match(cache_vector->get(i))) {
+        fp_matches++;
+        fp_index = i;
+      }
+    }
+    if (fp_matches == 1) {
+      CacheHTTPInfo *obj = cache_vector->get(fp_index);
+      if (calculate_quality_of_match(http_config_params, client_request, obj->request_get(), obj->response_get()) > 0.0) {
+        Debug("http_seq", "[SelectFromAlternates] Vary fingerprint picked alternate # %d", fp_index);
+        return fp_index;
+      }
+      fp_matches = 0;
+    }
+  }
+
+Lselect:
   for (int i = 0; i < alt_count; i++) {
     float Q;
     CacheHTTPInfo *obj = cache_vector->get(i);
     HTTPHdr *cached_request = obj->request_get();
     HTTPHdr *cached_response = obj->response_get();
 
+    if (fp_matches > 1 && !client_fp.match(obj))
+      continue;
+
     if (!(obj->object_key_get() == zero_key)) {
       ink_debug_assert(cached_request->valid());
       ink_debug_assert(cached_response->valid());
@@ -260,6 +344,15 @@ HttpTransactCache::SelectFromAlternates(CacheHTTPInfoVector * cache_vector,
       }
     }
   }
+  // none of the tied alternates is acceptable, one of the others may be
+  if (fp_matches > 1 && (best_index == -1 || best_Q <= unacceptable_Q)) {
+    Debug("http_seq", "[SelectFromAlternates] No alternate with a matching Vary fingerprint, trying all");
+    fp_matches = 0;
+    best_index = -1;
+    best_Q = -1.0;
+    best_age = NUM_SECONDS_IN_ONE_YEAR;
+    goto Lselect;
+  }
   Debug("http_seq", "[SelectFromAlternates] Chosen alternate # %d", best_index);
   if (diags->on("http_alts")) {
     ACQUIRE_PRINT_LOCK()
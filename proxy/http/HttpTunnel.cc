@@ -964,7 +964,8 @@ HttpTunnel::producer_run(HttpTunnelProducer * p)
       Debug("http_tunnel", "[%" PRId64 "] [tunnel_run] producer already done", sm->sm_id);
       producer_handler(HTTP_TUNNEL_EVENT_PRECOMPLETE, p);
     } else {
-      if (p->vc_type == HT_CACHE_READ && sm->t_state.range_setup == HttpTransact::RANGE_HANDLED_NO_TRANSFORM) {
+      if (p->vc_type == HT_CACHE_READ &&
+          (sm->t_state.range_setup == HttpTransact::RANGE_HANDLED_NO_TRANSFORM || sm->t_state.range_in_cache)) {
         p->read_vio = ((CacheVConnection*) p->vc)->do_io_pread(this, producer_n, p->read_buffer,
             sm->t_state.single_range._start);
       } else
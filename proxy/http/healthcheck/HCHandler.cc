@@ -93,7 +93,7 @@ HCHandler::process_hostdb_info(HostDBInfo *r)
       }
       for (int i = 0; i < rr->good; ++i) {
         HCSM *hcsm = HCSM::allocate();
-        hcsm->init(hc_entry, &rr->info[i]);
+        hcsm->init(hc_entry, &rr->info[i], false);
         eventProcessor.schedule_imm(hcsm, ET_TASK);
       }
     } else {
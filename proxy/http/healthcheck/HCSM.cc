@@ -54,12 +54,15 @@ write_header(HTTPHdr * h, MIOBuffer * b)
 }
 
 void
-HCSM::init(HCEntry *entry, HostDBInfo *r)
+HCSM::init(HCEntry *entry, HostDBInfo *r, bool name)
 {
   id = (int64_t) ink_atomic_increment((&next_id), 1);
   HC_STATE_ENTER(&HCSM::init);
   hc_entry = entry;
   hostdb_info = r;
+  by_name = name;
+  published = false;
+  start_time = 0;
   server_session = NULL;
   buffer_reader = NULL;
   mutex = new_ProxyMutex();
@@ -76,6 +79,10 @@ void
 HCSM::destroy()
 {
   HC_STATE_ENTER(&HCSM::destroy);
+  // Every way out of a started probe but the good response is a failure
+  if (start_time != 0 && !published) {
+    publish_health(false);
+  }
   mutex.clear();
   HttpConfig::release(http_config_param);
   http_parser_clear(&http_parser);
@@ -206,6 +213,7 @@ HCSM::state_read_res(int event, void *data)
   switch (state) {
   case PARSE_DONE:
     if (HTTP_STATUS_OK <= ret  && ret <= HTTP_STATUS_PARTIAL_CONTENT) {
+      publish_health(true);
       hostdb_info->hc_state = true;
       hostdb_info->hc_ttl = hc_entry->ttl;
       hostdb_info->refresh_hc();
@@ -244,6 +252,7 @@ HCSM::handle_con2os()
 {
   HC_STATE_ENTER(&HCSM::handle_con2os);
   SET_HANDLER(&HCSM::state_con2os);
+  start_time = ink_get_hrtime();
   HttpServerSession *session = NULL;
   //sockaddr const* ip = hostdb_info->ip();
   IpEndpoint ip;
@@ -338,3 +347,33 @@ HCSM::attach_server_session(HttpServerSession *session)
   server_session->get_netvc()->set_inactivity_timeout(HRTIME_SECONDS(connect_timeout));
   server_session->get_netvc()->set_active_timeout(HRTIME_SECONDS(txn_conf.transaction_active_timeout_out));
 }
+
+// Publishes the probe result in the origin health table, for the
+// address probed and, when it is the host's only one, for the host, so
+// that parent selection, HostDB round robin and congestion control
+// pass over a down origin. A failed probe holds until the one after
+// next would have come back.
+void
+HCSM::publish_health(bool up)
+{
+  published = true;
+  if (originHealthTable == NULL || !OriginHealthConfig::enabled) {
+    return;
+  }
+
+  ink_hrtime now = ink_get_hrtime();
+  int32_t now_sec = (int32_t) ink_hrtime_to_sec(now);
+  int32_t hold = 2 * (int32_t) hc_entry->ttl;
+  OriginHealth *h = originHealthTable->get(OriginHealthTable::make_key(hostdb_info->ip(), hc_entry->port));
+
+  Debug("healthcheck", "[%" PRId64 "] %s:%d is %s", id, hc_entry->hostname, hc_entry->port, up ? "up" : "down");
+  if (h != NULL) {
+    h->record_probe(now_sec, up, now - start_time, hold);
+  }
+  if (by_name) {
+    h = originHealthTable->get(OriginHealthTable::make_key(hc_entry->hostname, hc_entry->port));
+    if (h != NULL) {
+      h->record_probe(now_sec, up, now - start_time, hold);
+    }
+  }
+}
@@ -38,7 +38,8 @@ public:
   {
     return hcsmAllocator.alloc();
   }
-  void init(HCEntry *entry, HostDBInfo *r);
+  // by_name: r is the only address of the host, so its result is the host's
+  void init(HCEntry *entry, HostDBInfo *r, bool by_name = true);
   void destroy();
 
   int main_event(int event, void *data);
@@ -52,12 +53,16 @@ public:
   OverridableHttpConfigParams txn_conf;
 private:
   void attach_server_session(HttpServerSession *s);
+  void publish_health(bool up);
 
   int64_t id;
   int server_response_hdr_bytes;
 
   HCEntry *hc_entry;
   HostDBInfo *hostdb_info;
+  bool by_name;
+  bool published;
+  ink_hrtime start_time;        // of the connect, 0 until the probe starts
 
   VCEntry *vc_entry;
   HttpServerSession *server_session;
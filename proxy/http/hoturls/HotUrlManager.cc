@@ -51,13 +51,19 @@ int HotUrlManager::UrlArray::add(const char *url, const int length, const bool c
   entry->length = length;
   entry->generation = _generation;
 
+  //serve the local copy while it is fresh, else copy it from the owner
+  //again so that the owner's changes come through
   ink_mutex_acquire(&instance->_mutex);
+  time_t currentTime = (time_t)(ink_get_hrtime() / HRTIME_SECOND);
   HotUrlHistory::HotUrlEntry *historyEntry = HotUrlHistory::getHotUrl(url, length);
-  if (historyEntry != NULL) {
+  if (historyEntry != NULL && HotUrlStats::isReplicaFresh(
+        historyEntry->createTime, currentTime))
+  {
     entry->cache_flag = CACHE_CONTROL_LOCAL;
-    time_t createTime  = (time_t)(ink_get_hrtime() / HRTIME_SECOND);
-    if (historyEntry->createTime < createTime) {
-      historyEntry->createTime = createTime;
+    if (HotUrlStats::getInstance()->getConfig()->replica_ttl == 0 &&
+        historyEntry->createTime < currentTime)
+    {
+      historyEntry->createTime = currentTime;
     }
   }
   else {
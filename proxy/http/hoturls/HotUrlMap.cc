@@ -23,213 +23,242 @@
 
 #include "HotUrlMap.h"
 #include "HotUrlStats.h"
+#include "ts/TestBox.h"
 
-#define CLEAR_INTERVAL (100 * HRTIME_MSECOND)
+#define HOT_URL_MAP_INIT_SIZE  1024
 
-inline int64_t HotUrlMap::UrlMapEntry::getOrderBy()
+inline int64_t HotUrlMap::UrlMapEntry::getOrderBy() const
 {
   return (HotUrlStats::getDetecType() & HOT_URLS_DETECT_TYPE_BYTES) ?
     _bytes : _count;
 }
 
-HotUrlMap::PriorityQueue::PriorityQueue()
-  : _maxCount(0), _count(0), _head(NULL), _tail(NULL), _min(0)
+static int compareOrderBy(const void *p1, const void *p2)
 {
-  ink_mutex_init(&_mutex, "HotUrlPriorityQueue");
+  int64_t v1 = (*(const HotUrlMap::UrlMapEntry **)p1)->getOrderBy();
+  int64_t v2 = (*(const HotUrlMap::UrlMapEntry **)p2)->getOrderBy();
+  return v1 > v2 ? -1 : (v1 < v2 ? 1 : 0);
 }
 
-HotUrlMap::PriorityQueue::~PriorityQueue()
+HotUrlMap::HotUrlMap()
+  : _entries(NULL), _count(0), _allocSize(0), _buckets(NULL),
+  _bucketMask(0), _sorted(NULL), _head(NULL), _window(1), _slot(0),
+  _windowTime(0.00)
 {
-  ink_mutex_destroy(&_mutex);
+  memset(_slotTimes, 0, sizeof(_slotTimes));
 }
 
-void HotUrlMap::PriorityQueue::add(UrlMapEntry *entry)
+HotUrlMap::~HotUrlMap()
 {
-  if (entry->getOrderBy() <= _min) {
-    return;
-  }
+  ats_free(_entries);
+  ats_free(_buckets);
+  ats_free(_sorted);
+}
 
-  ink_mutex_acquire(&_mutex);
-  do {
-    if (entry->getOrderBy() <= _min) {
-      break;
-    }
+void HotUrlMap::expand()
+{
+  int allocSize = _allocSize == 0 ? HOT_URL_MAP_INIT_SIZE : 2 * _allocSize;
 
-    if (!entry->_inQueue) {
-      entry->_inQueue = true;
-      if (_count < _maxCount) {
-        ++_count;
-      }
-      else if (_tail != NULL) {  //remove the tail node
-        _tail->_inQueue = false;
-        if (_tail->_prev != NULL) {
-          _tail->_prev->_next = NULL;
-          _tail = _tail->_prev;
-        }
-        else {
-          _head = NULL;
-          _tail = NULL;
-        }
-      }
+  _entries = (UrlMapEntry *)ats_realloc(_entries, sizeof(UrlMapEntry) * allocSize);
+  _sorted = (UrlMapEntry **)ats_realloc(_sorted, sizeof(UrlMapEntry *) * allocSize);
+  _allocSize = allocSize;
 
-      entry->_prev = _tail;
-      entry->_next = NULL;
-      if (_tail == NULL) {
-        _head = entry;
-      }
-      else {
-        _tail->_next = entry;
-      }
+  //twice as many buckets
+  ats_free(_buckets);
+  _bucketMask = 2 * allocSize - 1;
+  _buckets = (int32_t *)ats_malloc(sizeof(int32_t) * (_bucketMask + 1));
+  rehash();
+}
 
-      _tail = entry;
-      _min = entry->getOrderBy();
-    }
-    else
-    {
-      if (entry->_next == NULL) {  //i am the tail node
-        _min = entry->getOrderBy();
-      }
-    }
+void HotUrlMap::rehash()
+{
+  memset(_buckets, 0xff, sizeof(int32_t) * (_bucketMask + 1));
+  for (int i=0; i<_count; i++) {
+    int32_t *bucket = _buckets + (_entries[i]._hash & _bucketMask);
+    _entries[i]._chain = *bucket;
+    *bucket = i;
+  }
+}
 
-    if (entry->_prev == NULL) { //i am the largest, do NOT resort
-      break;
-    }
+void HotUrlMap::setWindow(const int intervals)
+{
+  int window = intervals;
+  if (window < 1) {
+    window = 1;
+  }
+  else if (window > HOT_URLS_MAX_WINDOW) {
+    window = HOT_URLS_MAX_WINDOW;
+  }
 
-    if (entry->getOrderBy() <= entry->_prev->getOrderBy()) { //order is OK
-      break;
-    }
+  if (window != _window) {
+    clear();
+    _window = window;
+  }
+}
 
-    //remove this entry first
-    if (entry->_next == NULL) { //i am the tail node
-      _tail = entry->_prev;
-      _tail->_next = NULL;
-      _min = _tail->getOrderBy();
-    }
-    else {
-      entry->_next->_prev = entry->_prev;
-      entry->_prev->_next = entry->_next;
-    }
+void HotUrlMap::advance(const double seconds)
+{
+  UrlMapEntry *entry;
+  UrlMapEntry *dest;
+  UrlMapEntry *end;
+
+  _head = NULL;
+  _slot = (_slot + 1) % _window;
+  _windowTime += seconds - _slotTimes[_slot];
+  _slotTimes[_slot] = seconds;
+  if (_count == 0) {
+    return;
+  }
 
-    //then insert this entry
-    UrlMapEntry *prev = entry->_prev->_prev;
-    while (prev != NULL && entry->getOrderBy() > prev->getOrderBy()) {
-      prev = prev->_prev;
-    }
-    if (prev == NULL) {
-      entry->_prev = NULL;
-      entry->_next = _head;
-      _head->_prev = entry;
-      _head = entry;
+  dest = _entries;
+  end = _entries + _count;
+  for (entry=_entries; entry<end; entry++) {
+    entry->_count -= entry->_slotCounts[_slot];
+    entry->_bytes -= entry->_slotBytes[_slot];
+    entry->_slotCounts[_slot] = 0;
+    entry->_slotBytes[_slot] = 0;
+    if (entry->_count <= 0) {
+      continue;
     }
-    else {
-      prev->_next->_prev = entry;
-      entry->_next = prev->_next;
-      entry->_prev = prev;
-      prev->_next = entry;
+
+    if (dest != entry) {
+      memcpy(dest, entry, sizeof(UrlMapEntry));
     }
-  } while (0);
-  ink_mutex_release(&_mutex);
+    dest++;
+  }
+
+  if (dest != end) {
+    _count = dest - _entries;
+    rehash();
+  }
 }
 
-HotUrlMap::HotUrlMap()
+void HotUrlMap::merge(const HotUrlSketch *sketch)
 {
-  int64_t bytes;
-  UrlHashBucket *pBucket;
-  UrlHashBucket *pEnd;
+  int used = sketch->getUsed();
+  for (int i=0; i<used; i++) {
+    const HotUrlSketch::Counter *counter = sketch->getCounter(i);
+    const UrlEntry *url = sketch->getUrl(i);
+    UrlMapEntry *found = NULL;
+
+    if (_count > 0) {
+      int32_t index = _buckets[counter->_hash & _bucketMask];
+      while (index >= 0) {
+        if (_entries[index]._hash == counter->_hash && _entries[index].equals(url)) {
+          found = _entries + index;
+          break;
+        }
+        index = _entries[index]._chain;
+      }
+    }
 
-  bytes = sizeof(UrlHashBucket) * URL_HASH_TABLE_SIZE;
-  _urlTable._buckets = (UrlHashBucket *)ats_malloc(bytes);
+    if (found != NULL) {
+      found->_count += counter->_count;
+      found->_bytes += counter->_bytes;
+      found->_slotCounts[_slot] += counter->_count;
+      found->_slotBytes[_slot] += counter->_bytes;
+      continue;
+    }
 
-  bytes = sizeof(int) * URL_HASH_TABLE_SIZE;
-  _urlTable._counts = (int *)ats_malloc(bytes);
-  memset(_urlTable._counts, 0, bytes);
+    if (_count >= _allocSize) {
+      expand();
+    }
 
-  pEnd = _urlTable._buckets + URL_HASH_TABLE_SIZE;
-  for (pBucket=_urlTable._buckets; pBucket<pEnd; pBucket++) {
-    ink_mutex_init(&pBucket->_mutex, "HotUrlMapMutex");
+    found = _entries + _count;
+    found->setUrl(url->url, url->length);
+    found->_hash = counter->_hash;
+    found->_count = counter->_count;
+    found->_bytes = counter->_bytes;
+    memset(found->_slotCounts, 0, sizeof(int64_t) * _window);
+    memset(found->_slotBytes, 0, sizeof(int64_t) * _window);
+    found->_slotCounts[_slot] = counter->_count;
+    found->_slotBytes[_slot] = counter->_bytes;
+
+    int32_t *bucket = _buckets + (counter->_hash & _bucketMask);
+    found->_chain = *bucket;
+    *bucket = _count++;
   }
 }
 
-const HotUrlMap::UrlMapEntry *HotUrlMap::get(const char *url, const int url_len)
+const HotUrlMap::UrlMapEntry *HotUrlMap::sort(const uint32_t maxCount)
 {
-  unsigned int index;
-  UrlMapEntry *found;
-
-  index = time33Hash(url, url_len) % URL_HASH_TABLE_SIZE;
-  ink_mutex_acquire(&(_urlTable._buckets[index]._mutex));
-  found = find(index, url, url_len);
-  ink_mutex_release(&(_urlTable._buckets[index]._mutex));
-  return found;
-}
-
-void HotUrlMap::incrementBytes(const char *url, const int url_len, const int64_t bytes)
-{
-  unsigned int index;
-  UrlMapEntry *found;
+  int count;
 
-  if (url_len >= MAX_URL_SIZE) {
-    return;
+  _head = NULL;
+  if (_count == 0 || maxCount == 0) {
+    return NULL;
   }
 
-  index = time33Hash(url, url_len) % URL_HASH_TABLE_SIZE;
-  ink_mutex_acquire(&(_urlTable._buckets[index]._mutex));
-  found = find(index, url, url_len);
-  if (found != NULL) {
-    found->_bytes += bytes;
-    found->_count += 1;
+  for (int i=0; i<_count; i++) {
+    _sorted[i] = _entries + i;
   }
-  else {
-    if (_urlTable._counts[index] >= MAX_URL_COUNT_PER_BUCKET) {
-      ink_mutex_release(&(_urlTable._buckets[index]._mutex));
-      return;
-    }
+  qsort(_sorted, _count, sizeof(UrlMapEntry *), compareOrderBy);
 
-    found = _urlTable._buckets[index]._urls + _urlTable._counts[index];
-    found->_inQueue = false;
-    found->_bytes = bytes;
-    found->_count = 1;
-    found->setUrl(url, url_len);
-    _urlTable._counts[index]++;
+  count = (uint32_t)_count < maxCount ? _count : (int)maxCount;
+  for (int i=0; i<count; i++) {
+    _sorted[i]->_prev = i > 0 ? _sorted[i - 1] : NULL;
+    _sorted[i]->_next = i + 1 < count ? _sorted[i + 1] : NULL;
   }
-  ink_mutex_release(&(_urlTable._buckets[index]._mutex));
 
-  _urlQueue.add(found);
-  return;
+  _head = _sorted[0];
+  return _head;
 }
 
-void HotUrlMap::urlTableStat(int &urlCount, int &min, int &max, double &avg)
-{
-  int *pCount;
-  int *pEnd;
-  int usedCount;
-
-  urlCount = 0;
-  usedCount = 0;
-  min = -1;
-  max = 0;
-  pEnd = _urlTable._counts + URL_HASH_TABLE_SIZE;
-  for (pCount=_urlTable._counts; pCount<pEnd; pCount++) {
-    if (*pCount > 0) {
-      usedCount++;
-      urlCount += *pCount;
-
-      if (*pCount > max) {
-        max = *pCount;
-      }
-    }
+#if TS_HAS_TESTS
 
-    if (min < 0) {
-      min = *pCount;
-    }
-    else if (*pCount < min) {
-      min = *pCount;
+static const HotUrlMap::UrlMapEntry *findEntry(const HotUrlMap::UrlMapEntry *head, const char *url)
+{
+  for (; head != NULL; head = head->_next) {
+    if (head->equals(url, strlen(url))) {
+      return head;
     }
   }
-  if (usedCount > 0) {
-    avg = (double)urlCount / (double)usedCount;
-  }
-  else {
-    avg = 0.00;
+  return NULL;
+}
+
+REGRESSION_TEST(HotUrlMapWindow)(RegressionTest *t, int atype, int *pstatus)
+{
+  NOWARN_UNUSED(atype);
+
+  const char *hot = "http://www.example.com/hot";
+  const char *cold = "http://www.example.com/cold";
+  TestBox box(t, pstatus);
+  HotUrlSketch *sketch = HotUrlSketch::create(8);
+  HotUrlMap map;
+  const HotUrlMap::UrlMapEntry *entry;
+
+  box = REGRESSION_TEST_PASSED;
+  map.setWindow(2);
+
+  // interval 1: the hot url only
+  sketch->clear(1);
+  for (int i = 0; i < 10; i++) {
+    sketch->add(hot, strlen(hot), 100, true);
   }
+  map.advance(10.0);
+  map.merge(sketch);
+
+  // interval 2: the cold url only, the hot one is still in the window
+  sketch->clear(2);
+  sketch->add(cold, strlen(cold), 100, true);
+  map.advance(10.0);
+  map.merge(sketch);
+
+  entry = findEntry(map.sort(10), hot);
+  box.check(entry != NULL && entry->_count == 10 && entry->_bytes == 1000,
+      "hot url counted over the window");
+  box.check(map.head() == entry, "hot url ranked first");
+  box.check(map.getWindowTime() > 19.0 && map.getWindowTime() < 21.0, "window covers two intervals");
+
+  // interval 3: nothing, interval 1 slides out
+  sketch->clear(3);
+  map.advance(10.0);
+  map.merge(sketch);
+  box.check(findEntry(map.sort(10), hot) == NULL, "hot url dropped with its interval");
+  box.check(findEntry(map.head(), cold) != NULL, "cold url kept");
+  box.check(map.getCount() == 1, "one url left, got %d", map.getCount());
+
+  HotUrlSketch::destroy(sketch);
 }
 
+#endif
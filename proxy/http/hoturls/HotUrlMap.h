@@ -23,29 +23,43 @@
 
 //
 #include "I_HotUrls.h"
+#include "HotUrlSketch.h"
 
 #ifndef _HOT_URL_MAP_H_
 #define _HOT_URL_MAP_H_
 
-#define URL_HASH_TABLE_SIZE  10949
-#define MAX_URL_COUNT_PER_BUCKET  4
+//max detect intervals in the popularity window
+#define HOT_URLS_MAX_WINDOW  16
 
+//
+// HotUrlMap
+//
+//   The urls of the last detect intervals (the window), built by
+//   HotUrlProcessor by adding up the per thread summaries (see
+//   HotUrlSketch) once per interval. Each entry keeps what it got in each
+//   interval of the window so the oldest one can be taken off when the
+//   window slides. It is only touched from the processor so it takes no
+//   locks.
+//
 class HotUrlMap
 {
   public:
     struct UrlMapEntry {
       UrlEntry _url;
-      int _count;     //access count
-      bool _inQueue;
-      int64_t _bytes;
-      UrlMapEntry *_next;  //for priority queue
-      UrlMapEntry *_prev;  //for priority queue
-
-      inline bool equals(const UrlEntry *url) {
+      uint32_t _hash;
+      int32_t _chain;      //hash chain
+      int64_t _count;      //access count in the window
+      int64_t _bytes;      //bytes in the window
+      int64_t _slotCounts[HOT_URLS_MAX_WINDOW];
+      int64_t _slotBytes[HOT_URLS_MAX_WINDOW];
+      UrlMapEntry *_next;  //sorted list
+      UrlMapEntry *_prev;  //sorted list
+
+      inline bool equals(const UrlEntry *url) const {
         return _url.equals(url);
       }
 
-      inline bool equals(const char *url, const int url_len) {
+      inline bool equals(const char *url, const int url_len) const {
         return _url.equals(url, url_len);
       }
 
@@ -55,126 +69,85 @@ class HotUrlMap
         _url.length = url_len;
       }
 
-      inline int64_t getOrderBy();
-    };
-
-    class PriorityQueue {
-      public:
-        PriorityQueue();
-        ~PriorityQueue();
-
-        inline const UrlMapEntry *head() const {
-          return _head;
-        }
-
-        inline void clear() {
-          ink_mutex_acquire(&_mutex);
-          _count = 0;
-          _head = NULL;
-          _tail = NULL;
-          _min = 0;
-          ink_mutex_release(&_mutex);
-        }
-
-        void setMaxCount(const uint32_t maxCount) {
-          _maxCount = maxCount;
-        }
-
-        void add(UrlMapEntry *entry);
-
-
-      private:
-        uint32_t _maxCount;
-        uint32_t _count;
-        UrlMapEntry *_head;  //the largest
-        UrlMapEntry *_tail;  //the smallest
-        int64_t _min;
-        ink_mutex _mutex;
-    };
-
-    struct UrlHashBucket {
-      ink_mutex _mutex;  //use for locking this bucket
-      UrlMapEntry _urls[MAX_URL_COUNT_PER_BUCKET]; //urls items
-    };
-
-    struct UrlHashTable {
-      UrlHashBucket *_buckets;
-      int *_counts;
+      inline int64_t getOrderBy() const;
     };
 
   public:
     HotUrlMap();
-
-    inline PriorityQueue *getUrlQueue() {
-      return &_urlQueue;
-    }
+    ~HotUrlMap();
 
     inline void clear() {
-      memset(_urlTable._counts, 0, sizeof(int) * URL_HASH_TABLE_SIZE);
-      _urlQueue.clear();
+      if (_count > 0) {
+        memset(_buckets, 0xff, sizeof(int32_t) * (_bucketMask + 1));
+        _count = 0;
+      }
+      _slot = 0;
+      _head = NULL;
+      memset(_slotTimes, 0, sizeof(_slotTimes));
+      _windowTime = 0.00;
     }
 
-
     /**
-     * Gets the entry for the url
-     * @param url the url
-     * @param url_len the url length
-     * @return the url entry
+     * Set the window length, clears the map when it changes
+     * @param intervals detect intervals in the window
      */
-    const UrlMapEntry *get(const char *url, const int url_len);
+    void setWindow(const int intervals);
 
-    /**
-     * Change (increment/decrement) the send bytes
-     * @param url the url
-     * @param url_len the url length
-     * @param bytes to increase
-     */
-    void incrementBytes(const char *url, const int url_len, const int64_t bytes);
+    inline int getWindow() const {
+      return _window;
+    }
 
     /**
-     * stat url hash table
-     * @param urlCount the url count
-     * @param min the min url count of a bucket
-     * @param max the max url count of a bucket
-     * @param avg the avg url count
+     * Slide the window by one interval: drop what the oldest interval
+     * recorded and the urls left with nothing
+     * @param seconds the length of the interval about to be merged
      */
-    void urlTableStat(int &urlCount, int &min, int &max, double &avg);
-
-  protected:
-    inline uint64_t time33Hash(const char *key, const int key_len)
-    {
-      uint64_t nHash;
-      unsigned char *pKey;
-      unsigned char *pEnd;
-
-      nHash = 0;
-      pEnd = (unsigned char *)key + key_len;
-      for (pKey = (unsigned char *)key; pKey < pEnd; pKey++) {
-        nHash += (nHash << 5) + (*pKey);
-      }
-      return nHash;
+    void advance(const double seconds);
+
+    //the seconds covered by the window
+    inline double getWindowTime() const {
+      return _windowTime;
     }
 
-    inline UrlMapEntry *find(const unsigned int index, const char *url, const int url_len)
-    {
-      UrlMapEntry *urls = _urlTable._buckets[index]._urls;
-      int count = _urlTable._counts[index];
+    inline int getCount() const {
+      return _count;
+    }
 
-      for (int i=0; i<count; i++) {
-        if (urls[i].equals(url, url_len)) {
-          return urls  + i;
-        }
-      }
-      return NULL;
+    inline const UrlMapEntry *head() const {
+      return _head;
     }
 
+    /**
+     * Add the counters of a thread summary
+     * @param sketch the summary of one thread
+     */
+    void merge(const HotUrlSketch *sketch);
+
+    /**
+     * Link the largest entries from head() through _next, largest first
+     * @param maxCount the max entries to link
+     * @return the largest entry
+     */
+    const UrlMapEntry *sort(const uint32_t maxCount);
+
   private:
-    // Hide the constructor and copy constructor
+    // Hide the copy constructor
     HotUrlMap(const HotUrlMap & x) { NOWARN_UNUSED(x); }
 
-    UrlHashTable _urlTable;
-    PriorityQueue _urlQueue;
+    void expand();
+    void rehash();
+
+    UrlMapEntry *_entries;
+    int _count;
+    int _allocSize;
+    int32_t *_buckets;
+    uint32_t _bucketMask;
+    UrlMapEntry **_sorted;
+    UrlMapEntry *_head;
+    int _window;
+    int _slot;    //the interval being merged
+    double _slotTimes[HOT_URLS_MAX_WINDOW];
+    double _windowTime;
 };
 
 #endif
-
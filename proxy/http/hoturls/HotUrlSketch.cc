@@ -0,0 +1,299 @@
+/** @file
+
+  Per thread heavy hitter summary for hot url detection
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "HotUrlSketch.h"
+#include "HotUrlStats.h"
+#include "ts/TestBox.h"
+
+HotUrlSketch *HotUrlSketch::create(const int size)
+{
+  uint32_t nbuckets = 1;
+  while (nbuckets < 2 * (uint32_t)size) {
+    nbuckets <<= 1;
+  }
+
+  HotUrlSketch *sketch = new HotUrlSketch();
+  sketch->_size = size;
+  sketch->_bucketMask = nbuckets - 1;
+  sketch->_buckets = (int32_t *)ats_malloc(sizeof(int32_t) * nbuckets);
+  sketch->_counters = (Counter *)ats_malloc(sizeof(Counter) * size);
+  sketch->_heap = (int32_t *)ats_malloc(sizeof(int32_t) * size);
+  sketch->_urls = (UrlEntry *)ats_malloc(sizeof(UrlEntry) * size);
+  sketch->clear(-1);
+  return sketch;
+}
+
+void HotUrlSketch::destroy(HotUrlSketch *sketch)
+{
+  ats_free(sketch->_buckets);
+  ats_free(sketch->_counters);
+  ats_free(sketch->_heap);
+  ats_free(sketch->_urls);
+  delete sketch;
+}
+
+void HotUrlSketch::clear(const int32_t epoch)
+{
+  memset(_buckets, 0xff, sizeof(int32_t) * (_bucketMask + 1));
+  _used = 0;
+  _byBytes = false;
+  _epoch = epoch;
+}
+
+void HotUrlSketch::siftUp(int32_t pos)
+{
+  int32_t index = _heap[pos];
+  int64_t k = key(index);
+
+  while (pos > 0) {
+    int32_t parent = (pos - 1) / 2;
+    if (key(_heap[parent]) <= k) {
+      break;
+    }
+    _heap[pos] = _heap[parent];
+    _counters[_heap[pos]]._heapPos = pos;
+    pos = parent;
+  }
+  _heap[pos] = index;
+  _counters[index]._heapPos = pos;
+}
+
+void HotUrlSketch::siftDown(int32_t pos)
+{
+  int32_t index = _heap[pos];
+  int64_t k = key(index);
+
+  for (;;) {
+    int32_t child = 2 * pos + 1;
+    if (child >= _used) {
+      break;
+    }
+    if (child + 1 < _used && key(_heap[child + 1]) < key(_heap[child])) {
+      child++;
+    }
+    if (k <= key(_heap[child])) {
+      break;
+    }
+    _heap[pos] = _heap[child];
+    _counters[_heap[pos]]._heapPos = pos;
+    pos = child;
+  }
+  _heap[pos] = index;
+  _counters[index]._heapPos = pos;
+}
+
+void HotUrlSketch::add(const char *url, const int url_len, const int64_t bytes, const bool by_bytes)
+{
+  uint32_t h;
+  int32_t *bucket;
+  Counter *counter;
+  int32_t index;
+
+  if (url_len >= MAX_URL_SIZE) {
+    return;
+  }
+
+  if (by_bytes != _byBytes) {
+    //the eviction measure changed, reorder the heap
+    _byBytes = by_bytes;
+    for (int32_t pos = _used / 2 - 1; pos >= 0; pos--) {
+      siftDown(pos);
+    }
+  }
+
+  h = hash(url, url_len);
+  bucket = _buckets + (h & _bucketMask);
+  for (index = *bucket; index >= 0; index = _counters[index]._next) {
+    counter = _counters + index;
+    if (counter->_hash == h && _urls[index].equals(url, url_len)) {
+      counter->_count += 1;
+      counter->_bytes += bytes;
+      siftDown(counter->_heapPos);
+      return;
+    }
+  }
+
+  if (_used < _size) {
+    index = _used++;
+    counter = _counters + index;
+    counter->_count = 0;
+    counter->_bytes = 0;
+    counter->_heapPos = index;
+    _heap[index] = index;
+  }
+  else {
+    //take over the smallest counter
+    index = _heap[0];
+    counter = _counters + index;
+
+    int32_t *link = _buckets + (counter->_hash & _bucketMask);
+    while (*link != index) {
+      link = &_counters[*link]._next;
+    }
+    *link = counter->_next;
+  }
+
+  counter->_hash = h;
+  counter->_count += 1;
+  counter->_bytes += bytes;
+  counter->_next = *bucket;
+  *bucket = index;
+  //a new counter starts at the bottom, a taken over one at the top
+  if (counter->_heapPos > 0) {
+    siftUp(counter->_heapPos);
+  }
+  else {
+    siftDown(0);
+  }
+
+  memcpy(_urls[index].url, url, url_len);
+  _urls[index].url[url_len] = '\0';
+  _urls[index].length = url_len;
+}
+
+HotUrlThreadStats *HotUrlThreadStats::create(const int sketch_size)
+{
+  HotUrlThreadStats *stats = new HotUrlThreadStats();
+  stats->send_bytes = 0;
+  stats->query_count = 0;
+  stats->seq = 0;
+  stats->sketches[0] = HotUrlSketch::create(sketch_size);
+  stats->sketches[1] = HotUrlSketch::create(sketch_size);
+  return stats;
+}
+
+#if TS_HAS_TESTS
+
+// Zipf distributed ranks by inverting the CDF over a precomputed table.
+struct ZipfGenerator {
+  double *cdf;
+  int n;
+
+  ZipfGenerator(const int an, const double s) : n(an) {
+    double sum = 0.0;
+    cdf = (double *)ats_malloc(sizeof(double) * n);
+    for (int i = 0; i < n; i++) {
+      sum += 1.0 / pow((double)(i + 1), s);
+      cdf[i] = sum;
+    }
+    for (int i = 0; i < n; i++) {
+      cdf[i] /= sum;
+    }
+  }
+
+  ~ZipfGenerator() {
+    ats_free(cdf);
+  }
+
+  int next() {
+    double u = (double)random() / (double)RAND_MAX;
+    int lo = 0, hi = n - 1;
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if (cdf[mid] < u) {
+        lo = mid + 1;
+      }
+      else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+};
+
+REGRESSION_TEST(HotUrlSketch)(RegressionTest *t, int atype, int *pstatus)
+{
+  NOWARN_UNUSED(atype);
+
+  const int nurls = 100000;
+  const int nupdates = 1000000;
+  const int size = 50;
+  TestBox box(t, pstatus);
+  HotUrlSketch *sketch = HotUrlSketch::create(size);
+  ZipfGenerator zipf(nurls, 1.1);
+  int *ranks = (int *)ats_malloc(sizeof(int) * nupdates);
+  int64_t *exact = (int64_t *)ats_malloc(sizeof(int64_t) * nurls);
+  char url[64];
+
+  box = REGRESSION_TEST_PASSED;
+
+  memset(exact, 0, sizeof(int64_t) * nurls);
+  srandom(1);
+  for (int i = 0; i < nupdates; i++) {
+    ranks[i] = zipf.next();
+    exact[ranks[i]]++;
+  }
+
+  sketch->clear(0);
+  ink_hrtime start = ink_get_hrtime_internal();
+  for (int i = 0; i < nupdates; i++) {
+    int len = snprintf(url, sizeof(url), "http://www.example.com/object/%d", ranks[i]);
+    sketch->add(url, len, 1, false);
+  }
+  ink_hrtime elapsed = ink_get_hrtime_internal() - start;
+
+  rprintf(t, "%d zipf updates over %d urls with %d counters: %.1f ns per update\n",
+      nupdates, nurls, size, (double)elapsed / (double)nupdates);
+
+  // Every estimate overcounts by at most N/k, and the hottest url is tracked.
+  bool bounded = true;
+  bool found_top = false;
+  for (int i = 0; i < sketch->getUsed(); i++) {
+    const UrlEntry *entry = sketch->getUrl(i);
+    int rank = atoi(strrchr(entry->url, '/') + 1);
+    int64_t estimate = sketch->getCounter(i)->_count;
+    if (estimate < exact[rank] || estimate - exact[rank] > nupdates / size) {
+      bounded = false;
+    }
+    if (rank == 0) {
+      found_top = true;
+    }
+  }
+
+  box.check(sketch->getUsed() == size, "all %d counters used", size);
+  box.check(bounded, "estimates within N/k of the exact counts");
+  box.check(found_top, "hottest url tracked");
+
+  // By bytes the url with the fewest bytes is the one taken over, even
+  // if it was sent more often.
+  HotUrlSketch *pair = HotUrlSketch::create(2);
+  pair->clear(0);
+  pair->add("a", 1, 1000, true);
+  pair->add("b", 1, 10, true);
+  pair->add("b", 1, 10, true);
+  pair->add("c", 1, 10, true);
+  bool kept_a = false;
+  for (int i = 0; i < pair->getUsed(); i++) {
+    if (pair->getUrl(i)->equals("a", 1)) {
+      kept_a = pair->getCounter(i)->_bytes == 1000;
+    }
+  }
+  box.check(kept_a, "by bytes, the heaviest url is kept");
+
+  HotUrlSketch::destroy(pair);
+  HotUrlSketch::destroy(sketch);
+  ats_free(ranks);
+  ats_free(exact);
+}
+
+#endif
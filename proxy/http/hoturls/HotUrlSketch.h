@@ -0,0 +1,153 @@
+/** @file
+
+  Per thread heavy hitter summary for hot url detection
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "I_HotUrls.h"
+
+#ifndef _HOT_URL_SKETCH_H_
+#define _HOT_URL_SKETCH_H_
+
+//
+// HotUrlSketch
+//
+//   Space-Saving summary (Metwally et al.) of the urls sent by one thread.
+//   It has a fixed number of counters; a url that isn't tracked takes over
+//   the counter with the smallest estimate and inherits it. So with k
+//   counters every estimate overcounts by at most N/k, N being the total
+//   recorded, and every url heavier than N/k is tracked. Summaries of
+//   different threads can be added up and keep the same bound.
+//
+//   The counters are kept in a min-heap on the eviction measure, so the
+//   smallest one is found in O(1) and an update costs O(log k).
+//
+class HotUrlSketch
+{
+  public:
+    struct Counter {
+      uint32_t _hash;
+      int32_t _next;    //hash chain
+      int64_t _count;
+      int64_t _bytes;
+      int32_t _heapPos; //index in _heap
+    };
+
+    static HotUrlSketch *create(const int size);
+    static void destroy(HotUrlSketch *sketch);
+
+    static inline uint32_t hash(const char *url, const int url_len) {
+      return ATS_FNV1a32(url, url_len);
+    }
+
+    void clear(const int32_t epoch);
+
+    /**
+     * Record a response
+     * @param url the url
+     * @param url_len the url length
+     * @param bytes the bytes sent
+     * @param by_bytes evict by bytes (else by count)
+     */
+    void add(const char *url, const int url_len, const int64_t bytes, const bool by_bytes);
+
+    inline int32_t getEpoch() const {
+      return _epoch;
+    }
+
+    inline int getSize() const {
+      return _size;
+    }
+
+    inline int getUsed() const {
+      return _used;
+    }
+
+    inline const Counter *getCounter(const int i) const {
+      return _counters + i;
+    }
+
+    inline const UrlEntry *getUrl(const int i) const {
+      return _urls + i;
+    }
+
+  private:
+    HotUrlSketch() {}
+
+    inline int64_t key(const int32_t index) const {
+      return _byBytes ? _counters[index]._bytes : _counters[index]._count;
+    }
+
+    void siftUp(int32_t pos);
+    void siftDown(int32_t pos);
+
+    int32_t _epoch;       //the detect interval being recorded
+    int _size;
+    int _used;
+    bool _byBytes;        //what the heap is ordered by
+    uint32_t _bucketMask;
+    int32_t *_buckets;
+    Counter *_counters;   //kept apart from the urls so the heap stays in cache
+    int32_t *_heap;       //counter indexes, smallest first
+    UrlEntry *_urls;
+};
+
+//
+// HotUrlThreadStats
+//
+//   What one EThread records, reachable from the thread's private data.
+//   Only the owning thread writes it. The detect interval being recorded
+//   is HotUrlStats' epoch; the owner switches to the other summary when it
+//   moves, so HotUrlProcessor can read the previous interval's summary
+//   once the owner is done with its current update (see waitIdle()).
+//
+struct HotUrlThreadStats {
+  volatile int64_t send_bytes;    //totals since start
+  volatile int64_t query_count;
+  volatile int32_t seq;           //odd while an update is running
+  HotUrlSketch *sketches[2];      //by epoch parity
+
+  static HotUrlThreadStats *create(const int sketch_size);
+
+  inline void add(const volatile int32_t *epoch, const char *url, const int url_len,
+      const int64_t bytes, const bool by_bytes)
+  {
+    ink_atomic_increment(&seq, 1);
+    //read the epoch after announcing the update, pairs with HotUrlStats::doCalcHotUrls
+    int32_t current = *epoch;
+    HotUrlSketch *sketch = sketches[current & 1];
+    if (sketch->getEpoch() != current) {
+      sketch->clear(current);
+    }
+    sketch->add(url, url_len, bytes, by_bytes);
+    ink_atomic_increment(&seq, 1);
+  }
+
+  inline void waitIdle() const {
+    int32_t s = seq;
+    if (s & 1) {
+      while (seq == s) {
+        sched_yield();
+      }
+    }
+  }
+};
+
+#endif
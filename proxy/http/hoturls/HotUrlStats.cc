@@ -9,12 +9,12 @@ HotUrlStats *HotUrlStats::instance = new HotUrlStats();
 
 HotUrlStats::HotUrlStats()
 : _detect(false),
-  _total_send_bytes(0),
-  _total_query_count(0),
+  _epoch(0),
+  _threadStatsOffset(-1),
+  _sketchSize(0),
   _current_send_bps(0),
   _current_qps(0.00)
 {
-  _currentHotUrlMap = _hotUrlMaps;
 }
 
 void HotUrlStats::doCalcSendBps()
@@ -28,18 +28,30 @@ void HotUrlStats::doCalcSendBps()
   ink_hrtime current_time;
   double delta_time;
 
+  int64_t total_send_bytes = 0;
+  int64_t total_query_count = 0;
+
   current_time = ink_get_hrtime();
   delta_time = (double)(current_time - last_calc_time) / (double)HRTIME_SECOND;
   if (delta_time < 0.001) {
     return;
   }
 
-  _current_send_bps = (int64_t)(8 * (_total_send_bytes -
+  for (int i=0; i<eventProcessor.n_ethreads; i++) {
+    HotUrlThreadStats *stats = *(HotUrlThreadStats **)ETHREAD_GET_PTR(
+        eventProcessor.all_ethreads[i], _threadStatsOffset);
+    if (stats != NULL) {
+      total_send_bytes += stats->send_bytes;
+      total_query_count += stats->query_count;
+    }
+  }
+
+  _current_send_bps = (int64_t)(8 * (total_send_bytes -
         last_send_bytes) / delta_time);
-  last_send_bytes = _total_send_bytes;
+  last_send_bytes = total_send_bytes;
 
-  _current_qps = (_total_query_count - last_query_count) / delta_time;
-  last_query_count = _total_query_count;
+  _current_qps = (total_query_count - last_query_count) / delta_time;
+  last_query_count = total_query_count;
   last_calc_time = current_time;
 
   if (_config.max_count == 0) {
@@ -106,6 +118,9 @@ void HotUrlStats::doCalcSendBps()
 void HotUrlStats::doCalcHotUrls()
 {
   if (!_detect) {
+    if (_hotUrlMap.getCount() > 0) {
+      _hotUrlMap.clear();
+    }
     return;
   }
 
@@ -127,27 +142,37 @@ void HotUrlStats::doCalcHotUrls()
     return;
   }
 
-  HotUrlMap *OldUrlMap;
-  HotUrlMap *newUrlMap;
-  OldUrlMap = _currentHotUrlMap;
-  if (_currentHotUrlMap == _hotUrlMaps) {
-    newUrlMap = _hotUrlMaps + 1;
-  }
-  else {
-    newUrlMap = _hotUrlMaps;
-  }
-  newUrlMap->clear();
-  _currentHotUrlMap = newUrlMap;
+  //move the threads to the next interval, then add up what they recorded
+  //in this one once each is out of its current update
+  int32_t epoch = ink_atomic_increment(&_epoch, 1);
   last_calc_time = current_time;
 
-  HotUrlMap::PriorityQueue *urlQueue = OldUrlMap->getUrlQueue();
+  _hotUrlMap.setWindow(_config.window_intervals);
+  _hotUrlMap.advance(delta_time);
+  for (int t=0; t<eventProcessor.n_ethreads; t++) {
+    HotUrlThreadStats *stats = *(HotUrlThreadStats **)ETHREAD_GET_PTR(
+        eventProcessor.all_ethreads[t], _threadStatsOffset);
+    if (stats == NULL) {
+      continue;
+    }
+
+    stats->waitIdle();
+    HotUrlSketch *sketch = stats->sketches[epoch & 1];
+    if (sketch->getEpoch() == epoch) {
+      _hotUrlMap.merge(sketch);
+    }
+  }
+
+  //rank the urls by what they got over the whole window
+  delta_time = _hotUrlMap.getWindowTime();
+
   const HotUrlMap::UrlMapEntry *head;
   const HotUrlMap::UrlMapEntry *lastMatchEntry = NULL;
   bool matched;
   int i;
 
   i = 0;
-  head = urlQueue->head();
+  head = _hotUrlMap.sort(_config.max_count);
   while (head != NULL) {
     matched = false;
     if (_config.detect_type & HOT_URLS_DETECT_TYPE_BYTES) {
@@ -166,7 +191,7 @@ void HotUrlStats::doCalcHotUrls()
       if ((head->_count / delta_time) / current_qps >= _config.single_url_select_ratio) {
         lastMatchEntry = head;
         matched = true;
-        Debug(HOT_URLS_DEBUG_TAG, "single %d. %.*s, count=%d, "
+        Debug(HOT_URLS_DEBUG_TAG, "single %d. %.*s, count=%"PRId64", "
             "ratio=%.2f, qps=%.2f", i + 1, head->_url.length, head->_url.url,
             head->_count, ((double)head->_count / delta_time) / current_qps,
             (double)head->_count / delta_time);
@@ -185,7 +210,7 @@ void HotUrlStats::doCalcHotUrls()
     int64_t bytes_sum = 0;
     int64_t count_sum = 0;
     i = 0;
-    head = urlQueue->head();
+    head = _hotUrlMap.head();
     while (head != NULL) {
       if (_config.detect_type & HOT_URLS_DETECT_TYPE_BYTES) {
         bytes_sum += head->_bytes;
@@ -201,7 +226,7 @@ void HotUrlStats::doCalcHotUrls()
         count_sum += head->_count;
         if ((double)count_sum / delta_time / current_qps >= _config.multi_url_select_ratio) {
           lastMatchEntry = head;
-          Debug(HOT_URLS_DEBUG_TAG, "multi %d. %.*s: %d", i + 1,
+          Debug(HOT_URLS_DEBUG_TAG, "multi %d. %.*s: %"PRId64"", i + 1,
               head->_url.length, head->_url.url, head->_count);
           break;
         }
@@ -216,7 +241,7 @@ void HotUrlStats::doCalcHotUrls()
     HotUrlManager::clear();
   }
   else {
-    HotUrlManager::replace(urlQueue->head(), lastMatchEntry);
+    HotUrlManager::replace(_hotUrlMap.head(), lastMatchEntry);
   }
 }
 
@@ -236,10 +261,6 @@ void HotUrlStats::setDetect(const bool detect)
 
 void HotUrlStats::setMaxCount(const uint32_t maxCount)
 {
-  for (int i=0; i<2; i++) {
-    _hotUrlMaps[i].getUrlQueue()->setMaxCount(maxCount);
-  }
-
   int oldMaxCount = _config.max_count;
   _config.max_count = maxCount;
 
@@ -318,10 +339,30 @@ void HotUrlStats::init()
   REC_EstablishStaticConfigFloat(instance->_config.single_url_select_ratio, "proxy.config.http.hoturls.single_url_select_ratio");
   REC_EstablishStaticConfigFloat(instance->_config.multi_url_select_ratio, "proxy.config.http.hoturls.multi_url_select_ratio");
 
+  //every thread summary overcounts a url by at most its total / size, so
+  //the merged estimates are off by at most max_error of the interval total
+  instance->_config.max_error = (float)REC_ConfigReadFloat("proxy.config.http.hoturls.max_error");
+  if (instance->_config.max_error < 0.0001) {
+    instance->_config.max_error = 0.0001;
+  }
+  instance->_sketchSize = (int)ceil(1.0 / instance->_config.max_error);
+  if (instance->_sketchSize < 2 * HOT_URLS_MAX_COUNT_LIMIT) {
+    instance->_sketchSize = 2 * HOT_URLS_MAX_COUNT_LIMIT;
+  }
+  instance->_threadStatsOffset = eventProcessor.allocate(sizeof(HotUrlThreadStats *));
+
+  REC_EstablishStaticConfigInt32(instance->_config.window_intervals, "proxy.config.http.hoturls.window_intervals");
+  REC_EstablishStaticConfigInt32(instance->_config.replica_ttl, "proxy.config.http.hoturls.replica_ttl");
+  ink_release_assert(instance->_threadStatsOffset >= 0);
+
   Debug(HOT_URLS_DEBUG_TAG, "hot url detect_type: %d, detect_on_bps: %"PRId64", detect_on_bps_ratio: %.4f",
       instance->_config.detect_type, instance->_config.detect_on_bps, instance->_config.detect_on_bps_ratio);
   Debug(HOT_URLS_DEBUG_TAG, "hot url single_url_select_ratio: %.4f, multi_url_select_ratio: %.4f",
       instance->_config.single_url_select_ratio, instance->_config.multi_url_select_ratio);
+  Debug(HOT_URLS_DEBUG_TAG, "hot url max_error: %.4f, %d counters per thread",
+      instance->_config.max_error, instance->_sketchSize);
+  Debug(HOT_URLS_DEBUG_TAG, "hot url window_intervals: %d, replica_ttl: %ds",
+      instance->_config.window_intervals, instance->_config.replica_ttl);
 
   uint32_t maxCount = (uint32_t)REC_ConfigReadInteger("proxy.config.http.hoturls.max_count");
   instance->setMaxCount(maxCount);
@@ -10,6 +10,9 @@
 #define HOT_URLS_DETECT_TYPE_BYTES  1
 #define HOT_URLS_DETECT_TYPE_COUNTS 2
 
+//upper bound of proxy.config.http.hoturls.max_count
+#define HOT_URLS_MAX_COUNT_LIMIT    100
+
 struct HotUrlConfig {
   int detect_type;
   int keep_time;   //for purge
@@ -19,12 +22,16 @@ struct HotUrlConfig {
   float detect_on_bps_ratio;
   float single_url_select_ratio;
   float multi_url_select_ratio;
+  float max_error;  //of a url estimate, as a fraction of the interval total
+  int window_intervals;  //detect intervals a url popularity is counted over
+  int replica_ttl;  //seconds a diffused copy is served before copied again
   
   HotUrlConfig()
     : detect_type(HOT_URLS_DETECT_TYPE_BYTES), keep_time(0), max_count(0),
     detect_interval(HRTIME_SECONDS(1)), detect_on_bps(0),
     detect_on_bps_ratio(0.00), single_url_select_ratio(0.00),
-    multi_url_select_ratio(0.00)
+    multi_url_select_ratio(0.00), max_error(0.00), window_intervals(1),
+    replica_ttl(0)
   {
   }
 };
@@ -51,10 +58,17 @@ class HotUrlStats {
         const int64_t bytes)
     {
       if (instance->_config.max_count > 0) {
-        ink_atomic_increment64(&instance->_total_send_bytes, bytes);
-        ink_atomic_increment64(&instance->_total_query_count, 1);
+        HotUrlThreadStats *stats = getThreadStats();
+        if (stats == NULL) {
+          return;
+        }
+
+        //only this thread writes them
+        stats->send_bytes += bytes;
+        stats->query_count += 1;
         if (instance->_detect) {
-          instance->_currentHotUrlMap->incrementBytes(url, url_len, bytes);
+          stats->add(&instance->_epoch, url, url_len, bytes,
+              (instance->_config.detect_type & HOT_URLS_DETECT_TYPE_BYTES) != 0);
         }
       }
     }
@@ -73,6 +87,17 @@ class HotUrlStats {
       return instance->_config.detect_type;
     }
 
+    /**
+     * Whether a diffused local copy can still be served instead of the
+     * owner's one
+     * @param copyTime when it was copied from the owner
+     * @param currentTime the current time
+     */
+    static inline bool isReplicaFresh(const time_t copyTime, const time_t currentTime) {
+      return instance->_config.replica_ttl == 0 ||
+        copyTime + instance->_config.replica_ttl > currentTime;
+    }
+
     static inline bool enabled() {
       return instance->_config.max_count > 0;
     }
@@ -97,15 +122,30 @@ class HotUrlStats {
     void doCalcSendBps();
     void doCalcHotUrls();
 
+    static inline HotUrlThreadStats *getThreadStats() {
+      EThread *thread = this_ethread();
+      if (thread == NULL || instance->_threadStatsOffset < 0) {
+        return NULL;
+      }
+
+      HotUrlThreadStats **slot = (HotUrlThreadStats **)ETHREAD_GET_PTR(
+          thread, instance->_threadStatsOffset);
+      if (*slot == NULL) {
+        HotUrlThreadStats *stats = HotUrlThreadStats::create(instance->_sketchSize);
+        ink_atomic_swap_ptr(slot, stats);  //publish to the processor
+      }
+      return *slot;
+    }
+
   private:
     bool _detect;
-    volatile int64_t _total_send_bytes;
-    volatile int64_t _total_query_count;
+    volatile int32_t _epoch;   //the detect interval being recorded
+    off_t _threadStatsOffset;  //HotUrlThreadStats * in the thread private data
+    int _sketchSize;
     volatile int64_t _current_send_bps;
     volatile double _current_qps;
     HotUrlConfig _config;
-    HotUrlMap _hotUrlMaps[2];
-    HotUrlMap *_currentHotUrlMap;
+    HotUrlMap _hotUrlMap;
 };
 
 #endif
@@ -45,11 +45,11 @@ struct UrlEntry {
   char url[MAX_URL_SIZE];
   int length;
   
-  inline bool equals(const char *str, const int len) {
+  inline bool equals(const char *str, const int len) const {
     return length == len && memcmp(url, str, len) == 0;
   }
 
-  inline bool equals(const UrlEntry *entry) {
+  inline bool equals(const UrlEntry *entry) const {
     return equals(entry->url, entry->length);
   }
 };
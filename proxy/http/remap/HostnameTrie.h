@@ -2,43 +2,37 @@
 #define _HOSTNAME_TRIE_H
 
 #include "MappingTypes.h"
-
-#define DOT_INDEX  1
-#define VALID_CHAR_NUM   39
-
+#include "HostTrie.h"
+
+//
+// HostnameTrie
+//
+//   Remap's view of the shared HostTrie. A key bound with a leading dot
+//   (.example.com) is a suffix: it matches every name under the domain.
+//   lookupFirst() and lookupNext() return the keys matching a name from
+//   the shortest to the longest, the name itself last. With matchDomain,
+//   the name of a domain (example.com) matches the domain's suffix key
+//   too. Names are limited to the characters of _ascii2table.
+//
 template<typename T>
 class HostnameTrie
 {
   public:
     HostnameTrie() : _matchDomain(true) {
-      memset(&_root, 0, sizeof(_root));
     }
 
     HostnameTrie(const bool matchDomain) : _matchDomain(matchDomain) {
-      memset(&_root, 0, sizeof(_root));
     }
 
     virtual ~HostnameTrie() {
-      for (int i=0; i<VALID_CHAR_NUM; i++) {
-        if (_root.children[i] != NULL) {
-          freeTrieNode(_root.children[i]);
-          _root.children[i] = NULL;
-        }
-      }
     }
 
     bool insert(const char *hostname, const int hostname_len, T *value);
 
-    struct TrieNode {
-      T *value;
-      struct TrieNode *parent;
-      struct TrieNode *children[VALID_CHAR_NUM];
-      char c;
-    };
-
     struct LookupState {
-      const unsigned char *p;
-      TrieNode * current_node;
+      const unsigned char *p;   //last character not walked yet
+      HostTrie::Node current_node;
+      bool more;                //a label is left to walk
     };
 
     T *lookupFirst(const char *hostname, const int hostname_len,
@@ -74,13 +68,7 @@ class HostnameTrie
     }
 
     bool empty() const {
-      for (int i=0; i<VALID_CHAR_NUM; i++) {
-        if (_root.children[i] != NULL) {
-          return false;
-        }
-      }
-
-      return true;
+      return _trie.getCount() == 0;
     }
 
     T **getNodes(int *count) {
@@ -88,30 +76,21 @@ class HostnameTrie
         _nodes.count = 0;
       }
 
-      getNodes(&_root);
+      for (HostTrie::Node n = _trie.iter_first(); n != HostTrie::NO_NODE;
+          n = _trie.iter_next(n))
+      {
+        _nodes.add((T *)_trie.value(n));
+      }
       *count = _nodes.count;
       return _nodes.items;
     }
 
-    void getNodes(TrieNode * node)
-    {
-      if (node->value != NULL) {
-        _nodes.add(node->value);
-      }
-
-      for (int i=0; i<VALID_CHAR_NUM; i++) {
-        if (node->children[i] != NULL) {
-          getNodes(node->children[i]);
-        }
-      }
+    size_t getMemorySize() const {
+      return _trie.getMemorySize();
     }
 
   protected:
-    int allocTrieNode(TrieNode ** node);
-    void freeTrieNode(TrieNode * node);
-    void print(TrieNode * node);
-
-    TrieNode _root;
+    HostTrie _trie;
     bool _matchDomain;  //if match domain, taobao.com matchs taobao.com and *.taobao.com
     DynamicArray<T *> _nodes;  //for getNodes
 };
@@ -124,12 +103,7 @@ class HostnameTrieSet : public HostnameTrie<int>
     }
 
     ~HostnameTrieSet() {
-      if (_hosts.count > 0) {
-        for (int i=0; i<_hosts.count; i++) {
-          free(_hosts.items[i]);
-          _hosts.items[i] = NULL;
-        }
-      }
+      freeHostnames();
     }
 
     //for trie set, value is a flag only
@@ -151,11 +125,16 @@ class HostnameTrieSet : public HostnameTrie<int>
     }
 
     char **getHostnames(int *count) {
-      if (_hosts.count > 0) {
-        _hosts.count = 0;
-      }
+      char buff[256];
 
-      getHostnames(&_root);
+      freeHostnames();
+      for (HostTrie::Node n = _trie.iter_first(); n != HostTrie::NO_NODE;
+          n = _trie.iter_next(n))
+      {
+        if (_trie.getKey(n, buff, sizeof(buff)) >= 0) {
+          _hosts.add(strdup(buff));
+        }
+      }
       *count = _hosts.count;
       return _hosts.items;
     }
@@ -163,30 +142,12 @@ class HostnameTrieSet : public HostnameTrie<int>
   protected:
     DynamicArray<char *> _hosts;
 
-    void getHostnames(TrieNode * node)
-    {
-      int i;
-      if (node->value != NULL) {
-        char buff[256];
-        TrieNode * temp;
-        char *p;
-
-        p = buff;
-        temp = node;
-        while (temp != NULL) {
-          *p++ = temp->c;
-          temp = temp->parent;
-        }
-        *p = '\0';
-
-        _hosts.add(strdup(buff));
-      }
-
-      for (i=0; i<VALID_CHAR_NUM; i++) {
-        if (node->children[i] != NULL) {
-          getHostnames(node->children[i]);
-        }
+    void freeHostnames() {
+      for (int i=0; i<_hosts.count; i++) {
+        free(_hosts.items[i]);
+        _hosts.items[i] = NULL;
       }
+      _hosts.count = 0;
     }
 };
 
@@ -225,78 +186,22 @@ static const signed char _ascii2table[256] = {
     -1, -1, -1, -1, -1, -1, -1, -1
 };
 
-template<typename T>
-int HostnameTrie<T>::allocTrieNode(TrieNode ** node)
-{
-    int result;
-
-    *node = (TrieNode *)malloc(sizeof(TrieNode));
-    if (*node == NULL) {
-        result = errno != 0 ? errno : ENOMEM;
-        fprintf(stderr, "file: "__FILE__", line: %d, " \
-                "malloc %d bytes fail, errno: %d, error info: %s\n",
-                __LINE__, (int)sizeof(TrieNode), result, strerror(result));
-        return result;
-    }
-
-    memset(*node, 0, sizeof(TrieNode));
-    return 0;
-}
-
-template<typename T>
-void HostnameTrie<T>::freeTrieNode(TrieNode * node)
-{
-    int i;
-
-    for (i=0; i<VALID_CHAR_NUM; i++) {
-        if (node->children[i] != NULL) {
-            freeTrieNode(node->children[i]);
-        }
-    }
-
-    free(node);
-}
-
 template<typename T>
 bool HostnameTrie<T>::insert(const char *hostname, const int hostname_len, T *value)
 {
-    const unsigned char *p;
-    TrieNode *current_node;
-    int result;
-    int index;
-
     if (hostname_len <= 0) {
       return false;
     }
 
-    current_node = &_root;
-    p = (const unsigned char *)hostname + hostname_len - 1;
-    while (p >= (const unsigned char *)hostname) {
-        index = _ascii2table[*p];
-        if (index < 0) {
+    for (int i=0; i<hostname_len; i++) {
+        if (_ascii2table[(unsigned char)hostname[i]] < 0) {
             fprintf(stderr, "file: "__FILE__", line: %d, " \
-                    "invalid hostname: %s\n", __LINE__, hostname);
+                    "invalid hostname: %.*s\n", __LINE__, hostname_len, hostname);
             return false;
         }
-
-        if (current_node->children[index] == NULL) {
-            result = allocTrieNode((&current_node->children[index]));
-            if (result != 0) {
-                return false;
-            }
-
-            current_node->children[index]->c = *p;
-            current_node->children[index]->parent = current_node;
-        }
-
-        current_node = current_node->children[index];
-        --p;
     }
 
-    if (current_node->value == NULL) {
-      current_node->value = value;
-    }
-    else {
+    if (!_trie.Insert(hostname, hostname_len, value)) {
       fprintf(stderr, "file: "__FILE__", line: %d, " \
           "Can not insert duplicate: %.*s!\n", __LINE__, hostname_len, hostname);
       return false;
@@ -306,35 +211,17 @@ bool HostnameTrie<T>::insert(const char *hostname, const int hostname_len, T *va
 }
 
 template<typename T>
-void HostnameTrie<T>::print(TrieNode * node)
+void HostnameTrie<T>::print()
 {
-    int i;
-    if (node->value != NULL) {
-        char buff[128];
-        TrieNode * temp;
-        char *p;
-
-        p = buff;
-        temp = node;
-        while (temp != NULL) {
-            *p++ = temp->c;
-            temp = temp->parent;
-        }
-        *p = '\0';
-        printf("%s\n", buff);
-    }
+    char buff[256];
 
-    for (i=0; i<VALID_CHAR_NUM; i++) {
-        if (node->children[i] != NULL) {
-            print(node->children[i]);
+    for (HostTrie::Node n = _trie.iter_first(); n != HostTrie::NO_NODE;
+        n = _trie.iter_next(n))
+    {
+        if (_trie.getKey(n, buff, sizeof(buff)) >= 0) {
+            printf("%s\n", buff);
         }
     }
-}
-
-template<typename T>
-void HostnameTrie<T>::print()
-{
-    print(&_root);
     printf("\n");
 }
 
@@ -347,59 +234,71 @@ T *HostnameTrie<T>::lookupFirst(const char *hostname, const int hostname_len,
     }
 
     state->p = (const unsigned char *)hostname + hostname_len - 1;
-    state->current_node = &_root;
+    state->current_node = HostTrie::ROOT;
+    state->more = true;
     return this->lookupNext(hostname, hostname_len, state);
 }
 
+//
+// Walks the labels from the last one. Passing the dot before a label
+// is where the suffix key (.label...) of the labels walked so far
+// matches; the end of the name is where the name itself matches.
+//
 template<typename T>
 T *HostnameTrie<T>::lookupNext(const char *hostname, const int hostname_len,
     HostnameTrie::LookupState * state)
 {
-    int index;
+    const unsigned char *start = (const unsigned char *)hostname;
+    const unsigned char *label_end;
+    HostTrie::Node dot;
 
-    if (hostname == NULL || hostname_len == 0 ||
-            state->p < (const unsigned char *)hostname) {
+    if (hostname == NULL || hostname_len == 0) {
         return NULL;
     }
 
-    while (state->p >= (const unsigned char *)hostname) {
-        index = _ascii2table[*(state->p)];
-        if (index < 0) {
-            return NULL;
+    while (state->more) {
+        label_end = state->p + 1;
+        while (state->p >= start && *(state->p) != '.') {
+            if (_ascii2table[*(state->p)] < 0) {
+                state->more = false;
+                return NULL;
+            }
+            state->p--;
         }
 
-        if (state->current_node->children[index] == NULL) {
-          return NULL;
+        state->current_node = _trie.child(state->current_node,
+            (const char *)state->p + 1, label_end - (state->p + 1));
+        if (state->current_node == HostTrie::NO_NODE) {
+            state->more = false;
+            return NULL;
         }
 
-        state->current_node = state->current_node->children[index];
-        if (state->current_node->value != NULL && *(state->p) == '.') {
-            state->p--;
-            return state->current_node->value;
+        if (state->p < start) {
+            //the end of the name
+            state->more = false;
+            if (_trie.value(state->current_node) != NULL) {
+                return (T *)_trie.value(state->current_node);
+            }
+            if (!_matchDomain) {
+                return NULL;
+            }
+            dot = _trie.child(state->current_node, "", 0);
+            return dot != HostTrie::NO_NODE ? (T *)_trie.value(dot) : NULL;
         }
 
+        //passing the dot, an empty label follows a leading one
         state->p--;
-    }
-
-    if (state->current_node->value != NULL) {
-      return state->current_node->value;
-    }
-
-    if (!_matchDomain) {
-      return NULL;
-    }
-
-    TrieNode * current_node = state->current_node->children[DOT_INDEX];
-    if (current_node == NULL) {
-      return NULL;
-    }
-
-    if (current_node->value != NULL) {
-      return current_node->value;
+        dot = _trie.child(state->current_node, "", 0);
+        if (dot != HostTrie::NO_NODE && _trie.value(dot) != NULL) {
+            if (state->p < start) {
+                //the name is the suffix key itself
+                state->more = false;
+            }
+            return (T *)_trie.value(dot);
+        }
     }
 
     return NULL;
 }
 
 #endif
-
@@ -0,0 +1,194 @@
+/** @file
+
+  Compiled index of the exact host mappings of remap.config
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "RemapHostIndex.h"
+#include "ink_align.h"
+#include "URL.h"
+#include "ts/TestBox.h"
+
+#define SLOTS_ALIGN 64  //a cache line
+
+RemapHostIndex *RemapHostIndex::compile(InkHashTable *h_table)
+{
+  InkHashTableEntry *ht_entry;
+  InkHashTableIteratorState ht_iter;
+  uint32_t nkeys = 0;
+  uint32_t keys_size = 0;
+
+  if (h_table == NULL) {
+    return NULL;
+  }
+
+  for (ht_entry = ink_hash_table_iterator_first(h_table, &ht_iter); ht_entry != NULL;
+      ht_entry = ink_hash_table_iterator_next(h_table, &ht_iter))
+  {
+    nkeys++;
+    keys_size += strlen(ink_hash_table_entry_key(h_table, ht_entry));
+  }
+  if (nkeys == 0) {
+    return NULL;
+  }
+
+  uint32_t nslots = 4;
+  while (nslots < 2 * nkeys) {
+    nslots <<= 1;
+  }
+
+  uint32_t slots_offset = INK_ALIGN(sizeof(Header), SLOTS_ALIGN);
+  uint32_t keys_offset = slots_offset + sizeof(Slot) * nslots;
+  uint32_t size = keys_offset + keys_size;
+
+  RemapHostIndex *index = new RemapHostIndex();
+  index->_image = (char *)ats_memalign(SLOTS_ALIGN, size);
+  index->_slots = (const Slot *)(index->_image + slots_offset);
+  index->_slotMask = nslots - 1;
+  index->_values = (UrlMappingPathContainer **)ats_malloc(sizeof(UrlMappingPathContainer *) * nkeys);
+
+  Header *header = (Header *)index->_image;
+  memset(header, 0, slots_offset);
+  header->size = size;
+  header->nslots = nslots;
+  header->nkeys = nkeys;
+  header->keys_offset = keys_offset;
+
+  Slot *slots = (Slot *)(index->_image + slots_offset);
+  for (uint32_t i = 0; i < nslots; i++) {
+    slots[i].hash = 0;
+    slots[i].key_offset = 0;
+    slots[i].key_len = 0;
+    slots[i].value = EMPTY_SLOT;
+  }
+
+  uint32_t value = 0;
+  uint32_t key_offset = keys_offset;
+  for (ht_entry = ink_hash_table_iterator_first(h_table, &ht_iter); ht_entry != NULL;
+      ht_entry = ink_hash_table_iterator_next(h_table, &ht_iter))
+  {
+    const char *key = ink_hash_table_entry_key(h_table, ht_entry);
+    int key_len = strlen(key);
+    uint32_t h = hash(key, key_len);
+    uint32_t i = h & index->_slotMask;
+
+    //the table has no duplicate keys and is at most half full
+    while (slots[i].value != EMPTY_SLOT) {
+      i = (i + 1) & index->_slotMask;
+    }
+
+    memcpy(index->_image + key_offset, key, key_len);
+    slots[i].hash = h;
+    slots[i].key_offset = key_offset;
+    slots[i].key_len = key_len;
+    slots[i].value = value;
+    index->_values[value++] = (UrlMappingPathContainer *)ink_hash_table_entry_value(h_table, ht_entry);
+    key_offset += key_len;
+  }
+
+  return index;
+}
+
+void RemapHostIndex::destroy(RemapHostIndex *index)
+{
+  if (index == NULL) {
+    return;
+  }
+  ats_memalign_free(index->_image);
+  ats_free(index->_values);
+  delete index;
+}
+
+UrlMappingPathContainer *RemapHostIndex::lookup(const char *key, const int key_len) const
+{
+  uint32_t h = hash(key, key_len);
+  uint32_t i = h & _slotMask;
+  const Slot *slot;
+
+  while ((slot=_slots + i)->value != EMPTY_SLOT) {
+    if (slot->hash == h && slot->key_len == (uint32_t)key_len &&
+        memcmp(_image + slot->key_offset, key, key_len) == 0)
+    {
+      return _values[slot->value];
+    }
+    i = (i + 1) & _slotMask;
+  }
+
+  return NULL;
+}
+
+#if TS_HAS_TESTS
+
+REGRESSION_TEST(RemapHostIndex)(RegressionTest *t, int atype, int *pstatus)
+{
+  NOWARN_UNUSED(atype);
+
+  const int nkeys = 150000;
+  const int nlookups = 1000000;
+  TestBox box(t, pstatus);
+  InkHashTable *h_table = ink_hash_table_create(InkHashTableKeyType_String);
+  char key[64];
+  int len;
+
+  box = REGRESSION_TEST_PASSED;
+
+  //the values are only compared, never dereferenced
+  for (intptr_t i = 0; i < nkeys; i++) {
+    snprintf(key, sizeof(key), "host%ld.example.com.80.%d", (long)i, URL_WKSIDX_HTTP);
+    ink_hash_table_insert(h_table, key, (void *)(i + 1));
+  }
+
+  RemapHostIndex *index = RemapHostIndex::compile(h_table);
+  box.check(index != NULL && index->getKeyCount() == (uint32_t)nkeys, "all %d keys compiled", nkeys);
+  if (index == NULL) {
+    ink_hash_table_destroy(h_table);
+    return;
+  }
+
+  bool found = true;
+  ink_hrtime start = ink_get_hrtime_internal();
+  for (int i = 0; i < nlookups; i++) {
+    long k = (long)(i * 7919L) % nkeys;
+    len = snprintf(key, sizeof(key), "host%ld.example.com.80.%d", k, URL_WKSIDX_HTTP);
+    if (index->lookup(key, len) != (UrlMappingPathContainer *)(k + 1)) {
+      found = false;
+    }
+  }
+  ink_hrtime elapsed = ink_get_hrtime_internal() - start;
+
+  rprintf(t, "%d lookups over %d hosts, image %u bytes: %.1f ns per lookup\n",
+      nlookups, nkeys, index->getImageSize(), (double)elapsed / (double)nlookups);
+
+  box.check(found, "every key found with its value");
+  intptr_t values_sum = 0;
+  for (uint32_t i = 0; i < index->getKeyCount(); i++) {
+    values_sum += (intptr_t)index->getValue(i);
+  }
+  box.check(values_sum == (intptr_t)nkeys * (nkeys + 1) / 2, "every value kept once");
+  len = snprintf(key, sizeof(key), "host%d.example.com.80.%d", nkeys, URL_WKSIDX_HTTP);
+  box.check(index->lookup(key, len) == NULL, "unknown key not found");
+  len = snprintf(key, sizeof(key), "host1.example.com.443.%d", URL_WKSIDX_HTTPS);
+  box.check(index->lookup(key, len) == NULL, "other port and scheme not found");
+
+  RemapHostIndex::destroy(index);
+  ink_hash_table_destroy(h_table);
+}
+
+#endif
@@ -0,0 +1,100 @@
+/** @file
+
+  Compiled index of the exact host mappings of remap.config
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef _REMAP_HOST_INDEX_H_
+#define _REMAP_HOST_INDEX_H_
+
+#include "libts.h"
+
+class UrlMappingPathContainer;
+
+//
+// RemapHostIndex
+//
+//   The exact host lookup of a mapping store. Once the store is built
+//   from remap.config, its host keys ("host.port.scheme") are copied into
+//   one allocation: a header, an open addressed slot array of hash, key
+//   offset, length and value, and the key bytes. A slot is 16 bytes, so
+//   with at most half of the slots used a lookup reads one slot line and
+//   the key, instead of walking the chained InkHashTable the store was
+//   built with. A slot's value indexes an array of the path containers
+//   in this process; once compiled, the index owns them and the hash
+//   table is dropped. Only the lookup changes: a reload still parses
+//   remap.config and builds the store, then compiles this on top.
+//
+class RemapHostIndex
+{
+  public:
+    struct Header {
+      uint32_t size;        //of the whole image
+      uint32_t nslots;      //power of 2
+      uint32_t nkeys;
+      uint32_t keys_offset;
+    };
+
+    struct Slot {
+      uint32_t hash;
+      uint32_t key_offset;  //from the start of the image
+      uint32_t key_len;
+      uint32_t value;       //index into the values, EMPTY_SLOT if free
+    };
+
+    static const uint32_t EMPTY_SLOT = 0xffffffff;
+
+    /**
+     * Compile the keys of a store's hash table
+     * @param h_table key to UrlMappingPathContainer
+     * @return the index, NULL if the table is NULL or empty
+     */
+    static RemapHostIndex *compile(InkHashTable *h_table);
+    static void destroy(RemapHostIndex *index);
+
+    static inline uint32_t hash(const char *key, const int key_len) {
+      return ATS_FNV1a32(key, key_len);
+    }
+
+    UrlMappingPathContainer *lookup(const char *key, const int key_len) const;
+
+    inline uint32_t getImageSize() const {
+      return ((const Header *)_image)->size;
+    }
+
+    inline uint32_t getKeyCount() const {
+      return ((const Header *)_image)->nkeys;
+    }
+
+    //for walking all the path containers, value < getKeyCount()
+    inline UrlMappingPathContainer *getValue(const uint32_t value) const {
+      return _values[value];
+    }
+
+  private:
+    RemapHostIndex() {}
+
+    char *_image;
+    const Slot *_slots;       //into the image
+    uint32_t _slotMask;
+    UrlMappingPathContainer **_values;
+};
+
+#endif
@@ -266,6 +266,18 @@ UrlRewrite::_destroyTable(InkHashTable *h_table)
   }
 }
 
+/** Deallocates a compiled host index and all the url_mappings in it. */
+void
+UrlRewrite::_destroyIndex(RemapHostIndex *host_index)
+{
+  if (host_index != NULL) {
+    for (uint32_t i = 0; i < host_index->getKeyCount(); i++) {
+      delete host_index->getValue(i);
+    }
+    RemapHostIndex::destroy(host_index);
+  }
+}
+
 /** Debugging Method. */
 void
 UrlRewrite::Print()
@@ -298,15 +310,9 @@ UrlRewrite::Print()
 void
 UrlRewrite::PrintStore(MappingsStore &store)
 {
-  if (store.hash_lookup != NULL) {
-    InkHashTableEntry *ht_entry;
-    InkHashTableIteratorState ht_iter;
-    UrlMappingPathContainer *value;
-
-    for (ht_entry = ink_hash_table_iterator_first(store.hash_lookup, &ht_iter); ht_entry != NULL;) {
-      value = (UrlMappingPathContainer *) ink_hash_table_entry_value(store.hash_lookup, ht_entry);
-      value->Print();
-      ht_entry = ink_hash_table_iterator_next(store.hash_lookup, &ht_iter);
+  if (store.host_index != NULL) {
+    for (uint32_t i = 0; i < store.host_index->getKeyCount(); i++) {
+      store.host_index->getValue(i)->Print();
     }
   }
 
@@ -336,15 +342,17 @@ UrlRewrite::PrintStore(MappingsStore &store)
 
 */
 url_mapping *
-UrlRewrite::_tableLookup(InkHashTable *h_table, URL *request_url,
-    char *request_host_key, UrlMappingContainer &mapping_container)
+UrlRewrite::_tableLookup(const RemapHostIndex *host_index, URL *request_url,
+    const char *request_host_key, int host_key_len, UrlMappingContainer &mapping_container)
 {
   UrlMappingPathContainer *ht_entry;
-  int ht_result;
 
-  ht_result = ink_hash_table_lookup(h_table, request_host_key, (void **) &ht_entry);
+  if (host_index == NULL) {
+    return NULL;
+  }
 
-  if (likely(ht_result && ht_entry)) {
+  ht_entry = host_index->lookup(request_host_key, host_key_len);
+  if (likely(ht_entry != NULL)) {
     // for empty host don't do a normal search, get a mapping arbitrarily
     return ht_entry->Search(request_url, mapping_container);
   }
@@ -1325,9 +1333,37 @@ UrlRewrite::BuildTable()
       forward_mappings_with_recv_port.hash_lookup);
   }
 
+  _compileStore(forward_mappings);
+  _compileStore(reverse_mappings);
+  _compileStore(permanent_redirects);
+  _compileStore(temporary_redirects);
+  _compileStore(forward_mappings_with_recv_port);
+
   return 0;
 }
 
+/**
+  Compiles the host keys of a store, once it is built, into the flat
+  index the lookups go through. The index takes over the path
+  containers and the hash table is dropped, so the keys are only held
+  once.
+
+*/
+void
+UrlRewrite::_compileStore(MappingsStore &store)
+{
+  if (store.hash_lookup == NULL) {
+    return;
+  }
+
+  store.host_index = RemapHostIndex::compile(store.hash_lookup);
+  if (store.host_index != NULL) {
+    Debug("url_rewrite", "[BuildTable] compiled %u hosts into a %u bytes index",
+        store.host_index->getKeyCount(), store.host_index->getImageSize());
+  }
+  store.hash_lookup = ink_hash_table_destroy(store.hash_lookup);
+}
+
 /**
   Inserts arg mapping in h_table with key src_host chaining the mapping
   of existing entries bound to src_host if necessary.
@@ -1542,8 +1578,8 @@ UrlRewrite::_mappingLookup(MappingsStore &mappings, URL *request_url,
 
   bool retval = false;
   int rank_ceiling = -1;
-  url_mapping *mapping = _tableLookup(mappings.hash_lookup, request_url,
-      request_host_key, mapping_container);
+  url_mapping *mapping = _tableLookup(mappings.host_index, request_url,
+      request_host_key, host_key_len, mapping_container);
   if (mapping != NULL) {
     rank_ceiling = mapping->getRank();
     Debug("url_rewrite", "Found 'simple' mapping with rank %d", rank_ceiling);
@@ -29,6 +29,7 @@
 #include "UrlMappingPathContainer.h"
 #include "MappingTypes.h"
 #include "HostnameTrie.h"
+#include "RemapHostIndex.h"
 #include "HttpTransact.h"
 
 #ifdef HAVE_PCRE_PCRE_H
@@ -90,20 +91,21 @@ public:
 
   struct MappingsStore
   {
-    InkHashTable *hash_lookup; //key format is hostname:port:scheme
+    InkHashTable *hash_lookup; //key format is hostname:port:scheme, while building
+    RemapHostIndex *host_index; //hash_lookup compiled, replaces it once built
     HostnameTrie<SuffixMappings> *suffix_trie;  //key format is hostname:port:scheme
     UrlMappingRegexList regex_list;
     int suffix_trie_min_rank;
     int regex_list_min_rank;
 
-    MappingsStore() : hash_lookup(NULL), suffix_trie(NULL),
+    MappingsStore() : hash_lookup(NULL), host_index(NULL), suffix_trie(NULL),
       suffix_trie_min_rank(-1), regex_list_min_rank(-1)
     {
     }
 
     bool empty() {
-      return ((hash_lookup == NULL) && (suffix_trie == NULL) &&
-          regex_list.empty());
+      return ((hash_lookup == NULL) && (host_index == NULL) &&
+          (suffix_trie == NULL) && regex_list.empty());
     }
   };
 
@@ -114,7 +116,10 @@ public:
 
   void DestroyStore(MappingsStore &store)
   {
+    _destroyIndex(store.host_index);
+    store.host_index = NULL;
     _destroyTable(store.hash_lookup);
+    store.hash_lookup = NULL;
     _destroyList(store.regex_list);
 
     if (store.suffix_trie != NULL) {
@@ -200,8 +205,10 @@ private:
       int request_port, const char *request_host,
       int request_host_len, UrlMappingContainer &mapping_container);
 
-  url_mapping *_tableLookup(InkHashTable * h_table, URL * request_url,
-    char *request_host_key, UrlMappingContainer &mapping_container);
+  url_mapping *_tableLookup(const RemapHostIndex *host_index, URL * request_url,
+    const char *request_host_key, int host_key_len, UrlMappingContainer &mapping_container);
+
+  void _compileStore(MappingsStore &store);
 
   bool _suffixMappingLookup(HostnameTrie<SuffixMappings> *suffix_trie,
     URL *request_url, const char *request_host, const int request_host_len,
@@ -220,6 +227,7 @@ private:
   bool _processUrlMappingFullRegex(UrlMappingRegexMatcher *reg_map);
 
   void _destroyTable(InkHashTable *h_table);
+  void _destroyIndex(RemapHostIndex *host_index);
   void _destroyList(UrlMappingRegexList &regexes);
 
   inline bool _addToStore(MappingsStore &store, url_mapping *new_mapping, char *src_host,